@@ -132,6 +132,16 @@ OBJS += src/utils/wpabuf.c
 OBJS += src/utils/os_$(CONFIG_OS).c
 OBJS += src/utils/ip_addr.c
 
+ifdef CONFIG_WORKER_THREADS
+L_CFLAGS += -DCONFIG_WORKER_THREADS
+OBJS += src/utils/worker.c
+endif
+
+ifdef CONFIG_FRAME_POOL
+L_CFLAGS += -DCONFIG_FRAME_POOL
+OBJS += src/utils/frame_pool.c
+endif
+
 OBJS += src/common/ieee802_11_common.c
 OBJS += src/common/wpa_common.c
 OBJS += src/common/hw_features_common.c
@@ -166,6 +176,9 @@ ifdef CONFIG_NO_VLAN
 L_CFLAGS += -DCONFIG_NO_VLAN
 else
 OBJS += src/ap/vlan_init.c
+ifdef CONFIG_FULL_DYNAMIC_VLAN
+OBJS += src/ap/vlan_rtnl.c
+endif
 ifdef CONFIG_VLAN_NETLINK
 ifdef CONFIG_FULL_DYNAMIC_VLAN
 OBJS += src/ap/vlan_util.c
@@ -752,6 +765,7 @@ ifdef NEED_MD5
 ifdef CONFIG_INTERNAL_MD5
 OBJS += src/crypto/md5-internal.c
 HOBJS += src/crypto/md5-internal.c
+L_CFLAGS += -DCONFIG_INTERNAL_MD5
 endif
 endif
 
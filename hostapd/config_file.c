@@ -2291,6 +2291,11 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->radius->acct_server->shared_secret_len = len;
 	} else if (os_strcmp(buf, "radius_retry_primary_interval") == 0) {
 		bss->radius->retry_primary_interval = atoi(pos);
+	} else if (os_strcmp(buf, "radius_acct_max_pending") == 0) {
+		bss->radius->acct_max_pending = atoi(pos);
+	} else if (os_strcmp(buf, "radius_acct_spool") == 0) {
+		os_free(bss->radius->acct_spool);
+		bss->radius->acct_spool = os_strdup(pos);
 	} else if (os_strcmp(buf, "radius_acct_interim_interval") == 0) {
 		bss->acct_interim_interval = atoi(pos);
 	} else if (os_strcmp(buf, "radius_request_cui") == 0) {
@@ -2361,6 +2366,26 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		bss->wpa_group_rekey = atoi(pos);
 	} else if (os_strcmp(buf, "wpa_strict_rekey") == 0) {
 		bss->wpa_strict_rekey = atoi(pos);
+	} else if (os_strcmp(buf, "wpa_group_update_window") == 0) {
+		int val = atoi(pos);
+
+		if (val < 0 || val > 3600000) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid wpa_group_update_window %d",
+				   line, val);
+			return 1;
+		}
+		bss->wpa_group_update_window = val;
+	} else if (os_strcmp(buf, "wpa_group_update_batch") == 0) {
+		int val = atoi(pos);
+
+		if (val < 1) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid wpa_group_update_batch %d",
+				   line, val);
+			return 1;
+		}
+		bss->wpa_group_update_batch = val;
 	} else if (os_strcmp(buf, "wpa_gmk_rekey") == 0) {
 		bss->wpa_gmk_rekey = atoi(pos);
 	} else if (os_strcmp(buf, "wpa_ptk_rekey") == 0) {
@@ -2375,11 +2400,11 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		os_free(bss->ssid.wpa_passphrase);
 		bss->ssid.wpa_passphrase = os_strdup(pos);
 		if (bss->ssid.wpa_passphrase) {
-			hostapd_config_clear_wpa_psk(&bss->ssid.wpa_psk);
+			hostapd_config_clear_wpa_psk(&bss->ssid);
 			bss->ssid.wpa_passphrase_set = 1;
 		}
 	} else if (os_strcmp(buf, "wpa_psk") == 0) {
-		hostapd_config_clear_wpa_psk(&bss->ssid.wpa_psk);
+		hostapd_config_clear_wpa_psk(&bss->ssid);
 		bss->ssid.wpa_psk = os_zalloc(sizeof(struct hostapd_wpa_psk));
 		if (bss->ssid.wpa_psk == NULL)
 			return 1;
@@ -2387,7 +2412,7 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 		    pos[PMK_LEN * 2] != '\0') {
 			wpa_printf(MSG_ERROR, "Line %d: Invalid PSK '%s'.",
 				   line, pos);
-			hostapd_config_clear_wpa_psk(&bss->ssid.wpa_psk);
+			hostapd_config_clear_wpa_psk(&bss->ssid);
 			return 1;
 		}
 		bss->ssid.wpa_psk->group = 1;
@@ -2712,6 +2737,25 @@ static int hostapd_config_fill(struct hostapd_config *conf,
 	} else if (os_strcmp(buf, "vlan_tagged_interface") == 0) {
 		os_free(bss->ssid.vlan_tagged_interface);
 		bss->ssid.vlan_tagged_interface = os_strdup(pos);
+	} else if (os_strcmp(buf, "vlan_preprovision") == 0) {
+		char *end;
+
+		bss->ssid.vlan_preprovision_start = strtol(pos, &end, 10);
+		if (*end == '-')
+			bss->ssid.vlan_preprovision_end = strtol(end + 1, &end,
+								 10);
+		else
+			bss->ssid.vlan_preprovision_end =
+				bss->ssid.vlan_preprovision_start;
+		if (*end != '\0' || bss->ssid.vlan_preprovision_start <= 0 ||
+		    bss->ssid.vlan_preprovision_end > MAX_VLAN_ID ||
+		    bss->ssid.vlan_preprovision_start >
+		    bss->ssid.vlan_preprovision_end) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: invalid vlan_preprovision range '%s'",
+				   line, pos);
+			return 1;
+		}
 #endif /* CONFIG_FULL_DYNAMIC_VLAN */
 #endif /* CONFIG_NO_VLAN */
 	} else if (os_strcmp(buf, "ap_table_max_size") == 0) {
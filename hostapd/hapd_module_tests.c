@@ -9,9 +9,139 @@
 #include "utils/includes.h"
 
 #include "utils/common.h"
+#include "ap/ap_config.h"
+
+
+static int hapd_wpa_psk_add(struct hostapd_ssid *ssid, const char *addr,
+			    const char *p2p_dev_addr, u8 id)
+{
+	struct hostapd_wpa_psk *psk;
+
+	psk = os_zalloc(sizeof(*psk));
+	if (!psk)
+		return -1;
+	if (addr == NULL)
+		psk->group = 1;
+	else if (hwaddr_aton(addr, psk->addr) < 0)
+		goto fail;
+	if (p2p_dev_addr && hwaddr_aton(p2p_dev_addr, psk->p2p_dev_addr) < 0)
+		goto fail;
+	os_memset(psk->psk, id, PMK_LEN);
+	psk->next = ssid->wpa_psk;
+	ssid->wpa_psk = psk;
+	return 0;
+fail:
+	os_free(psk);
+	return -1;
+}
+
+
+static int hapd_wpa_psk_module_tests(void)
+{
+	struct hostapd_bss_config conf;
+	struct hostapd_ssid *ssid = &conf.ssid;
+	u8 addr[ETH_ALEN], p2p[ETH_ALEN];
+	const u8 *psk;
+	int i, ret = -1;
+	char buf[20];
+
+	wpa_printf(MSG_INFO, "PSK index tests");
+
+	os_memset(&conf, 0, sizeof(conf));
+
+	if (hapd_wpa_psk_add(ssid, NULL, NULL, 1) < 0 ||
+	    hapd_wpa_psk_add(ssid, "02:00:00:00:00:01", NULL, 2) < 0 ||
+	    hapd_wpa_psk_add(ssid, "02:00:00:00:00:02", "02:11:00:00:00:02",
+			     3) < 0 ||
+	    hapd_wpa_psk_add(ssid, "02:00:00:00:00:01", NULL, 4) < 0)
+		goto fail;
+	for (i = 0; i < 1000; i++) {
+		os_snprintf(buf, sizeof(buf), "02:00:00:01:%02x:%02x",
+			    i >> 8, i & 0xff);
+		if (hapd_wpa_psk_add(ssid, buf, NULL, 5) < 0)
+			goto fail;
+	}
+	if (hostapd_wpa_psk_index_update(ssid) < 0 || !ssid->wpa_psk_index)
+		goto fail;
+
+	/* Two per-device PSKs followed by the group PSK */
+	hwaddr_aton("02:00:00:00:00:01", addr);
+	psk = hostapd_get_psk(&conf, addr, NULL, NULL);
+	if (!psk || psk[0] != 4)
+		goto fail;
+	psk = hostapd_get_psk(&conf, addr, NULL, psk);
+	if (!psk || psk[0] != 2)
+		goto fail;
+	psk = hostapd_get_psk(&conf, addr, NULL, psk);
+	if (!psk || psk[0] != 1 ||
+	    hostapd_get_psk(&conf, addr, NULL, psk) != NULL)
+		goto fail;
+
+	/* Unknown station gets only the group PSK */
+	hwaddr_aton("02:00:00:00:00:03", addr);
+	psk = hostapd_get_psk(&conf, addr, NULL, NULL);
+	if (!psk || psk[0] != 1 ||
+	    hostapd_get_psk(&conf, addr, NULL, psk) != NULL)
+		goto fail;
+
+	/* Matching based on P2P Device Address */
+	hwaddr_aton("02:11:00:00:00:02", p2p);
+	psk = hostapd_get_psk(&conf, addr, p2p, NULL);
+	if (!psk || psk[0] != 3)
+		goto fail;
+	psk = hostapd_get_psk(&conf, addr, p2p, psk);
+	if (!psk || psk[0] != 1)
+		goto fail;
+
+	hwaddr_aton("02:00:00:01:03:e7", addr);
+	psk = hostapd_get_psk(&conf, addr, NULL, NULL);
+	if (!psk || psk[0] != 5)
+		goto fail;
+
+	/* Group PSK listed before the per-device PSKs keeps the list order */
+	if (hapd_wpa_psk_add(ssid, NULL, NULL, 6) < 0 ||
+	    hostapd_wpa_psk_index_update(ssid) < 0)
+		goto fail;
+	hwaddr_aton("02:00:00:00:00:01", addr);
+	psk = hostapd_get_psk(&conf, addr, NULL, NULL);
+	if (!psk || psk[0] != 6)
+		goto fail;
+	psk = hostapd_get_psk(&conf, addr, NULL, psk);
+	if (!psk || psk[0] != 4)
+		goto fail;
+	psk = hostapd_get_psk(&conf, addr, NULL, psk);
+	if (!psk || psk[0] != 2)
+		goto fail;
+	psk = hostapd_get_psk(&conf, addr, NULL, psk);
+	if (!psk || psk[0] != 1 ||
+	    hostapd_get_psk(&conf, addr, NULL, psk) != NULL)
+		goto fail;
+	psk = hostapd_get_psk(&conf, addr, p2p, NULL);
+	if (!psk || psk[0] != 6)
+		goto fail;
+	psk = hostapd_get_psk(&conf, addr, p2p, psk);
+	if (!psk || psk[0] != 3)
+		goto fail;
+
+	ret = 0;
+fail:
+	hostapd_config_clear_wpa_psk(ssid);
+	if (ssid->wpa_psk_index)
+		ret = -1;
+	if (ret)
+		wpa_printf(MSG_ERROR, "PSK index module test failure");
+	return ret;
+}
+
 
 int hapd_module_tests(void)
 {
+	int ret = 0;
+
 	wpa_printf(MSG_INFO, "hostapd module tests");
-	return 0;
+
+	if (hapd_wpa_psk_module_tests() < 0)
+		ret = -1;
+
+	return ret;
 }
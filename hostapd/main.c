@@ -15,6 +15,8 @@
 #include "utils/common.h"
 #include "utils/eloop.h"
 #include "utils/uuid.h"
+#include "utils/worker.h"
+#include "utils/frame_pool.h"
 #include "crypto/random.h"
 #include "crypto/tls.h"
 #include "common/version.h"
@@ -332,6 +334,10 @@ static int hostapd_global_init(struct hapd_interfaces *interfaces,
 
 	random_init(entropy_file);
 
+	if (worker_init(0, 0) < 0)
+		wpa_printf(MSG_INFO,
+			   "Failed to start worker threads - run jobs synchronously");
+
 #ifndef CONFIG_NATIVE_WINDOWS
 	eloop_register_signal(SIGHUP, handle_reload, interfaces);
 	eloop_register_signal(SIGUSR1, handle_dump_state, interfaces);
@@ -374,6 +380,10 @@ static void hostapd_global_deinit(const char *pid_file)
 
 	random_deinit();
 
+	worker_deinit();
+	frame_pool_deinit();
+	hostapd_config_psk_cache_flush();
+
 	eloop_destroy();
 
 #ifndef CONFIG_NATIVE_WINDOWS
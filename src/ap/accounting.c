@@ -232,8 +232,13 @@ void accounting_sta_start(struct hostapd_data *hapd, struct sta_info *sta)
 		interval = sta->acct_interim_interval;
 	else
 		interval = ACCT_DEFAULT_UPDATE_INTERVAL;
-	eloop_register_timeout(interval, 0, accounting_interim_update,
-			       hapd, sta);
+	/* Spread the updates of stations that were associated at the same
+	 * time (e.g., after a restart) over the last quarter of the first
+	 * interval so that they are not all sent at once from then on. */
+	if (interval >= 4)
+		interval -= os_random() % (interval / 4);
+	eloop_register_timeout(interval, os_random() % 1000000,
+			       accounting_interim_update, hapd, sta);
 
 	msg = accounting_msg(hapd, sta, RADIUS_ACCT_STATUS_TYPE_START);
 	if (msg &&
@@ -9,6 +9,9 @@
 #include "utils/includes.h"
 
 #include "utils/common.h"
+#include "utils/list.h"
+#include "utils/worker.h"
+#include "crypto/crypto.h"
 #include "crypto/sha1.h"
 #include "radius/radius_client.h"
 #include "common/ieee802_11_defs.h"
@@ -52,6 +55,7 @@ void hostapd_config_defaults_bss(struct hostapd_bss_config *bss)
 	bss->eap_reauth_period = 3600;
 
 	bss->wpa_group_rekey = 600;
+	bss->wpa_group_update_batch = 32;
 	bss->wpa_gmk_rekey = 86400;
 	bss->wpa_key_mgmt = WPA_KEY_MGMT_PSK;
 	bss->wpa_pairwise = WPA_CIPHER_TKIP;
@@ -204,6 +208,180 @@ int hostapd_mac_comp_empty(const void *a)
 }
 
 
+/*
+ * Cache of PSKs derived from passphrases in wpa_psk_file. This is kept over
+ * configuration reloads so that only new or modified passphrases need to go
+ * through the expensive PBKDF2 operation. Entries are indexed with a hash of
+ * SSID and passphrase, so the passphrase itself is not stored.
+ */
+#define PSK_CACHE_HASH_SIZE 1024
+#define PSK_CACHE_MAX_ENTRIES 65536
+
+struct hostapd_psk_cache_entry {
+	struct dl_list list; /* psk_cache_hash[] bucket */
+	struct dl_list lru; /* psk_cache_lru, least recently used first */
+	u8 key[SHA1_MAC_LEN];
+	u8 psk[PMK_LEN];
+};
+
+static struct dl_list psk_cache_hash[PSK_CACHE_HASH_SIZE];
+static struct dl_list psk_cache_lru = DL_LIST_HEAD_INIT(psk_cache_lru);
+static unsigned int psk_cache_entries = 0;
+
+
+static void hostapd_psk_cache_key(const char *passphrase, const u8 *ssid,
+				  size_t ssid_len, u8 *key)
+{
+	const u8 *addr[3];
+	size_t len[3];
+	u8 slen = ssid_len;
+
+	addr[0] = &slen;
+	len[0] = 1;
+	addr[1] = ssid;
+	len[1] = ssid_len;
+	addr[2] = (const u8 *) passphrase;
+	len[2] = os_strlen(passphrase);
+	sha1_vector(3, addr, len, key);
+}
+
+
+static struct dl_list * hostapd_psk_cache_bucket(const u8 *key)
+{
+	unsigned int i;
+
+	if (!psk_cache_hash[0].next) {
+		for (i = 0; i < PSK_CACHE_HASH_SIZE; i++)
+			dl_list_init(&psk_cache_hash[i]);
+	}
+
+	return &psk_cache_hash[WPA_GET_BE16(key) % PSK_CACHE_HASH_SIZE];
+}
+
+
+static int hostapd_psk_cache_get(const u8 *key, u8 *psk)
+{
+	struct dl_list *bucket = hostapd_psk_cache_bucket(key);
+	struct hostapd_psk_cache_entry *e;
+
+	dl_list_for_each(e, bucket, struct hostapd_psk_cache_entry, list) {
+		if (os_memcmp(e->key, key, SHA1_MAC_LEN) == 0) {
+			os_memcpy(psk, e->psk, PMK_LEN);
+			dl_list_del(&e->lru);
+			dl_list_add_tail(&psk_cache_lru, &e->lru);
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+
+static void hostapd_psk_cache_free(struct hostapd_psk_cache_entry *e)
+{
+	dl_list_del(&e->list);
+	dl_list_del(&e->lru);
+	bin_clear_free(e, sizeof(*e));
+	psk_cache_entries--;
+}
+
+
+static void hostapd_psk_cache_add(const u8 *key, const u8 *psk)
+{
+	struct dl_list *bucket = hostapd_psk_cache_bucket(key);
+	struct hostapd_psk_cache_entry *e;
+
+	if (psk_cache_entries >= PSK_CACHE_MAX_ENTRIES) {
+		e = dl_list_first(&psk_cache_lru,
+				  struct hostapd_psk_cache_entry, lru);
+		if (e)
+			hostapd_psk_cache_free(e);
+	}
+
+	e = os_zalloc(sizeof(*e));
+	if (!e)
+		return;
+	os_memcpy(e->key, key, SHA1_MAC_LEN);
+	os_memcpy(e->psk, psk, PMK_LEN);
+	dl_list_add(bucket, &e->list);
+	dl_list_add_tail(&psk_cache_lru, &e->lru);
+	psk_cache_entries++;
+}
+
+
+/**
+ * hostapd_config_psk_cache_flush - Remove all entries from the PSK cache
+ */
+void hostapd_config_psk_cache_flush(void)
+{
+	struct hostapd_psk_cache_entry *e;
+
+	while ((e = dl_list_first(&psk_cache_lru,
+				  struct hostapd_psk_cache_entry, lru)))
+		hostapd_psk_cache_free(e);
+}
+
+
+struct hostapd_psk_derive_job {
+	struct hostapd_wpa_psk *psk;
+	char passphrase[64];
+	u8 ssid[SSID_MAX_LEN];
+	size_t ssid_len;
+	u8 key[SHA1_MAC_LEN];
+};
+
+
+static void hostapd_psk_derive(void *ctx)
+{
+	struct hostapd_psk_derive_job *job = ctx;
+
+	pbkdf2_sha1(job->passphrase, job->ssid, job->ssid_len, 4096,
+		    job->psk->psk, PMK_LEN);
+}
+
+
+static void hostapd_psk_derive_done(void *ctx, int cancelled)
+{
+	struct hostapd_psk_derive_job *job = ctx;
+
+	if (!cancelled)
+		hostapd_psk_cache_add(job->key, job->psk->psk);
+	bin_clear_free(job, sizeof(*job));
+}
+
+
+static int hostapd_config_psk_from_passphrase(struct hostapd_wpa_psk *psk,
+					      const char *passphrase,
+					      struct hostapd_ssid *ssid,
+					      unsigned int *derived)
+{
+	struct hostapd_psk_derive_job *job;
+	u8 key[SHA1_MAC_LEN];
+
+	hostapd_psk_cache_key(passphrase, ssid->ssid, ssid->ssid_len, key);
+	if (hostapd_psk_cache_get(key, psk->psk) == 0)
+		return 0;
+
+	(*derived)++;
+	job = os_zalloc(sizeof(*job));
+	if (!job)
+		return -1;
+	job->psk = psk;
+	os_strlcpy(job->passphrase, passphrase, sizeof(job->passphrase));
+	os_memcpy(job->ssid, ssid->ssid, ssid->ssid_len);
+	job->ssid_len = ssid->ssid_len;
+	os_memcpy(job->key, key, SHA1_MAC_LEN);
+	if (worker_submit(hostapd_psk_derive, hostapd_psk_derive_done,
+			  job) < 0) {
+		/* No worker threads or queue full - derive the PSK here */
+		hostapd_psk_derive(job);
+		hostapd_psk_derive_done(job, 0);
+	}
+
+	return 0;
+}
+
+
 static int hostapd_config_read_wpa_psk(const char *fname,
 				       struct hostapd_ssid *ssid)
 {
@@ -212,6 +390,7 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 	int line = 0, ret = 0, len, ok;
 	u8 addr[ETH_ALEN];
 	struct hostapd_wpa_psk *psk;
+	unsigned int entries = 0, derived = 0;
 
 	if (!fname)
 		return 0;
@@ -270,11 +449,10 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 		len = os_strlen(pos);
 		if (len == 64 && hexstr2bin(pos, psk->psk, PMK_LEN) == 0)
 			ok = 1;
-		else if (len >= 8 && len < 64) {
-			pbkdf2_sha1(pos, ssid->ssid, ssid->ssid_len,
-				    4096, psk->psk, PMK_LEN);
+		else if (len >= 8 && len < 64 &&
+			 hostapd_config_psk_from_passphrase(psk, pos, ssid,
+							    &derived) == 0)
 			ok = 1;
-		}
 		if (!ok) {
 			wpa_printf(MSG_ERROR, "Invalid PSK '%s' on line %d in "
 				   "'%s'", pos, line, fname);
@@ -285,9 +463,18 @@ static int hostapd_config_read_wpa_psk(const char *fname,
 
 		psk->next = ssid->wpa_psk;
 		ssid->wpa_psk = psk;
+		entries++;
 	}
 
 	fclose(f);
+	os_memset(buf, 0, sizeof(buf));
+
+	/* Wait for the passphrase-to-PSK derivations to complete */
+	worker_wait_func(hostapd_psk_derive);
+
+	wpa_printf(MSG_DEBUG,
+		   "Read %u PSK entries from '%s' (%u derived from passphrase, %d worker threads)",
+		   entries, fname, derived, worker_threads());
 
 	return ret;
 }
@@ -337,7 +524,109 @@ int hostapd_setup_wpa_psk(struct hostapd_bss_config *conf)
 			return -1;
 	}
 
+	return hostapd_wpa_psk_index_update(ssid);
+}
+
+
+static unsigned int hostapd_wpa_psk_hash(const u8 *addr, unsigned int mask)
+{
+	/* Mostly the NIC specific part differs, but do not ignore the OUI */
+	return (WPA_GET_BE24(&addr[3]) ^ (WPA_GET_BE24(addr) << 5)) & mask;
+}
+
+
+static void hostapd_wpa_psk_index_free(struct hostapd_wpa_psk_index *idx)
+{
+	if (!idx)
+		return;
+	os_free(idx->addr_hash);
+	os_free(idx->p2p_hash);
+	os_free(idx);
+}
+
+
+/**
+ * hostapd_wpa_psk_index_update - Rebuild PSK lookup index
+ * @ssid: SSID configuration with the PSK list
+ * Returns: 0 on success, -1 on failure
+ *
+ * This needs to be called after every change (addition or removal) to
+ * ssid->wpa_psk since the index refers to the list entries directly.
+ * The index maps station addresses (and P2P Device Addresses) to per-device
+ * PSKs and collects group PSKs to a separate list so that hostapd_get_psk()
+ * does not need to iterate over the full PSK list.
+ */
+int hostapd_wpa_psk_index_update(struct hostapd_ssid *ssid)
+{
+	struct hostapd_wpa_psk_index *idx;
+	struct hostapd_wpa_psk *psk, **entries;
+	unsigned int count = 0, size = 16, i, h;
+	int p2p = 0;
+
+	hostapd_wpa_psk_index_free(ssid->wpa_psk_index);
+	ssid->wpa_psk_index = NULL;
+
+	for (psk = ssid->wpa_psk; psk; psk = psk->next) {
+		count++;
+		if (!is_zero_ether_addr(psk->p2p_dev_addr))
+			p2p = 1;
+	}
+	if (count == 0)
+		return 0;
+	while (size < count)
+		size <<= 1;
+
+	idx = os_zalloc(sizeof(*idx));
+	entries = os_calloc(count, sizeof(*entries));
+	if (!idx || !entries)
+		goto fail;
+	idx->hash_mask = size - 1;
+	idx->addr_hash = os_calloc(size, sizeof(*idx->addr_hash));
+	if (!idx->addr_hash)
+		goto fail;
+	if (p2p) {
+		idx->p2p_hash = os_calloc(size, sizeof(*idx->p2p_hash));
+		if (!idx->p2p_hash)
+			goto fail;
+	}
+
+	/*
+	 * Insert entries in reverse order to maintain the configuration file
+	 * order within each hash bucket and in the group PSK list.
+	 */
+	for (i = 0, psk = ssid->wpa_psk; psk; psk = psk->next) {
+		psk->pos = i;
+		entries[i++] = psk;
+	}
+	while (i > 0) {
+		psk = entries[--i];
+		if (psk->group) {
+			psk->hnext = idx->group;
+			idx->group = psk;
+			continue;
+		}
+		h = hostapd_wpa_psk_hash(psk->addr, idx->hash_mask);
+		psk->hnext = idx->addr_hash[h];
+		idx->addr_hash[h] = psk;
+		if (idx->p2p_hash && !is_zero_ether_addr(psk->p2p_dev_addr)) {
+			h = hostapd_wpa_psk_hash(psk->p2p_dev_addr,
+						 idx->hash_mask);
+			psk->p2p_hnext = idx->p2p_hash[h];
+			idx->p2p_hash[h] = psk;
+		}
+	}
+
+	os_free(entries);
+	ssid->wpa_psk_index = idx;
+	wpa_printf(MSG_DEBUG, "Indexed %u PSK entries (%u hash buckets)",
+		   count, size);
 	return 0;
+
+fail:
+	os_free(entries);
+	hostapd_wpa_psk_index_free(idx);
+	wpa_printf(MSG_ERROR, "Failed to allocate PSK lookup index");
+	return -1;
 }
 
 
@@ -396,16 +685,19 @@ static void hostapd_config_free_wep(struct hostapd_wep_keys *keys)
 }
 
 
-void hostapd_config_clear_wpa_psk(struct hostapd_wpa_psk **l)
+void hostapd_config_clear_wpa_psk(struct hostapd_ssid *ssid)
 {
 	struct hostapd_wpa_psk *psk, *tmp;
 
-	for (psk = *l; psk;) {
+	hostapd_wpa_psk_index_free(ssid->wpa_psk_index);
+	ssid->wpa_psk_index = NULL;
+
+	for (psk = ssid->wpa_psk; psk;) {
 		tmp = psk;
 		psk = psk->next;
 		bin_clear_free(tmp, sizeof(*tmp));
 	}
-	*l = NULL;
+	ssid->wpa_psk = NULL;
 }
 
 
@@ -416,7 +708,7 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 	if (conf == NULL)
 		return;
 
-	hostapd_config_clear_wpa_psk(&conf->ssid.wpa_psk);
+	hostapd_config_clear_wpa_psk(&conf->ssid);
 
 	str_clear_free(conf->ssid.wpa_passphrase);
 	os_free(conf->ssid.wpa_psk_file);
@@ -443,6 +735,7 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 					   conf->radius->num_auth_servers);
 		hostapd_config_free_radius(conf->radius->acct_servers,
 					   conf->radius->num_acct_servers);
+		os_free(conf->radius->acct_spool);
 	}
 	hostapd_config_free_radius_attr(conf->radius_auth_req_attr);
 	hostapd_config_free_radius_attr(conf->radius_acct_req_attr);
@@ -666,10 +959,27 @@ const char * hostapd_get_vlan_id_ifname(struct hostapd_vlan *vlan, int vlan_id)
 }
 
 
+static struct hostapd_wpa_psk *
+hostapd_wpa_psk_next_dev(struct hostapd_wpa_psk *psk, const u8 *addr,
+			 const u8 *p2p_dev_addr)
+{
+	if (addr) {
+		while (psk && os_memcmp(psk->addr, addr, ETH_ALEN) != 0)
+			psk = psk->hnext;
+	} else {
+		while (psk && os_memcmp(psk->p2p_dev_addr, p2p_dev_addr,
+					ETH_ALEN) != 0)
+			psk = psk->p2p_hnext;
+	}
+	return psk;
+}
+
+
 const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
 			   const u8 *addr, const u8 *p2p_dev_addr,
 			   const u8 *prev_psk)
 {
+	const struct hostapd_wpa_psk_index *idx = conf->ssid.wpa_psk_index;
 	struct hostapd_wpa_psk *psk;
 	int next_ok = prev_psk == NULL;
 
@@ -684,6 +994,44 @@ const u8 * hostapd_get_psk(const struct hostapd_bss_config *conf,
 			   MAC2STR(addr), prev_psk);
 	}
 
+	if (idx) {
+		struct hostapd_wpa_psk *dev = NULL, *group = idx->group;
+
+		/*
+		 * Merge the matching per-device PSKs with the group PSKs in the
+		 * PSK list order so that the result is identical to a full
+		 * iteration of the list.
+		 */
+		if (addr)
+			dev = hostapd_wpa_psk_next_dev(
+				idx->addr_hash[hostapd_wpa_psk_hash(
+						addr, idx->hash_mask)],
+				addr, NULL);
+		else if (p2p_dev_addr && idx->p2p_hash)
+			dev = hostapd_wpa_psk_next_dev(
+				idx->p2p_hash[hostapd_wpa_psk_hash(
+						p2p_dev_addr, idx->hash_mask)],
+				NULL, p2p_dev_addr);
+
+		while (dev || group) {
+			if (dev && (!group || dev->pos < group->pos)) {
+				psk = dev;
+				dev = hostapd_wpa_psk_next_dev(
+					addr ? dev->hnext : dev->p2p_hnext,
+					addr, p2p_dev_addr);
+			} else {
+				psk = group;
+				group = group->hnext;
+			}
+			if (next_ok)
+				return psk->psk;
+			if (psk->psk == prev_psk)
+				next_ok = 1;
+		}
+
+		return NULL;
+	}
+
 	for (psk = conf->ssid.wpa_psk; psk != NULL; psk = psk->next) {
 		if (next_ok &&
 		    (psk->group ||
@@ -89,6 +89,7 @@ struct hostapd_ssid {
 	secpolicy security_policy;
 
 	struct hostapd_wpa_psk *wpa_psk;
+	struct hostapd_wpa_psk_index *wpa_psk_index;
 	char *wpa_passphrase;
 	char *wpa_psk_file;
 
@@ -104,6 +105,8 @@ struct hostapd_ssid {
 	int vlan_naming;
 #ifdef CONFIG_FULL_DYNAMIC_VLAN
 	char *vlan_tagged_interface;
+	int vlan_preprovision_start;
+	int vlan_preprovision_end;
 #endif /* CONFIG_FULL_DYNAMIC_VLAN */
 };
 
@@ -131,12 +134,27 @@ struct hostapd_sta_wpa_psk_short {
 
 struct hostapd_wpa_psk {
 	struct hostapd_wpa_psk *next;
+	struct hostapd_wpa_psk *hnext; /* hash bucket or group PSK list */
+	struct hostapd_wpa_psk *p2p_hnext; /* P2P Device Address hash bucket */
+	unsigned int pos; /* position in the PSK list when indexed */
 	int group;
 	u8 psk[PMK_LEN];
 	u8 addr[ETH_ALEN];
 	u8 p2p_dev_addr[ETH_ALEN];
 };
 
+/*
+ * Lookup index for struct hostapd_ssid::wpa_psk. The PSK list itself remains
+ * the authoritative configuration; this index is rebuilt with
+ * hostapd_wpa_psk_index_update() whenever the list changes.
+ */
+struct hostapd_wpa_psk_index {
+	struct hostapd_wpa_psk **addr_hash;
+	struct hostapd_wpa_psk **p2p_hash;
+	unsigned int hash_mask;
+	struct hostapd_wpa_psk *group; /* group PSKs linked with hnext */
+};
+
 struct hostapd_eap_user {
 	struct hostapd_eap_user *next;
 	u8 *identity;
@@ -300,6 +318,8 @@ struct hostapd_bss_config {
 	int wpa_group;
 	int wpa_group_rekey;
 	int wpa_strict_rekey;
+	int wpa_group_update_window;
+	int wpa_group_update_batch;
 	int wpa_gmk_rekey;
 	int wpa_ptk_rekey;
 	int rsn_pairwise;
@@ -661,7 +681,9 @@ int hostapd_mac_comp_empty(const void *a);
 struct hostapd_config * hostapd_config_defaults(void);
 void hostapd_config_defaults_bss(struct hostapd_bss_config *bss);
 void hostapd_config_free_eap_user(struct hostapd_eap_user *user);
-void hostapd_config_clear_wpa_psk(struct hostapd_wpa_psk **p);
+void hostapd_config_clear_wpa_psk(struct hostapd_ssid *ssid);
+int hostapd_wpa_psk_index_update(struct hostapd_ssid *ssid);
+void hostapd_config_psk_cache_flush(void);
 void hostapd_config_free_bss(struct hostapd_bss_config *conf);
 void hostapd_config_free(struct hostapd_config *conf);
 int hostapd_maclist_found(struct mac_acl_entry *list, int num_entries,
@@ -13,6 +13,7 @@
 #ifndef CONFIG_NATIVE_WINDOWS
 
 #include "utils/common.h"
+#include "utils/frame_pool.h"
 #include "common/ieee802_11_defs.h"
 #include "common/ieee802_11_common.h"
 #include "common/hw_features_common.h"
@@ -387,7 +388,14 @@ static u8 * hostapd_gen_probe_resp(struct hostapd_data *hapd,
 		buflen += 5 + 2 + sizeof(struct ieee80211_vht_capabilities) +
 			2 + sizeof(struct ieee80211_vht_operation);
 	}
-	resp = os_zalloc(buflen);
+	/*
+	 * Responses to Probe Request frames are freed right after sending
+	 * them, so they can use a buffer from the frame pool.
+	 */
+	if (req)
+		resp = frame_pool_alloc(buflen);
+	else
+		resp = os_zalloc(buflen);
 	if (resp == NULL)
 		return NULL;
 
@@ -740,7 +748,7 @@ void handle_probe_req(struct hostapd_data *hapd,
 	if (hostapd_drv_send_mlme(hapd, resp, resp_len, noack) < 0)
 		wpa_printf(MSG_INFO, "handle_probe_req: send failed");
 
-	os_free(resp);
+	frame_pool_free(resp);
 
 	wpa_printf(MSG_EXCESSIVE, "STA " MACSTR " sent probe request for %s "
 		   "SSID", MAC2STR(mgmt->sa),
@@ -146,14 +146,8 @@ static void handle_dhcp(void *ctx, const u8 *src_addr, const u8 *buf,
 		sta->ipaddr = b->your_ip;
 	}
 
-	if (hapd->conf->disable_dgaf && is_broadcast_ether_addr(buf)) {
-		for (sta = hapd->sta_list; sta; sta = sta->next) {
-			if (!(sta->flags & WLAN_STA_AUTHORIZED))
-				continue;
-			x_snoop_mcast_to_ucast_convert_send(hapd, sta,
-							    (u8 *) buf, len);
-		}
-	}
+	if (hapd->conf->disable_dgaf && is_broadcast_ether_addr(buf))
+		x_snoop_mcast_to_ucast_convert_send_all(hapd, (u8 *) buf, len);
 }
 
 
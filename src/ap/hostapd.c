@@ -83,7 +83,7 @@ static void hostapd_reload_bss(struct hostapd_data *hapd)
 		 * Force PSK to be derived again since SSID or passphrase may
 		 * have changed.
 		 */
-		hostapd_config_clear_wpa_psk(&hapd->conf->ssid.wpa_psk);
+		hostapd_config_clear_wpa_psk(&hapd->conf->ssid);
 	}
 	if (hostapd_setup_wpa_psk(hapd->conf)) {
 		wpa_printf(MSG_ERROR, "Failed to re-configure WPA PSK "
@@ -261,6 +261,7 @@ static void hostapd_free_hapd_data(struct hostapd_data *hapd)
 {
 	os_free(hapd->probereq_cb);
 	hapd->probereq_cb = NULL;
+	sae_pwe_cache_flush(hapd);
 
 #ifdef CONFIG_P2P
 	wpabuf_free(hapd->p2p_beacon_ie);
@@ -252,6 +252,7 @@ struct hostapd_data {
 #ifdef CONFIG_PROXYARP
 	struct l2_packet_data *sock_dhcp;
 	struct l2_packet_data *sock_ndisc;
+	struct x_snoop_recent *x_snoop_recent;
 #endif /* CONFIG_PROXYARP */
 #ifdef CONFIG_MESH
 	int num_plinks;
@@ -269,6 +270,11 @@ struct hostapd_data {
 	/** Key used for generating SAE anti-clogging tokens */
 	u8 sae_token_key[8];
 	struct os_reltime last_sae_token_key_update;
+	/** Recently derived PWEs for SAE retries (most recently used first) */
+	struct sae_pwe_cache_entry *sae_pwe_cache;
+	unsigned int sae_pwe_cache_len;
+	/** Number of PWE derivations in progress in worker threads */
+	unsigned int sae_pwe_pending;
 #endif /* CONFIG_SAE */
 
 #ifdef CONFIG_TESTING_OPTIONS
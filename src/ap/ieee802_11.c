@@ -12,6 +12,8 @@
 
 #include "utils/common.h"
 #include "utils/eloop.h"
+#include "utils/frame_pool.h"
+#include "utils/worker.h"
 #include "crypto/crypto.h"
 #include "crypto/sha256.h"
 #include "crypto/random.h"
@@ -257,7 +259,7 @@ static void send_auth_reply(struct hostapd_data *hapd,
 	size_t rlen;
 
 	rlen = IEEE80211_HDRLEN + sizeof(reply->u.auth) + ies_len;
-	buf = os_zalloc(rlen);
+	buf = frame_pool_alloc(rlen);
 	if (buf == NULL)
 		return;
 
@@ -282,7 +284,7 @@ static void send_auth_reply(struct hostapd_data *hapd,
 	if (hostapd_drv_send_mlme(hapd, reply, rlen, 0) < 0)
 		wpa_printf(MSG_INFO, "send_auth_reply: send");
 
-	os_free(buf);
+	frame_pool_free(buf);
 }
 
 
@@ -317,6 +319,134 @@ static void handle_auth_ft_finish(void *ctx, const u8 *dst, const u8 *bssid,
 #define dot11RSNASAERetransPeriod 40	/* msec */
 #define dot11RSNASAESync 5		/* attempts */
 
+#define SAE_PWE_CACHE_SIZE 32
+#define SAE_MAX_PENDING_PWE 32
+
+/*
+ * PWE only depends on the password, the group, and the MAC addresses, so it
+ * can be reused when a station retries SAE authentication. This avoids
+ * repeating the expensive hunting-and-pecking loop, e.g., after an
+ * anti-clogging token exchange or when a station reconnects.
+ */
+struct sae_pwe_cache_entry {
+	struct sae_pwe_cache_entry *next;
+	u8 addr[ETH_ALEN];
+	int group;
+	u8 *password;
+	size_t password_len;
+	struct wpabuf *pwe;
+};
+
+
+static void sae_pwe_cache_entry_free(struct sae_pwe_cache_entry *e)
+{
+	bin_clear_free(e->password, e->password_len);
+	wpabuf_clear_free(e->pwe);
+	os_free(e);
+}
+
+
+void sae_pwe_cache_flush(struct hostapd_data *hapd)
+{
+	struct sae_pwe_cache_entry *e, *prev;
+
+	e = hapd->sae_pwe_cache;
+	hapd->sae_pwe_cache = NULL;
+	hapd->sae_pwe_cache_len = 0;
+	while (e) {
+		prev = e;
+		e = e->next;
+		sae_pwe_cache_entry_free(prev);
+	}
+}
+
+
+static int sae_pwe_cache_get(struct hostapd_data *hapd, struct sta_info *sta)
+{
+	struct sae_pwe_cache_entry *e, *prev = NULL;
+	const char *password = hapd->conf->ssid.wpa_passphrase;
+
+	for (e = hapd->sae_pwe_cache; e; prev = e, e = e->next) {
+		if (os_memcmp(e->addr, sta->addr, ETH_ALEN) == 0 &&
+		    e->group == sta->sae->group)
+			break;
+	}
+	if (!e || !password || e->password_len != os_strlen(password) ||
+	    os_memcmp(e->password, password, e->password_len) != 0 ||
+	    sae_import_pwe(sta->sae, wpabuf_head(e->pwe),
+			   wpabuf_len(e->pwe)) < 0)
+		return -1;
+
+	if (prev) {
+		/* Move to the front to maintain LRU order */
+		prev->next = e->next;
+		e->next = hapd->sae_pwe_cache;
+		hapd->sae_pwe_cache = e;
+	}
+	wpa_printf(MSG_DEBUG, "SAE: Use cached PWE for " MACSTR " (group %d)",
+		   MAC2STR(sta->addr), e->group);
+	return 0;
+}
+
+
+/* Takes ownership of pwe */
+static void sae_pwe_cache_add(struct hostapd_data *hapd, const u8 *addr,
+			      int group, struct wpabuf *pwe)
+{
+	struct sae_pwe_cache_entry *e, *prev = NULL;
+	const char *password = hapd->conf->ssid.wpa_passphrase;
+
+	if (!pwe || !password) {
+		wpabuf_clear_free(pwe);
+		return;
+	}
+
+	for (e = hapd->sae_pwe_cache; e; prev = e, e = e->next) {
+		if (os_memcmp(e->addr, addr, ETH_ALEN) == 0 &&
+		    e->group == group) {
+			if (prev)
+				prev->next = e->next;
+			else
+				hapd->sae_pwe_cache = e->next;
+			hapd->sae_pwe_cache_len--;
+			sae_pwe_cache_entry_free(e);
+			break;
+		}
+	}
+
+	e = os_zalloc(sizeof(*e));
+	if (!e) {
+		wpabuf_clear_free(pwe);
+		return;
+	}
+	e->password_len = os_strlen(password);
+	e->password = os_malloc(e->password_len);
+	if (!e->password) {
+		os_free(e);
+		wpabuf_clear_free(pwe);
+		return;
+	}
+	os_memcpy(e->password, password, e->password_len);
+	os_memcpy(e->addr, addr, ETH_ALEN);
+	e->group = group;
+	e->pwe = pwe;
+	e->next = hapd->sae_pwe_cache;
+	hapd->sae_pwe_cache = e;
+	hapd->sae_pwe_cache_len++;
+
+	if (hapd->sae_pwe_cache_len > SAE_PWE_CACHE_SIZE) {
+		/* Remove the least recently used entry */
+		for (prev = e; prev->next && prev->next->next;
+		     prev = prev->next)
+			;
+		if (prev->next) {
+			sae_pwe_cache_entry_free(prev->next);
+			prev->next = NULL;
+			hapd->sae_pwe_cache_len--;
+		}
+	}
+}
+
 
 static struct wpabuf * auth_build_sae_commit(struct hostapd_data *hapd,
 					     struct sta_info *sta, int update)
@@ -328,13 +458,21 @@ static struct wpabuf * auth_build_sae_commit(struct hostapd_data *hapd,
 		return NULL;
 	}
 
-	if (update &&
-	    sae_prepare_commit(hapd->own_addr, sta->addr,
-			       (u8 *) hapd->conf->ssid.wpa_passphrase,
-			       os_strlen(hapd->conf->ssid.wpa_passphrase),
-			       sta->sae) < 0) {
-		wpa_printf(MSG_DEBUG, "SAE: Could not pick PWE");
-		return NULL;
+	if (update && sae_pwe_cache_get(hapd, sta) == 0) {
+		if (sae_prepare_commit_pwe(sta->sae) < 0) {
+			wpa_printf(MSG_DEBUG, "SAE: Could not derive commit");
+			return NULL;
+		}
+	} else if (update) {
+		if (sae_prepare_commit(hapd->own_addr, sta->addr,
+				       (u8 *) hapd->conf->ssid.wpa_passphrase,
+				       os_strlen(hapd->conf->ssid.wpa_passphrase),
+				       sta->sae) < 0) {
+			wpa_printf(MSG_DEBUG, "SAE: Could not pick PWE");
+			return NULL;
+		}
+		sae_pwe_cache_add(hapd, sta->addr, sta->sae->group,
+				  sae_export_pwe(sta->sae));
 	}
 
 	buf = wpabuf_alloc(SAE_COMMIT_MAX_LEN);
@@ -414,7 +552,7 @@ static int use_sae_anti_clogging(struct hostapd_data *hapd)
 		if (!sta->sae)
 			continue;
 		if (sta->sae->state != SAE_COMMITTED &&
-		    sta->sae->state != SAE_CONFIRMED)
+		    sta->sae->state != SAE_CONFIRMED && !sta->sae_pwe_job)
 			continue;
 		open++;
 		if (open >= hapd->conf->sae_anti_clogging_threshold)
@@ -690,6 +828,135 @@ static int sae_sm_step(struct hostapd_data *hapd, struct sta_info *sta,
 }
 
 
+/*
+ * PWE derivation for a new SAE authentication is run in a worker thread if
+ * worker threads are available. The job uses its own struct sae_data instance
+ * and the result is delivered through the PWE cache once the job completes.
+ * Authentication frames from the station are dropped while the derivation is
+ * in progress.
+ */
+struct sae_pwe_job {
+	struct hostapd_data *hapd;
+	struct sta_info *sta; /* NULL if the station was removed */
+	u8 own_addr[ETH_ALEN];
+	u8 addr[ETH_ALEN];
+	u8 bssid[ETH_ALEN];
+	u8 *password;
+	size_t password_len;
+	struct sae_data sae;
+	int res;
+};
+
+
+static void sae_pwe_job_free(struct sae_pwe_job *job)
+{
+	sae_clear_data(&job->sae);
+	bin_clear_free(job->password, job->password_len);
+	os_free(job);
+}
+
+
+static void sae_pwe_job_run(void *ctx)
+{
+	struct sae_pwe_job *job = ctx;
+
+	job->res = sae_derive_pwe(job->own_addr, job->addr, job->password,
+				  job->password_len, &job->sae);
+}
+
+
+static void sae_pwe_job_done(void *ctx, int cancelled)
+{
+	struct sae_pwe_job *job = ctx;
+	struct hostapd_data *hapd = job->hapd;
+	struct sta_info *sta = job->sta;
+	u16 resp;
+
+	if (!sta) {
+		sae_pwe_job_free(job);
+		return;
+	}
+
+	sta->sae_pwe_job = NULL;
+	hapd->sae_pwe_pending--;
+	if (cancelled || job->res < 0 || !sta->sae ||
+	    sta->sae->group != job->sae.group) {
+		wpa_printf(MSG_DEBUG, "SAE: PWE derivation for " MACSTR
+			   " failed", MAC2STR(sta->addr));
+		sae_pwe_job_free(job);
+		return;
+	}
+
+	sae_pwe_cache_add(hapd, sta->addr, job->sae.group,
+			  sae_export_pwe(&job->sae));
+	resp = sae_sm_step(hapd, sta, job->bssid, 1);
+	if (resp != WLAN_STATUS_SUCCESS)
+		send_auth_reply(hapd, job->addr, job->bssid, WLAN_AUTH_SAE, 1,
+				resp, (u8 *) "", 0);
+	sae_pwe_job_free(job);
+}
+
+
+/*
+ * Returns 0 if the Commit message will be processed once PWE has been derived
+ * in a worker thread or -1 if it is to be processed synchronously.
+ */
+static int sae_start_pwe_derivation(struct hostapd_data *hapd,
+				    struct sta_info *sta, const u8 *bssid)
+{
+	const char *password = hapd->conf->ssid.wpa_passphrase;
+	struct sae_pwe_job *job;
+
+	if (worker_threads() == 0 || !password ||
+	    sta->sae->state != SAE_NOTHING || sae_pwe_cache_get(hapd, sta) == 0)
+		return -1;
+
+	job = os_zalloc(sizeof(*job));
+	if (!job)
+		return -1;
+	job->hapd = hapd;
+	job->sta = sta;
+	os_memcpy(job->own_addr, hapd->own_addr, ETH_ALEN);
+	os_memcpy(job->addr, sta->addr, ETH_ALEN);
+	os_memcpy(job->bssid, bssid, ETH_ALEN);
+	job->password_len = os_strlen(password);
+	job->password = os_malloc(job->password_len);
+	if (!job->password || sae_set_group(&job->sae, sta->sae->group) < 0) {
+		sae_pwe_job_free(job);
+		return -1;
+	}
+	os_memcpy(job->password, password, job->password_len);
+
+	sta->sae_pwe_job = job;
+	hapd->sae_pwe_pending++;
+	if (worker_submit(sae_pwe_job_run, sae_pwe_job_done, job) < 0) {
+		sta->sae_pwe_job = NULL;
+		hapd->sae_pwe_pending--;
+		sae_pwe_job_free(job);
+		return -1;
+	}
+
+	wpa_printf(MSG_DEBUG, "SAE: Deriving PWE for " MACSTR
+		   " in a worker (%u pending)",
+		   MAC2STR(sta->addr), hapd->sae_pwe_pending);
+	return 0;
+}
+
+
+void sae_cancel_pwe_derivation(struct hostapd_data *hapd,
+			       struct sta_info *sta)
+{
+	struct sae_pwe_job *job = sta->sae_pwe_job;
+
+	if (!job)
+		return;
+	sta->sae_pwe_job = NULL;
+	hapd->sae_pwe_pending--;
+	job->sta = NULL;
+	worker_cancel(job);
+}
+
+
 static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 			    const struct ieee80211_mgmt *mgmt, size_t len,
 			    u16 auth_transaction, u16 status_code)
@@ -697,6 +964,13 @@ static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 	u16 resp = WLAN_STATUS_SUCCESS;
 	struct wpabuf *data = NULL;
 
+	if (sta->sae_pwe_job) {
+		wpa_printf(MSG_DEBUG, "SAE: Drop Authentication frame from "
+			   MACSTR " while PWE derivation is pending",
+			   MAC2STR(sta->addr));
+		return;
+	}
+
 	if (!sta->sae) {
 		if (auth_transaction != 1 || status_code != WLAN_STATUS_SUCCESS)
 			return;
@@ -799,6 +1073,18 @@ static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 			goto reply;
 		}
 
+		if (sta->sae->state == SAE_NOTHING &&
+		    hapd->sae_pwe_pending >= SAE_MAX_PENDING_PWE) {
+			/* The station will retransmit its Commit message */
+			wpa_printf(MSG_DEBUG,
+				   "SAE: Too many pending PWE derivations - drop commit message from "
+				   MACSTR, MAC2STR(sta->addr));
+			return;
+		}
+
+		if (sae_start_pwe_derivation(hapd, sta, mgmt->bssid) == 0)
+			return;
+
 		resp = sae_sm_step(hapd, sta, mgmt->bssid, auth_transaction);
 	} else if (auth_transaction == 2) {
 		hostapd_logger(hapd, sta->addr, HOSTAPD_MODULE_IEEE80211,
@@ -1575,11 +1861,14 @@ static void send_assoc_resp(struct hostapd_data *hapd, struct sta_info *sta,
 			    size_t ies_len)
 {
 	int send_len;
-	u8 buf[sizeof(struct ieee80211_mgmt) + 1024];
+	size_t buflen = sizeof(struct ieee80211_mgmt) + 1024;
+	u8 *buf;
 	struct ieee80211_mgmt *reply;
 	u8 *p;
 
-	os_memset(buf, 0, sizeof(buf));
+	buf = frame_pool_alloc(buflen);
+	if (buf == NULL)
+		return;
 	reply = (struct ieee80211_mgmt *) buf;
 	reply->frame_control =
 		IEEE80211_FC(WLAN_FC_TYPE_MGMT,
@@ -1605,7 +1894,7 @@ static void send_assoc_resp(struct hostapd_data *hapd, struct sta_info *sta,
 		/* IEEE 802.11r: Mobility Domain Information, Fast BSS
 		 * Transition Information, RSN, [RIC Response] */
 		p = wpa_sm_write_assoc_resp_ies(sta->wpa_sm, p,
-						buf + sizeof(buf) - p,
+						buf + buflen - p,
 						sta->auth_alg, ies, ies_len);
 	}
 #endif /* CONFIG_IEEE80211R */
@@ -1695,6 +1984,8 @@ static void send_assoc_resp(struct hostapd_data *hapd, struct sta_info *sta,
 	if (hostapd_drv_send_mlme(hapd, reply, send_len, 0) < 0)
 		wpa_printf(MSG_INFO, "Failed to send assoc resp: %s",
 			   strerror(errno));
+
+	frame_pool_free(buf);
 }
 
 
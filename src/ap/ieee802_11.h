@@ -97,11 +97,23 @@ int auth_sae_init_committed(struct hostapd_data *hapd, struct sta_info *sta);
 #ifdef CONFIG_SAE
 void sae_clear_retransmit_timer(struct hostapd_data *hapd,
 				struct sta_info *sta);
+void sae_cancel_pwe_derivation(struct hostapd_data *hapd,
+			       struct sta_info *sta);
+void sae_pwe_cache_flush(struct hostapd_data *hapd);
 #else /* CONFIG_SAE */
 static inline void sae_clear_retransmit_timer(struct hostapd_data *hapd,
 					      struct sta_info *sta)
 {
 }
+
+static inline void sae_cancel_pwe_derivation(struct hostapd_data *hapd,
+					     struct sta_info *sta)
+{
+}
+
+static inline void sae_pwe_cache_flush(struct hostapd_data *hapd)
+{
+}
 #endif /* CONFIG_SAE */
 
 #endif /* IEEE802_11_H */
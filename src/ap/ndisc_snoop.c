@@ -83,13 +83,7 @@ static int sta_has_ip6addr(struct sta_info *sta, struct in6_addr *addr)
 
 static void ucast_to_stas(struct hostapd_data *hapd, const u8 *buf, size_t len)
 {
-	struct sta_info *sta;
-
-	for (sta = hapd->sta_list; sta; sta = sta->next) {
-		if (!(sta->flags & WLAN_STA_AUTHORIZED))
-			continue;
-		x_snoop_mcast_to_ucast_convert_send(hapd, sta, (u8 *) buf, len);
-	}
+	x_snoop_mcast_to_ucast_convert_send_all(hapd, (u8 *) buf, len);
 }
 
 
@@ -161,6 +161,7 @@ struct sta_info {
 
 #ifdef CONFIG_SAE
 	struct sae_data *sae;
+	struct sae_pwe_job *sae_pwe_job; /* PWE derivation in a worker */
 #endif /* CONFIG_SAE */
 
 	u32 session_timeout; /* valid only if session_timeout_set == 1 */
@@ -11,10 +11,6 @@
 #include "utils/includes.h"
 #ifdef CONFIG_FULL_DYNAMIC_VLAN
 #include <net/if.h>
-#include <sys/ioctl.h>
-#include <linux/sockios.h>
-#include <linux/if_vlan.h>
-#include <linux/if_bridge.h>
 #endif /* CONFIG_FULL_DYNAMIC_VLAN */
 
 #include "utils/common.h"
@@ -29,16 +25,21 @@
 
 #include "drivers/priv_netlink.h"
 #include "utils/eloop.h"
+#include "vlan_rtnl.h"
 
 
 struct full_dynamic_vlan {
 	int s; /* socket on which to listen for new/removed interfaces. */
+	u8 *provisioned; /* DVLAN_PROV_* flags for the pre-provisioned VIDs */
 };
 
 #define DVLAN_CLEAN_BR         0x1
 #define DVLAN_CLEAN_VLAN       0x2
 #define DVLAN_CLEAN_VLAN_PORT  0x4
 
+#define DVLAN_PROV_BR          0x1
+#define DVLAN_PROV_VLAN        0x2
+
 struct dynamic_iface {
 	char ifname[IFNAMSIZ + 1];
 	int usage;
@@ -46,6 +47,10 @@ struct dynamic_iface {
 	struct dynamic_iface *next;
 };
 
+/* rtnetlink socket shared by all BSSes for configuring interfaces */
+static struct vlan_rtnl *rtnl;
+static int rtnl_users;
+
 
 /* Increment ref counter for ifname and add clean flag.
  * If not in list, add it only if some flags are given.
@@ -120,42 +125,34 @@ static int dyn_iface_put(struct hostapd_data *hapd, const char *ifname)
 }
 
 
-static int ifconfig_helper(const char *if_name, int up)
+/* Commit the pending requests and return the result of the given one */
+static int rtnl_exec(int req)
 {
-	int fd;
-	struct ifreq ifr;
+	int res;
 
-	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: socket(AF_INET,SOCK_STREAM) "
-			   "failed: %s", __func__, strerror(errno));
+	if (req < 0 || vlan_rtnl_commit(rtnl) < 0)
+		return -1;
+	res = vlan_rtnl_result(rtnl, req);
+	if (res) {
+		errno = res;
 		return -1;
 	}
+	return 0;
+}
 
-	os_memset(&ifr, 0, sizeof(ifr));
-	os_strlcpy(ifr.ifr_name, if_name, IFNAMSIZ);
 
-	if (ioctl(fd, SIOCGIFFLAGS, &ifr) != 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: ioctl(SIOCGIFFLAGS) failed "
-			   "for interface %s: %s",
-			   __func__, if_name, strerror(errno));
-		close(fd);
+static int ifconfig_helper(const char *if_name, int up)
+{
+	if (!rtnl)
 		return -1;
-	}
-
-	if (up)
-		ifr.ifr_flags |= IFF_UP;
-	else
-		ifr.ifr_flags &= ~IFF_UP;
 
-	if (ioctl(fd, SIOCSIFFLAGS, &ifr) != 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: ioctl(SIOCSIFFLAGS) failed "
+	if (rtnl_exec(vlan_rtnl_set_up(rtnl, if_name, up)) < 0) {
+		wpa_printf(MSG_ERROR, "VLAN: %s: RTM_SETLINK failed "
 			   "for interface %s (up=%d): %s",
 			   __func__, if_name, up, strerror(errno));
-		close(fd);
 		return -1;
 	}
 
-	close(fd);
 	return 0;
 }
 
@@ -174,59 +171,27 @@ static int ifconfig_down(const char *if_name)
 }
 
 
-/*
- * These are only available in recent linux headers (without the leading
- * underscore).
- */
-#define _GET_VLAN_REALDEV_NAME_CMD	8
-#define _GET_VLAN_VID_CMD		9
-
-/* This value should be 256 ONLY. If it is something else, then hostapd
- * might crash!, as this value has been hard-coded in 2.4.x kernel
- * bridging code.
- */
-#define MAX_BR_PORTS      		256
-
 static int br_delif(const char *br_name, const char *if_name)
 {
-	int fd;
-	struct ifreq ifr;
-	unsigned long args[2];
-	int if_index;
+	int br_index;
 
 	wpa_printf(MSG_DEBUG, "VLAN: br_delif(%s, %s)", br_name, if_name);
-	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: socket(AF_INET,SOCK_STREAM) "
-			   "failed: %s", __func__, strerror(errno));
-		return -1;
-	}
-
-	if_index = if_nametoindex(if_name);
-
-	if (if_index == 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: Failure determining "
-			   "interface index for '%s'",
-			   __func__, if_name);
-		close(fd);
+	if (!rtnl)
 		return -1;
-	}
-
-	args[0] = BRCTL_DEL_IF;
-	args[1] = if_index;
 
-	os_strlcpy(ifr.ifr_name, br_name, sizeof(ifr.ifr_name));
-	ifr.ifr_data = (__caddr_t) args;
+	/* No error if interface already removed. */
+	br_index = if_nametoindex(br_name);
+	if (br_index == 0 || vlan_rtnl_get_master(rtnl, if_name) != br_index)
+		return 0;
 
-	if (ioctl(fd, SIOCDEVPRIVATE, &ifr) < 0 && errno != EINVAL) {
-		/* No error if interface already removed. */
-		wpa_printf(MSG_ERROR, "VLAN: %s: ioctl[SIOCDEVPRIVATE,"
-			   "BRCTL_DEL_IF] failed for br_name=%s if_name=%s: "
-			   "%s", __func__, br_name, if_name, strerror(errno));
-		close(fd);
+	if (rtnl_exec(vlan_rtnl_set_master(rtnl, if_name, NULL)) < 0 &&
+	    errno != ENODEV) {
+		wpa_printf(MSG_ERROR, "VLAN: %s: RTM_SETLINK failed for "
+			   "br_name=%s if_name=%s: %s",
+			   __func__, br_name, if_name, strerror(errno));
 		return -1;
 	}
 
-	close(fd);
 	return 0;
 }
 
@@ -240,77 +205,51 @@ static int br_delif(const char *br_name, const char *if_name)
 */
 static int br_addif(const char *br_name, const char *if_name)
 {
-	int fd;
-	struct ifreq ifr;
-	unsigned long args[2];
-	int if_index;
+	int br_index, master;
 
 	wpa_printf(MSG_DEBUG, "VLAN: br_addif(%s, %s)", br_name, if_name);
-	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: socket(AF_INET,SOCK_STREAM) "
-			   "failed: %s", __func__, strerror(errno));
+	if (!rtnl)
 		return -1;
-	}
-
-	if_index = if_nametoindex(if_name);
 
-	if (if_index == 0) {
+	br_index = if_nametoindex(br_name);
+	master = vlan_rtnl_get_master(rtnl, if_name);
+	if (br_index == 0 || master < 0) {
 		wpa_printf(MSG_ERROR, "VLAN: %s: Failure determining "
-			   "interface index for '%s'",
-			   __func__, if_name);
-		close(fd);
+			   "interface index for '%s' or '%s'",
+			   __func__, br_name, if_name);
 		return -1;
 	}
 
-	args[0] = BRCTL_ADD_IF;
-	args[1] = if_index;
-
-	os_strlcpy(ifr.ifr_name, br_name, sizeof(ifr.ifr_name));
-	ifr.ifr_data = (__caddr_t) args;
-
-	if (ioctl(fd, SIOCDEVPRIVATE, &ifr) < 0) {
-		if (errno == EBUSY) {
-			/* The interface is already added. */
-			close(fd);
-			return 1;
-		}
+	if (master == br_index) {
+		/* The interface is already added. */
+		return 1;
+	}
 
-		wpa_printf(MSG_ERROR, "VLAN: %s: ioctl[SIOCDEVPRIVATE,"
-			   "BRCTL_ADD_IF] failed for br_name=%s if_name=%s: "
-			   "%s", __func__, br_name, if_name, strerror(errno));
-		close(fd);
+	if (rtnl_exec(vlan_rtnl_set_master(rtnl, if_name, br_name)) < 0) {
+		wpa_printf(MSG_ERROR, "VLAN: %s: RTM_SETLINK failed for "
+			   "br_name=%s if_name=%s: %s",
+			   __func__, br_name, if_name, strerror(errno));
 		return -1;
 	}
 
-	close(fd);
 	return 0;
 }
 
 
 static int br_delbr(const char *br_name)
 {
-	int fd;
-	unsigned long arg[2];
-
 	wpa_printf(MSG_DEBUG, "VLAN: br_delbr(%s)", br_name);
-	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: socket(AF_INET,SOCK_STREAM) "
-			   "failed: %s", __func__, strerror(errno));
+	if (!rtnl)
 		return -1;
-	}
-
-	arg[0] = BRCTL_DEL_BRIDGE;
-	arg[1] = (unsigned long) br_name;
 
-	if (ioctl(fd, SIOCGIFBR, arg) < 0 && errno != ENXIO) {
+	if (rtnl_exec(vlan_rtnl_del_link(rtnl, br_name)) < 0 &&
+	    errno != ENODEV) {
 		/* No error if bridge already removed. */
-		wpa_printf(MSG_ERROR, "VLAN: %s: BRCTL_DEL_BRIDGE failed for "
+		wpa_printf(MSG_ERROR, "VLAN: %s: RTM_DELLINK failed for "
 			   "%s: %s", __func__, br_name, strerror(errno));
-		close(fd);
 		return -1;
 	}
 
-	close(fd);
 	return 0;
 }
 
@@ -324,130 +263,96 @@ static int br_delbr(const char *br_name)
 */
 static int br_addbr(const char *br_name)
 {
-	int fd;
-	unsigned long arg[4];
-	struct ifreq ifr;
-
 	wpa_printf(MSG_DEBUG, "VLAN: br_addbr(%s)", br_name);
-	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: socket(AF_INET,SOCK_STREAM) "
-			   "failed: %s", __func__, strerror(errno));
+	if (!rtnl)
 		return -1;
-	}
 
-	arg[0] = BRCTL_ADD_BRIDGE;
-	arg[1] = (unsigned long) br_name;
-
-	if (ioctl(fd, SIOCGIFBR, arg) < 0) {
- 		if (errno == EEXIST) {
+	if (rtnl_exec(vlan_rtnl_add_bridge(rtnl, br_name, 0)) < 0) {
+		if (errno == EEXIST) {
 			/* The bridge is already added. */
-			close(fd);
 			return 1;
-		} else {
-			wpa_printf(MSG_ERROR, "VLAN: %s: BRCTL_ADD_BRIDGE "
-				   "failed for %s: %s",
-				   __func__, br_name, strerror(errno));
-			close(fd);
-			return -1;
 		}
+		wpa_printf(MSG_ERROR, "VLAN: %s: RTM_NEWLINK failed for %s: %s",
+			   __func__, br_name, strerror(errno));
+		return -1;
 	}
 
-	/* Decrease forwarding delay to avoid EAPOL timeouts. */
-	os_memset(&ifr, 0, sizeof(ifr));
-	os_strlcpy(ifr.ifr_name, br_name, IFNAMSIZ);
-	arg[0] = BRCTL_SET_BRIDGE_FORWARD_DELAY;
-	arg[1] = 1;
-	arg[2] = 0;
-	arg[3] = 0;
-	ifr.ifr_data = (char *) &arg;
-	if (ioctl(fd, SIOCDEVPRIVATE, &ifr) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: "
-			   "BRCTL_SET_BRIDGE_FORWARD_DELAY (1 sec) failed for "
-			   "%s: %s", __func__, br_name, strerror(errno));
-		/* Continue anyway */
-	}
-
-	close(fd);
 	return 0;
 }
 
 
-static int br_getnumports(const char *br_name)
+struct br_ports {
+	const int *br_index;
+	int *ports;
+	int num;
+};
+
+
+static void br_count_ports(void *ctx, int ifindex, const char *ifname,
+			   int master)
 {
-	int fd;
+	struct br_ports *p = ctx;
 	int i;
-	int port_cnt = 0;
-	unsigned long arg[4];
-	int ifindices[MAX_BR_PORTS];
-	struct ifreq ifr;
-
-	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: socket(AF_INET,SOCK_STREAM) "
-			   "failed: %s", __func__, strerror(errno));
-		return -1;
-	}
 
-	arg[0] = BRCTL_GET_PORT_LIST;
-	arg[1] = (unsigned long) ifindices;
-	arg[2] = MAX_BR_PORTS;
-	arg[3] = 0;
+	if (master <= 0)
+		return;
+	for (i = 0; i < p->num; i++) {
+		if (p->br_index[i] == master)
+			p->ports[i]++;
+	}
+}
 
-	os_memset(ifindices, 0, sizeof(ifindices));
-	os_strlcpy(ifr.ifr_name, br_name, sizeof(ifr.ifr_name));
-	ifr.ifr_data = (__caddr_t) arg;
 
-	if (ioctl(fd, SIOCDEVPRIVATE, &ifr) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: BRCTL_GET_PORT_LIST "
-			   "failed for %s: %s",
-			   __func__, br_name, strerror(errno));
-		close(fd);
+/* Count the ports of a number of bridges with a single link dump */
+static int br_getnumports_multi(const int *br_index, int *ports, int num)
+{
+	struct br_ports p;
+
+	os_memset(ports, 0, num * sizeof(int));
+	p.br_index = br_index;
+	p.ports = ports;
+	p.num = num;
+	if (!rtnl || vlan_rtnl_dump_links(rtnl, br_count_ports, &p) < 0) {
+		wpa_printf(MSG_ERROR, "VLAN: %s: RTM_GETLINK dump failed: %s",
+			   __func__, strerror(errno));
 		return -1;
 	}
 
-	for (i = 1; i < MAX_BR_PORTS; i++) {
-		if (ifindices[i] > 0) {
-			port_cnt++;
-		}
-	}
-
-	close(fd);
-	return port_cnt;
+	return 0;
 }
 
 
-#ifndef CONFIG_VLAN_NETLINK
-
-int vlan_rem(const char *if_name)
+static int br_getnumports(const char *br_name)
 {
-	int fd;
-	struct vlan_ioctl_args if_request;
+	int br_index, ports;
 
-	wpa_printf(MSG_DEBUG, "VLAN: vlan_rem(%s)", if_name);
-	if ((os_strlen(if_name) + 1) > sizeof(if_request.device1)) {
-		wpa_printf(MSG_ERROR, "VLAN: Interface name too long: '%s'",
-			   if_name);
+	br_index = if_nametoindex(br_name);
+	if (br_index == 0) {
+		wpa_printf(MSG_ERROR, "VLAN: %s: Failure determining "
+			   "interface index for '%s'", __func__, br_name);
 		return -1;
 	}
 
-	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: socket(AF_INET,SOCK_STREAM) "
-			   "failed: %s", __func__, strerror(errno));
+	if (br_getnumports_multi(&br_index, &ports, 1) < 0)
 		return -1;
-	}
+	return ports;
+}
+
 
-	os_memset(&if_request, 0, sizeof(if_request));
+#ifndef CONFIG_VLAN_NETLINK
 
-	os_strlcpy(if_request.device1, if_name, sizeof(if_request.device1));
-	if_request.cmd = DEL_VLAN_CMD;
+int vlan_rem(const char *if_name)
+{
+	wpa_printf(MSG_DEBUG, "VLAN: vlan_rem(%s)", if_name);
+	if (!rtnl)
+		return -1;
 
-	if (ioctl(fd, SIOCSIFVLAN, &if_request) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: DEL_VLAN_CMD failed for %s: "
+	if (rtnl_exec(vlan_rtnl_del_link(rtnl, if_name)) < 0) {
+		wpa_printf(MSG_ERROR, "VLAN: %s: RTM_DELLINK failed for %s: "
 			   "%s", __func__, if_name, strerror(errno));
-		close(fd);
 		return -1;
 	}
 
-	close(fd);
 	return 0;
 }
 
@@ -462,101 +367,56 @@ int vlan_rem(const char *if_name)
 */
 int vlan_add(const char *if_name, int vid, const char *vlan_if_name)
 {
-	int fd;
-	struct vlan_ioctl_args if_request;
-
 	wpa_printf(MSG_DEBUG, "VLAN: vlan_add(if_name=%s, vid=%d)",
 		   if_name, vid);
 	ifconfig_up(if_name);
-
-	if ((os_strlen(if_name) + 1) > sizeof(if_request.device1)) {
-		wpa_printf(MSG_ERROR, "VLAN: Interface name too long: '%s'",
-			   if_name);
-		return -1;
-	}
-
-	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: socket(AF_INET,SOCK_STREAM) "
-			   "failed: %s", __func__, strerror(errno));
+	if (!rtnl)
 		return -1;
-	}
-
-	os_memset(&if_request, 0, sizeof(if_request));
-
-	/* Determine if a suitable vlan device already exists. */
 
-	os_snprintf(if_request.device1, sizeof(if_request.device1), "vlan%d",
-		    vid);
-
-	if_request.cmd = _GET_VLAN_VID_CMD;
-
-	if (ioctl(fd, SIOCSIFVLAN, &if_request) == 0) {
-
-		if (if_request.u.VID == vid) {
-			if_request.cmd = _GET_VLAN_REALDEV_NAME_CMD;
-
-			if (ioctl(fd, SIOCSIFVLAN, &if_request) == 0 &&
-			    os_strncmp(if_request.u.device2, if_name,
-				       sizeof(if_request.u.device2)) == 0) {
-				close(fd);
-				wpa_printf(MSG_DEBUG, "VLAN: vlan_add: "
-					   "if_name %s exists already",
-					   if_request.device1);
-				return 1;
-			}
+	if (rtnl_exec(vlan_rtnl_add_vlan(rtnl, if_name, vid, vlan_if_name,
+					 NULL, 0)) < 0) {
+		if (errno == EEXIST) {
+			wpa_printf(MSG_DEBUG, "VLAN: vlan_add: "
+				   "if_name %s exists already",
+				   vlan_if_name);
+			return 1;
 		}
-	}
-
-	/* A suitable vlan device does not already exist, add one. */
-
-	os_memset(&if_request, 0, sizeof(if_request));
-	os_strlcpy(if_request.device1, if_name, sizeof(if_request.device1));
-	if_request.u.VID = vid;
-	if_request.cmd = ADD_VLAN_CMD;
-
-	if (ioctl(fd, SIOCSIFVLAN, &if_request) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: ADD_VLAN_CMD failed for %s: "
-			   "%s",
-			   __func__, if_request.device1, strerror(errno));
-		close(fd);
+		wpa_printf(MSG_ERROR, "VLAN: %s: RTM_NEWLINK failed for %s: "
+			   "%s", __func__, vlan_if_name, strerror(errno));
 		return -1;
 	}
 
-	close(fd);
 	return 0;
 }
 
+#endif /* CONFIG_VLAN_NETLINK */
 
-static int vlan_set_name_type(unsigned int name_type)
-{
-	int fd;
-	struct vlan_ioctl_args if_request;
-
-	wpa_printf(MSG_DEBUG, "VLAN: vlan_set_name_type(name_type=%u)",
-		   name_type);
-	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: socket(AF_INET,SOCK_STREAM) "
-			   "failed: %s", __func__, strerror(errno));
-		return -1;
-	}
 
-	os_memset(&if_request, 0, sizeof(if_request));
+static void vlan_bridge_name(struct hostapd_data *hapd, int vlan_id,
+			     char *br_name, size_t len)
+{
+	char *tagged_interface = hapd->conf->ssid.vlan_tagged_interface;
 
-	if_request.u.name_type = name_type;
-	if_request.cmd = SET_VLAN_NAME_TYPE_CMD;
-	if (ioctl(fd, SIOCSIFVLAN, &if_request) < 0) {
-		wpa_printf(MSG_ERROR, "VLAN: %s: SET_VLAN_NAME_TYPE_CMD "
-			   "name_type=%u failed: %s",
-			   __func__, name_type, strerror(errno));
-		close(fd);
-		return -1;
+	if (hapd->conf->vlan_bridge[0]) {
+		os_snprintf(br_name, len, "%s%d", hapd->conf->vlan_bridge,
+			    vlan_id);
+	} else if (tagged_interface) {
+		os_snprintf(br_name, len, "br%s.%d", tagged_interface, vlan_id);
+	} else {
+		os_snprintf(br_name, len, "brvlan%d", vlan_id);
 	}
-
-	close(fd);
-	return 0;
 }
 
-#endif /* CONFIG_VLAN_NETLINK */
+
+static void vlan_if_name(struct hostapd_data *hapd, int vlan_id,
+			 char *vlan_ifname, size_t len)
+{
+	if (hapd->conf->ssid.vlan_naming == DYNAMIC_VLAN_NAMING_WITH_DEVICE)
+		os_snprintf(vlan_ifname, len, "%s.%d",
+			    hapd->conf->ssid.vlan_tagged_interface, vlan_id);
+	else
+		os_snprintf(vlan_ifname, len, "vlan%d", vlan_id);
+}
 
 
 static void vlan_newlink(char *ifname, struct hostapd_data *hapd)
@@ -565,7 +425,6 @@ static void vlan_newlink(char *ifname, struct hostapd_data *hapd)
 	char br_name[IFNAMSIZ];
 	struct hostapd_vlan *vlan = hapd->conf->vlan;
 	char *tagged_interface = hapd->conf->ssid.vlan_tagged_interface;
-	int vlan_naming = hapd->conf->ssid.vlan_naming;
 	int clean;
 
 	wpa_printf(MSG_DEBUG, "VLAN: vlan_newlink(%s)", ifname);
@@ -574,18 +433,8 @@ static void vlan_newlink(char *ifname, struct hostapd_data *hapd)
 		if (os_strcmp(ifname, vlan->ifname) == 0 && !vlan->configured) {
 			vlan->configured = 1;
 
-			if (hapd->conf->vlan_bridge[0]) {
-				os_snprintf(br_name, sizeof(br_name), "%s%d",
-					    hapd->conf->vlan_bridge,
-					    vlan->vlan_id);
-			} else if (tagged_interface) {
-				os_snprintf(br_name, sizeof(br_name),
-				            "br%s.%d", tagged_interface,
-					    vlan->vlan_id);
-			} else {
-				os_snprintf(br_name, sizeof(br_name),
-				            "brvlan%d", vlan->vlan_id);
-			}
+			vlan_bridge_name(hapd, vlan->vlan_id, br_name,
+					 sizeof(br_name));
 
 			dyn_iface_get(hapd, br_name,
 				      br_addbr(br_name) ? 0 : DVLAN_CLEAN_BR);
@@ -593,16 +442,8 @@ static void vlan_newlink(char *ifname, struct hostapd_data *hapd)
 			ifconfig_up(br_name);
 
 			if (tagged_interface) {
-				if (vlan_naming ==
-				    DYNAMIC_VLAN_NAMING_WITH_DEVICE)
-					os_snprintf(vlan_ifname,
-						    sizeof(vlan_ifname),
-						    "%s.%d", tagged_interface,
-						    vlan->vlan_id);
-				else
-					os_snprintf(vlan_ifname,
-						    sizeof(vlan_ifname),
-						    "vlan%d", vlan->vlan_id);
+				vlan_if_name(hapd, vlan->vlan_id, vlan_ifname,
+					     sizeof(vlan_ifname));
 
 				clean = 0;
 				ifconfig_up(tagged_interface);
@@ -636,7 +477,6 @@ static void vlan_dellink(char *ifname, struct hostapd_data *hapd)
 	char br_name[IFNAMSIZ];
 	struct hostapd_vlan *first, *prev, *vlan = hapd->conf->vlan;
 	char *tagged_interface = hapd->conf->ssid.vlan_tagged_interface;
-	int vlan_naming = hapd->conf->ssid.vlan_naming;
 	int clean;
 
 	wpa_printf(MSG_DEBUG, "VLAN: vlan_dellink(%s)", ifname);
@@ -646,33 +486,15 @@ static void vlan_dellink(char *ifname, struct hostapd_data *hapd)
 	while (vlan) {
 		if (os_strcmp(ifname, vlan->ifname) == 0 &&
 		    vlan->configured) {
-			if (hapd->conf->vlan_bridge[0]) {
-				os_snprintf(br_name, sizeof(br_name), "%s%d",
-					    hapd->conf->vlan_bridge,
-					    vlan->vlan_id);
-			} else if (tagged_interface) {
-				os_snprintf(br_name, sizeof(br_name),
-				            "br%s.%d", tagged_interface,
-					    vlan->vlan_id);
-			} else {
-				os_snprintf(br_name, sizeof(br_name),
-				            "brvlan%d", vlan->vlan_id);
-			}
+			vlan_bridge_name(hapd, vlan->vlan_id, br_name,
+					 sizeof(br_name));
 
 			if (vlan->clean & DVLAN_CLEAN_WLAN_PORT)
 				br_delif(br_name, vlan->ifname);
 
 			if (tagged_interface) {
-				if (vlan_naming ==
-				    DYNAMIC_VLAN_NAMING_WITH_DEVICE)
-					os_snprintf(vlan_ifname,
-						    sizeof(vlan_ifname),
-						    "%s.%d", tagged_interface,
-						    vlan->vlan_id);
-				else
-					os_snprintf(vlan_ifname,
-						    sizeof(vlan_ifname),
-						    "vlan%d", vlan->vlan_id);
+				vlan_if_name(hapd, vlan->vlan_id, vlan_ifname,
+					     sizeof(vlan_ifname));
 
 				clean = dyn_iface_put(hapd, vlan_ifname);
 
@@ -833,13 +655,6 @@ full_dynamic_vlan_init(struct hostapd_data *hapd)
 	if (priv == NULL)
 		return NULL;
 
-#ifndef CONFIG_VLAN_NETLINK
-	vlan_set_name_type(hapd->conf->ssid.vlan_naming ==
-			   DYNAMIC_VLAN_NAMING_WITH_DEVICE ?
-			   VLAN_NAME_TYPE_RAW_PLUS_VID_NO_PAD :
-			   VLAN_NAME_TYPE_PLUS_VID_NO_PAD);
-#endif /* CONFIG_VLAN_NETLINK */
-
 	priv->s = socket(PF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
 	if (priv->s < 0) {
 		wpa_printf(MSG_ERROR, "VLAN: %s: socket(PF_NETLINK,SOCK_RAW,"
@@ -867,6 +682,16 @@ full_dynamic_vlan_init(struct hostapd_data *hapd)
 		return NULL;
 	}
 
+	if (!rtnl)
+		rtnl = vlan_rtnl_init();
+	if (!rtnl) {
+		eloop_unregister_read_sock(priv->s);
+		close(priv->s);
+		os_free(priv);
+		return NULL;
+	}
+	rtnl_users++;
+
 	return priv;
 }
 
@@ -877,7 +702,190 @@ static void full_dynamic_vlan_deinit(struct full_dynamic_vlan *priv)
 		return;
 	eloop_unregister_read_sock(priv->s);
 	close(priv->s);
+	os_free(priv->provisioned);
 	os_free(priv);
+
+	if (--rtnl_users == 0) {
+		vlan_rtnl_deinit(rtnl);
+		rtnl = NULL;
+	}
+}
+
+
+/*
+ * Create the bridges and the VLAN interfaces for the vlan_preprovision range.
+ * All the interfaces of one type are requested in a single batch, so this
+ * takes a few round trips regardless of the size of the range. References to
+ * the interfaces are taken the same way as in vlan_newlink(), so stations
+ * assigned to these VLANs later on find them in place.
+ */
+static void vlan_preprovision(struct hostapd_data *hapd)
+{
+	struct full_dynamic_vlan *priv = hapd->full_dynamic_vlan;
+	char *tagged_interface = hapd->conf->ssid.vlan_tagged_interface;
+	int start = hapd->conf->ssid.vlan_preprovision_start;
+	int num = hapd->conf->ssid.vlan_preprovision_end - start + 1;
+	char br_name[IFNAMSIZ], vlan_ifname[IFNAMSIZ];
+	struct os_reltime t0, t1;
+	int *req, i, res, clean;
+
+	if (!priv || !rtnl || start <= 0 || num <= 0)
+		return;
+
+	priv->provisioned = os_zalloc(num);
+	req = os_calloc(num, sizeof(int));
+	if (!priv->provisioned || !req) {
+		os_free(req);
+		return;
+	}
+
+	os_get_reltime(&t0);
+	for (i = 0; i < num; i++) {
+		vlan_bridge_name(hapd, start + i, br_name, sizeof(br_name));
+		req[i] = vlan_rtnl_add_bridge(rtnl, br_name, 1);
+	}
+	if (vlan_rtnl_commit(rtnl) < 0)
+		wpa_printf(MSG_ERROR, "VLAN: Could not create bridges");
+
+	/* Save the results; they are lost on the next request */
+	for (i = 0; i < num; i++)
+		req[i] = req[i] < 0 ? -1 : vlan_rtnl_result(rtnl, req[i]);
+
+	for (i = 0; i < num; i++) {
+		vlan_bridge_name(hapd, start + i, br_name, sizeof(br_name));
+		res = req[i];
+		if (res == 0) {
+			dyn_iface_get(hapd, br_name, DVLAN_CLEAN_BR);
+		} else if (res == EEXIST) {
+			dyn_iface_get(hapd, br_name, 0);
+			vlan_rtnl_set_up(rtnl, br_name, 1);
+		} else {
+			wpa_printf(MSG_ERROR, "VLAN: Could not create bridge %s: %s",
+				   br_name, res > 0 ? strerror(res) : "");
+			continue;
+		}
+		priv->provisioned[i] |= DVLAN_PROV_BR;
+	}
+	vlan_rtnl_commit(rtnl);
+
+	if (tagged_interface) {
+		ifconfig_up(tagged_interface);
+		for (i = 0; i < num; i++) {
+			req[i] = -1;
+			if (!(priv->provisioned[i] & DVLAN_PROV_BR))
+				continue;
+			vlan_bridge_name(hapd, start + i, br_name,
+					 sizeof(br_name));
+			vlan_if_name(hapd, start + i, vlan_ifname,
+				     sizeof(vlan_ifname));
+			req[i] = vlan_rtnl_add_vlan(rtnl, tagged_interface,
+						    start + i, vlan_ifname,
+						    br_name, 1);
+		}
+		if (vlan_rtnl_commit(rtnl) < 0)
+			wpa_printf(MSG_ERROR,
+				   "VLAN: Could not create VLAN interfaces");
+
+		for (i = 0; i < num; i++)
+			req[i] = req[i] < 0 ? -1 :
+				vlan_rtnl_result(rtnl, req[i]);
+
+		for (i = 0; i < num; i++) {
+			if (!(priv->provisioned[i] & DVLAN_PROV_BR))
+				continue;
+			vlan_bridge_name(hapd, start + i, br_name,
+					 sizeof(br_name));
+			vlan_if_name(hapd, start + i, vlan_ifname,
+				     sizeof(vlan_ifname));
+			if (req[i] != 0 && req[i] != EEXIST) {
+				wpa_printf(MSG_ERROR,
+					   "VLAN: Could not create VLAN interface %s: %s",
+					   vlan_ifname,
+					   req[i] > 0 ? strerror(req[i]) : "");
+				continue;
+			}
+			if (req[i] == 0) {
+				clean = DVLAN_CLEAN_VLAN |
+					DVLAN_CLEAN_VLAN_PORT;
+			} else {
+				/* Not created by us; make sure it is in the
+				 * bridge and up */
+				clean = 0;
+				if (!br_addif(br_name, vlan_ifname))
+					clean |= DVLAN_CLEAN_VLAN_PORT;
+				ifconfig_up(vlan_ifname);
+			}
+			dyn_iface_get(hapd, vlan_ifname, clean);
+			priv->provisioned[i] |= DVLAN_PROV_VLAN;
+		}
+	}
+
+	os_get_reltime(&t1);
+	os_reltime_sub(&t1, &t0, &t1);
+	wpa_printf(MSG_DEBUG, "VLAN: Pre-provisioned VLAN IDs %d-%d in %ld.%06ld s",
+		   start, start + num - 1, (long) t1.sec, (long) t1.usec);
+	os_free(req);
+}
+
+
+/* Release the references taken in vlan_preprovision() and remove the
+ * interfaces that are no longer used */
+static void vlan_preprovision_release(struct hostapd_data *hapd)
+{
+	struct full_dynamic_vlan *priv = hapd->full_dynamic_vlan;
+	int start = hapd->conf->ssid.vlan_preprovision_start;
+	int num = hapd->conf->ssid.vlan_preprovision_end - start + 1;
+	char br_name[IFNAMSIZ], vlan_ifname[IFNAMSIZ];
+	int *br_index, *ports, i, clean, count = 0;
+
+	if (!priv || !priv->provisioned || !rtnl)
+		return;
+
+	br_index = os_calloc(num, sizeof(int));
+	ports = os_calloc(num, sizeof(int));
+	if (!br_index || !ports)
+		goto out;
+
+	for (i = 0; i < num; i++) {
+		if (!(priv->provisioned[i] & DVLAN_PROV_VLAN))
+			continue;
+		vlan_if_name(hapd, start + i, vlan_ifname, sizeof(vlan_ifname));
+		clean = dyn_iface_put(hapd, vlan_ifname);
+		if (clean & DVLAN_CLEAN_VLAN)
+			vlan_rtnl_del_link(rtnl, vlan_ifname);
+		else if (clean & DVLAN_CLEAN_VLAN_PORT)
+			vlan_rtnl_set_master(rtnl, vlan_ifname, NULL);
+	}
+	vlan_rtnl_commit(rtnl);
+
+	for (i = 0; i < num; i++) {
+		if (!(priv->provisioned[i] & DVLAN_PROV_BR))
+			continue;
+		vlan_bridge_name(hapd, start + i, br_name, sizeof(br_name));
+		clean = dyn_iface_put(hapd, br_name);
+		if (clean & DVLAN_CLEAN_BR) {
+			br_index[i] = if_nametoindex(br_name);
+			if (br_index[i])
+				count++;
+		}
+	}
+
+	if (count == 0 || br_getnumports_multi(br_index, ports, num) < 0)
+		goto out;
+
+	for (i = 0; i < num; i++) {
+		if (!br_index[i] || ports[i])
+			continue;
+		vlan_bridge_name(hapd, start + i, br_name, sizeof(br_name));
+		vlan_rtnl_del_link(rtnl, br_name);
+	}
+	vlan_rtnl_commit(rtnl);
+
+out:
+	os_free(br_index);
+	os_free(ports);
+	os_free(priv->provisioned);
+	priv->provisioned = NULL;
 }
 #endif /* CONFIG_FULL_DYNAMIC_VLAN */
 
@@ -985,6 +993,10 @@ int vlan_init(struct hostapd_data *hapd)
 	if (vlan_dynamic_add(hapd, hapd->conf->vlan))
 		return -1;
 
+#ifdef CONFIG_FULL_DYNAMIC_VLAN
+	vlan_preprovision(hapd);
+#endif /* CONFIG_FULL_DYNAMIC_VLAN */
+
         return 0;
 }
 
@@ -994,6 +1006,7 @@ void vlan_deinit(struct hostapd_data *hapd)
 	vlan_dynamic_remove(hapd, hapd->conf->vlan);
 
 #ifdef CONFIG_FULL_DYNAMIC_VLAN
+	vlan_preprovision_release(hapd);
 	full_dynamic_vlan_deinit(hapd->full_dynamic_vlan);
 	hapd->full_dynamic_vlan = NULL;
 #endif /* CONFIG_FULL_DYNAMIC_VLAN */
@@ -0,0 +1,673 @@
+/*
+ * hostapd / VLAN and bridge interfaces over rtnetlink
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Requests for creating, removing, and configuring interfaces are collected
+ * into a batch and sent over a single long-lived NETLINK_ROUTE socket when
+ * the batch is committed. The kernel processes all the requests in a
+ * datagram in one go, so setting up the bridge and VLAN interfaces for a
+ * large number of VLANs takes a few round trips instead of a socket and an
+ * ioctl() per operation. Each request is acknowledged separately and the
+ * result can be fetched with vlan_rtnl_result() after vlan_rtnl_commit().
+ */
+
+#include "utils/includes.h"
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+
+#include "utils/common.h"
+#include "vlan_rtnl.h"
+
+/* IFLA_BR_FORWARD_DELAY is not included in older kernel headers */
+#define VLAN_IFLA_BR_FORWARD_DELAY 1
+
+/* Maximum size and number of the requests sent in one datagram; each request
+ * is acknowledged separately and all the acknowledgements need to fit into the
+ * receive buffer of the socket */
+#define VLAN_RTNL_CHUNK 16384
+#define VLAN_RTNL_CHUNK_REQ 64
+
+struct vlan_rtnl {
+	int sock;
+	u32 seq; /* sequence number of the first request in the batch */
+	struct wpabuf *batch;
+	int *res;
+	size_t num_req;
+	size_t res_size;
+	int committed;
+};
+
+
+struct vlan_rtnl * vlan_rtnl_init(void)
+{
+	struct vlan_rtnl *rtnl;
+	struct sockaddr_nl local;
+	struct timeval tv;
+	int rcvbuf = 262144;
+
+	rtnl = os_zalloc(sizeof(*rtnl));
+	if (rtnl == NULL)
+		return NULL;
+
+	rtnl->sock = socket(PF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+	if (rtnl->sock < 0) {
+		wpa_printf(MSG_ERROR, "VLAN: %s: socket(PF_NETLINK,SOCK_RAW,"
+			   "NETLINK_ROUTE) failed: %s",
+			   __func__, strerror(errno));
+		os_free(rtnl);
+		return NULL;
+	}
+
+	os_memset(&local, 0, sizeof(local));
+	local.nl_family = AF_NETLINK;
+	if (bind(rtnl->sock, (struct sockaddr *) &local, sizeof(local)) < 0) {
+		wpa_printf(MSG_ERROR, "VLAN: %s: bind(netlink) failed: %s",
+			   __func__, strerror(errno));
+		vlan_rtnl_deinit(rtnl);
+		return NULL;
+	}
+
+	/* Do not block the event loop if the kernel does not respond */
+	tv.tv_sec = 2;
+	tv.tv_usec = 0;
+	setsockopt(rtnl->sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(rtnl->sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	rtnl->seq = os_random();
+	rtnl->batch = wpabuf_alloc(4096);
+	if (rtnl->batch == NULL) {
+		vlan_rtnl_deinit(rtnl);
+		return NULL;
+	}
+
+	return rtnl;
+}
+
+
+void vlan_rtnl_deinit(struct vlan_rtnl *rtnl)
+{
+	if (rtnl == NULL)
+		return;
+	if (rtnl->sock >= 0)
+		close(rtnl->sock);
+	wpabuf_free(rtnl->batch);
+	os_free(rtnl->res);
+	os_free(rtnl);
+}
+
+
+/* Start a new request in the batch; returns the offset of the message */
+static int vlan_rtnl_msg_start(struct vlan_rtnl *rtnl, u16 type, u16 flags,
+			       int ifindex, unsigned int ifi_flags,
+			       unsigned int ifi_change)
+{
+	struct nlmsghdr *h;
+	struct ifinfomsg *ifi;
+	size_t pos;
+
+	if (rtnl->committed) {
+		rtnl->batch->used = 0;
+		rtnl->seq += rtnl->num_req;
+		rtnl->num_req = 0;
+		rtnl->committed = 0;
+	}
+
+	if (rtnl->num_req == rtnl->res_size) {
+		size_t size = rtnl->res_size ? rtnl->res_size * 2 : 32;
+		int *res;
+
+		res = os_realloc_array(rtnl->res, size, sizeof(int));
+		if (res == NULL)
+			return -1;
+		rtnl->res = res;
+		rtnl->res_size = size;
+	}
+
+	/* Room for the message and all the attributes used below */
+	if (wpabuf_resize(&rtnl->batch, 256) < 0)
+		return -1;
+
+	pos = wpabuf_len(rtnl->batch);
+	h = wpabuf_put(rtnl->batch, NLMSG_HDRLEN);
+	os_memset(h, 0, NLMSG_HDRLEN);
+	h->nlmsg_type = type;
+	h->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | flags;
+	h->nlmsg_seq = rtnl->seq + rtnl->num_req;
+
+	ifi = wpabuf_put(rtnl->batch, NLMSG_ALIGN(sizeof(*ifi)));
+	os_memset(ifi, 0, NLMSG_ALIGN(sizeof(*ifi)));
+	ifi->ifi_family = AF_UNSPEC;
+	ifi->ifi_index = ifindex;
+	ifi->ifi_flags = ifi_flags;
+	ifi->ifi_change = ifi_change;
+
+	return pos;
+}
+
+
+static int vlan_rtnl_msg_end(struct vlan_rtnl *rtnl, int pos)
+{
+	struct nlmsghdr *h;
+
+	h = (struct nlmsghdr *) (wpabuf_mhead_u8(rtnl->batch) + pos);
+	h->nlmsg_len = wpabuf_len(rtnl->batch) - pos;
+	rtnl->res[rtnl->num_req] = EINPROGRESS;
+	return rtnl->num_req++;
+}
+
+
+static size_t vlan_rtnl_attr(struct vlan_rtnl *rtnl, u16 type,
+			     const void *data, size_t len)
+{
+	struct rtattr *rta;
+	size_t pos = wpabuf_len(rtnl->batch);
+
+	rta = wpabuf_put(rtnl->batch, RTA_LENGTH(0));
+	rta->rta_type = type;
+	rta->rta_len = RTA_LENGTH(len);
+	if (len)
+		wpabuf_put_data(rtnl->batch, data, len);
+	if (RTA_ALIGN(len) > len)
+		os_memset(wpabuf_put(rtnl->batch, RTA_ALIGN(len) - len), 0,
+			  RTA_ALIGN(len) - len);
+	return pos;
+}
+
+
+static void vlan_rtnl_nest_end(struct vlan_rtnl *rtnl, size_t pos)
+{
+	struct rtattr *rta;
+
+	rta = (struct rtattr *) (wpabuf_mhead_u8(rtnl->batch) + pos);
+	rta->rta_len = wpabuf_len(rtnl->batch) - pos;
+}
+
+
+static int vlan_rtnl_ifname(struct vlan_rtnl *rtnl, const char *ifname)
+{
+	size_t len = os_strlen(ifname);
+
+	if (len + 1 > IFNAMSIZ) {
+		wpa_printf(MSG_ERROR, "VLAN: Interface name too long: '%s'",
+			   ifname);
+		return -1;
+	}
+	vlan_rtnl_attr(rtnl, IFLA_IFNAME, ifname, len + 1);
+	return 0;
+}
+
+
+static void vlan_rtnl_cancel(struct vlan_rtnl *rtnl, int pos)
+{
+	rtnl->batch->used = pos;
+}
+
+
+static int vlan_rtnl_master(const char *br_name, u32 *master)
+{
+	if (br_name == NULL) {
+		*master = 0;
+		return 0;
+	}
+
+	*master = if_nametoindex(br_name);
+	if (*master == 0) {
+		wpa_printf(MSG_ERROR, "VLAN: Bridge %s does not exist",
+			   br_name);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * vlan_rtnl_add_link - Add a request for creating an interface
+ * @rtnl: Context from vlan_rtnl_init()
+ * @ifname: Name of the new interface
+ * @kind: Link type (e.g., "bridge" or "veth")
+ * @up: Whether to set the interface up
+ * Returns: Request number for vlan_rtnl_result() or -1 on failure
+ *
+ * The request fails with EEXIST if the interface already exists.
+ */
+int vlan_rtnl_add_link(struct vlan_rtnl *rtnl, const char *ifname,
+		       const char *kind, int up)
+{
+	size_t linkinfo;
+	int pos;
+
+	pos = vlan_rtnl_msg_start(rtnl, RTM_NEWLINK,
+				  NLM_F_CREATE | NLM_F_EXCL, 0,
+				  up ? IFF_UP : 0, up ? IFF_UP : 0);
+	if (pos < 0)
+		return -1;
+	if (vlan_rtnl_ifname(rtnl, ifname) < 0) {
+		vlan_rtnl_cancel(rtnl, pos);
+		return -1;
+	}
+	linkinfo = vlan_rtnl_attr(rtnl, IFLA_LINKINFO, NULL, 0);
+	vlan_rtnl_attr(rtnl, IFLA_INFO_KIND, kind, os_strlen(kind));
+	vlan_rtnl_nest_end(rtnl, linkinfo);
+
+	return vlan_rtnl_msg_end(rtnl, pos);
+}
+
+
+/**
+ * vlan_rtnl_add_bridge - Add a request for creating a bridge
+ * @rtnl: Context from vlan_rtnl_init()
+ * @br_name: Name of the new bridge
+ * @up: Whether to set the bridge up
+ * Returns: Request number for vlan_rtnl_result() or -1 on failure
+ *
+ * The request fails with EEXIST if the interface already exists. The
+ * forwarding delay of a new bridge is decreased to avoid EAPOL timeouts; this
+ * is done in the same request so that an existing bridge is left as is.
+ */
+int vlan_rtnl_add_bridge(struct vlan_rtnl *rtnl, const char *br_name, int up)
+{
+	size_t linkinfo, data;
+	u32 delay = 100; /* 1 second in clock_t units */
+	int pos;
+
+	pos = vlan_rtnl_msg_start(rtnl, RTM_NEWLINK,
+				  NLM_F_CREATE | NLM_F_EXCL, 0,
+				  up ? IFF_UP : 0, up ? IFF_UP : 0);
+	if (pos < 0)
+		return -1;
+	if (vlan_rtnl_ifname(rtnl, br_name) < 0) {
+		vlan_rtnl_cancel(rtnl, pos);
+		return -1;
+	}
+	linkinfo = vlan_rtnl_attr(rtnl, IFLA_LINKINFO, NULL, 0);
+	vlan_rtnl_attr(rtnl, IFLA_INFO_KIND, "bridge", 6);
+	data = vlan_rtnl_attr(rtnl, IFLA_INFO_DATA, NULL, 0);
+	vlan_rtnl_attr(rtnl, VLAN_IFLA_BR_FORWARD_DELAY, &delay,
+		       sizeof(delay));
+	vlan_rtnl_nest_end(rtnl, data);
+	vlan_rtnl_nest_end(rtnl, linkinfo);
+
+	return vlan_rtnl_msg_end(rtnl, pos);
+}
+
+
+/**
+ * vlan_rtnl_add_vlan - Add a request for creating a VLAN interface
+ * @rtnl: Context from vlan_rtnl_init()
+ * @if_name: Tagged interface
+ * @vid: VLAN ID
+ * @vlan_if_name: Name of the new VLAN interface
+ * @br_name: Bridge to add the new interface to or %NULL
+ * @up: Whether to set the interface up
+ * Returns: Request number for vlan_rtnl_result() or -1 on failure
+ *
+ * The request fails with EEXIST if the interface already exists. The bridge
+ * must exist when the request is added.
+ */
+int vlan_rtnl_add_vlan(struct vlan_rtnl *rtnl, const char *if_name, int vid,
+		       const char *vlan_if_name, const char *br_name, int up)
+{
+	size_t linkinfo, data;
+	u32 link, master;
+	u16 id = vid;
+	int pos;
+
+	link = if_nametoindex(if_name);
+	if (link == 0) {
+		wpa_printf(MSG_ERROR, "VLAN: interface %s does not exist",
+			   if_name);
+		return -1;
+	}
+	if (vlan_rtnl_master(br_name, &master) < 0)
+		return -1;
+
+	pos = vlan_rtnl_msg_start(rtnl, RTM_NEWLINK,
+				  NLM_F_CREATE | NLM_F_EXCL, 0,
+				  up ? IFF_UP : 0, up ? IFF_UP : 0);
+	if (pos < 0)
+		return -1;
+	if (vlan_rtnl_ifname(rtnl, vlan_if_name) < 0) {
+		vlan_rtnl_cancel(rtnl, pos);
+		return -1;
+	}
+	vlan_rtnl_attr(rtnl, IFLA_LINK, &link, sizeof(link));
+	if (master)
+		vlan_rtnl_attr(rtnl, IFLA_MASTER, &master, sizeof(master));
+	linkinfo = vlan_rtnl_attr(rtnl, IFLA_LINKINFO, NULL, 0);
+	vlan_rtnl_attr(rtnl, IFLA_INFO_KIND, "vlan", 4);
+	data = vlan_rtnl_attr(rtnl, IFLA_INFO_DATA, NULL, 0);
+	vlan_rtnl_attr(rtnl, IFLA_VLAN_ID, &id, sizeof(id));
+	vlan_rtnl_nest_end(rtnl, data);
+	vlan_rtnl_nest_end(rtnl, linkinfo);
+
+	return vlan_rtnl_msg_end(rtnl, pos);
+}
+
+
+/**
+ * vlan_rtnl_set_up - Add a request for setting an interface up or down
+ * @rtnl: Context from vlan_rtnl_init()
+ * @ifname: Interface name
+ * @up: Whether to set the interface up or down
+ * Returns: Request number for vlan_rtnl_result() or -1 on failure
+ */
+int vlan_rtnl_set_up(struct vlan_rtnl *rtnl, const char *ifname, int up)
+{
+	int pos;
+
+	pos = vlan_rtnl_msg_start(rtnl, RTM_SETLINK, 0, 0, up ? IFF_UP : 0,
+				  IFF_UP);
+	if (pos < 0)
+		return -1;
+	if (vlan_rtnl_ifname(rtnl, ifname) < 0) {
+		vlan_rtnl_cancel(rtnl, pos);
+		return -1;
+	}
+
+	return vlan_rtnl_msg_end(rtnl, pos);
+}
+
+
+/**
+ * vlan_rtnl_set_master - Add a request for adding an interface to a bridge
+ * @rtnl: Context from vlan_rtnl_init()
+ * @ifname: Interface name
+ * @br_name: Bridge name or %NULL to remove the interface from its bridge
+ * Returns: Request number for vlan_rtnl_result() or -1 on failure
+ *
+ * The bridge must exist when the request is added.
+ */
+int vlan_rtnl_set_master(struct vlan_rtnl *rtnl, const char *ifname,
+			 const char *br_name)
+{
+	u32 master;
+	int pos;
+
+	if (vlan_rtnl_master(br_name, &master) < 0)
+		return -1;
+
+	pos = vlan_rtnl_msg_start(rtnl, RTM_SETLINK, 0, 0, 0, 0);
+	if (pos < 0)
+		return -1;
+	if (vlan_rtnl_ifname(rtnl, ifname) < 0) {
+		vlan_rtnl_cancel(rtnl, pos);
+		return -1;
+	}
+	vlan_rtnl_attr(rtnl, IFLA_MASTER, &master, sizeof(master));
+
+	return vlan_rtnl_msg_end(rtnl, pos);
+}
+
+
+/**
+ * vlan_rtnl_del_link - Add a request for removing an interface
+ * @rtnl: Context from vlan_rtnl_init()
+ * @ifname: Interface name
+ * Returns: Request number for vlan_rtnl_result() or -1 on failure
+ *
+ * The request fails with ENODEV if the interface does not exist.
+ */
+int vlan_rtnl_del_link(struct vlan_rtnl *rtnl, const char *ifname)
+{
+	int pos;
+
+	pos = vlan_rtnl_msg_start(rtnl, RTM_DELLINK, 0, 0, 0, 0);
+	if (pos < 0)
+		return -1;
+	if (vlan_rtnl_ifname(rtnl, ifname) < 0) {
+		vlan_rtnl_cancel(rtnl, pos);
+		return -1;
+	}
+
+	return vlan_rtnl_msg_end(rtnl, pos);
+}
+
+
+/* Process the responses to the request with the given sequence number or to
+ * all requests in [first, last] (ack == 1) */
+static int vlan_rtnl_receive(struct vlan_rtnl *rtnl, u32 first, u32 last,
+			     void (*cb)(void *ctx, int ifindex,
+					const char *ifname, int master),
+			     void *ctx)
+{
+	u8 buf[8192];
+	struct nlmsghdr *h;
+	struct nlmsgerr *err;
+	struct ifinfomsg *ifi;
+	struct rtattr *rta;
+	char ifname[IFNAMSIZ + 1];
+	int len, attrlen, master;
+	u32 left = last - first + 1;
+
+	while (left > 0) {
+		len = recv(rtnl->sock, buf, sizeof(buf), 0);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			wpa_printf(MSG_ERROR, "VLAN: %s: recv failed: %s",
+				   __func__, strerror(errno));
+			return -1;
+		}
+
+		for (h = (struct nlmsghdr *) buf; NLMSG_OK(h, len);
+		     h = NLMSG_NEXT(h, len)) {
+			if (h->nlmsg_seq - first > last - first)
+				continue; /* stale response */
+
+			if (h->nlmsg_type == NLMSG_ERROR) {
+				if (h->nlmsg_len < NLMSG_LENGTH(sizeof(*err)))
+					continue;
+				err = NLMSG_DATA(h);
+				if (h->nlmsg_seq - rtnl->seq < rtnl->num_req)
+					rtnl->res[h->nlmsg_seq - rtnl->seq] =
+						-err->error;
+				if (cb && err->error) {
+					errno = -err->error;
+					return -1;
+				}
+				left--;
+				continue;
+			}
+
+			if (h->nlmsg_type == NLMSG_DONE) {
+				left--;
+				continue;
+			}
+
+			if (h->nlmsg_type != RTM_NEWLINK || !cb ||
+			    h->nlmsg_len < NLMSG_LENGTH(sizeof(*ifi)))
+				continue;
+
+			ifi = NLMSG_DATA(h);
+			os_memset(ifname, 0, sizeof(ifname));
+			master = 0;
+			attrlen = h->nlmsg_len -
+				NLMSG_LENGTH(NLMSG_ALIGN(sizeof(*ifi)));
+			for (rta = (struct rtattr *)
+				     (((u8 *) ifi) + NLMSG_ALIGN(sizeof(*ifi)));
+			     RTA_OK(rta, attrlen);
+			     rta = RTA_NEXT(rta, attrlen)) {
+				if (rta->rta_type == IFLA_IFNAME)
+					os_strlcpy(ifname, RTA_DATA(rta),
+						   sizeof(ifname) >
+						   (size_t) RTA_PAYLOAD(rta) ?
+						   (size_t) RTA_PAYLOAD(rta) + 1 :
+						   sizeof(ifname));
+				else if (rta->rta_type == IFLA_MASTER &&
+					 RTA_PAYLOAD(rta) == sizeof(u32))
+					master = *(u32 *) RTA_DATA(rta);
+			}
+			cb(ctx, ifi->ifi_index, ifname, master);
+			if (!(h->nlmsg_flags & NLM_F_MULTI))
+				left--;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * vlan_rtnl_commit - Send the pending requests and wait for the results
+ * @rtnl: Context from vlan_rtnl_init()
+ * Returns: Number of failed requests or -1 if the requests could not be sent
+ *
+ * The requests are sent in as few datagrams as possible. The result of each
+ * request can be fetched with vlan_rtnl_result() until the next request is
+ * added.
+ */
+int vlan_rtnl_commit(struct vlan_rtnl *rtnl)
+{
+	struct sockaddr_nl kernel;
+	const u8 *buf = wpabuf_head_u8(rtnl->batch);
+	size_t len = wpabuf_len(rtnl->batch), pos = 0, end, i;
+	const struct nlmsghdr *h;
+	u32 first, last;
+	int failed = 0;
+
+	if (rtnl->committed)
+		return 0;
+	rtnl->committed = 1;
+
+	os_memset(&kernel, 0, sizeof(kernel));
+	kernel.nl_family = AF_NETLINK;
+
+	while (pos < len) {
+		/* Split the batch at a message boundary */
+		end = pos;
+		h = (const struct nlmsghdr *) (buf + pos);
+		first = last = h->nlmsg_seq;
+		while (end < len) {
+			h = (const struct nlmsghdr *) (buf + end);
+			if (end > pos &&
+			    (end - pos + h->nlmsg_len > VLAN_RTNL_CHUNK ||
+			     h->nlmsg_seq - first >= VLAN_RTNL_CHUNK_REQ))
+				break;
+			last = h->nlmsg_seq;
+			end += NLMSG_ALIGN(h->nlmsg_len);
+		}
+
+		if (sendto(rtnl->sock, buf + pos, end - pos, 0,
+			   (struct sockaddr *) &kernel, sizeof(kernel)) < 0) {
+			wpa_printf(MSG_ERROR, "VLAN: %s: sendto failed: %s",
+				   __func__, strerror(errno));
+			break;
+		}
+		if (vlan_rtnl_receive(rtnl, first, last, NULL, NULL) < 0)
+			break;
+		pos = end;
+	}
+
+	for (i = 0; i < rtnl->num_req; i++) {
+		if (rtnl->res[i] == EINPROGRESS)
+			rtnl->res[i] = ETIMEDOUT;
+		if (rtnl->res[i])
+			failed++;
+	}
+
+	return pos < len ? -1 : failed;
+}
+
+
+/**
+ * vlan_rtnl_result - Get the result of a committed request
+ * @rtnl: Context from vlan_rtnl_init()
+ * @req: Request number
+ * Returns: 0 on success or an errno value
+ */
+int vlan_rtnl_result(struct vlan_rtnl *rtnl, int req)
+{
+	if (req < 0 || (size_t) req >= rtnl->num_req)
+		return EINVAL;
+	return rtnl->res[req];
+}
+
+
+static int vlan_rtnl_get(struct vlan_rtnl *rtnl, const char *ifname,
+			 void (*cb)(void *ctx, int ifindex, const char *ifname,
+				    int master),
+			 void *ctx)
+{
+	struct sockaddr_nl kernel;
+	struct nlmsghdr *h;
+	u32 seq;
+	int pos;
+
+	/* Keep the results of the pending requests */
+	vlan_rtnl_commit(rtnl);
+
+	pos = vlan_rtnl_msg_start(rtnl, RTM_GETLINK,
+				  ifname ? 0 : NLM_F_DUMP, 0, 0, 0);
+	if (pos < 0)
+		return -1;
+	if (ifname && vlan_rtnl_ifname(rtnl, ifname) < 0) {
+		vlan_rtnl_cancel(rtnl, pos);
+		return -1;
+	}
+	h = (struct nlmsghdr *) (wpabuf_mhead_u8(rtnl->batch) + pos);
+	h->nlmsg_flags &= ~NLM_F_ACK;
+	vlan_rtnl_msg_end(rtnl, pos);
+	rtnl->committed = 1;
+	seq = h->nlmsg_seq;
+
+	os_memset(&kernel, 0, sizeof(kernel));
+	kernel.nl_family = AF_NETLINK;
+	if (sendto(rtnl->sock, h, h->nlmsg_len, 0,
+		   (struct sockaddr *) &kernel, sizeof(kernel)) < 0) {
+		wpa_printf(MSG_ERROR, "VLAN: %s: sendto failed: %s",
+			   __func__, strerror(errno));
+		return -1;
+	}
+
+	return vlan_rtnl_receive(rtnl, seq, seq, cb, ctx);
+}
+
+
+static void vlan_rtnl_master_cb(void *ctx, int ifindex, const char *ifname,
+				int master)
+{
+	*(int *) ctx = master;
+}
+
+
+/**
+ * vlan_rtnl_get_master - Get the bridge of an interface
+ * @rtnl: Context from vlan_rtnl_init()
+ * @ifname: Interface name
+ * Returns: Interface index of the bridge, 0 if the interface is not in a
+ * bridge, or -1 on failure (e.g., if the interface does not exist)
+ *
+ * Pending requests are committed first.
+ */
+int vlan_rtnl_get_master(struct vlan_rtnl *rtnl, const char *ifname)
+{
+	int master = 0;
+
+	if (vlan_rtnl_get(rtnl, ifname, vlan_rtnl_master_cb, &master) < 0)
+		return -1;
+	return master;
+}
+
+
+/**
+ * vlan_rtnl_dump_links - Go through all network interfaces
+ * @rtnl: Context from vlan_rtnl_init()
+ * @cb: Callback function for each interface; master is the interface index of
+ *	the bridge the interface is in or 0
+ * @ctx: Context data for the callback
+ * Returns: 0 on success or -1 on failure
+ *
+ * Pending requests are committed first.
+ */
+int vlan_rtnl_dump_links(struct vlan_rtnl *rtnl,
+			 void (*cb)(void *ctx, int ifindex, const char *ifname,
+				    int master),
+			 void *ctx)
+{
+	return vlan_rtnl_get(rtnl, NULL, cb, ctx);
+}
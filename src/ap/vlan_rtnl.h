@@ -0,0 +1,36 @@
+/*
+ * hostapd / VLAN and bridge interfaces over rtnetlink
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef VLAN_RTNL_H
+#define VLAN_RTNL_H
+
+struct vlan_rtnl;
+
+struct vlan_rtnl * vlan_rtnl_init(void);
+void vlan_rtnl_deinit(struct vlan_rtnl *rtnl);
+
+int vlan_rtnl_add_link(struct vlan_rtnl *rtnl, const char *ifname,
+		       const char *kind, int up);
+int vlan_rtnl_add_bridge(struct vlan_rtnl *rtnl, const char *br_name,
+			 int up);
+int vlan_rtnl_add_vlan(struct vlan_rtnl *rtnl, const char *if_name, int vid,
+		       const char *vlan_if_name, const char *br_name, int up);
+int vlan_rtnl_set_up(struct vlan_rtnl *rtnl, const char *ifname, int up);
+int vlan_rtnl_set_master(struct vlan_rtnl *rtnl, const char *ifname,
+			 const char *br_name);
+int vlan_rtnl_del_link(struct vlan_rtnl *rtnl, const char *ifname);
+int vlan_rtnl_commit(struct vlan_rtnl *rtnl);
+int vlan_rtnl_result(struct vlan_rtnl *rtnl, int req);
+
+int vlan_rtnl_get_master(struct vlan_rtnl *rtnl, const char *ifname);
+int vlan_rtnl_dump_links(struct vlan_rtnl *rtnl,
+			 void (*cb)(void *ctx, int ifindex, const char *ifname,
+				    int master),
+			 void *ctx);
+
+#endif /* VLAN_RTNL_H */
@@ -51,6 +51,7 @@ static void wpa_group_get(struct wpa_authenticator *wpa_auth,
 			  struct wpa_group *group);
 static void wpa_group_put(struct wpa_authenticator *wpa_auth,
 			  struct wpa_group *group);
+static void wpa_group_update_batch(void *eloop_ctx, void *timeout_ctx);
 
 static const u32 dot11RSNAConfigGroupUpdateCount = 4;
 static const u32 dot11RSNAConfigPairwiseUpdateCount = 4;
@@ -504,6 +505,7 @@ void wpa_deinit(struct wpa_authenticator *wpa_auth)
 
 	eloop_cancel_timeout(wpa_rekey_gmk, wpa_auth, NULL);
 	eloop_cancel_timeout(wpa_rekey_gtk, wpa_auth, NULL);
+	eloop_cancel_timeout(wpa_group_update_batch, wpa_auth, ELOOP_ALL_CTX);
 
 #ifdef CONFIG_PEERKEY
 	while (wpa_auth->stsl_negotiations)
@@ -2518,6 +2520,8 @@ SM_STATE(WPA_PTK_GROUP, REKEYNEGOTIATING)
 	SM_ENTRY_MA(WPA_PTK_GROUP, REKEYNEGOTIATING, wpa_ptk_group);
 
 	sm->GTimeoutCtr++;
+	if (sm->GTimeoutCtr == 1 && sm->GUpdateStationKeys)
+		sm->wpa_auth->group_update_started++;
 	if (sm->GTimeoutCtr > (int) dot11RSNAConfigGroupUpdateCount) {
 		/* No point in sending the EAPOL-Key - we will disconnect
 		 * immediately following this. */
@@ -2552,10 +2556,26 @@ SM_STATE(WPA_PTK_GROUP, REKEYNEGOTIATING)
 			return;
 
 		kde = pos = kde_buf;
-		hdr[0] = gsm->GN & 0x03;
-		hdr[1] = 0;
-		pos = wpa_add_kde(pos, RSN_KEY_DATA_GROUPKEY, hdr, 2,
-				  gtk, gsm->GTK_len);
+		if (gtk == dummy_gtk) {
+			hdr[0] = gsm->GN & 0x03;
+			hdr[1] = 0;
+			pos = wpa_add_kde(pos, RSN_KEY_DATA_GROUPKEY, hdr, 2,
+					  gtk, gsm->GTK_len);
+		} else {
+			/* Same GTK KDE for all STAs; only the KEK differs */
+			if (gsm->GTK_KDE_len == 0) {
+				hdr[0] = gsm->GN & 0x03;
+				hdr[1] = 0;
+				gsm->GTK_KDE_len =
+					wpa_add_kde(gsm->GTK_KDE,
+						    RSN_KEY_DATA_GROUPKEY,
+						    hdr, 2, gtk,
+						    gsm->GTK_len) -
+					gsm->GTK_KDE;
+			}
+			os_memcpy(pos, gsm->GTK_KDE, gsm->GTK_KDE_len);
+			pos += gsm->GTK_KDE_len;
+		}
 		pos = ieee80211w_kde_add(sm, pos);
 		kde_len = pos - kde;
 	} else {
@@ -2577,8 +2597,10 @@ SM_STATE(WPA_PTK_GROUP, REKEYESTABLISHED)
 {
 	SM_ENTRY_MA(WPA_PTK_GROUP, REKEYESTABLISHED, wpa_ptk_group);
 	sm->EAPOLKeyReceived = FALSE;
-	if (sm->GUpdateStationKeys)
+	if (sm->GUpdateStationKeys) {
 		sm->group->GKeyDoneStations--;
+		sm->wpa_auth->group_update_completed++;
+	}
 	sm->GUpdateStationKeys = FALSE;
 	sm->GTimeoutCtr = 0;
 	/* FIX: MLME.SetProtection.Request(TA, Tx_Rx) */
@@ -2592,8 +2614,10 @@ SM_STATE(WPA_PTK_GROUP, REKEYESTABLISHED)
 SM_STATE(WPA_PTK_GROUP, KEYERROR)
 {
 	SM_ENTRY_MA(WPA_PTK_GROUP, KEYERROR, wpa_ptk_group);
-	if (sm->GUpdateStationKeys)
+	if (sm->GUpdateStationKeys) {
 		sm->group->GKeyDoneStations--;
+		sm->wpa_auth->group_update_failures++;
+	}
 	sm->GUpdateStationKeys = FALSE;
 	sm->Disconnect = TRUE;
 }
@@ -2635,6 +2659,7 @@ static int wpa_gtk_update(struct wpa_authenticator *wpa_auth,
 {
 	int ret = 0;
 
+	group->GTK_KDE_len = 0;
 	os_memcpy(group->GNonce, group->Counter, WPA_NONCE_LEN);
 	inc_byte_array(group->Counter, WPA_NONCE_LEN);
 	if (wpa_gmk_to_gtk(group->GMK, "Group key expansion",
@@ -2713,11 +2738,76 @@ static int wpa_group_update_sta(struct wpa_state_machine *sm, void *ctx)
 	sm->group->GKeyDoneStations++;
 	sm->GUpdateStationKeys = TRUE;
 
-	wpa_sm_step(sm);
+	/* With paced rekeying, the Group Key handshake is started from
+	 * wpa_group_update_batch() */
+	if (ctx == NULL || !sm->wpa_auth->conf.wpa_group_update_window)
+		wpa_sm_step(sm);
 	return 0;
 }
 
 
+struct wpa_group_update_ctx {
+	struct wpa_group *group;
+	int left;
+	int pending; /* marked STAs that could not be started now */
+};
+
+
+static int wpa_group_update_next(struct wpa_state_machine *sm, void *ctx)
+{
+	struct wpa_group_update_ctx *batch = ctx;
+
+	if (sm->group != batch->group || !sm->GUpdateStationKeys)
+		return 0;
+
+	if (sm->wpa_ptk_group_state != WPA_PTK_GROUP_IDLE || sm->in_step_loop) {
+		batch->pending++;
+		return 0;
+	}
+
+	batch->left--;
+	wpa_sm_step(sm);
+	return batch->left == 0;
+}
+
+
+static void wpa_group_update_batch(void *eloop_ctx, void *timeout_ctx)
+{
+	struct wpa_authenticator *wpa_auth = eloop_ctx;
+	struct wpa_group_update_ctx batch;
+	int size;
+
+	batch.group = timeout_ctx;
+	if (batch.group->wpa_group_state != WPA_GROUP_SETKEYS)
+		return;
+
+	size = wpa_auth->conf.wpa_group_update_batch;
+	if (size <= 0)
+		size = 1;
+	batch.left = size;
+	batch.pending = 0;
+	wpa_auth_for_each_sta(wpa_auth, wpa_group_update_next, &batch);
+
+	if (batch.left != size) {
+		wpa_auth->group_update_batches++;
+		wpa_printf(MSG_DEBUG, "WPA: Started Group Key handshakes with "
+			   "%d STAs (VLAN-ID %d, %d not yet completed)",
+			   size - batch.left, batch.group->vlan_id,
+			   batch.group->GKeyDoneStations);
+	}
+
+	/*
+	 * STAs that were busy with another handshake still need to be
+	 * started, so keep going even if this batch was not full.
+	 */
+	if (batch.left == 0 || batch.pending)
+		eloop_register_timeout(batch.group->update_interval / 1000000,
+				       batch.group->update_interval % 1000000,
+				       wpa_group_update_batch, wpa_auth,
+				       batch.group);
+}
+
+
 #ifdef CONFIG_WNM
 /* update GTK when exiting WNM-Sleep Mode */
 void wpa_wnmsleep_rekey_gtk(struct wpa_state_machine *sm)
@@ -2832,6 +2922,22 @@ static void wpa_group_setkeys(struct wpa_authenticator *wpa_auth,
 	wpa_auth_for_each_sta(wpa_auth, wpa_group_update_sta, group);
 	wpa_printf(MSG_DEBUG, "wpa_group_setkeys: GKeyDoneStations=%d",
 		   group->GKeyDoneStations);
+
+	if (wpa_auth->conf.wpa_group_update_window &&
+	    group->GKeyDoneStations) {
+		int size = wpa_auth->conf.wpa_group_update_batch;
+		int batches;
+
+		/* Spread the Group Key handshakes over the window */
+		if (size <= 0)
+			size = 1;
+		batches = (group->GKeyDoneStations + size - 1) / size;
+		group->update_interval =
+			(unsigned int) wpa_auth->conf.wpa_group_update_window *
+			1000 / batches;
+		eloop_cancel_timeout(wpa_group_update_batch, wpa_auth, group);
+		wpa_group_update_batch(wpa_auth, group);
+	}
 }
 
 
@@ -3009,6 +3115,17 @@ void wpa_gtk_rekey(struct wpa_authenticator *wpa_auth)
 }
 
 
+/* Start a GTK rekeying with Group Key handshakes without waiting for the
+ * wpa_group_rekey timer */
+void wpa_auth_rekey_gtk(struct wpa_authenticator *wpa_auth)
+{
+	if (wpa_auth == NULL)
+		return;
+	eloop_cancel_timeout(wpa_rekey_gtk, wpa_auth, NULL);
+	wpa_rekey_gtk(wpa_auth, NULL);
+}
+
+
 static const char * wpa_bool_txt(int val)
 {
 	return val ? "TRUE" : "FALSE";
@@ -3098,8 +3215,19 @@ int wpa_get_mib(struct wpa_authenticator *wpa_auth, char *buf, size_t buflen)
 	/* TODO: dot11RSNAConfigAuthenticationSuitesTable */
 
 	/* Private MIB */
-	ret = os_snprintf(buf + len, buflen - len, "hostapdWPAGroupState=%d\n",
-			  wpa_auth->group->wpa_group_state);
+	ret = os_snprintf(buf + len, buflen - len,
+			  "hostapdWPAGroupState=%d\n"
+			  "hostapdWPAGroupUpdatePending=%d\n"
+			  "hostapdWPAGroupUpdateStarted=%u\n"
+			  "hostapdWPAGroupUpdateCompleted=%u\n"
+			  "hostapdWPAGroupUpdateFailures=%u\n"
+			  "hostapdWPAGroupUpdateBatches=%u\n",
+			  wpa_auth->group->wpa_group_state,
+			  wpa_auth->group->GKeyDoneStations,
+			  wpa_auth->group_update_started,
+			  wpa_auth->group_update_completed,
+			  wpa_auth->group_update_failures,
+			  wpa_auth->group_update_batches);
 	if (os_snprintf_error(buflen - len, ret))
 		return len;
 	len += ret;
@@ -3308,6 +3436,7 @@ static void wpa_group_free(struct wpa_authenticator *wpa_auth,
 
 	wpa_printf(MSG_DEBUG, "WPA: Remove group state machine for VLAN-ID %d",
 		   group->vlan_id);
+	eloop_cancel_timeout(wpa_group_update_batch, wpa_auth, group);
 
 	while (prev) {
 		if (prev->next == group) {
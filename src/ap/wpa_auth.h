@@ -131,6 +131,8 @@ struct wpa_auth_config {
 	int wpa_group;
 	int wpa_group_rekey;
 	int wpa_strict_rekey;
+	int wpa_group_update_window; /* in ms; 0 = update all STAs at once */
+	int wpa_group_update_batch;
 	int wpa_gmk_rekey;
 	int wpa_ptk_rekey;
 	int rsn_pairwise;
@@ -260,6 +262,7 @@ void wpa_remove_ptk(struct wpa_state_machine *sm);
 int wpa_auth_sm_event(struct wpa_state_machine *sm, wpa_event event);
 void wpa_auth_sm_notify(struct wpa_state_machine *sm);
 void wpa_gtk_rekey(struct wpa_authenticator *wpa_auth);
+void wpa_auth_rekey_gtk(struct wpa_authenticator *wpa_auth);
 int wpa_get_mib(struct wpa_authenticator *wpa_auth, char *buf, size_t buflen);
 int wpa_get_mib_sta(struct wpa_state_machine *sm, char *buf, size_t buflen);
 void wpa_auth_countermeasures_start(struct wpa_authenticator *wpa_auth);
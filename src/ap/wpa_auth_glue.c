@@ -38,6 +38,8 @@ static void hostapd_wpa_auth_conf(struct hostapd_bss_config *conf,
 	wconf->wpa_group = conf->wpa_group;
 	wconf->wpa_group_rekey = conf->wpa_group_rekey;
 	wconf->wpa_strict_rekey = conf->wpa_strict_rekey;
+	wconf->wpa_group_update_window = conf->wpa_group_update_window;
+	wconf->wpa_group_update_batch = conf->wpa_group_update_batch;
 	wconf->wpa_gmk_rekey = conf->wpa_gmk_rekey;
 	wconf->wpa_ptk_rekey = conf->wpa_ptk_rekey;
 	wconf->rsn_pairwise = conf->rsn_pairwise;
@@ -162,6 +162,12 @@ struct wpa_group {
 	u8 GMK[WPA_GMK_LEN];
 	u8 GTK[2][WPA_GTK_MAX_LEN];
 	u8 GNonce[WPA_NONCE_LEN];
+	/* GTK KDE for GTK[GN] shared by all Group Key handshakes; cleared
+	 * whenever the GTK changes */
+	u8 GTK_KDE[2 + RSN_SELECTOR_LEN + 2 + WPA_GTK_MAX_LEN];
+	size_t GTK_KDE_len;
+	/* Time between batches of paced Group Key handshakes in usec */
+	unsigned int update_interval;
 	Boolean changed;
 	Boolean first_sta_seen;
 	Boolean reject_4way_hs_for_entropy;
@@ -191,6 +197,12 @@ struct wpa_authenticator {
 	unsigned int dot11RSNATKIPCounterMeasuresInvoked;
 	unsigned int dot11RSNA4WayHandshakeFailures;
 
+	/* Group Key handshakes started as part of GTK rekeying */
+	unsigned int group_update_started;
+	unsigned int group_update_completed;
+	unsigned int group_update_failures;
+	unsigned int group_update_batches;
+
 	struct wpa_stsl_negotiation *stsl_negotiations;
 
 	struct wpa_auth_config conf;
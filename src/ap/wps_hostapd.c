@@ -11,6 +11,7 @@
 #include "utils/common.h"
 #include "utils/eloop.h"
 #include "utils/uuid.h"
+#include "utils/worker.h"
 #include "common/wpa_ctrl.h"
 #include "common/ieee802_11_defs.h"
 #include "common/ieee802_11_common.h"
@@ -27,6 +28,9 @@
 #include "sta_info.h"
 #include "wps_hostapd.h"
 
+/* Number of precomputed DH keypairs kept available per BSS */
+#define WPS_DH_POOL_SIZE 4
+
 
 #ifdef CONFIG_WPS_UPNP
 #include "wps/wps_upnp.h"
@@ -133,6 +137,7 @@ static int hostapd_wps_new_psk_cb(void *ctx, const u8 *mac_addr,
 
 	p->next = ssid->wpa_psk;
 	ssid->wpa_psk = p;
+	hostapd_wpa_psk_index_update(ssid);
 
 	if (ssid->wpa_psk_file) {
 		FILE *f;
@@ -366,9 +371,9 @@ static int hapd_wps_reconfig_in_memory(struct hostapd_data *hapd,
 			if (bss->ssid.wpa_passphrase)
 				os_memcpy(bss->ssid.wpa_passphrase, cred->key,
 					  cred->key_len);
-			hostapd_config_clear_wpa_psk(&bss->ssid.wpa_psk);
+			hostapd_config_clear_wpa_psk(&bss->ssid);
 		} else if (cred->key_len == 64) {
-			hostapd_config_clear_wpa_psk(&bss->ssid.wpa_psk);
+			hostapd_config_clear_wpa_psk(&bss->ssid);
 			bss->ssid.wpa_psk =
 				os_zalloc(sizeof(struct hostapd_wpa_psk));
 			if (bss->ssid.wpa_psk &&
@@ -957,6 +962,7 @@ static void hostapd_free_wps(struct wps_context *wps)
 {
 	int i;
 
+	wps_dh_pool_deinit(wps);
 	for (i = 0; i < MAX_WPS_VENDOR_EXTENSIONS; i++)
 		wpabuf_free(wps->dev.vendor_ext[i]);
 	wps_device_data_free(&wps->dev);
@@ -1149,6 +1155,14 @@ int hostapd_init_wps(struct hostapd_data *hapd,
 		goto fail;
 	}
 
+	/*
+	 * Precompute DH keypairs for new registration runs. This is only
+	 * useful if the keys can be generated outside the eloop thread.
+	 */
+	if (worker_threads() > 0 &&
+	    wps_dh_pool_init(wps, WPS_DH_POOL_SIZE) < 0)
+		wpa_printf(MSG_DEBUG, "WPS: Failed to initialize DH key pool");
+
 #ifdef CONFIG_WPS_UPNP
 	wps->friendly_name = hapd->conf->friendly_name;
 	wps->manufacturer_url = hapd->conf->manufacturer_url;
@@ -9,6 +9,8 @@
 #include "utils/includes.h"
 
 #include "utils/common.h"
+#include "crypto/sha1.h"
+#include "crypto/crypto.h"
 #include "hostapd.h"
 #include "sta_info.h"
 #include "ap_drv_ops.h"
@@ -88,6 +90,12 @@ x_snoop_get_l2_packet(struct hostapd_data *hapd,
 		return NULL;
 	}
 
+	/* All multicast traffic on the bridge passes through the filter */
+	if (l2_packet_enable_rx_ring(l2) < 0)
+		wpa_printf(MSG_DEBUG,
+			   "x_snoop: L2 packet RX ring not available for type: %d",
+			   type);
+
 	return l2;
 }
 
@@ -123,8 +131,118 @@ void x_snoop_mcast_to_ucast_convert_send(struct hostapd_data *hapd,
 }
 
 
+/*
+ * Identical multicast packets that are received again within a short time
+ * (e.g., when the same packet is seen more than once on the bridge) are
+ * converted only once.
+ */
+#define X_SNOOP_RECENT_COUNT 4
+#define X_SNOOP_RECENT_USEC 100000
+
+struct x_snoop_recent {
+	u8 hash[SHA1_MAC_LEN];
+	size_t len;
+	struct os_reltime time;
+};
+
+
+static int x_snoop_mcast_duplicate(struct hostapd_data *hapd, const u8 *buf,
+				   size_t len)
+{
+	struct x_snoop_recent *r, *oldest = NULL;
+	struct os_reltime now, age;
+	u8 hash[SHA1_MAC_LEN];
+	int i;
+
+	if (hapd->x_snoop_recent == NULL) {
+		hapd->x_snoop_recent = os_calloc(X_SNOOP_RECENT_COUNT,
+						 sizeof(struct x_snoop_recent));
+		if (hapd->x_snoop_recent == NULL)
+			return 0;
+	}
+
+	if (sha1_vector(1, &buf, &len, hash))
+		return 0;
+	os_get_reltime(&now);
+
+	for (i = 0; i < X_SNOOP_RECENT_COUNT; i++) {
+		r = &hapd->x_snoop_recent[i];
+		if (r->len == len &&
+		    os_memcmp(r->hash, hash, SHA1_MAC_LEN) == 0) {
+			os_reltime_sub(&now, &r->time, &age);
+			if (age.sec == 0 && age.usec < X_SNOOP_RECENT_USEC)
+				return 1;
+			oldest = r;
+			break;
+		}
+		if (!oldest || os_reltime_before(&r->time, &oldest->time))
+			oldest = r;
+	}
+
+	os_memcpy(oldest->hash, hash, SHA1_MAC_LEN);
+	oldest->len = len;
+	oldest->time = now;
+	return 0;
+}
+
+
+void x_snoop_mcast_to_ucast_convert_send_all(struct hostapd_data *hapd,
+					     u8 *buf, size_t len)
+{
+	struct sta_info *sta;
+	u8 *addrs;
+	size_t num = 0;
+	int res;
+
+	if (len < ETH_ALEN || !(buf[0] & 0x01))
+		return;
+
+	if (x_snoop_mcast_duplicate(hapd, buf, len)) {
+		wpa_printf(MSG_EXCESSIVE,
+			   "x_snoop: Skip conversion of duplicate multicast packet (len %u)",
+			   (unsigned int) len);
+		return;
+	}
+
+	addrs = os_malloc(hapd->num_sta * ETH_ALEN);
+	if (addrs) {
+		for (sta = hapd->sta_list; sta && num < hapd->num_sta;
+		     sta = sta->next) {
+			if (sta->flags & WLAN_STA_AUTHORIZED)
+				os_memcpy(&addrs[num++ * ETH_ALEN], sta->addr,
+					  ETH_ALEN);
+		}
+		if (num == 0) {
+			os_free(addrs);
+			return;
+		}
+
+		res = l2_packet_send_multi(hapd->sock_dhcp, addrs, num, buf,
+					   len);
+		os_free(addrs);
+		if (res >= 0) {
+			wpa_printf(MSG_EXCESSIVE,
+				   "x_snoop: Multicast-to-unicast conversion "
+				   MACSTR " to %d/%u stations (len %u)",
+				   MAC2STR(buf), res, (unsigned int) num,
+				   (unsigned int) len);
+			return;
+		}
+	}
+
+	/* Batched sending not available - send the copies one by one */
+	for (sta = hapd->sta_list; sta; sta = sta->next) {
+		if (!(sta->flags & WLAN_STA_AUTHORIZED))
+			continue;
+		x_snoop_mcast_to_ucast_convert_send(hapd, sta, buf, len);
+	}
+}
+
+
 void x_snoop_deinit(struct hostapd_data *hapd)
 {
+	os_free(hapd->x_snoop_recent);
+	hapd->x_snoop_recent = NULL;
 	hostapd_drv_br_set_net_param(hapd, DRV_BR_NET_PARAM_GARP_ACCEPT, 0);
 	hostapd_drv_br_port_set_attr(hapd, DRV_BR_PORT_ATTR_PROXYARP, 0);
 	hostapd_drv_br_port_set_attr(hapd, DRV_BR_PORT_ATTR_HAIRPIN_MODE, 0);
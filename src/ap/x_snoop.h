@@ -22,6 +22,8 @@ x_snoop_get_l2_packet(struct hostapd_data *hapd,
 void x_snoop_mcast_to_ucast_convert_send(struct hostapd_data *hapd,
 					 struct sta_info *sta, u8 *buf,
 					 size_t len);
+void x_snoop_mcast_to_ucast_convert_send_all(struct hostapd_data *hapd,
+					     u8 *buf, size_t len);
 void x_snoop_deinit(struct hostapd_data *hapd);
 
 #else /* CONFIG_PROXYARP */
@@ -47,6 +49,12 @@ x_snoop_mcast_to_ucast_convert_send(struct hostapd_data *hapd,
 {
 }
 
+static inline void
+x_snoop_mcast_to_ucast_convert_send_all(struct hostapd_data *hapd, void *buf,
+					size_t len)
+{
+}
+
 static inline void x_snoop_deinit(struct hostapd_data *hapd)
 {
 }
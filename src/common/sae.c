@@ -694,21 +694,142 @@ fail:
 }
 
 
-int sae_prepare_commit(const u8 *addr1, const u8 *addr2,
-		       const u8 *password, size_t password_len,
-		       struct sae_data *sae)
+/**
+ * sae_derive_pwe - Derive the password element (PWE)
+ * @addr1: Own MAC address
+ * @addr2: Peer MAC address
+ * @password: Password
+ * @password_len: Length of password in octets
+ * @sae: SAE data with the group selected with sae_set_group()
+ * Returns: 0 on success, -1 on failure
+ *
+ * This is the expensive hunting-and-pecking part of sae_prepare_commit(). It
+ * does not use any state outside @sae, so it can be run in a worker thread
+ * with a separate struct sae_data instance.
+ */
+int sae_derive_pwe(const u8 *addr1, const u8 *addr2,
+		   const u8 *password, size_t password_len,
+		   struct sae_data *sae)
 {
 	if (sae->tmp == NULL ||
 	    (sae->tmp->ec && sae_derive_pwe_ecc(sae, addr1, addr2, password,
 						password_len) < 0) ||
 	    (sae->tmp->dh && sae_derive_pwe_ffc(sae, addr1, addr2, password,
-						password_len) < 0) ||
+						password_len) < 0))
+		return -1;
+	return 0;
+}
+
+
+int sae_prepare_commit(const u8 *addr1, const u8 *addr2,
+		       const u8 *password, size_t password_len,
+		       struct sae_data *sae)
+{
+	if (sae_derive_pwe(addr1, addr2, password, password_len, sae) < 0 ||
+	    sae_derive_commit(sae) < 0)
+		return -1;
+	return 0;
+}
+
+
+/**
+ * sae_prepare_commit_pwe - Prepare a new commit with the current PWE
+ * @sae: SAE data with PWE from sae_derive_pwe() or sae_import_pwe()
+ * Returns: 0 on success, -1 on failure
+ */
+int sae_prepare_commit_pwe(struct sae_data *sae)
+{
+	if (sae->tmp == NULL || (!sae->tmp->pwe_ecc && !sae->tmp->pwe_ffc) ||
 	    sae_derive_commit(sae) < 0)
 		return -1;
 	return 0;
 }
 
 
+/**
+ * sae_export_pwe - Get the derived PWE in binary format
+ * @sae: SAE data with a derived PWE
+ * Returns: PWE (x || y for ECC groups) or %NULL on failure
+ *
+ * The returned buffer is secret and the caller is responsible for freeing it
+ * with wpabuf_clear_free().
+ */
+struct wpabuf * sae_export_pwe(struct sae_data *sae)
+{
+	struct wpabuf *buf;
+	size_t prime_len;
+	u8 *pos;
+
+	if (sae->tmp == NULL)
+		return NULL;
+	prime_len = sae->tmp->prime_len;
+	buf = wpabuf_alloc(2 * prime_len);
+	if (buf == NULL)
+		return NULL;
+
+	if (sae->tmp->ec && sae->tmp->pwe_ecc) {
+		pos = wpabuf_put(buf, 2 * prime_len);
+		if (crypto_ec_point_to_bin(sae->tmp->ec, sae->tmp->pwe_ecc,
+					   pos, pos + prime_len) < 0)
+			goto fail;
+	} else if (sae->tmp->dh && sae->tmp->pwe_ffc) {
+		pos = wpabuf_put(buf, prime_len);
+		if (crypto_bignum_to_bin(sae->tmp->pwe_ffc, pos, prime_len,
+					 prime_len) < 0)
+			goto fail;
+	} else {
+		goto fail;
+	}
+
+	return buf;
+fail:
+	wpabuf_clear_free(buf);
+	return NULL;
+}
+
+
+/**
+ * sae_import_pwe - Set PWE from binary format
+ * @sae: SAE data with the group selected with sae_set_group()
+ * @pwe: PWE from sae_export_pwe() for the same group, addresses, and password
+ * @pwe_len: Length of pwe in octets
+ * Returns: 0 on success, -1 on failure
+ */
+int sae_import_pwe(struct sae_data *sae, const u8 *pwe, size_t pwe_len)
+{
+	if (sae->tmp == NULL)
+		return -1;
+
+	if (sae->tmp->ec) {
+		struct crypto_ec_point *point;
+
+		if (pwe_len != 2 * (size_t) sae->tmp->prime_len)
+			return -1;
+		point = crypto_ec_point_from_bin(sae->tmp->ec, pwe);
+		if (point == NULL)
+			return -1;
+		crypto_ec_point_deinit(sae->tmp->pwe_ecc, 1);
+		sae->tmp->pwe_ecc = point;
+		return 0;
+	}
+
+	if (sae->tmp->dh) {
+		struct crypto_bignum *bn;
+
+		if (pwe_len != (size_t) sae->tmp->prime_len)
+			return -1;
+		bn = crypto_bignum_init_set(pwe, pwe_len);
+		if (bn == NULL)
+			return -1;
+		crypto_bignum_deinit(sae->tmp->pwe_ffc, 1);
+		sae->tmp->pwe_ffc = bn;
+		return 0;
+	}
+
+	return -1;
+}
+
+
 static int sae_derive_k_ecc(struct sae_data *sae, u8 *k)
 {
 	struct crypto_ec_point *K;
@@ -55,9 +55,15 @@ int sae_set_group(struct sae_data *sae, int group);
 void sae_clear_temp_data(struct sae_data *sae);
 void sae_clear_data(struct sae_data *sae);
 
+int sae_derive_pwe(const u8 *addr1, const u8 *addr2,
+		   const u8 *password, size_t password_len,
+		   struct sae_data *sae);
 int sae_prepare_commit(const u8 *addr1, const u8 *addr2,
 		       const u8 *password, size_t password_len,
 		       struct sae_data *sae);
+int sae_prepare_commit_pwe(struct sae_data *sae);
+struct wpabuf * sae_export_pwe(struct sae_data *sae);
+int sae_import_pwe(struct sae_data *sae, const u8 *pwe, size_t pwe_len);
 int sae_process_commit(struct sae_data *sae);
 void sae_write_commit(struct sae_data *sae, struct wpabuf *buf,
 		      const struct wpabuf *token);
@@ -434,6 +434,16 @@ int __must_check crypto_mod_exp(const u8 *base, size_t base_len,
 				const u8 *modulus, size_t modulus_len,
 				u8 *result, size_t *result_len);
 
+/**
+ * crypto_mod_exp_deinit - Free cached crypto_mod_exp() state
+ *
+ * The internal crypto implementation caches precomputed tables for bases that
+ * are used repeatedly (e.g., DH group generators). This function frees them.
+ * It is only used with the internal crypto implementation
+ * (CONFIG_CRYPTO=internal).
+ */
+void crypto_mod_exp_deinit(void);
+
 /**
  * rc4_skip - XOR RC4 stream to given data with skip-stream-start
  * @key: RC4 key
@@ -13,12 +13,241 @@
 #include "crypto.h"
 
 
+#ifdef LTM_FAST
+
+#ifdef CONFIG_WORKER_THREADS
+#include <pthread.h>
+static pthread_mutex_t modexp_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define modexp_cache_lock() pthread_mutex_lock(&modexp_cache_mutex)
+#define modexp_cache_unlock() pthread_mutex_unlock(&modexp_cache_mutex)
+#else /* CONFIG_WORKER_THREADS */
+#define modexp_cache_lock() do { } while (0)
+#define modexp_cache_unlock() do { } while (0)
+#endif /* CONFIG_WORKER_THREADS */
+
+
+/*
+ * Bases that are used repeatedly with the same modulus (i.e., the generator
+ * of a DH group) get a fixed-base exponentiation table once they are seen for
+ * the second time. Other bases (peer public values) use bignum_exptmod(). The
+ * lock covers only the cache; tables are immutable and reference counted so
+ * that exponentiation and table generation are done without the lock held.
+ */
+
+#define MODEXP_CACHE_SIZE 4
+
+struct modexp_table {
+	struct bignum_fixed_base *fb;
+	int exp_bits;
+	unsigned int refs; /* cache entry and users */
+};
+
+struct modexp_cache_entry {
+	u8 *key; /* base followed by modulus */
+	size_t base_len;
+	size_t modulus_len;
+	unsigned int uses;
+	unsigned int last_used;
+	int building;
+	int no_table; /* table generation failed */
+	struct modexp_table *table;
+};
+
+static struct modexp_cache_entry modexp_cache[MODEXP_CACHE_SIZE];
+static unsigned int modexp_cache_time;
+
+
+/* Must be called with the cache lock held */
+static void modexp_table_unref(struct modexp_table *table)
+{
+	if (table && --table->refs == 0) {
+		bignum_fixed_base_deinit(table->fb);
+		os_free(table);
+	}
+}
+
+
+static void modexp_table_put(struct modexp_table *table)
+{
+	if (table == NULL)
+		return;
+	modexp_cache_lock();
+	modexp_table_unref(table);
+	modexp_cache_unlock();
+}
+
+
+/* Must be called with the cache lock held */
+static struct modexp_cache_entry *
+modexp_cache_find(const u8 *base, size_t base_len,
+		  const u8 *modulus, size_t modulus_len)
+{
+	struct modexp_cache_entry *e;
+	unsigned int i;
+
+	for (i = 0; i < MODEXP_CACHE_SIZE; i++) {
+		e = &modexp_cache[i];
+		if (e->key && e->base_len == base_len &&
+		    e->modulus_len == modulus_len &&
+		    os_memcmp(e->key, base, base_len) == 0 &&
+		    os_memcmp(e->key + base_len, modulus, modulus_len) == 0)
+			return e;
+	}
+	return NULL;
+}
+
+
+/* Must be called with the cache lock held */
+static void modexp_cache_clear(struct modexp_cache_entry *e)
+{
+	os_free(e->key);
+	modexp_table_unref(e->table);
+	os_memset(e, 0, sizeof(*e));
+}
+
+
+/* Must be called with the cache lock held */
+static struct modexp_cache_entry *
+modexp_cache_add(const u8 *base, size_t base_len,
+		 const u8 *modulus, size_t modulus_len)
+{
+	struct modexp_cache_entry *e, *victim = NULL;
+	unsigned int i;
+	u8 *key;
+
+	key = os_malloc(base_len + modulus_len);
+	if (key == NULL)
+		return NULL;
+	os_memcpy(key, base, base_len);
+	os_memcpy(key + base_len, modulus, modulus_len);
+
+	/* Replace the least recently used entry, preferably one w/o a table */
+	for (i = 0; i < MODEXP_CACHE_SIZE; i++) {
+		e = &modexp_cache[i];
+		if (!victim ||
+		    (!e->table && victim->table) ||
+		    (!e->table == !victim->table &&
+		     e->last_used < victim->last_used))
+			victim = e;
+	}
+	modexp_cache_clear(victim);
+	victim->key = key;
+	victim->base_len = base_len;
+	victim->modulus_len = modulus_len;
+	return victim;
+}
+
+
+static struct modexp_table *
+modexp_cache_get(const u8 *base, size_t base_len,
+		 const u8 *modulus, size_t modulus_len,
+		 const struct bignum *bn_base, const struct bignum *bn_modulus,
+		 int exp_bits)
+{
+	struct modexp_cache_entry *e;
+	struct modexp_table *table = NULL;
+
+	if (modulus_len == 0 || !(modulus[modulus_len - 1] & 1))
+		return NULL;
+
+	modexp_cache_lock();
+	e = modexp_cache_find(base, base_len, modulus, modulus_len);
+	if (e == NULL)
+		e = modexp_cache_add(base, base_len, modulus, modulus_len);
+	if (e == NULL)
+		goto out;
+	e->last_used = ++modexp_cache_time;
+	e->uses++;
+	if (e->table && e->table->exp_bits >= exp_bits) {
+		table = e->table;
+		table->refs++;
+		goto out;
+	}
+	if (e->uses < 2 || e->building || e->no_table)
+		goto out;
+	e->building = 1;
+	modexp_cache_unlock();
+
+	table = os_zalloc(sizeof(*table));
+	if (table) {
+		table->fb = bignum_fixed_base_init(bn_base, bn_modulus,
+						   exp_bits);
+		table->exp_bits = exp_bits;
+		table->refs = 1;
+		if (table->fb == NULL) {
+			os_free(table);
+			table = NULL;
+		}
+	}
+
+	modexp_cache_lock();
+	/* The entry may have been replaced while the lock was released */
+	e = modexp_cache_find(base, base_len, modulus, modulus_len);
+	if (e && e->building) {
+		e->building = 0;
+		e->no_table = table == NULL;
+		if (table) {
+			modexp_table_unref(e->table);
+			e->table = table;
+			table->refs++;
+		}
+	}
+out:
+	modexp_cache_unlock();
+	return table;
+}
+
+
+/**
+ * crypto_mod_exp_deinit - Free the fixed-base exponentiation cache
+ *
+ * This function is only used with the internal crypto implementation.
+ */
+void crypto_mod_exp_deinit(void)
+{
+	unsigned int i;
+
+	modexp_cache_lock();
+	for (i = 0; i < MODEXP_CACHE_SIZE; i++)
+		modexp_cache_clear(&modexp_cache[i]);
+	modexp_cache_unlock();
+}
+
+#else /* LTM_FAST */
+
+struct modexp_table {
+	struct bignum_fixed_base *fb;
+};
+
+static struct modexp_table *
+modexp_cache_get(const u8 *base, size_t base_len,
+		 const u8 *modulus, size_t modulus_len,
+		 const struct bignum *bn_base, const struct bignum *bn_modulus,
+		 int exp_bits)
+{
+	return NULL;
+}
+
+
+static void modexp_table_put(struct modexp_table *table)
+{
+}
+
+
+void crypto_mod_exp_deinit(void)
+{
+}
+
+#endif /* LTM_FAST */
+
+
 int crypto_mod_exp(const u8 *base, size_t base_len,
 		   const u8 *power, size_t power_len,
 		   const u8 *modulus, size_t modulus_len,
 		   u8 *result, size_t *result_len)
 {
 	struct bignum *bn_base, *bn_exp, *bn_modulus, *bn_result;
+	struct modexp_table *table = NULL;
 	int ret = -1;
 
 	bn_base = bignum_init();
@@ -35,12 +264,17 @@ int crypto_mod_exp(const u8 *base, size_t base_len,
 	    bignum_set_unsigned_bin(bn_modulus, modulus, modulus_len) < 0)
 		goto error;
 
-	if (bignum_exptmod(bn_base, bn_exp, bn_modulus, bn_result) < 0)
+	table = modexp_cache_get(base, base_len, modulus, modulus_len,
+				 bn_base, bn_modulus, power_len * 8);
+	if ((table == NULL ||
+	     bignum_fixed_base_exptmod(table->fb, bn_exp, bn_result) < 0) &&
+	    bignum_exptmod(bn_base, bn_exp, bn_modulus, bn_result) < 0)
 		goto error;
 
 	ret = bignum_get_unsigned_bin(bn_result, result, result_len);
 
 error:
+	modexp_table_put(table);
 	bignum_deinit(bn_base);
 	bignum_deinit(bn_exp);
 	bignum_deinit(bn_modulus);
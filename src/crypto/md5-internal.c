@@ -41,6 +41,75 @@ int md5_vector(size_t num_elem, const u8 *addr[], const size_t *len, u8 *mac)
 }
 
 
+/**
+ * hmac_md5_state_init - Precompute HMAC-MD5 key state
+ * @state: Buffer for the state
+ * @key: Key for HMAC operations
+ * @key_len: Length of the key in bytes
+ *
+ * This processes the padded key blocks once so that hmac_md5_state_vector()
+ * can be used for any number of messages with the same key without repeating
+ * that part of the HMAC calculation.
+ */
+void hmac_md5_state_init(struct hmac_md5_state *state, const u8 *key,
+			 size_t key_len)
+{
+	u8 k_pad[64]; /* padding - key XORd with ipad/opad */
+	u8 tk[16];
+	size_t i;
+
+	/* if key is longer than 64 bytes reset it to key = MD5(key) */
+	if (key_len > 64) {
+		md5_vector(1, &key, &key_len, tk);
+		key = tk;
+		key_len = 16;
+	}
+
+	os_memset(k_pad, 0, sizeof(k_pad));
+	os_memcpy(k_pad, key, key_len);
+	for (i = 0; i < 64; i++)
+		k_pad[i] ^= 0x36;
+	MD5Init(&state->inner);
+	MD5Update(&state->inner, k_pad, sizeof(k_pad));
+
+	os_memset(k_pad, 0, sizeof(k_pad));
+	os_memcpy(k_pad, key, key_len);
+	for (i = 0; i < 64; i++)
+		k_pad[i] ^= 0x5c;
+	MD5Init(&state->outer);
+	MD5Update(&state->outer, k_pad, sizeof(k_pad));
+
+	os_memset(k_pad, 0, sizeof(k_pad));
+	os_memset(tk, 0, sizeof(tk));
+}
+
+
+/**
+ * hmac_md5_state_vector - HMAC-MD5 over data vector with precomputed key
+ * @state: Key state from hmac_md5_state_init()
+ * @num_elem: Number of elements in the data vector
+ * @addr: Pointers to the data areas
+ * @len: Lengths of the data blocks
+ * @mac: Buffer for the hash (16 bytes)
+ */
+void hmac_md5_state_vector(const struct hmac_md5_state *state,
+			   size_t num_elem, const u8 *addr[], const size_t *len,
+			   u8 *mac)
+{
+	MD5_CTX ctx;
+	size_t i;
+
+	ctx = state->inner;
+	for (i = 0; i < num_elem; i++)
+		MD5Update(&ctx, addr[i], len[i]);
+	MD5Final(mac, &ctx);
+
+	ctx = state->outer;
+	MD5Update(&ctx, mac, MD5_MAC_LEN);
+	MD5Final(mac, &ctx);
+}
+
+
 /* ===== start - public domain MD5 implementation ===== */
 /*
  * This code implements the MD5 message-digest algorithm.
@@ -20,4 +20,20 @@ void MD5Update(struct MD5Context *context, unsigned char const *buf,
 	       unsigned len);
 void MD5Final(unsigned char digest[16], struct MD5Context *context);
 
+/**
+ * struct hmac_md5_state - Precomputed HMAC-MD5 key state
+ * @inner: MD5 state after the inner padded key block
+ * @outer: MD5 state after the outer padded key block
+ */
+struct hmac_md5_state {
+	struct MD5Context inner;
+	struct MD5Context outer;
+};
+
+void hmac_md5_state_init(struct hmac_md5_state *state, const u8 *key,
+			 size_t key_len);
+void hmac_md5_state_vector(const struct hmac_md5_state *state,
+			   size_t num_elem, const u8 *addr[], const size_t *len,
+			   u8 *mac);
+
 #endif /* MD5_I_H */
@@ -26,6 +26,9 @@
 #ifdef __linux__
 #include <fcntl.h>
 #endif /* __linux__ */
+#ifdef CONFIG_WORKER_THREADS
+#include <pthread.h>
+#endif /* CONFIG_WORKER_THREADS */
 
 #include "utils/common.h"
 #include "utils/eloop.h"
@@ -63,6 +66,16 @@ static unsigned int total_collected = 0;
 
 static void random_write_entropy(void);
 
+#ifdef CONFIG_WORKER_THREADS
+/* random_get_bytes() may be called from worker threads */
+static pthread_mutex_t random_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+#define random_lock() pthread_mutex_lock(&random_pool_lock)
+#define random_unlock() pthread_mutex_unlock(&random_pool_lock)
+#else /* CONFIG_WORKER_THREADS */
+#define random_lock() do { } while (0)
+#define random_unlock() do { } while (0)
+#endif /* CONFIG_WORKER_THREADS */
+
 
 static u32 __ROL32(u32 x, u32 y)
 {
@@ -140,6 +153,7 @@ void random_add_randomness(const void *buf, size_t len)
 		   count, entropy);
 
 	os_get_time(&t);
+	random_lock();
 	wpa_hexdump_key(MSG_EXCESSIVE, "random pool",
 			(const u8 *) pool, sizeof(pool));
 	random_mix_pool(&t, sizeof(t));
@@ -148,6 +162,7 @@ void random_add_randomness(const void *buf, size_t len)
 			(const u8 *) pool, sizeof(pool));
 	entropy++;
 	total_collected++;
+	random_unlock();
 }
 
 
@@ -166,6 +181,7 @@ int random_get_bytes(void *buf, size_t len)
 			buf, len);
 
 	/* Mix in additional entropy extracted from the internal pool */
+	random_lock();
 	left = len;
 	while (left) {
 		size_t siz, i;
@@ -178,6 +194,7 @@ int random_get_bytes(void *buf, size_t len)
 			*bytes++ ^= tmp[i];
 		left -= siz;
 	}
+	random_unlock();
 
 #ifdef CONFIG_FIPS
 	/* Mix in additional entropy from the crypto module */
@@ -201,10 +218,12 @@ int random_get_bytes(void *buf, size_t len)
 
 	wpa_hexdump_key(MSG_EXCESSIVE, "mixed random", buf, len);
 
+	random_lock();
 	if (entropy < len)
 		entropy = 0;
 	else
 		entropy -= len;
+	random_unlock();
 
 	return ret;
 }
@@ -237,8 +256,10 @@ int random_pool_ready(void)
 		return -1;
 	}
 
+	random_lock();
 	res = read(fd, dummy_key + dummy_key_avail,
 		   sizeof(dummy_key) - dummy_key_avail);
+	random_unlock();
 	if (res < 0) {
 		wpa_printf(MSG_ERROR, "random: Cannot read from /dev/random: "
 			   "%s", strerror(errno));
@@ -308,8 +329,10 @@ static void random_read_fd(int sock, void *eloop_ctx, void *sock_ctx)
 		return;
 	}
 
+	random_lock();
 	res = read(sock, dummy_key + dummy_key_avail,
 		   sizeof(dummy_key) - dummy_key_avail);
+	random_unlock();
 	if (res < 0) {
 		wpa_printf(MSG_ERROR, "random: Cannot read from /dev/random: "
 			   "%s", strerror(errno));
@@ -12,6 +12,7 @@
 #include "includes.h"
 
 #include "common.h"
+#include "crypto.h"
 #include "tls.h"
 #include "tls/tlsv1_client.h"
 #include "tls/tlsv1_server.h"
@@ -67,6 +68,9 @@ void tls_deinit(void *ssl_ctx)
 		tlsv1_cred_free(global->server_cred);
 		tlsv1_server_global_deinit();
 #endif /* CONFIG_TLS_INTERNAL_SERVER */
+#ifdef CONFIG_CRYPTO_INTERNAL
+		crypto_mod_exp_deinit();
+#endif /* CONFIG_CRYPTO_INTERNAL */
 	}
 	os_free(global);
 }
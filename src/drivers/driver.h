@@ -3394,6 +3394,18 @@ struct wpa_driver_ops {
 	 * Returns 0 on success, -1 on failure
 	 */
 	int (*set_band)(void *priv, enum set_band band);
+
+	/**
+	 * abort_scan - Request the driver to abort an ongoing scan
+	 * @priv: Private driver interface data
+	 * Returns 0 on success, -1 on failure
+	 *
+	 * The scan is completed with EVENT_SCAN_RESULTS as if it had finished
+	 * normally, with union wpa_event_data::scan_info::aborted set. This is
+	 * used to release the radio for a higher priority operation, e.g., a
+	 * connection.
+	 */
+	int (*abort_scan)(void *priv);
 };
 
 
@@ -25,6 +25,7 @@
 
 #include "common.h"
 #include "eloop.h"
+#include "frame_pool.h"
 #include "common/qca-vendor.h"
 #include "common/qca-vendor-attr.h"
 #include "common/ieee802_11_defs.h"
@@ -319,6 +320,32 @@ static void nl80211_nlmsg_clear(struct nl_msg *msg)
 }
 
 
+static int recv_reply(struct nl_handle *nl_handle, struct nl_cb *cb,
+		      int (*valid_handler)(struct nl_msg *, void *),
+		      void *valid_data)
+{
+	int err = 1;
+
+	nl_cb_err(cb, NL_CB_CUSTOM, error_handler, &err);
+	nl_cb_set(cb, NL_CB_FINISH, NL_CB_CUSTOM, finish_handler, &err);
+	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, ack_handler, &err);
+
+	if (valid_handler)
+		nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM,
+			  valid_handler, valid_data);
+
+	while (err > 0) {
+		int res = nl_recvmsgs(nl_handle, cb);
+		if (res < 0) {
+			wpa_printf(MSG_INFO,
+				   "nl80211: %s->nl_recvmsgs failed: %d",
+				   __func__, res);
+		}
+	}
+	return err;
+}
+
+
 static int send_and_recv(struct nl80211_global *global,
 			 struct nl_handle *nl_handle, struct nl_msg *msg,
 			 int (*valid_handler)(struct nl_msg *, void *),
@@ -330,6 +357,10 @@ static int send_and_recv(struct nl80211_global *global,
 	if (!msg)
 		return -ENOMEM;
 
+	/* Queued asynchronous commands need to be processed first */
+	if (nl80211_async_queued(global->async))
+		nl80211_async_flush(global->async);
+
 	cb = nl_cb_clone(global->nl_cb);
 	if (!cb)
 		goto out;
@@ -338,24 +369,7 @@ static int send_and_recv(struct nl80211_global *global,
 	if (err < 0)
 		goto out;
 
-	err = 1;
-
-	nl_cb_err(cb, NL_CB_CUSTOM, error_handler, &err);
-	nl_cb_set(cb, NL_CB_FINISH, NL_CB_CUSTOM, finish_handler, &err);
-	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, ack_handler, &err);
-
-	if (valid_handler)
-		nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM,
-			  valid_handler, valid_data);
-
-	while (err > 0) {
-		int res = nl_recvmsgs(nl_handle, cb);
-		if (res < 0) {
-			wpa_printf(MSG_INFO,
-				   "nl80211: %s->nl_recvmsgs failed: %d",
-				   __func__, res);
-		}
-	}
+	err = recv_reply(nl_handle, cb, valid_handler, valid_data);
  out:
 	nl_cb_put(cb);
 	if (!valid_handler && valid_data == (void *) -1)
@@ -365,6 +379,30 @@ static int send_and_recv(struct nl80211_global *global,
 }
 
 
+/* Send a command built with nl80211_frame_cmd_inplace() */
+static int send_and_recv_inplace(struct nl80211_global *global,
+				 struct nlmsghdr *hdr,
+				 int (*valid_handler)(struct nl_msg *, void *),
+				 void *valid_data)
+{
+	struct nl_cb *cb;
+	int err;
+
+	if (nl80211_async_queued(global->async))
+		nl80211_async_flush(global->async);
+
+	cb = nl_cb_clone(global->nl_cb);
+	if (!cb)
+		return -ENOMEM;
+
+	err = nl_sendto(global->nl, hdr, hdr->nlmsg_len);
+	if (err >= 0)
+		err = recv_reply(global->nl, cb, valid_handler, valid_data);
+	nl_cb_put(cb);
+	return err;
+}
+
+
 int send_and_recv_msgs(struct wpa_driver_nl80211_data *drv,
 		       struct nl_msg *msg,
 		       int (*valid_handler)(struct nl_msg *, void *),
@@ -375,6 +413,15 @@ int send_and_recv_msgs(struct wpa_driver_nl80211_data *drv,
 }
 
 
+int send_msgs_async(struct wpa_driver_nl80211_data *drv, struct nl_msg *msg)
+{
+	if (!drv->global->async)
+		return send_and_recv_msgs(drv, msg, NULL, NULL);
+	return nl80211_send_async(drv->global->async, msg, NULL, NULL, NULL,
+				  NULL);
+}
+
+
 struct family_data {
 	const char *group;
 	int id;
@@ -1479,6 +1526,18 @@ static int wpa_driver_nl80211_init_nl_global(struct nl80211_global *global)
 				    wpa_driver_nl80211_event_receive,
 				    global->nl_cb);
 
+	global->nl_async = nl_create_handle(global->nl_cb, "async");
+	if (global->nl_async) {
+		global->async = nl80211_async_init(global->nl_async);
+		if (!global->async)
+			nl_destroy_handles(&global->nl_async);
+	}
+	if (!global->async) {
+		wpa_printf(MSG_DEBUG,
+			   "nl80211: Asynchronous commands not available");
+		/* Continue with synchronous commands only */
+	}
+
 	return 0;
 
 err:
@@ -4300,7 +4359,8 @@ static int wpa_driver_nl80211_sta_set_flags(void *priv, const u8 *addr,
 	if (nla_put(msg, NL80211_ATTR_STA_FLAGS2, sizeof(upd), &upd))
 		goto fail;
 
-	return send_and_recv_msgs(bss->drv, msg, NULL, NULL);
+	/* Callers do not need the result; failures are only logged */
+	return send_msgs_async(bss->drv, msg);
 fail:
 	nlmsg_free(msg);
 	return -ENOBUFS;
@@ -6120,7 +6180,7 @@ static int nl80211_send_frame_cmd(struct i802_bss *bss,
 				  int offchanok)
 {
 	struct wpa_driver_nl80211_data *drv = bss->drv;
-	struct nl_msg *msg;
+	struct nl_msg *msg = NULL;
 	u64 cookie;
 	int ret = -1;
 
@@ -6129,6 +6189,36 @@ static int nl80211_send_frame_cmd(struct i802_bss *bss,
 		   freq, wait, no_cck, no_ack, offchanok);
 	wpa_hexdump(MSG_MSGDUMP, "CMD_FRAME", buf, buf_len);
 
+	if (frame_pool_headroom(buf)) {
+		u16 flags[3];
+		size_t num_flags = 0;
+		struct nlmsghdr *hdr;
+
+		/*
+		 * Build the command in the headroom in front of the frame
+		 * instead of copying the frame into a new message.
+		 */
+		if (offchanok &&
+		    ((drv->capa.flags & WPA_DRIVER_FLAGS_OFFCHANNEL_TX) ||
+		     drv->test_use_roc_tx))
+			flags[num_flags++] = NL80211_ATTR_OFFCHANNEL_TX_OK;
+		if (no_cck)
+			flags[num_flags++] = NL80211_ATTR_TX_NO_CCK_RATE;
+		if (no_ack)
+			flags[num_flags++] = NL80211_ATTR_DONT_WAIT_FOR_ACK;
+		hdr = nl80211_frame_cmd_inplace(
+			drv->global->nl, drv->global->nl80211_id, bss->ifindex,
+			bss->wdev_id_set ? &bss->wdev_id : NULL, freq, wait,
+			flags, num_flags, (u8 *) buf, buf_len,
+			frame_pool_headroom(buf));
+		if (hdr) {
+			cookie = 0;
+			ret = send_and_recv_inplace(drv->global, hdr,
+						    cookie_handler, &cookie);
+			goto done;
+		}
+	}
+
 	if (!(msg = nl80211_cmd_msg(bss, 0, NL80211_CMD_FRAME)) ||
 	    (freq && nla_put_u32(msg, NL80211_ATTR_WIPHY_FREQ, freq)) ||
 	    (wait && nla_put_u32(msg, NL80211_ATTR_DURATION, wait)) ||
@@ -6143,6 +6233,7 @@ static int nl80211_send_frame_cmd(struct i802_bss *bss,
 	cookie = 0;
 	ret = send_and_recv_msgs(drv, msg, cookie_handler, &cookie);
 	msg = NULL;
+done:
 	if (ret) {
 		wpa_printf(MSG_DEBUG, "nl80211: Frame command failed: ret=%d "
 			   "(%s) (freq=%u wait=%u)", ret, strerror(-ret),
@@ -6646,6 +6737,9 @@ static void nl80211_global_deinit(void *priv)
 	if (global->netlink)
 		netlink_deinit(global->netlink);
 
+	nl80211_async_deinit(global->async);
+	nl_destroy_handles(&global->nl_async);
+
 	nl_destroy_handles(&global->nl);
 
 	if (global->nl_event)
@@ -8493,6 +8587,7 @@ const struct wpa_driver_ops wpa_driver_nl80211_ops = {
 	.scan2 = driver_nl80211_scan2,
 	.sched_scan = wpa_driver_nl80211_sched_scan,
 	.stop_sched_scan = wpa_driver_nl80211_stop_sched_scan,
+	.abort_scan = wpa_driver_nl80211_abort_scan,
 	.get_scan_results2 = wpa_driver_nl80211_get_scan_results,
 	.deauthenticate = driver_nl80211_deauthenticate,
 	.authenticate = driver_nl80211_authenticate,
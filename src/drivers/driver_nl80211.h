@@ -36,6 +36,10 @@ struct nl80211_global {
 	int ioctl_sock; /* socket for ioctl() use */
 
 	struct nl_handle *nl_event;
+
+	/* Commands that do not need to wait for the response */
+	struct nl_handle *nl_async;
+	struct nl80211_async *async;
 };
 
 struct nl80211_wiphy_data {
@@ -193,6 +197,7 @@ struct nl_msg * nl80211_bss_msg(struct i802_bss *bss, int flags, uint8_t cmd);
 int send_and_recv_msgs(struct wpa_driver_nl80211_data *drv, struct nl_msg *msg,
 		       int (*valid_handler)(struct nl_msg *, void *),
 		       void *valid_data);
+int send_msgs_async(struct wpa_driver_nl80211_data *drv, struct nl_msg *msg);
 int nl80211_create_iface(struct wpa_driver_nl80211_data *drv,
 			 const char *ifname, enum nl80211_iftype iftype,
 			 const u8 *addr, int wds,
@@ -258,6 +263,17 @@ struct nl80211_bss_info_arg {
 	unsigned int assoc_freq;
 	unsigned int ibss_freq;
 	u8 assoc_bssid[ETH_ALEN];
+
+	/* Allocated length of res->res */
+	size_t res_size;
+	/*
+	 * BSSID hash of res->res for finding duplicated entries; the values
+	 * are indexes to res->res plus one and zero terminates the chain.
+	 */
+#define NL80211_BSS_HASH_SIZE 256
+#define NL80211_BSS_HASH(bssid) ((bssid)[5])
+	size_t hash[NL80211_BSS_HASH_SIZE];
+	size_t *hnext;
 };
 
 int bss_info_handler(struct nl_msg *msg, void *arg);
@@ -268,8 +284,32 @@ int wpa_driver_nl80211_sched_scan(void *priv,
 				  struct wpa_driver_scan_params *params,
 				  u32 interval);
 int wpa_driver_nl80211_stop_sched_scan(void *priv);
+int wpa_driver_nl80211_abort_scan(void *priv);
 struct wpa_scan_results * wpa_driver_nl80211_get_scan_results(void *priv);
 void nl80211_dump_scan(struct wpa_driver_nl80211_data *drv);
 const u8 * nl80211_get_ie(const u8 *ies, size_t ies_len, u8 ie);
 
+/* driver_nl80211_async.c */
+struct nl80211_async * nl80211_async_init(struct nl_handle *handle);
+void nl80211_async_deinit(struct nl80211_async *async);
+int nl80211_send_async(struct nl80211_async *async, struct nl_msg *msg,
+		       int (*valid_handler)(struct nl_msg *, void *),
+		       void *valid_data,
+		       void (*done)(void *ctx, int err), void *ctx);
+int nl80211_async_flush(struct nl80211_async *async);
+int nl80211_async_wait(struct nl80211_async *async);
+void nl80211_async_cancel(struct nl80211_async *async, void *ctx);
+unsigned int nl80211_async_pending(struct nl80211_async *async);
+unsigned int nl80211_async_queued(struct nl80211_async *async);
+
+/* driver_nl80211_frame.c */
+struct nlmsghdr * nl80211_frame_cmd_inplace(struct nl_handle *handle,
+					    int family, int ifindex,
+					    const u64 *wdev_id,
+					    unsigned int freq,
+					    unsigned int wait,
+					    const u16 *flags, size_t num_flags,
+					    u8 *frame, size_t frame_len,
+					    size_t headroom);
+
 #endif /* DRIVER_NL80211_H */
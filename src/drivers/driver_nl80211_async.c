@@ -0,0 +1,502 @@
+/*
+ * Driver interaction with Linux nl80211/cfg80211 - asynchronous commands
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Commands whose result is not needed before continuing (e.g., station flag
+ * updates) are queued here instead of waiting for the kernel response after
+ * each command. Queued commands are sent together in a single sendmsg() call
+ * once the current eloop callback returns (or when the batch buffer fills up)
+ * and the responses are matched to the commands by sequence number when they
+ * are received through eloop.
+ *
+ * The kernel processes a netlink command when it is sent, so the order of
+ * commands is maintained as long as the queue is flushed before sending any
+ * other command. send_and_recv() takes care of that for the synchronous
+ * commands, which are then sent through the socket the caller selected.
+ */
+
+#include "includes.h"
+#include <poll.h>
+#include <netlink/genl/genl.h>
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "utils/list.h"
+#include "driver_nl80211.h"
+
+
+/* Maximum number of octets of queued commands to send at once */
+#define NL80211_ASYNC_BATCH_SIZE 16384
+/* Maximum number of commands waiting for a response */
+#define NL80211_ASYNC_MAX_PENDING 64
+/* Time to wait for a response in nl80211_async_wait() */
+#define NL80211_ASYNC_WAIT_MS 5000
+
+#ifdef ANDROID
+/* system/core/libnl_2 does not include nl_socket_set_nonblocking() */
+#undef nl_socket_set_nonblocking
+#define nl_socket_set_nonblocking(h) android_nl_socket_set_nonblocking(h)
+#endif /* ANDROID */
+
+struct nl80211_async_req {
+	struct dl_list list;
+	u32 seq;
+	u8 cmd;
+	int sent;
+	int (*valid_handler)(struct nl_msg *msg, void *arg);
+	void *valid_data;
+	void (*done)(void *ctx, int err);
+	void *ctx;
+};
+
+struct nl80211_async {
+	struct nl_handle *handle;
+	struct nl_cb *cb;
+	struct dl_list reqs; /* struct nl80211_async_req, in sequence order */
+	unsigned int num_reqs;
+	u8 batch[NL80211_ASYNC_BATCH_SIZE];
+	size_t batch_len;
+	unsigned int batch_count;
+	int flush_scheduled;
+};
+
+
+static struct nl80211_async_req *
+nl80211_async_get_req(struct nl80211_async *async, u32 seq)
+{
+	struct nl80211_async_req *req;
+
+	dl_list_for_each(req, &async->reqs, struct nl80211_async_req, list) {
+		if (req->seq == seq)
+			return req;
+	}
+	return NULL;
+}
+
+
+static void nl80211_async_complete(struct nl80211_async *async, u32 seq,
+				   int err)
+{
+	struct nl80211_async_req *req;
+
+	req = nl80211_async_get_req(async, seq);
+	if (!req)
+		return;
+
+	dl_list_del(&req->list);
+	async->num_reqs--;
+	if (err && err != -ENOENT)
+		wpa_printf(MSG_DEBUG,
+			   "nl80211: Asynchronous command %u (seq %u) failed: %d (%s)",
+			   req->cmd, seq, err, strerror(-err));
+	if (req->done)
+		req->done(req->ctx, err);
+	os_free(req);
+}
+
+
+static int nl80211_async_valid(struct nl_msg *msg, void *arg)
+{
+	struct nl80211_async *async = arg;
+	struct nl80211_async_req *req;
+
+	req = nl80211_async_get_req(async, nlmsg_hdr(msg)->nlmsg_seq);
+	if (req && req->valid_handler)
+		req->valid_handler(msg, req->valid_data);
+	return NL_SKIP;
+}
+
+
+static int nl80211_async_ack(struct nl_msg *msg, void *arg)
+{
+	/* Continue with the rest of the batch instead of NL_STOP */
+	nl80211_async_complete(arg, nlmsg_hdr(msg)->nlmsg_seq, 0);
+	return NL_OK;
+}
+
+
+static int nl80211_async_finish(struct nl_msg *msg, void *arg)
+{
+	nl80211_async_complete(arg, nlmsg_hdr(msg)->nlmsg_seq, 0);
+	return NL_SKIP;
+}
+
+
+static int nl80211_async_error(struct sockaddr_nl *nla, struct nlmsgerr *err,
+			       void *arg)
+{
+	nl80211_async_complete(arg, err->msg.nlmsg_seq, err->error);
+	return NL_SKIP;
+}
+
+
+static int nl80211_async_seq_check(struct nl_msg *msg, void *arg)
+{
+	return NL_OK;
+}
+
+
+static void nl80211_async_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct nl80211_async *async = eloop_ctx;
+
+	struct nl80211_async_req *req, *tmp;
+	int res;
+
+	res = nl_recvmsgs(async->handle, async->cb);
+	if (res >= 0)
+		return;
+	wpa_printf(MSG_INFO, "nl80211: %s->nl_recvmsgs failed: %d",
+		   __func__, res);
+#ifdef NLE_NOMEM
+	if (res != -NLE_NOMEM)
+		return;
+#else /* NLE_NOMEM */
+	if (res != -ENOBUFS)
+		return;
+#endif /* NLE_NOMEM */
+
+	/*
+	 * Responses were dropped due to the receive buffer overflowing (the
+	 * kernel reports this as ENOBUFS) and there is no way of knowing which
+	 * ones, so do not leave the sent commands waiting forever.
+	 */
+	dl_list_for_each_safe(req, tmp, &async->reqs, struct nl80211_async_req,
+			      list) {
+		if (req->sent)
+			nl80211_async_complete(async, req->seq, -ENOBUFS);
+	}
+}
+
+
+static void nl80211_async_flush_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct nl80211_async *async = eloop_ctx;
+
+	async->flush_scheduled = 0;
+	nl80211_async_flush(async);
+}
+
+
+/* Wait for and process the next response */
+static int nl80211_async_poll(struct nl80211_async *async)
+{
+	struct pollfd pfd;
+
+	os_memset(&pfd, 0, sizeof(pfd));
+	pfd.fd = nl_socket_get_fd(async->handle);
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, NL80211_ASYNC_WAIT_MS) <= 0) {
+		wpa_printf(MSG_INFO,
+			   "nl80211: No response to %u asynchronous command(s)",
+			   async->num_reqs);
+		return -ETIMEDOUT;
+	}
+	nl80211_async_receive(pfd.fd, async, NULL);
+	return 0;
+}
+
+
+static int nl80211_async_drain(struct nl80211_async *async,
+			       unsigned int max_pending)
+{
+	nl80211_async_flush(async);
+	while (async->num_reqs > max_pending) {
+		if (nl80211_async_poll(async) < 0)
+			return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+
+/**
+ * nl80211_async_init - Initialize asynchronous command processing
+ * @handle: Connected netlink handle to use for the commands
+ * Returns: Pointer to the context or %NULL on failure
+ *
+ * The handle is used only for the asynchronous commands and it needs to
+ * remain valid until nl80211_async_deinit() has been called.
+ */
+struct nl80211_async * nl80211_async_init(struct nl_handle *handle)
+{
+	struct nl80211_async *async;
+
+	async = os_zalloc(sizeof(*async));
+	if (!async)
+		return NULL;
+	async->handle = handle;
+	dl_list_init(&async->reqs);
+
+	async->cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!async->cb) {
+		os_free(async);
+		return NULL;
+	}
+	nl_cb_set(async->cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM,
+		  nl80211_async_seq_check, NULL);
+	nl_cb_set(async->cb, NL_CB_VALID, NL_CB_CUSTOM, nl80211_async_valid,
+		  async);
+	nl_cb_set(async->cb, NL_CB_ACK, NL_CB_CUSTOM, nl80211_async_ack,
+		  async);
+	nl_cb_set(async->cb, NL_CB_FINISH, NL_CB_CUSTOM, nl80211_async_finish,
+		  async);
+	nl_cb_err(async->cb, NL_CB_CUSTOM, nl80211_async_error, async);
+
+#ifdef CONFIG_LIBNL20
+	/* Room for the responses to all pending commands */
+	if (nl_socket_set_buffer_size(handle, 262144, 0) < 0)
+		wpa_printf(MSG_DEBUG,
+			   "nl80211: Could not set async nl_socket RX buffer size: %s",
+			   strerror(errno));
+#endif /* CONFIG_LIBNL20 */
+
+#if defined(NETLINK_CAP_ACK) && defined(SOL_NETLINK)
+	{
+		int val = 1;
+
+		/* Do not include the full command in each ACK */
+		setsockopt(nl_socket_get_fd(handle), SOL_NETLINK,
+			   NETLINK_CAP_ACK, &val, sizeof(val));
+	}
+#endif /* NETLINK_CAP_ACK && SOL_NETLINK */
+
+	nl_socket_set_nonblocking(handle);
+	eloop_register_read_sock(nl_socket_get_fd(handle),
+				 nl80211_async_receive, async, NULL);
+
+	return async;
+}
+
+
+/**
+ * nl80211_async_deinit - Deinitialize asynchronous command processing
+ * @async: Context from nl80211_async_init()
+ *
+ * Queued commands are sent before returning. The done callbacks are not called
+ * for commands that have not yet been completed.
+ */
+void nl80211_async_deinit(struct nl80211_async *async)
+{
+	struct nl80211_async_req *req, *tmp;
+
+	if (!async)
+		return;
+
+	nl80211_async_flush(async);
+	eloop_cancel_timeout(nl80211_async_flush_timeout, async, NULL);
+	eloop_unregister_read_sock(nl_socket_get_fd(async->handle));
+	dl_list_for_each_safe(req, tmp, &async->reqs,
+			      struct nl80211_async_req, list) {
+		dl_list_del(&req->list);
+		os_free(req);
+	}
+	nl_cb_put(async->cb);
+	os_free(async);
+}
+
+
+/**
+ * nl80211_send_async - Queue a command without waiting for the response
+ * @async: Context from nl80211_async_init()
+ * @msg: Command to send; this is freed by the function
+ * @valid_handler: Handler for response messages or %NULL
+ * @valid_data: Context data for valid_handler
+ * @done: Callback for the result (0 or -errno) of the command or %NULL
+ * @ctx: Context data for done
+ * Returns: 0 if the command was queued or -errno on failure
+ *
+ * The handlers are called from eloop or, if too many commands are already
+ * waiting for a response, from within this function. The command message is
+ * cleared once sent, so this can be used for commands that include key
+ * material.
+ */
+int nl80211_send_async(struct nl80211_async *async, struct nl_msg *msg,
+		       int (*valid_handler)(struct nl_msg *, void *),
+		       void *valid_data,
+		       void (*done)(void *ctx, int err), void *ctx)
+{
+	struct nl80211_async_req *req;
+	struct nlmsghdr *hdr;
+	size_t len;
+	int ret;
+
+	if (!msg)
+		return -ENOMEM;
+
+	/*
+	 * Limit the number of outstanding commands so that the responses fit
+	 * in the socket receive buffer even if the responses are not processed
+	 * until the next eloop iteration.
+	 */
+	if (async->num_reqs >= NL80211_ASYNC_MAX_PENDING &&
+	    nl80211_async_drain(async, NL80211_ASYNC_MAX_PENDING / 2) < 0) {
+		nlmsg_free(msg);
+		return -EBUSY;
+	}
+
+	req = os_zalloc(sizeof(*req));
+	if (!req) {
+		nlmsg_free(msg);
+		return -ENOMEM;
+	}
+
+	nl_auto_complete(async->handle, msg);
+	hdr = nlmsg_hdr(msg);
+	len = NLMSG_ALIGN(hdr->nlmsg_len);
+	if (async->batch_len + len > sizeof(async->batch)) {
+		ret = nl80211_async_flush(async);
+		if (ret < 0)
+			goto fail;
+	}
+
+	if (len > sizeof(async->batch)) {
+		/* Too long to be batched, so send this on its own */
+		if (nl_sendto(async->handle, hdr, hdr->nlmsg_len) < 0) {
+			ret = -EIO;
+			goto fail;
+		}
+		req->sent = 1;
+	} else {
+		os_memcpy(&async->batch[async->batch_len], hdr,
+			  hdr->nlmsg_len);
+		os_memset(&async->batch[async->batch_len + hdr->nlmsg_len], 0,
+			  len - hdr->nlmsg_len);
+		async->batch_len += len;
+		async->batch_count++;
+	}
+
+	req->seq = hdr->nlmsg_seq;
+	if (hdr->nlmsg_len >= NLMSG_HDRLEN + GENL_HDRLEN)
+		req->cmd = ((struct genlmsghdr *) nlmsg_data(hdr))->cmd;
+	req->valid_handler = valid_handler;
+	req->valid_data = valid_data;
+	req->done = done;
+	req->ctx = ctx;
+	dl_list_add_tail(&async->reqs, &req->list);
+	async->num_reqs++;
+
+	os_memset(nlmsg_data(hdr), 0, hdr->nlmsg_len - NLMSG_HDRLEN);
+	nlmsg_free(msg);
+
+	if (async->batch_count && !async->flush_scheduled &&
+	    eloop_register_timeout(0, 0, nl80211_async_flush_timeout, async,
+				   NULL) == 0)
+		async->flush_scheduled = 1;
+
+	return 0;
+
+fail:
+	os_memset(nlmsg_data(hdr), 0, hdr->nlmsg_len - NLMSG_HDRLEN);
+	nlmsg_free(msg);
+	os_free(req);
+	return ret;
+}
+
+
+/**
+ * nl80211_async_flush - Send queued commands
+ * @async: Context from nl80211_async_init() or %NULL
+ * Returns: 0 on success or -errno on failure
+ *
+ * This needs to be called before sending other commands to the kernel if they
+ * may depend on the queued ones.
+ */
+int nl80211_async_flush(struct nl80211_async *async)
+{
+	struct nl80211_async_req *req, *tmp;
+	unsigned int count;
+	int res;
+
+	if (!async || !async->batch_count)
+		return 0;
+
+	res = nl_sendto(async->handle, async->batch, async->batch_len);
+	os_memset(async->batch, 0, async->batch_len);
+	count = async->batch_count;
+	async->batch_len = 0;
+	async->batch_count = 0;
+	if (res < 0)
+		wpa_printf(MSG_INFO,
+			   "nl80211: Failed to send %u asynchronous command(s): %d",
+			   count, res);
+
+	dl_list_for_each_safe(req, tmp, &async->reqs, struct nl80211_async_req,
+			      list) {
+		if (req->sent)
+			continue;
+		if (count-- == 0)
+			break;
+		req->sent = 1;
+		if (res < 0)
+			nl80211_async_complete(async, req->seq, -EIO);
+	}
+
+	return res < 0 ? -EIO : 0;
+}
+
+
+/**
+ * nl80211_async_wait - Wait for all pending commands to complete
+ * @async: Context from nl80211_async_init() or %NULL
+ * Returns: 0 on success or -ETIMEDOUT if some commands did not complete
+ *
+ * This can be used by callers that need to know the results of the commands
+ * before continuing. The done callbacks are called from this function.
+ */
+int nl80211_async_wait(struct nl80211_async *async)
+{
+	if (!async)
+		return 0;
+	return nl80211_async_drain(async, 0);
+}
+
+
+/**
+ * nl80211_async_queued - Number of commands queued for sending
+ * @async: Context from nl80211_async_init() or %NULL
+ * Returns: Number of commands that have not yet been sent
+ */
+unsigned int nl80211_async_queued(struct nl80211_async *async)
+{
+	return async ? async->batch_count : 0;
+}
+
+
+/**
+ * nl80211_async_cancel - Cancel done callbacks for a context
+ * @async: Context from nl80211_async_init() or %NULL
+ * @ctx: Context data that was passed to nl80211_send_async()
+ *
+ * The commands themselves are not cancelled, but neither the valid_handler nor
+ * done callback will be called for them anymore. This needs to be called
+ * before freeing the context data.
+ */
+void nl80211_async_cancel(struct nl80211_async *async, void *ctx)
+{
+	struct nl80211_async_req *req;
+
+	if (!async)
+		return;
+
+	dl_list_for_each(req, &async->reqs, struct nl80211_async_req, list) {
+		if (req->ctx == ctx) {
+			req->valid_handler = NULL;
+			req->done = NULL;
+		}
+	}
+}
+
+
+/**
+ * nl80211_async_pending - Number of commands waiting for completion
+ * @async: Context from nl80211_async_init() or %NULL
+ * Returns: Number of queued or sent, but not yet completed, commands
+ */
+unsigned int nl80211_async_pending(struct nl80211_async *async)
+{
+	return async ? async->num_reqs : 0;
+}
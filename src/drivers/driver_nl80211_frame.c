@@ -0,0 +1,126 @@
+/*
+ * Driver interaction with Linux nl80211/cfg80211 - in-place frame commands
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * NL80211_CMD_FRAME carries the whole management frame in the
+ * NL80211_ATTR_FRAME attribute. When the frame was allocated with
+ * frame_pool_alloc(), the netlink message header, the generic netlink header,
+ * and the other attributes are written into the headroom in front of the
+ * frame, so that the frame becomes the payload of the last attribute and the
+ * message can be sent as is. This avoids allocating a netlink message and
+ * copying the frame into it for each transmitted frame.
+ */
+
+#include "includes.h"
+#include <netlink/genl/genl.h>
+
+#include "utils/common.h"
+#include "driver_nl80211.h"
+
+
+static u8 * nl80211_put_attr(u8 *pos, u16 type, const void *data, size_t len)
+{
+	struct nlattr *nla = (struct nlattr *) pos;
+
+	nla->nla_type = type;
+	nla->nla_len = NLA_HDRLEN + len;
+	pos += NLA_HDRLEN;
+	if (len) {
+		os_memcpy(pos, data, len);
+		os_memset(pos + len, 0, NLA_ALIGN(len) - len);
+	}
+	return pos + NLA_ALIGN(len);
+}
+
+
+/**
+ * nl80211_frame_cmd_inplace - Build NL80211_CMD_FRAME in front of a frame
+ * @handle: Netlink handle that will be used to send the message
+ * @family: nl80211 generic netlink family id
+ * @ifindex: Interface index (used if @wdev_id is %NULL)
+ * @wdev_id: Wireless device id or %NULL
+ * @freq: Frequency in MHz or 0 to not include NL80211_ATTR_WIPHY_FREQ
+ * @wait: Wait time in ms or 0 to not include NL80211_ATTR_DURATION
+ * @flags: Flag attributes to include
+ * @num_flags: Number of entries in @flags
+ * @frame: Frame to send
+ * @frame_len: Length of the frame
+ * @headroom: Number of octets that can be used in front of the frame
+ * Returns: Netlink message to be sent with nl_sendto() or %NULL if the
+ * message headers do not fit in the headroom
+ */
+struct nlmsghdr * nl80211_frame_cmd_inplace(struct nl_handle *handle,
+					    int family, int ifindex,
+					    const u64 *wdev_id,
+					    unsigned int freq,
+					    unsigned int wait,
+					    const u16 *flags, size_t num_flags,
+					    u8 *frame, size_t frame_len,
+					    size_t headroom)
+{
+	struct nlmsghdr *hdr;
+	struct genlmsghdr *genl;
+	struct nlattr *nla;
+	size_t attrs_len, i;
+	u32 val;
+	u8 *pos;
+
+	attrs_len = nla_total_size(wdev_id ? sizeof(u64) : sizeof(u32));
+	if (freq)
+		attrs_len += nla_total_size(sizeof(u32));
+	if (wait)
+		attrs_len += nla_total_size(sizeof(u32));
+	attrs_len += num_flags * NLA_HDRLEN;
+
+	if (NLMSG_HDRLEN + GENL_HDRLEN + attrs_len + NLA_HDRLEN > headroom ||
+	    NLA_HDRLEN + frame_len > 0xffff ||
+	    ((uintptr_t) frame & (NLA_ALIGNTO - 1)))
+		return NULL;
+
+	pos = frame - NLA_HDRLEN - attrs_len - GENL_HDRLEN - NLMSG_HDRLEN;
+	hdr = (struct nlmsghdr *) pos;
+	hdr->nlmsg_len = NLMSG_HDRLEN + GENL_HDRLEN + attrs_len + NLA_HDRLEN +
+		frame_len;
+	hdr->nlmsg_type = family;
+	hdr->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+	hdr->nlmsg_seq = nl_socket_use_seq(handle);
+	hdr->nlmsg_pid = nl_socket_get_local_port(handle);
+	pos += NLMSG_HDRLEN;
+
+	genl = (struct genlmsghdr *) pos;
+	genl->cmd = NL80211_CMD_FRAME;
+	genl->version = 0;
+	genl->reserved = 0;
+	pos += GENL_HDRLEN;
+
+	if (wdev_id) {
+		pos = nl80211_put_attr(pos, NL80211_ATTR_WDEV, wdev_id,
+				       sizeof(*wdev_id));
+	} else {
+		val = ifindex;
+		pos = nl80211_put_attr(pos, NL80211_ATTR_IFINDEX, &val,
+				       sizeof(val));
+	}
+	if (freq) {
+		val = freq;
+		pos = nl80211_put_attr(pos, NL80211_ATTR_WIPHY_FREQ, &val,
+				       sizeof(val));
+	}
+	if (wait) {
+		val = wait;
+		pos = nl80211_put_attr(pos, NL80211_ATTR_DURATION, &val,
+				       sizeof(val));
+	}
+	for (i = 0; i < num_flags; i++)
+		pos = nl80211_put_attr(pos, flags[i], NULL, 0);
+
+	/* The frame itself is the payload of the last attribute */
+	nla = (struct nlattr *) pos;
+	nla->nla_type = NL80211_ATTR_FRAME;
+	nla->nla_len = NLA_HDRLEN + frame_len;
+
+	return hdr;
+}
@@ -433,6 +433,31 @@ int wpa_driver_nl80211_stop_sched_scan(void *priv)
 }
 
 
+/**
+ * wpa_driver_nl80211_abort_scan - Abort an ongoing scan
+ * @priv: Pointer to private driver data from wpa_driver_nl80211_init()
+ * Returns: 0 on success, -1 on failure
+ */
+int wpa_driver_nl80211_abort_scan(void *priv)
+{
+	struct i802_bss *bss = priv;
+	struct wpa_driver_nl80211_data *drv = bss->drv;
+	int ret;
+	struct nl_msg *msg;
+
+	msg = nl80211_drv_msg(drv, 0, NL80211_CMD_ABORT_SCAN);
+	ret = send_and_recv_msgs(drv, msg, NULL, NULL);
+	if (ret) {
+		wpa_printf(MSG_DEBUG, "nl80211: Abort scan failed: ret=%d (%s)",
+			   ret, strerror(-ret));
+		return -1;
+	}
+
+	wpa_printf(MSG_DEBUG, "nl80211: Abort scan sent");
+	return 0;
+}
+
+
 const u8 * nl80211_get_ie(const u8 *ies, size_t ies_len, u8 ie)
 {
 	const u8 *end, *pos;
@@ -504,7 +529,8 @@ int bss_info_handler(struct nl_msg *msg, void *arg)
 	const u8 *ie, *beacon_ie;
 	size_t ie_len, beacon_ie_len;
 	u8 *pos;
-	size_t i;
+	size_t i, *hnext;
+	u8 h;
 
 	nla_parse(tb, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
 		  genlmsg_attrlen(gnlh, 0), NULL);
@@ -618,15 +644,20 @@ int bss_info_handler(struct nl_msg *msg, void *arg)
 	 * not use frequency as a separate key in the BSS table, so filter out
 	 * duplicated entries. Prefer associated BSS entry in such a case in
 	 * order to get the correct frequency into the BSS table. Similarly,
-	 * prefer newer entries over older.
+	 * prefer newer entries over older. The entries already in the results
+	 * are found through a hash on BSSID to avoid going through all of
+	 * them for each entry in large dumps.
 	 */
-	for (i = 0; i < res->num; i++) {
+	h = NL80211_BSS_HASH(r->bssid);
+	for (i = _arg->hash[h]; i; i = _arg->hnext[i - 1]) {
+		struct wpa_scan_res *prev = res->res[i - 1];
 		const u8 *s1, *s2;
-		if (os_memcmp(res->res[i]->bssid, r->bssid, ETH_ALEN) != 0)
+
+		if (os_memcmp(prev->bssid, r->bssid, ETH_ALEN) != 0)
 			continue;
 
-		s1 = nl80211_get_ie((u8 *) (res->res[i] + 1),
-				    res->res[i]->ie_len, WLAN_EID_SSID);
+		s1 = nl80211_get_ie((u8 *) (prev + 1), prev->ie_len,
+				    WLAN_EID_SSID);
 		s2 = nl80211_get_ie((u8 *) (r + 1), r->ie_len, WLAN_EID_SSID);
 		if (s1 == NULL || s2 == NULL || s1[1] != s2[1] ||
 		    os_memcmp(s1, s2, 2 + s1[1]) != 0)
@@ -637,23 +668,36 @@ int bss_info_handler(struct nl_msg *msg, void *arg)
 			   "for " MACSTR, MAC2STR(r->bssid));
 
 		if (((r->flags & WPA_SCAN_ASSOCIATED) &&
-		     !(res->res[i]->flags & WPA_SCAN_ASSOCIATED)) ||
-		    r->age < res->res[i]->age) {
-			os_free(res->res[i]);
-			res->res[i] = r;
+		     !(prev->flags & WPA_SCAN_ASSOCIATED)) ||
+		    r->age < prev->age) {
+			os_free(prev);
+			res->res[i - 1] = r;
 		} else
 			os_free(r);
 		return NL_SKIP;
 	}
 
-	tmp = os_realloc_array(res->res, res->num + 1,
-			       sizeof(struct wpa_scan_res *));
-	if (tmp == NULL) {
-		os_free(r);
-		return NL_SKIP;
+	if (res->num == _arg->res_size) {
+		size_t size = _arg->res_size ? 2 * _arg->res_size : 32;
+
+		tmp = os_realloc_array(res->res, size,
+				       sizeof(struct wpa_scan_res *));
+		if (tmp == NULL) {
+			os_free(r);
+			return NL_SKIP;
+		}
+		res->res = tmp;
+		hnext = os_realloc_array(_arg->hnext, size, sizeof(size_t));
+		if (hnext == NULL) {
+			os_free(r);
+			return NL_SKIP;
+		}
+		_arg->hnext = hnext;
+		_arg->res_size = size;
 	}
-	tmp[res->num++] = r;
-	res->res = tmp;
+	_arg->hnext[res->num] = _arg->hash[h];
+	res->res[res->num++] = r;
+	_arg->hash[h] = res->num;
 
 	return NL_SKIP;
 }
@@ -723,9 +767,11 @@ nl80211_get_scan_results(struct wpa_driver_nl80211_data *drv)
 		return NULL;
 	}
 
+	os_memset(&arg, 0, sizeof(arg));
 	arg.drv = drv;
 	arg.res = res;
 	ret = send_and_recv_msgs(drv, msg, bss_info_handler, &arg);
+	os_free(arg.hnext);
 	if (ret == 0) {
 		wpa_printf(MSG_DEBUG, "nl80211: Received scan results (%lu "
 			   "BSSes)", (unsigned long) res->num);
@@ -81,41 +81,46 @@ static int eap_pwd_kdf(const u8 *key, size_t keylen, const u8 *label,
 }
 
 
-/*
- * compute a "random" secret point on an elliptic curve based
- * on the password and identities.
- */
-int compute_password_element(EAP_PWD_group *grp, u16 num,
-			     const u8 *password, size_t password_len,
-			     const u8 *id_server, size_t id_server_len,
-			     const u8 *id_peer, size_t id_peer_len,
-			     const u8 *token)
+static int eap_pwd_group_nid(u16 num)
 {
-	BIGNUM *x_candidate = NULL, *rnd = NULL, *cofactor = NULL;
-	struct crypto_hash *hash;
-	unsigned char pwe_digest[SHA256_MAC_LEN], *prfbuf = NULL, ctr;
-	int nid, is_odd, ret = 0;
-	size_t primebytelen, primebitlen;
-
 	switch (num) { /* from IANA registry for IKE D-H groups */
         case 19:
-		nid = NID_X9_62_prime256v1;
-		break;
+		return NID_X9_62_prime256v1;
         case 20:
-		nid = NID_secp384r1;
-		break;
+		return NID_secp384r1;
         case 21:
-		nid = NID_secp521r1;
-		break;
+		return NID_secp521r1;
 #ifndef OPENSSL_IS_BORINGSSL
         case 25:
-		nid = NID_X9_62_prime192v1;
-		break;
+		return NID_X9_62_prime192v1;
 #endif /* OPENSSL_IS_BORINGSSL */
         case 26:
-		nid = NID_secp224r1;
-		break;
+		return NID_secp224r1;
         default:
+		return -1;
+	}
+}
+
+
+static void eap_pwd_group_clear(EAP_PWD_group *grp)
+{
+	EC_GROUP_free(grp->group);
+	grp->group = NULL;
+	EC_POINT_clear_free(grp->pwe);
+	grp->pwe = NULL;
+	BN_clear_free(grp->order);
+	grp->order = NULL;
+	BN_clear_free(grp->prime);
+	grp->prime = NULL;
+}
+
+
+static int eap_pwd_group_setup(EAP_PWD_group *grp, u16 num)
+{
+	int nid;
+
+	nid = eap_pwd_group_nid(num);
+	if (nid < 0) {
 		wpa_printf(MSG_INFO, "EAP-pwd: unsupported group %d", num);
 		return -1;
 	}
@@ -129,12 +134,9 @@ int compute_password_element(EAP_PWD_group *grp, u16 num,
 		goto fail;
 	}
 
-	if (((rnd = BN_new()) == NULL) ||
-	    ((cofactor = BN_new()) == NULL) ||
-	    ((grp->pwe = EC_POINT_new(grp->group)) == NULL) ||
+	if (((grp->pwe = EC_POINT_new(grp->group)) == NULL) ||
 	    ((grp->order = BN_new()) == NULL) ||
-	    ((grp->prime = BN_new()) == NULL) ||
-	    ((x_candidate = BN_new()) == NULL)) {
+	    ((grp->prime = BN_new()) == NULL)) {
 		wpa_printf(MSG_INFO, "EAP-pwd: unable to create bignums");
 		goto fail;
 	}
@@ -149,6 +151,173 @@ int compute_password_element(EAP_PWD_group *grp, u16 num,
 		wpa_printf(MSG_INFO, "EAP-pwd: unable to get order for curve");
 		goto fail;
 	}
+	grp->group_num = num;
+	return 0;
+
+fail:
+	eap_pwd_group_clear(grp);
+	return -1;
+}
+
+
+/*
+ * Pools of group and BN_CTX contexts. Creating an EC_GROUP includes
+ * precomputation that is significant compared to the rest of an EAP-pwd
+ * exchange, so contexts are returned to the pool at the end of a session and
+ * reused by the following ones. The pools are only accessed from the main
+ * thread; a context that has been taken from the pool may be passed to a
+ * worker thread.
+ */
+#define EAP_PWD_GROUP_POOL_SIZE 16
+#define EAP_PWD_BNCTX_POOL_SIZE 16
+
+static EAP_PWD_group *group_pool = NULL;
+static unsigned int group_pool_len = 0;
+static BN_CTX *bnctx_pool[EAP_PWD_BNCTX_POOL_SIZE];
+static unsigned int bnctx_pool_len = 0;
+
+
+/**
+ * eap_pwd_group_get - Get a group context
+ * @num: Group number
+ * Returns: Group context with an unset PWE or %NULL on failure
+ *
+ * The returned context is ready for compute_password_element(). It is freed
+ * (or returned to the pool) with eap_pwd_group_put().
+ */
+EAP_PWD_group * eap_pwd_group_get(u16 num)
+{
+	EAP_PWD_group *grp, **prev;
+
+	for (prev = &group_pool; *prev; prev = &(*prev)->next) {
+		grp = *prev;
+		if (grp->group_num == num) {
+			*prev = grp->next;
+			grp->next = NULL;
+			group_pool_len--;
+			return grp;
+		}
+	}
+
+	grp = os_zalloc(sizeof(*grp));
+	if (grp == NULL)
+		return NULL;
+	if (eap_pwd_group_setup(grp, num) < 0) {
+		os_free(grp);
+		return NULL;
+	}
+	return grp;
+}
+
+
+/**
+ * eap_pwd_group_put - Release a group context from eap_pwd_group_get()
+ * @grp: Group context or %NULL
+ */
+void eap_pwd_group_put(EAP_PWD_group *grp)
+{
+	if (grp == NULL)
+		return;
+
+	if (grp->group && grp->pwe && grp->order && grp->prime &&
+	    group_pool_len < EAP_PWD_GROUP_POOL_SIZE) {
+		/* Do not leave the password element behind in the pool */
+		EC_POINT_clear_free(grp->pwe);
+		grp->pwe = EC_POINT_new(grp->group);
+		if (grp->pwe) {
+			grp->next = group_pool;
+			group_pool = grp;
+			group_pool_len++;
+			return;
+		}
+	}
+
+	eap_pwd_group_clear(grp);
+	os_free(grp);
+}
+
+
+/**
+ * eap_pwd_bnctx_get - Get a BN_CTX
+ * Returns: BN_CTX or %NULL on failure
+ */
+BN_CTX * eap_pwd_bnctx_get(void)
+{
+	if (bnctx_pool_len > 0)
+		return bnctx_pool[--bnctx_pool_len];
+	return BN_CTX_new();
+}
+
+
+/**
+ * eap_pwd_bnctx_put - Release a BN_CTX from eap_pwd_bnctx_get()
+ * @bnctx: BN_CTX or %NULL
+ */
+void eap_pwd_bnctx_put(BN_CTX *bnctx)
+{
+	if (bnctx == NULL)
+		return;
+	if (bnctx_pool_len < EAP_PWD_BNCTX_POOL_SIZE)
+		bnctx_pool[bnctx_pool_len++] = bnctx;
+	else
+		BN_CTX_free(bnctx);
+}
+
+
+/**
+ * eap_pwd_pool_deinit - Free the pooled group and BN_CTX contexts
+ */
+void eap_pwd_pool_deinit(void)
+{
+	EAP_PWD_group *grp;
+
+	while ((grp = group_pool)) {
+		group_pool = grp->next;
+		eap_pwd_group_clear(grp);
+		os_free(grp);
+	}
+	group_pool_len = 0;
+
+	while (bnctx_pool_len > 0)
+		BN_CTX_free(bnctx_pool[--bnctx_pool_len]);
+}
+
+
+/*
+ * compute a "random" secret point on an elliptic curve based
+ * on the password and identities.
+ *
+ * grp can either be a zeroed structure or a context from eap_pwd_group_get().
+ * This does not use any global state, so it can be called from a worker
+ * thread.
+ */
+int compute_password_element(EAP_PWD_group *grp, u16 num,
+			     const u8 *password, size_t password_len,
+			     const u8 *id_server, size_t id_server_len,
+			     const u8 *id_peer, size_t id_peer_len,
+			     const u8 *token)
+{
+	BIGNUM *x_candidate = NULL, *rnd = NULL, *cofactor = NULL;
+	struct crypto_hash *hash;
+	unsigned char pwe_digest[SHA256_MAC_LEN], *prfbuf = NULL, ctr;
+	int is_odd, ret = 0;
+	size_t primebytelen, primebitlen;
+
+	if (grp->group == NULL) {
+		if (eap_pwd_group_setup(grp, num) < 0)
+			return -1;
+	} else if (grp->group_num != num) {
+		wpa_printf(MSG_INFO, "EAP-pwd: group context mismatch");
+		return -1;
+	}
+
+	if (((rnd = BN_new()) == NULL) ||
+	    ((cofactor = BN_new()) == NULL) ||
+	    ((x_candidate = BN_new()) == NULL)) {
+		wpa_printf(MSG_INFO, "EAP-pwd: unable to create bignums");
+		goto fail;
+	}
+
 	if (!EC_GROUP_get_cofactor(grp->group, cofactor, NULL)) {
 		wpa_printf(MSG_INFO, "EAP-pwd: unable to get cofactor for "
 			   "curve");
@@ -261,17 +430,9 @@ int compute_password_element(EAP_PWD_group *grp, u16 num,
 		break;
 	}
 	wpa_printf(MSG_DEBUG, "EAP-pwd: found a PWE in %d tries", ctr);
-	grp->group_num = num;
 	if (0) {
  fail:
-		EC_GROUP_free(grp->group);
-		grp->group = NULL;
-		EC_POINT_clear_free(grp->pwe);
-		grp->pwe = NULL;
-		BN_clear_free(grp->order);
-		grp->order = NULL;
-		BN_clear_free(grp->prime);
-		grp->prime = NULL;
+		eap_pwd_group_clear(grp);
 		ret = 1;
 	}
 	/* cleanliness and order.... */
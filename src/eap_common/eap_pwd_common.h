@@ -23,6 +23,7 @@ typedef struct group_definition_ {
 	EC_POINT *pwe;
 	BIGNUM *order;
 	BIGNUM *prime;
+	struct group_definition_ *next; /* free list in the context pool */
 } EAP_PWD_group;
 
 /*
@@ -65,6 +66,11 @@ int compute_keys(EAP_PWD_group *grp, BN_CTX *bnctx, const BIGNUM *k,
 		 const BIGNUM *peer_scalar, const BIGNUM *server_scalar,
 		 const u8 *confirm_peer, const u8 *confirm_server,
 		 const u32 *ciphersuite, u8 *msk, u8 *emsk, u8 *session_id);
+EAP_PWD_group * eap_pwd_group_get(u16 num);
+void eap_pwd_group_put(EAP_PWD_group *grp);
+BN_CTX * eap_pwd_bnctx_get(void);
+void eap_pwd_bnctx_put(BN_CTX *bnctx);
+void eap_pwd_pool_deinit(void);
 struct crypto_hash * eap_pwd_h_init(void);
 void eap_pwd_h_update(struct crypto_hash *hash, const u8 *data, size_t len);
 void eap_pwd_h_final(struct crypto_hash *hash, u8 *digest);
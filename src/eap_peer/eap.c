@@ -710,7 +710,7 @@ SM_STATE(EAP, SEND_RESPONSE)
 		if (sm->workaround)
 			os_memcpy(sm->last_md5, sm->req_md5, 16);
 		sm->lastId = sm->reqId;
-		sm->lastRespData = wpabuf_dup(sm->eapRespData);
+		sm->lastRespData = wpabuf_ref(sm->eapRespData);
 		eapol_set_bool(sm, EAPOL_eapResp, TRUE);
 	} else {
 		wpa_printf(MSG_DEBUG, "EAP: No eapRespData available");
@@ -778,7 +778,7 @@ SM_STATE(EAP, RETRANSMIT)
 	SM_ENTRY(EAP, RETRANSMIT);
 	wpabuf_free(sm->eapRespData);
 	if (sm->lastRespData)
-		sm->eapRespData = wpabuf_dup(sm->lastRespData);
+		sm->eapRespData = wpabuf_ref(sm->lastRespData);
 	else
 		sm->eapRespData = NULL;
 }
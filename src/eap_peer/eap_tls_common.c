@@ -287,6 +287,10 @@ int eap_peer_tls_ssl_init(struct eap_sm *sm, struct eap_ssl_data *data,
  */
 void eap_peer_tls_ssl_deinit(struct eap_sm *sm, struct eap_ssl_data *data)
 {
+	if (data->copies)
+		wpa_printf(MSG_DEBUG,
+			   "SSL: TLS data copied %u times (%lu bytes) for reassembly and fragmentation",
+			   data->copies, (unsigned long) data->copied_bytes);
 	tls_connection_deinit(data->ssl_ctx, data->conn);
 	eap_peer_tls_reset_input(data);
 	eap_peer_tls_reset_output(data);
@@ -377,7 +381,7 @@ u8 * eap_peer_tls_derive_session_id(struct eap_sm *sm,
 static int eap_peer_tls_reassemble_fragment(struct eap_ssl_data *data,
 					    const struct wpabuf *in_data)
 {
-	size_t tls_in_len, in_len;
+	size_t tls_in_len, in_len, alloc_len;
 
 	tls_in_len = data->tls_in ? wpabuf_len(data->tls_in) : 0;
 	in_len = in_data ? wpabuf_len(in_data) : 0;
@@ -412,7 +416,16 @@ static int eap_peer_tls_reassemble_fragment(struct eap_ssl_data *data,
 		return -1;
 	}
 
-	if (wpabuf_resize(&data->tls_in, in_len) < 0) {
+	/*
+	 * Allocate the full message on the first fragment when the length is
+	 * known to avoid reallocating and copying the buffer for each
+	 * fragment.
+	 */
+	alloc_len = in_len;
+	if (!data->tls_in && data->tls_in_total > in_len &&
+	    data->tls_in_total <= 65536)
+		alloc_len = data->tls_in_total;
+	if (wpabuf_resize(&data->tls_in, alloc_len) < 0) {
 		wpa_printf(MSG_INFO, "SSL: Could not allocate memory for TLS "
 			   "data");
 		eap_peer_tls_reset_input(data);
@@ -420,6 +433,8 @@ static int eap_peer_tls_reassemble_fragment(struct eap_ssl_data *data,
 	}
 	if (in_data)
 		wpabuf_put_buf(data->tls_in, in_data);
+	data->copies++;
+	data->copied_bytes += in_len;
 	data->tls_in_left -= in_len;
 
 	if (data->tls_in_left > 0) {
@@ -466,6 +481,8 @@ static const struct wpabuf * eap_peer_tls_data_reassemble(
 		data->tls_in = wpabuf_dup(in_data);
 		if (data->tls_in == NULL)
 			return NULL;
+		data->copies++;
+		data->copied_bytes += wpabuf_len(in_data);
 	}
 
 	return data->tls_in;
@@ -592,6 +609,8 @@ static int eap_tls_process_output(struct eap_ssl_data *data, EapType eap_type,
 	wpabuf_put_data(*out_data,
 			wpabuf_head_u8(data->tls_out) + data->tls_out_pos,
 			len);
+	data->copies++;
+	data->copied_bytes += len;
 	data->tls_out_pos += len;
 
 	if (!more_fragments)
@@ -73,6 +73,17 @@ struct eap_ssl_data {
 	 * eap_type - EAP method used in Phase 1 (EAP_TYPE_TLS/PEAP/TTLS/FAST)
 	 */
 	u8 eap_type;
+
+	/**
+	 * copies - Number of times TLS data has been copied for reassembly or
+	 * fragmentation during the exchange
+	 */
+	unsigned int copies;
+
+	/**
+	 * copied_bytes - Total length of the TLS data copies
+	 */
+	size_t copied_bytes;
 };
 
 
@@ -102,6 +102,7 @@ struct eapol_callbacks {
 	struct eap_server_erp_key * (*erp_get_key)(void *ctx,
 						   const char *keyname);
 	int (*erp_add_key)(void *ctx, struct eap_server_erp_key *erp);
+	void (*pending_done)(void *ctx);
 };
 
 struct eap_config {
@@ -145,6 +146,7 @@ void eap_server_sm_deinit(struct eap_sm *sm);
 int eap_server_sm_step(struct eap_sm *sm);
 void eap_sm_notify_cached(struct eap_sm *sm);
 void eap_sm_pending_cb(struct eap_sm *sm);
+void eap_server_pending_done(struct eap_sm *sm);
 int eap_sm_method_pending(struct eap_sm *sm);
 const u8 * eap_get_identity(struct eap_sm *sm, size_t *len);
 struct eap_eapol_interface * eap_get_interface(struct eap_sm *sm);
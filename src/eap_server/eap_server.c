@@ -112,14 +112,16 @@ static struct wpabuf * eap_sm_buildInitiateReauthStart(struct eap_sm *sm,
 }
 
 
-static int eap_copy_buf(struct wpabuf **dst, const struct wpabuf *src)
+static int eap_copy_buf(struct wpabuf **dst, struct wpabuf *src)
 {
 	if (src == NULL)
 		return -1;
 
+	/* The messages are not modified after this, so they can be shared */
+	wpabuf_ref(src);
 	wpabuf_free(*dst);
-	*dst = wpabuf_dup(src);
-	return *dst ? 0 : -1;
+	*dst = src;
+	return 0;
 }
 
 
@@ -1929,6 +1931,26 @@ void eap_sm_pending_cb(struct eap_sm *sm)
 }
 
 
+/**
+ * eap_server_pending_done - Notify completion of internal pending processing
+ * @sm: Pointer to EAP state machine allocated with eap_server_sm_init()
+ *
+ * This is used by EAP methods that use METHOD_PENDING_WAIT while an operation
+ * is completed asynchronously within the EAP server (e.g., in a worker
+ * thread). The owner of the EAP state machine is notified so that it can
+ * reprocess the pending EAP message.
+ */
+void eap_server_pending_done(struct eap_sm *sm)
+{
+	if (sm == NULL)
+		return;
+	if (sm->eapol_cb && sm->eapol_cb->pending_done)
+		sm->eapol_cb->pending_done(sm->eapol_ctx);
+	else
+		eap_sm_pending_cb(sm);
+}
+
+
 /**
  * eap_sm_method_pending - Query whether EAP method is waiting for pending data
  * @sm: Pointer to EAP state machine allocated with eap_server_sm_init()
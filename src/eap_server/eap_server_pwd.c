@@ -9,12 +9,40 @@
 #include "includes.h"
 
 #include "common.h"
+#include "utils/worker.h"
 #include "crypto/sha256.h"
 #include "crypto/ms_funcs.h"
 #include "eap_server/eap_i.h"
+#include "eap_server/eap_methods.h"
 #include "eap_common/eap_pwd_common.h"
 
 
+/*
+ * Password elements are derived in worker threads when those are available.
+ * If more derivations than this are already in progress, the element is
+ * derived synchronously.
+ */
+#define EAP_PWD_MAX_PWE_JOBS 64
+
+struct eap_pwd_pwe_job {
+	struct eap_sm *sm;
+	struct eap_pwd_data *data; /* NULL if the session has been freed */
+	EAP_PWD_group *grp;
+	u16 group_num;
+	u8 token[4];
+	const u8 *password;
+	size_t password_len;
+	const u8 *id_server;
+	size_t id_server_len;
+	const u8 *id_peer;
+	size_t id_peer_len;
+	size_t len; /* allocated length including the inputs */
+	int res;
+};
+
+static unsigned int pwe_jobs = 0;
+
+
 struct eap_pwd_data {
 	enum {
 		PWD_ID_Req, PWD_Commit_Req, PWD_Confirm_Req, SUCCESS, FAILURE
@@ -50,6 +78,10 @@ struct eap_pwd_data {
 	u8 session_id[1 + SHA256_MAC_LEN];
 
 	BN_CTX *bnctx;
+
+	struct eap_pwd_pwe_job *pwe_job;
+	int pwe_ready;
+	int pwe_res;
 };
 
 
@@ -116,7 +148,7 @@ static void * eap_pwd_init(struct eap_sm *sm)
 	os_memcpy(data->password, sm->user->password, data->password_len);
 	data->password_hash = sm->user->password_hash;
 
-	data->bnctx = BN_CTX_new();
+	data->bnctx = eap_pwd_bnctx_get();
 	if (data->bnctx == NULL) {
 		wpa_printf(MSG_INFO, "EAP-PWD: bn context allocation fail");
 		bin_clear_free(data->password, data->password_len);
@@ -138,23 +170,21 @@ static void eap_pwd_reset(struct eap_sm *sm, void *priv)
 {
 	struct eap_pwd_data *data = priv;
 
+	if (data->pwe_job) {
+		data->pwe_job->data = NULL;
+		worker_cancel(data->pwe_job);
+	}
 	BN_clear_free(data->private_value);
 	BN_clear_free(data->peer_scalar);
 	BN_clear_free(data->my_scalar);
 	BN_clear_free(data->k);
-	BN_CTX_free(data->bnctx);
+	eap_pwd_bnctx_put(data->bnctx);
 	EC_POINT_clear_free(data->my_element);
 	EC_POINT_clear_free(data->peer_element);
 	bin_clear_free(data->id_peer, data->id_peer_len);
 	bin_clear_free(data->id_server, data->id_server_len);
 	bin_clear_free(data->password, data->password_len);
-	if (data->grp) {
-		EC_GROUP_free(data->grp->group);
-		EC_POINT_clear_free(data->grp->pwe);
-		BN_clear_free(data->grp->order);
-		BN_clear_free(data->grp->prime);
-		os_free(data->grp);
-	}
+	eap_pwd_group_put(data->grp);
 	wpabuf_free(data->inbuf);
 	wpabuf_free(data->outbuf);
 	bin_clear_free(data, sizeof(*data));
@@ -578,6 +608,109 @@ static Boolean eap_pwd_check(struct eap_sm *sm, void *priv,
 }
 
 
+static void eap_pwd_pwe_derived(struct eap_pwd_data *data, int res)
+{
+	if (res) {
+		wpa_printf(MSG_INFO, "EAP-PWD (server): unable to compute "
+			   "PWE");
+		return;
+	}
+	wpa_printf(MSG_DEBUG, "EAP-PWD (server): computed %d bit PWE...",
+		   BN_num_bits(data->grp->prime));
+
+	eap_pwd_state(data, PWD_Commit_Req);
+}
+
+
+static void eap_pwd_pwe_job_free(struct eap_pwd_pwe_job *job)
+{
+	eap_pwd_group_put(job->grp);
+	bin_clear_free(job, job->len);
+}
+
+
+static void eap_pwd_pwe_job_run(void *ctx)
+{
+	struct eap_pwd_pwe_job *job = ctx;
+
+	job->res = compute_password_element(job->grp, job->group_num,
+					    job->password, job->password_len,
+					    job->id_server, job->id_server_len,
+					    job->id_peer, job->id_peer_len,
+					    job->token);
+}
+
+
+static void eap_pwd_pwe_job_done(void *ctx, int cancelled)
+{
+	struct eap_pwd_pwe_job *job = ctx;
+	struct eap_pwd_data *data = job->data;
+
+	pwe_jobs--;
+	if (data) {
+		data->pwe_job = NULL;
+		if (!cancelled) {
+			wpa_printf(MSG_DEBUG,
+				   "EAP-PWD (server): PWE derivation completed");
+			data->grp = job->grp;
+			job->grp = NULL;
+			data->pwe_res = job->res;
+			data->pwe_ready = 1;
+			eap_server_pending_done(job->sm);
+		}
+	}
+	eap_pwd_pwe_job_free(job);
+}
+
+
+static int eap_pwd_pwe_job_start(struct eap_sm *sm, struct eap_pwd_data *data,
+				 const u8 *password, size_t password_len)
+{
+	struct eap_pwd_pwe_job *job;
+	size_t len;
+	u8 *pos;
+
+	if (worker_threads() == 0 || pwe_jobs >= EAP_PWD_MAX_PWE_JOBS)
+		return -1;
+
+	len = sizeof(*job) + password_len + data->id_server_len +
+		data->id_peer_len;
+	job = os_zalloc(len);
+	if (job == NULL)
+		return -1;
+	job->len = len;
+	job->sm = sm;
+	job->data = data;
+	job->group_num = data->group_num;
+	os_memcpy(job->token, &data->token, sizeof(job->token));
+	pos = (u8 *) (job + 1);
+	os_memcpy(pos, password, password_len);
+	job->password = pos;
+	job->password_len = password_len;
+	pos += password_len;
+	os_memcpy(pos, data->id_server, data->id_server_len);
+	job->id_server = pos;
+	job->id_server_len = data->id_server_len;
+	pos += data->id_server_len;
+	os_memcpy(pos, data->id_peer, data->id_peer_len);
+	job->id_peer = pos;
+	job->id_peer_len = data->id_peer_len;
+	/* The group context is owned by the job until it completes */
+	job->grp = data->grp;
+
+	if (worker_submit(eap_pwd_pwe_job_run, eap_pwd_pwe_job_done, job) < 0)
+	{
+		bin_clear_free(job, job->len);
+		return -1;
+	}
+	data->grp = NULL;
+	data->pwe_job = job;
+	pwe_jobs++;
+	wpa_printf(MSG_DEBUG, "EAP-PWD (server): derive PWE in a worker thread");
+	return 0;
+}
+
+
 static void eap_pwd_process_id_resp(struct eap_sm *sm,
 				    struct eap_pwd_data *data,
 				    const u8 *payload, size_t payload_len)
@@ -612,7 +745,8 @@ static void eap_pwd_process_id_resp(struct eap_sm *sm,
 	wpa_hexdump_ascii(MSG_DEBUG, "EAP-PWD (server): peer sent id of",
 			  data->id_peer, data->id_peer_len);
 
-	data->grp = os_zalloc(sizeof(EAP_PWD_group));
+	eap_pwd_group_put(data->grp);
+	data->grp = eap_pwd_group_get(data->group_num);
 	if (data->grp == NULL) {
 		wpa_printf(MSG_INFO, "EAP-PWD: failed to allocate memory for "
 			   "group");
@@ -630,21 +764,19 @@ static void eap_pwd_process_id_resp(struct eap_sm *sm,
 		password_len = data->password_len;
 	}
 
+	if (eap_pwd_pwe_job_start(sm, data, password, password_len) == 0) {
+		os_memset(pwhashhash, 0, sizeof(pwhashhash));
+		sm->method_pending = METHOD_PENDING_WAIT;
+		return;
+	}
+
 	res = compute_password_element(data->grp, data->group_num,
 				       password, password_len,
 				       data->id_server, data->id_server_len,
 				       data->id_peer, data->id_peer_len,
 				       (u8 *) &data->token);
 	os_memset(pwhashhash, 0, sizeof(pwhashhash));
-	if (res) {
-		wpa_printf(MSG_INFO, "EAP-PWD (server): unable to compute "
-			   "PWE");
-		return;
-	}
-	wpa_printf(MSG_DEBUG, "EAP-PWD (server): computed %d bit PWE...",
-		   BN_num_bits(data->grp->prime));
-
-	eap_pwd_state(data, PWD_Commit_Req);
+	eap_pwd_pwe_derived(data, res);
 }
 
 
@@ -911,6 +1043,18 @@ static void eap_pwd_process(struct eap_sm *sm, void *priv,
 	u8 lm_exch;
 	u16 tot_len;
 
+	if (data->pwe_job) {
+		wpa_printf(MSG_DEBUG,
+			   "EAP-pwd: PWE derivation in progress - ignore message");
+		return;
+	}
+	if (data->pwe_ready) {
+		/* Reprocessing the ID response after pending PWE derivation */
+		data->pwe_ready = 0;
+		eap_pwd_pwe_derived(data, data->pwe_res);
+		return;
+	}
+
 	pos = eap_hdr_validate(EAP_VENDOR_IETF, EAP_TYPE_PWD, respData, &len);
 	if ((pos == NULL) || (len < 1)) {
 		wpa_printf(MSG_INFO, "Bad EAP header! pos %s and len = %d",
@@ -1091,6 +1235,13 @@ static u8 * eap_pwd_get_session_id(struct eap_sm *sm, void *priv, size_t *len)
 }
 
 
+static void eap_pwd_method_free(struct eap_method *method)
+{
+	eap_pwd_pool_deinit();
+	eap_server_method_free(method);
+}
+
+
 int eap_server_pwd_register(void)
 {
 	struct eap_method *eap;
@@ -1120,6 +1271,7 @@ int eap_server_pwd_register(void)
 	eap->get_emsk = eap_pwd_get_emsk;
 	eap->isSuccess = eap_pwd_is_success;
 	eap->getSessionId = eap_pwd_get_session_id;
+	eap->free = eap_pwd_method_free;
 
 	ret = eap_server_method_register(eap);
 	if (ret)
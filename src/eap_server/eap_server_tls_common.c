@@ -90,6 +90,10 @@ int eap_server_tls_ssl_init(struct eap_sm *sm, struct eap_ssl_data *data,
 
 void eap_server_tls_ssl_deinit(struct eap_sm *sm, struct eap_ssl_data *data)
 {
+	if (data->copies)
+		wpa_printf(MSG_DEBUG,
+			   "SSL: TLS data copied %u times (%lu bytes) for reassembly and fragmentation",
+			   data->copies, (unsigned long) data->copied_bytes);
 	tls_connection_deinit(sm->ssl_ctx, data->conn);
 	eap_server_tls_free_in_buf(data);
 	wpabuf_free(data->tls_out);
@@ -195,6 +199,8 @@ struct wpabuf * eap_server_tls_build_msg(struct eap_ssl_data *data,
 
 	wpabuf_put_data(req, wpabuf_head_u8(data->tls_out) + data->tls_out_pos,
 			send_len);
+	data->copies++;
+	data->copied_bytes += send_len;
 	data->tls_out_pos += send_len;
 
 	if (data->tls_out_pos == wpabuf_len(data->tls_out)) {
@@ -240,6 +246,8 @@ static int eap_server_tls_process_cont(struct eap_ssl_data *data,
 	}
 
 	wpabuf_put_data(data->tls_in, buf, len);
+	data->copies++;
+	data->copied_bytes += len;
 	wpa_printf(MSG_DEBUG, "SSL: Received %lu bytes, waiting for %lu "
 		   "bytes more", (unsigned long) len,
 		   (unsigned long) wpabuf_tailroom(data->tls_in));
@@ -284,6 +292,8 @@ static int eap_server_tls_process_fragment(struct eap_ssl_data *data,
 			return -1;
 		}
 		wpabuf_put_data(data->tls_in, buf, len);
+		data->copies++;
+		data->copied_bytes += len;
 		wpa_printf(MSG_DEBUG, "SSL: Received %lu bytes in first "
 			   "fragment, waiting for %lu bytes more",
 			   (unsigned long) len,
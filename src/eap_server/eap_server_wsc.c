@@ -76,6 +76,17 @@ static void eap_wsc_ext_reg_timeout(void *eloop_ctx, void *timeout_ctx)
 }
 
 
+static void eap_wsc_pending_cb(void *ctx)
+{
+	struct eap_sm *sm = ctx;
+
+	if (sm->method_pending != METHOD_PENDING_WAIT)
+		return;
+	wpa_printf(MSG_DEBUG, "EAP-WSC: Pending WPS processing completed");
+	eap_server_pending_done(sm);
+}
+
+
 static void * eap_wsc_init(struct eap_sm *sm)
 {
 	struct eap_wsc_data *data;
@@ -139,6 +150,10 @@ static void * eap_wsc_init(struct eap_sm *sm)
 	}
 #endif /* CONFIG_P2P */
 	cfg.pbc_in_m1 = sm->pbc_in_m1;
+	if (registrar) {
+		cfg.pending_cb = eap_wsc_pending_cb;
+		cfg.pending_cb_ctx = sm;
+	}
 	data->wps = wps_init(&cfg);
 	if (data->wps == NULL) {
 		os_free(data);
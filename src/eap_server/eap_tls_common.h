@@ -48,6 +48,17 @@ struct eap_ssl_data {
 	 */
 	struct eap_sm *eap;
 
+	/**
+	 * copies - Number of times TLS data has been copied for reassembly or
+	 * fragmentation during the exchange
+	 */
+	unsigned int copies;
+
+	/**
+	 * copied_bytes - Total length of the TLS data copies
+	 */
+	size_t copied_bytes;
+
 	enum { MSG, FRAG_ACK, WAIT_FRAG_ACK } state;
 	struct wpabuf tmpbuf;
 };
@@ -1056,6 +1056,14 @@ static int eapol_sm_erp_add_key(void *ctx, struct eap_server_erp_key *erp)
 }
 
 
+static void eapol_sm_pending_done(void *ctx)
+{
+	struct eapol_state_machine *sm = ctx;
+
+	eapol_auth_eap_pending_cb(sm, sm->eap);
+}
+
+
 static const struct eapol_callbacks eapol_cb =
 {
 	eapol_sm_get_eap_user,
@@ -1065,6 +1073,7 @@ static const struct eapol_callbacks eapol_cb =
 	eapol_sm_get_erp_domain,
 	eapol_sm_erp_get_key,
 	eapol_sm_erp_add_key,
+	eapol_sm_pending_done,
 };
 
 
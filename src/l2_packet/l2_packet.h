@@ -109,6 +109,25 @@ int l2_packet_get_own_addr(struct l2_packet_data *l2, u8 *addr);
 int l2_packet_send(struct l2_packet_data *l2, const u8 *dst_addr, u16 proto,
 		   const u8 *buf, size_t len);
 
+/**
+ * l2_packet_send_multi - Send copies of a packet to multiple destinations
+ * @l2: Pointer to internal l2_packet data from l2_packet_init()
+ * @dst_addrs: Destination addresses (num_dst * ETH_ALEN octets)
+ * @num_dst: Number of destination addresses
+ * @buf: Packet contents to be sent including the layer 2 header
+ * @len: Length of the buffer
+ * Returns: Number of packets sent or -1 if this is not supported
+ *
+ * This sends a copy of the packet for each destination address with the
+ * destination address in the layer 2 header replaced. buf itself is not
+ * modified. This can only be used if l2_hdr was set to 1 in l2_packet_init()
+ * call. l2_packet implementation will need to define the function, but it can
+ * return -1 in which case the caller is expected to send the copies with
+ * l2_packet_send().
+ */
+int l2_packet_send_multi(struct l2_packet_data *l2, const u8 *dst_addrs,
+			 size_t num_dst, const u8 *buf, size_t len);
+
 /**
  * l2_packet_get_ip_addr - Get the current IP address from the interface
  * @l2: Pointer to internal l2_packet data from l2_packet_init()
@@ -151,4 +170,20 @@ void l2_packet_notify_auth_start(struct l2_packet_data *l2);
 int l2_packet_set_packet_filter(struct l2_packet_data *l2,
 				enum l2_packet_filter_type type);
 
+/**
+ * l2_packet_enable_rx_ring - Receive packets through a memory-mapped ring
+ * @l2: Pointer to internal l2_packet data from l2_packet_init()
+ * Returns: 0 on success, -1 if not supported
+ *
+ * This function can be used for l2_packet sockets that receive large amounts
+ * of traffic (e.g., with a filter from l2_packet_set_packet_filter() on a
+ * bridge interface) to avoid a system call and a copy for each received
+ * packet. Packets are processed in batches and the buffer passed to the
+ * rx_callback points directly to the ring; it is valid only until the callback
+ * returns and the callback must not call l2_packet_deinit(). l2_packet
+ * implementation will need to define the function, but it can return -1 in
+ * which case packets continue to be received one at a time.
+ */
+int l2_packet_enable_rx_ring(struct l2_packet_data *l2);
+
 #endif /* L2_PACKET_H */
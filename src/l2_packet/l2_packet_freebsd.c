@@ -72,6 +72,13 @@ int l2_packet_send(struct l2_packet_data *l2, const u8 *dst_addr, u16 proto,
 }
 
 
+int l2_packet_send_multi(struct l2_packet_data *l2, const u8 *dst_addrs,
+			 size_t num_dst, const u8 *buf, size_t len)
+{
+	return -1;
+}
+
+
 static void l2_packet_receive(int sock, void *eloop_ctx, void *sock_ctx)
 {
 	struct l2_packet_data *l2 = eloop_ctx;
@@ -327,3 +334,9 @@ int l2_packet_set_packet_filter(struct l2_packet_data *l2,
 {
 	return -1;
 }
+
+
+int l2_packet_enable_rx_ring(struct l2_packet_data *l2)
+{
+	return -1;
+}
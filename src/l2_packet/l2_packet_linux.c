@@ -6,9 +6,13 @@
  * See README for more details.
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* sendmmsg() */
+#endif /* _GNU_SOURCE */
 #include "includes.h"
 #include <sys/ioctl.h>
-#include <netpacket/packet.h>
+#include <sys/mman.h>
+#include <linux/if_packet.h>
 #include <net/if.h>
 #include <linux/filter.h>
 
@@ -35,6 +39,13 @@ struct l2_packet_data {
 	int last_from_br;
 	u8 last_hash[SHA1_MAC_LEN];
 	unsigned int num_rx, num_rx_br;
+
+#ifdef TPACKET3_HDRLEN
+	/* Memory-mapped TPACKET_V3 RX ring (l2_packet_enable_rx_ring()) */
+	u8 *ring;
+	size_t ring_len;
+	unsigned int ring_block;
+#endif /* TPACKET3_HDRLEN */
 };
 
 /* Generated by 'sudo tcpdump -s 3000 -dd greater 278 and ip and udp and
@@ -64,14 +75,22 @@ static const struct sock_fprog dhcp_sock_filter = {
 };
 
 
-/* Generated by 'sudo tcpdump -dd -s 1500 multicast and ip6[6]=58' */
+/* Generated by 'sudo tcpdump -dd -s 1500 multicast and ip6[6]=58 and
+ * (ip6[40]=134 or ip6[40]=135 or ip6[40]=136)', i.e., only the Router
+ * Advertisement, Neighbor Solicitation, and Neighbor Advertisement messages
+ * that are processed for proxy ARP/NDISC snooping
+ */
 static struct sock_filter ndisc_sock_filter_insns[] = {
 	{ 0x30, 0, 0, 0x00000000 },
-	{ 0x45, 0, 5, 0x00000001 },
+	{ 0x45, 0, 9, 0x00000001 },
 	{ 0x28, 0, 0, 0x0000000c },
-	{ 0x15, 0, 3, 0x000086dd },
+	{ 0x15, 0, 7, 0x000086dd },
 	{ 0x30, 0, 0, 0x00000014 },
-	{ 0x15, 0, 1, 0x0000003a },
+	{ 0x15, 0, 5, 0x0000003a },
+	{ 0x30, 0, 0, 0x00000036 },
+	{ 0x15, 2, 0, 0x00000086 },
+	{ 0x15, 1, 0, 0x00000087 },
+	{ 0x15, 0, 1, 0x00000088 },
 	{ 0x6, 0, 0, 0x000005dc },
 	{ 0x6, 0, 0, 0x00000000 },
 };
@@ -119,6 +138,59 @@ int l2_packet_send(struct l2_packet_data *l2, const u8 *dst_addr, u16 proto,
 }
 
 
+/* Maximum number of packets to pass to the kernel in a single sendmmsg() */
+#define L2_PACKET_SEND_BATCH 64
+
+int l2_packet_send_multi(struct l2_packet_data *l2, const u8 *dst_addrs,
+			 size_t num_dst, const u8 *buf, size_t len)
+{
+	struct mmsghdr msgs[L2_PACKET_SEND_BATCH];
+	struct iovec iov[L2_PACKET_SEND_BATCH][2];
+	size_t i, n, pos = 0;
+	int res, sent = 0;
+
+	if (l2 == NULL || !l2->l2_hdr || len < ETH_ALEN)
+		return -1;
+
+	/*
+	 * Each copy consists of the destination address followed by the rest
+	 * of the original packet, so the packet itself does not need to be
+	 * copied or modified.
+	 */
+	while (pos < num_dst) {
+		n = num_dst - pos;
+		if (n > L2_PACKET_SEND_BATCH)
+			n = L2_PACKET_SEND_BATCH;
+		os_memset(msgs, 0, n * sizeof(msgs[0]));
+		for (i = 0; i < n; i++) {
+			iov[i][0].iov_base = (void *) &dst_addrs[(pos + i) *
+								 ETH_ALEN];
+			iov[i][0].iov_len = ETH_ALEN;
+			iov[i][1].iov_base = (void *) (buf + ETH_ALEN);
+			iov[i][1].iov_len = len - ETH_ALEN;
+			msgs[i].msg_hdr.msg_iov = iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 2;
+		}
+
+		res = sendmmsg(l2->fd, msgs, n, 0);
+		if (res < 0) {
+			if (errno == ENOSYS && pos == 0)
+				return -1;
+			wpa_printf(MSG_DEBUG,
+				   "l2_packet_send_multi - sendmmsg: %s",
+				   strerror(errno));
+			/* Skip the packet that could not be sent */
+			res = 1;
+		} else {
+			sent += res;
+		}
+		pos += res;
+	}
+
+	return sent;
+}
+
+
 static void l2_packet_receive(int sock, void *eloop_ctx, void *sock_ctx)
 {
 	struct l2_packet_data *l2 = eloop_ctx;
@@ -216,6 +288,69 @@ static void l2_packet_receive_br(int sock, void *eloop_ctx, void *sock_ctx)
 }
 
 
+#ifdef TPACKET3_HDRLEN
+
+/* TPACKET_V3 RX ring parameters */
+#define L2_PACKET_RING_BLOCK_SIZE (1 << 15)
+#define L2_PACKET_RING_BLOCKS 8
+#define L2_PACKET_RING_FRAME_SIZE 2048
+#define L2_PACKET_RING_TIMEOUT_MS 10
+
+static void l2_packet_receive_ring(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct l2_packet_data *l2 = eloop_ctx;
+	struct tpacket_block_desc *bd;
+	struct tpacket3_hdr *hdr;
+	struct sockaddr_ll *ll;
+	unsigned int i, num_pkts, blocks = 0;
+
+	/*
+	 * Process all blocks that the kernel has handed over. The frames are
+	 * passed to the callback directly from the ring and the block is
+	 * returned to the kernel once all of its frames have been processed.
+	 */
+	while (blocks < L2_PACKET_RING_BLOCKS) {
+		bd = (struct tpacket_block_desc *)
+			(l2->ring + l2->ring_block * L2_PACKET_RING_BLOCK_SIZE);
+		if (!(bd->hdr.bh1.block_status & TP_STATUS_USER))
+			break;
+
+		num_pkts = bd->hdr.bh1.num_pkts;
+		wpa_printf(MSG_EXCESSIVE, "%s: block %u: %u packets",
+			   __func__, l2->ring_block, num_pkts);
+		hdr = (struct tpacket3_hdr *)
+			((u8 *) bd + bd->hdr.bh1.offset_to_first_pkt);
+		for (i = 0; i < num_pkts; i++) {
+			ll = (struct sockaddr_ll *)
+				((u8 *) hdr +
+				 TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+			l2->num_rx++;
+			l2->rx_callback(l2->rx_callback_ctx, ll->sll_addr,
+					(u8 *) hdr + hdr->tp_mac,
+					hdr->tp_snaplen);
+			hdr = (struct tpacket3_hdr *)
+				((u8 *) hdr + hdr->tp_next_offset);
+		}
+
+		__sync_synchronize();
+		bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+		l2->ring_block = (l2->ring_block + 1) % L2_PACKET_RING_BLOCKS;
+		blocks++;
+	}
+}
+
+
+static void l2_packet_ring_deinit(struct l2_packet_data *l2)
+{
+	if (l2->ring) {
+		munmap(l2->ring, l2->ring_len);
+		l2->ring = NULL;
+	}
+}
+
+#endif /* TPACKET3_HDRLEN */
+
+
 struct l2_packet_data * l2_packet_init(
 	const char *ifname, const u8 *own_addr, unsigned short protocol,
 	void (*rx_callback)(void *ctx, const u8 *src_addr,
@@ -377,6 +512,10 @@ void l2_packet_deinit(struct l2_packet_data *l2)
 		close(l2->fd_br_rx);
 	}
 
+#ifdef TPACKET3_HDRLEN
+	l2_packet_ring_deinit(l2);
+#endif /* TPACKET3_HDRLEN */
+
 	os_free(l2);
 }
 
@@ -445,3 +584,74 @@ int l2_packet_set_packet_filter(struct l2_packet_data *l2,
 
 	return 0;
 }
+
+
+int l2_packet_enable_rx_ring(struct l2_packet_data *l2)
+{
+#ifdef TPACKET3_HDRLEN
+	struct tpacket_req3 req;
+	int ver = TPACKET_V3;
+	void *ring;
+
+	if (l2 == NULL || l2->fd < 0)
+		return -1;
+	if (l2->ring)
+		return 0;
+	if (l2->fd_br_rx >= 0) {
+		/* Duplicate detection with the workaround socket needs copies */
+		return -1;
+	}
+
+	if (setsockopt(l2->fd, SOL_PACKET, PACKET_VERSION, &ver,
+		       sizeof(ver)) < 0) {
+		wpa_printf(MSG_DEBUG,
+			   "l2_packet_linux: setsockopt(PACKET_VERSION) failed: %s",
+			   strerror(errno));
+		return -1;
+	}
+
+	os_memset(&req, 0, sizeof(req));
+	req.tp_block_size = L2_PACKET_RING_BLOCK_SIZE;
+	req.tp_block_nr = L2_PACKET_RING_BLOCKS;
+	req.tp_frame_size = L2_PACKET_RING_FRAME_SIZE;
+	req.tp_frame_nr = L2_PACKET_RING_BLOCK_SIZE / L2_PACKET_RING_FRAME_SIZE *
+		L2_PACKET_RING_BLOCKS;
+	req.tp_retire_blk_tov = L2_PACKET_RING_TIMEOUT_MS;
+	if (setsockopt(l2->fd, SOL_PACKET, PACKET_RX_RING, &req,
+		       sizeof(req)) < 0) {
+		wpa_printf(MSG_DEBUG,
+			   "l2_packet_linux: setsockopt(PACKET_RX_RING) failed: %s",
+			   strerror(errno));
+		goto fail;
+	}
+
+	l2->ring_len = (size_t) req.tp_block_size * req.tp_block_nr;
+	ring = mmap(NULL, l2->ring_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    l2->fd, 0);
+	if (ring == MAP_FAILED) {
+		wpa_printf(MSG_DEBUG, "l2_packet_linux: mmap(RX ring): %s",
+			   strerror(errno));
+		os_memset(&req, 0, sizeof(req));
+		setsockopt(l2->fd, SOL_PACKET, PACKET_RX_RING, &req,
+			   sizeof(req));
+		goto fail;
+	}
+	l2->ring = ring;
+	l2->ring_block = 0;
+
+	eloop_unregister_read_sock(l2->fd);
+	eloop_register_read_sock(l2->fd, l2_packet_receive_ring, l2, NULL);
+	wpa_printf(MSG_DEBUG,
+		   "l2_packet_linux: Using TPACKET_V3 RX ring (%u x %u bytes) on %s",
+		   req.tp_block_nr, req.tp_block_size, l2->ifname);
+
+	return 0;
+
+fail:
+	ver = TPACKET_V1;
+	setsockopt(l2->fd, SOL_PACKET, PACKET_VERSION, &ver, sizeof(ver));
+	return -1;
+#else /* TPACKET3_HDRLEN */
+	return -1;
+#endif /* TPACKET3_HDRLEN */
+}
@@ -12,6 +12,9 @@
 #include "utils/wpabuf.h"
 #include "crypto/md5.h"
 #include "crypto/crypto.h"
+#ifdef CONFIG_INTERNAL_MD5
+#include "crypto/md5_i.h"
+#endif /* CONFIG_INTERNAL_MD5 */
 #include "radius.h"
 
 
@@ -46,6 +49,15 @@ struct radius_msg {
 	 * attr_used - Total number of attributes in the array
 	 */
 	size_t attr_used;
+
+	/**
+	 * secret_state - Precomputed shared secret state or %NULL
+	 *
+	 * This is set by the owner of the shared secret with
+	 * radius_msg_set_secret_state() and is used only when the secret
+	 * passed to the radius_msg_*() functions matches it.
+	 */
+	const struct radius_secret_state *secret_state;
 };
 
 
@@ -69,6 +81,151 @@ radius_get_attr_hdr(struct radius_msg *msg, int idx)
 }
 
 
+/**
+ * struct radius_secret_state - Precomputed MD5 state for a shared secret
+ *
+ * The secret-dependent part of HMAC-MD5 and of the MD5(Secret + ...)
+ * constructions does not need to be repeated for each message. This is owned
+ * by the RADIUS client (per server) or server (per client) data.
+ */
+struct radius_secret_state {
+	u8 *secret;
+	size_t secret_len;
+#ifdef CONFIG_INTERNAL_MD5
+	struct hmac_md5_state hmac;
+	struct MD5Context prefix; /* MD5 state after processing the secret */
+#endif /* CONFIG_INTERNAL_MD5 */
+};
+
+
+/**
+ * radius_secret_state_init - Precompute MD5 state for a shared secret
+ * @secret: Shared secret
+ * @secret_len: Length of secret in octets
+ * Returns: Pointer to the state or %NULL if not available
+ *
+ * The state can be attached to messages with radius_msg_set_secret_state().
+ * %NULL is returned if the MD5 implementation does not allow the state to be
+ * precomputed; the radius_msg_*() functions work without it.
+ */
+struct radius_secret_state * radius_secret_state_init(const u8 *secret,
+						      size_t secret_len)
+{
+#ifdef CONFIG_INTERNAL_MD5
+	struct radius_secret_state *state;
+
+	state = os_zalloc(sizeof(*state));
+	if (state == NULL)
+		return NULL;
+	state->secret = os_malloc(secret_len ? secret_len : 1);
+	if (state->secret == NULL) {
+		os_free(state);
+		return NULL;
+	}
+	os_memcpy(state->secret, secret, secret_len);
+	state->secret_len = secret_len;
+	hmac_md5_state_init(&state->hmac, secret, secret_len);
+	MD5Init(&state->prefix);
+	MD5Update(&state->prefix, secret, secret_len);
+	return state;
+#else /* CONFIG_INTERNAL_MD5 */
+	return NULL;
+#endif /* CONFIG_INTERNAL_MD5 */
+}
+
+
+/**
+ * radius_secret_state_free - Free shared secret state
+ * @state: State from radius_secret_state_init() or %NULL
+ *
+ * The state must not be attached to any message anymore.
+ */
+void radius_secret_state_free(struct radius_secret_state *state)
+{
+	if (state == NULL)
+		return;
+	bin_clear_free(state->secret, state->secret_len);
+	bin_clear_free(state, sizeof(*state));
+}
+
+
+/**
+ * radius_secret_state_match - Check whether state is for the given secret
+ * @state: State from radius_secret_state_init() or %NULL
+ * @secret: Shared secret
+ * @secret_len: Length of secret in octets
+ * Returns: 1 if @state was precomputed for @secret, 0 if not
+ */
+int radius_secret_state_match(const struct radius_secret_state *state,
+			      const u8 *secret, size_t secret_len)
+{
+	return state && secret && state->secret_len == secret_len &&
+		os_memcmp_const(state->secret, secret, secret_len) == 0;
+}
+
+
+/**
+ * radius_msg_set_secret_state - Attach shared secret state to a message
+ * @msg: RADIUS message
+ * @state: State from radius_secret_state_init() or %NULL to detach
+ *
+ * The state is used by the functions that process @msg with the matching
+ * shared secret. The caller is responsible for keeping @state available for
+ * as long as it is attached to @msg.
+ */
+void radius_msg_set_secret_state(struct radius_msg *msg,
+				 const struct radius_secret_state *state)
+{
+	msg->secret_state = state;
+}
+
+
+static const struct radius_secret_state *
+radius_msg_secret_state(const struct radius_msg *msg, const u8 *secret,
+			size_t secret_len)
+{
+	if (msg &&
+	    radius_secret_state_match(msg->secret_state, secret, secret_len))
+		return msg->secret_state;
+	return NULL;
+}
+
+
+static void radius_hmac_md5(const struct radius_secret_state *state,
+			    const u8 *secret, size_t secret_len,
+			    const u8 *data, size_t data_len, u8 *mac)
+{
+#ifdef CONFIG_INTERNAL_MD5
+	if (state) {
+		hmac_md5_state_vector(&state->hmac, 1, &data, &data_len, mac);
+		return;
+	}
+#endif /* CONFIG_INTERNAL_MD5 */
+	hmac_md5(secret, secret_len, data, data_len, mac);
+}
+
+
+/* MD5 over a data vector in which the first element is the shared secret */
+static int radius_md5_vector(const struct radius_secret_state *state,
+			     size_t num_elem, const u8 *addr[],
+			     const size_t *len, u8 *mac)
+{
+#ifdef CONFIG_INTERNAL_MD5
+	struct MD5Context ctx;
+	size_t i;
+
+	if (state) {
+		ctx = state->prefix;
+		for (i = 1; i < num_elem; i++)
+			MD5Update(&ctx, addr[i], len[i]);
+		MD5Final(mac, &ctx);
+		return 0;
+	}
+#endif /* CONFIG_INTERNAL_MD5 */
+	return md5_vector(num_elem, addr, len, mac);
+}
+
+
 static void radius_msg_set_hdr(struct radius_msg *msg, u8 code, u8 identifier)
 {
 	msg->hdr->code = code;
@@ -376,8 +533,10 @@ int radius_msg_finish(struct radius_msg *msg, const u8 *secret,
 			return -1;
 		}
 		msg->hdr->length = host_to_be16(wpabuf_len(msg->buf));
-		hmac_md5(secret, secret_len, wpabuf_head(msg->buf),
-			 wpabuf_len(msg->buf), (u8 *) (attr + 1));
+		radius_hmac_md5(radius_msg_secret_state(msg, secret,
+							secret_len),
+				secret, secret_len, wpabuf_head(msg->buf),
+				wpabuf_len(msg->buf), (u8 *) (attr + 1));
 	} else
 		msg->hdr->length = host_to_be16(wpabuf_len(msg->buf));
 
@@ -408,8 +567,9 @@ int radius_msg_finish_srv(struct radius_msg *msg, const u8 *secret,
 	msg->hdr->length = host_to_be16(wpabuf_len(msg->buf));
 	os_memcpy(msg->hdr->authenticator, req_authenticator,
 		  sizeof(msg->hdr->authenticator));
-	hmac_md5(secret, secret_len, wpabuf_head(msg->buf),
-		 wpabuf_len(msg->buf), (u8 *) (attr + 1));
+	radius_hmac_md5(radius_msg_secret_state(msg, secret, secret_len),
+			secret, secret_len, wpabuf_head(msg->buf),
+			wpabuf_len(msg->buf), (u8 *) (attr + 1));
 
 	/* ResponseAuth = MD5(Code+ID+Length+RequestAuth+Attributes+Secret) */
 	addr[0] = (u8 *) msg->hdr;
@@ -450,8 +610,9 @@ int radius_msg_finish_das_resp(struct radius_msg *msg, const u8 *secret,
 
 	msg->hdr->length = host_to_be16(wpabuf_len(msg->buf));
 	os_memcpy(msg->hdr->authenticator, req_hdr->authenticator, 16);
-	hmac_md5(secret, secret_len, wpabuf_head(msg->buf),
-		 wpabuf_len(msg->buf), (u8 *) (attr + 1));
+	radius_hmac_md5(radius_msg_secret_state(msg, secret, secret_len),
+			secret, secret_len, wpabuf_head(msg->buf),
+			wpabuf_len(msg->buf), (u8 *) (attr + 1));
 
 	/* ResponseAuth = MD5(Code+ID+Length+RequestAuth+Attributes+Secret) */
 	addr[0] = wpabuf_head_u8(msg->buf);
@@ -584,8 +745,9 @@ int radius_msg_verify_das_req(struct radius_msg *msg, const u8 *secret,
 		  sizeof(orig_authenticator));
 	os_memset(msg->hdr->authenticator, 0,
 		  sizeof(msg->hdr->authenticator));
-	hmac_md5(secret, secret_len, wpabuf_head(msg->buf),
-		 wpabuf_len(msg->buf), auth);
+	radius_hmac_md5(radius_msg_secret_state(msg, secret, secret_len),
+			secret, secret_len, wpabuf_head(msg->buf),
+			wpabuf_len(msg->buf), auth);
 	os_memcpy(attr + 1, orig, MD5_MAC_LEN);
 	os_memcpy(msg->hdr->authenticator, orig_authenticator,
 		  sizeof(orig_authenticator));
@@ -725,7 +887,16 @@ struct radius_msg * radius_msg_parse(const u8 *data, size_t len)
 int radius_msg_add_eap(struct radius_msg *msg, const u8 *data, size_t data_len)
 {
 	const u8 *pos = data;
-	size_t left = data_len;
+	size_t left = data_len, needed;
+
+	/* Reserve room for all EAP-Message attributes at once */
+	needed = data_len + (data_len + RADIUS_MAX_ATTR_LEN - 1) /
+		RADIUS_MAX_ATTR_LEN * sizeof(struct radius_attr_hdr);
+	if (wpabuf_tailroom(msg->buf) < needed) {
+		if (wpabuf_resize(&msg->buf, needed) < 0)
+			return 0;
+		msg->hdr = wpabuf_mhead(msg->buf);
+	}
 
 	while (left > 0) {
 		int len;
@@ -783,8 +954,11 @@ struct wpabuf * radius_msg_get_eap(struct radius_msg *msg)
 }
 
 
-int radius_msg_verify_msg_auth(struct radius_msg *msg, const u8 *secret,
-			       size_t secret_len, const u8 *req_auth)
+static int
+radius_msg_verify_msg_auth_state(struct radius_msg *msg,
+				 const struct radius_secret_state *state,
+				 const u8 *secret, size_t secret_len,
+				 const u8 *req_auth)
 {
 	u8 auth[MD5_MAC_LEN], orig[MD5_MAC_LEN];
 	u8 orig_authenticator[16];
@@ -815,8 +989,8 @@ int radius_msg_verify_msg_auth(struct radius_msg *msg, const u8 *secret,
 		os_memcpy(msg->hdr->authenticator, req_auth,
 			  sizeof(msg->hdr->authenticator));
 	}
-	hmac_md5(secret, secret_len, wpabuf_head(msg->buf),
-		 wpabuf_len(msg->buf), auth);
+	radius_hmac_md5(state, secret, secret_len, wpabuf_head(msg->buf),
+			wpabuf_len(msg->buf), auth);
 	os_memcpy(attr + 1, orig, MD5_MAC_LEN);
 	if (req_auth) {
 		os_memcpy(msg->hdr->authenticator, orig_authenticator,
@@ -832,6 +1006,15 @@ int radius_msg_verify_msg_auth(struct radius_msg *msg, const u8 *secret,
 }
 
 
+int radius_msg_verify_msg_auth(struct radius_msg *msg, const u8 *secret,
+			       size_t secret_len, const u8 *req_auth)
+{
+	return radius_msg_verify_msg_auth_state(
+		msg, radius_msg_secret_state(msg, secret, secret_len),
+		secret, secret_len, req_auth);
+}
+
+
 int radius_msg_verify(struct radius_msg *msg, const u8 *secret,
 		      size_t secret_len, struct radius_msg *sent_msg, int auth)
 {
@@ -844,9 +1027,11 @@ int radius_msg_verify(struct radius_msg *msg, const u8 *secret,
 		return 1;
 	}
 
+	/* The request carries the state of the RADIUS client */
 	if (auth &&
-	    radius_msg_verify_msg_auth(msg, secret, secret_len,
-				       sent_msg->hdr->authenticator)) {
+	    radius_msg_verify_msg_auth_state(
+		    msg, radius_msg_secret_state(sent_msg, secret, secret_len),
+		    secret, secret_len, sent_msg->hdr->authenticator)) {
 		return 1;
 	}
 
@@ -981,6 +1166,7 @@ static u8 *radius_msg_get_vendor_attr(struct radius_msg *msg, u32 vendor,
 
 static u8 * decrypt_ms_key(const u8 *key, size_t len,
 			   const u8 *req_authenticator,
+			   const struct radius_secret_state *state,
 			   const u8 *secret, size_t secret_len, size_t *reslen)
 {
 	u8 *plain, *ppos, *res;
@@ -1028,7 +1214,7 @@ static u8 * decrypt_ms_key(const u8 *key, size_t len,
 			addr[1] = pos - MD5_MAC_LEN;
 			elen[1] = MD5_MAC_LEN;
 		}
-		md5_vector(first ? 3 : 2, addr, elen, hash);
+		radius_md5_vector(state, first ? 3 : 2, addr, elen, hash);
 		first = 0;
 
 		for (i = 0; i < MD5_MAC_LEN; i++)
@@ -1057,6 +1243,7 @@ static u8 * decrypt_ms_key(const u8 *key, size_t len,
 
 static void encrypt_ms_key(const u8 *key, size_t key_len, u16 salt,
 			   const u8 *req_authenticator,
+			   const struct radius_secret_state *state,
 			   const u8 *secret, size_t secret_len,
 			   u8 *ebuf, size_t *elen)
 {
@@ -1092,7 +1279,7 @@ static void encrypt_ms_key(const u8 *key, size_t key_len, u16 salt,
 			addr[1] = pos - MD5_MAC_LEN;
 			_len[1] = MD5_MAC_LEN;
 		}
-		md5_vector(first ? 3 : 2, addr, _len, hash);
+		radius_md5_vector(state, first ? 3 : 2, addr, _len, hash);
 		first = 0;
 
 		for (i = 0; i < MD5_MAC_LEN; i++)
@@ -1110,9 +1297,11 @@ radius_msg_get_ms_keys(struct radius_msg *msg, struct radius_msg *sent_msg,
 	u8 *key;
 	size_t keylen;
 	struct radius_ms_mppe_keys *keys;
+	const struct radius_secret_state *state;
 
 	if (msg == NULL || sent_msg == NULL)
 		return NULL;
+	state = radius_msg_secret_state(sent_msg, secret, secret_len);
 
 	keys = os_zalloc(sizeof(*keys));
 	if (keys == NULL)
@@ -1123,7 +1312,7 @@ radius_msg_get_ms_keys(struct radius_msg *msg, struct radius_msg *sent_msg,
 					 &keylen);
 	if (key) {
 		keys->send = decrypt_ms_key(key, keylen,
-					    sent_msg->hdr->authenticator,
+					    sent_msg->hdr->authenticator, state,
 					    secret, secret_len,
 					    &keys->send_len);
 		if (!keys->send) {
@@ -1138,7 +1327,7 @@ radius_msg_get_ms_keys(struct radius_msg *msg, struct radius_msg *sent_msg,
 					 &keylen);
 	if (key) {
 		keys->recv = decrypt_ms_key(key, keylen,
-					    sent_msg->hdr->authenticator,
+					    sent_msg->hdr->authenticator, state,
 					    secret, secret_len,
 					    &keys->recv_len);
 		if (!keys->recv) {
@@ -1159,9 +1348,11 @@ radius_msg_get_cisco_keys(struct radius_msg *msg, struct radius_msg *sent_msg,
 	u8 *key;
 	size_t keylen;
 	struct radius_ms_mppe_keys *keys;
+	const struct radius_secret_state *state;
 
 	if (msg == NULL || sent_msg == NULL)
 		return NULL;
+	state = radius_msg_secret_state(sent_msg, secret, secret_len);
 
 	keys = os_zalloc(sizeof(*keys));
 	if (keys == NULL)
@@ -1172,7 +1363,7 @@ radius_msg_get_cisco_keys(struct radius_msg *msg, struct radius_msg *sent_msg,
 	if (key && keylen == 51 &&
 	    os_memcmp(key, "leap:session-key=", 17) == 0) {
 		keys->recv = decrypt_ms_key(key + 17, keylen - 17,
-					    sent_msg->hdr->authenticator,
+					    sent_msg->hdr->authenticator, state,
 					    secret, secret_len,
 					    &keys->recv_len);
 	}
@@ -1196,7 +1387,9 @@ int radius_msg_add_mppe_keys(struct radius_msg *msg,
 	size_t elen;
 	int hlen;
 	u16 salt;
+	const struct radius_secret_state *state;
 
+	state = radius_msg_secret_state(msg, secret, secret_len);
 	hlen = sizeof(vendor_id) + sizeof(*vhdr) + 2;
 
 	/* MS-MPPE-Send-Key */
@@ -1213,8 +1406,8 @@ int radius_msg_add_mppe_keys(struct radius_msg *msg,
 	salt = os_random() | 0x8000;
 	WPA_PUT_BE16(pos, salt);
 	pos += 2;
-	encrypt_ms_key(send_key, send_key_len, salt, req_authenticator, secret,
-		       secret_len, pos, &elen);
+	encrypt_ms_key(send_key, send_key_len, salt, req_authenticator, state,
+		       secret, secret_len, pos, &elen);
 	vhdr->vendor_length = hlen + elen - sizeof(vendor_id);
 
 	attr = radius_msg_add_attr(msg, RADIUS_ATTR_VENDOR_SPECIFIC,
@@ -1238,8 +1431,8 @@ int radius_msg_add_mppe_keys(struct radius_msg *msg,
 	salt ^= 1;
 	WPA_PUT_BE16(pos, salt);
 	pos += 2;
-	encrypt_ms_key(recv_key, recv_key_len, salt, req_authenticator, secret,
-		       secret_len, pos, &elen);
+	encrypt_ms_key(recv_key, recv_key_len, salt, req_authenticator, state,
+		       secret, secret_len, pos, &elen);
 	vhdr->vendor_length = hlen + elen - sizeof(vendor_id);
 
 	attr = radius_msg_add_attr(msg, RADIUS_ATTR_VENDOR_SPECIFIC,
@@ -1289,9 +1482,11 @@ int radius_user_password_hide(struct radius_msg *msg,
 	const u8 *addr[2];
 	size_t len[2];
 	u8 hash[16];
+	const struct radius_secret_state *state;
 
 	if (data_len + 16 > buf_len)
 		return -1;
+	state = radius_msg_secret_state(msg, secret, secret_len);
 
 	os_memcpy(buf, data, data_len);
 
@@ -1308,7 +1503,7 @@ int radius_user_password_hide(struct radius_msg *msg,
 	len[0] = secret_len;
 	addr[1] = msg->hdr->authenticator;
 	len[1] = 16;
-	md5_vector(2, addr, len, hash);
+	radius_md5_vector(state, 2, addr, len, hash);
 
 	for (i = 0; i < 16; i++)
 		buf[i] ^= hash[i];
@@ -1319,7 +1514,7 @@ int radius_user_password_hide(struct radius_msg *msg,
 		len[0] = secret_len;
 		addr[1] = &buf[pos - 16];
 		len[1] = 16;
-		md5_vector(2, addr, len, hash);
+		radius_md5_vector(state, 2, addr, len, hash);
 
 		for (i = 0; i < 16; i++)
 			buf[pos + i] ^= hash[i];
@@ -1521,6 +1716,9 @@ char * radius_msg_get_tunnel_password(struct radius_msg *msg, int *keylen,
 	const u8 *fdata = NULL; /* points to found item */
 	size_t fdlen = -1;
 	char *ret = NULL;
+	const struct radius_secret_state *state;
+
+	state = radius_msg_secret_state(sent_msg, secret, secret_len);
 
 	/* find n-th valid Tunnel-Password attribute */
 	for (i = 0; i < msg->attr_used; i++) {
@@ -1564,7 +1762,7 @@ char * radius_msg_get_tunnel_password(struct radius_msg *msg, int *keylen,
 		len[0] = secret_len;
 		addr[1] = pos - 16;
 		len[1] = 16;
-		md5_vector(2, addr, len, hash);
+		radius_md5_vector(state, 2, addr, len, hash);
 
 		for (i = 0; i < 16; i++)
 			pos[i] ^= hash[i];
@@ -1581,7 +1779,7 @@ char * radius_msg_get_tunnel_password(struct radius_msg *msg, int *keylen,
 	len[1] = 16;
 	addr[2] = salt;
 	len[2] = 2;
-	md5_vector(3, addr, len, hash);
+	radius_md5_vector(state, 3, addr, len, hash);
 
 	for (i = 0; i < 16; i++)
 		pos[i] ^= hash[i];
@@ -202,6 +202,7 @@ struct radius_ms_mppe_keys {
 
 
 struct radius_msg;
+struct radius_secret_state;
 
 /* Default size to be allocated for new RADIUS messages */
 #define RADIUS_DEFAULT_MSG_SIZE 1024
@@ -278,6 +279,13 @@ int radius_msg_get_vlanid(struct radius_msg *msg);
 char * radius_msg_get_tunnel_password(struct radius_msg *msg, int *keylen,
 				      const u8 *secret, size_t secret_len,
 				      struct radius_msg *sent_msg, size_t n);
+struct radius_secret_state * radius_secret_state_init(const u8 *secret,
+						      size_t secret_len);
+void radius_secret_state_free(struct radius_secret_state *state);
+int radius_secret_state_match(const struct radius_secret_state *state,
+			      const u8 *secret, size_t secret_len);
+void radius_msg_set_secret_state(struct radius_msg *msg,
+				 const struct radius_secret_state *state);
 
 static inline int radius_msg_add_attr_int32(struct radius_msg *msg, u8 type,
 					    u32 value)
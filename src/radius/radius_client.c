@@ -9,6 +9,7 @@
 #include "includes.h"
 
 #include "common.h"
+#include "list.h"
 #include "radius.h"
 #include "radius_client.h"
 #include "eloop.h"
@@ -49,6 +50,20 @@
  */
 #define RADIUS_CLIENT_NUM_FAILOVER 4
 
+/**
+ * RADIUS_CLIENT_ACCT_QUEUE_MAX - RADIUS client maximum queued accounting msgs
+ *
+ * Maximum number of accounting messages waiting to be sent when the number of
+ * pending accounting requests is limited with acct_max_pending. Additional
+ * messages are written to the spool file, if one is configured, or dropped.
+ */
+#define RADIUS_CLIENT_ACCT_QUEUE_MAX 256
+
+/**
+ * RADIUS_CLIENT_ACCT_SPOOL_MAX - RADIUS client maximum spool file size
+ */
+#define RADIUS_CLIENT_ACCT_SPOOL_MAX (4 * 1024 * 1024)
+
 
 /**
  * struct radius_rx_handler - RADIUS client RX handler
@@ -143,6 +158,18 @@ struct radius_msg_list {
 };
 
 
+/**
+ * struct radius_acct_queued - Accounting message waiting to be sent
+ */
+struct radius_acct_queued {
+	struct dl_list list;
+	struct radius_msg *msg;
+	RadiusType msg_type;
+	u8 addr[ETH_ALEN];
+	int has_addr;
+};
+
+
 /**
  * struct radius_client_data - Internal RADIUS client data
  *
@@ -226,6 +253,40 @@ struct radius_client_data {
 	 * next_radius_identifier - Next RADIUS message identifier to use
 	 */
 	u8 next_radius_identifier;
+
+	/**
+	 * acct_queue - Accounting messages waiting for acct_max_pending
+	 */
+	struct dl_list acct_queue;
+
+	/**
+	 * acct_queue_len - Number of messages in acct_queue
+	 */
+	size_t acct_queue_len;
+
+	/**
+	 * acct_server_ok - Whether the accounting server is responding
+	 *
+	 * This is set when a response is received and cleared when an
+	 * accounting message is dropped after too many retransmissions. Spooled
+	 * messages are sent only while the server is responding.
+	 */
+	int acct_server_ok;
+
+	/**
+	 * acct_spool_pos - Offset of the next message to send from acct_spool
+	 */
+	long acct_spool_pos;
+
+	/**
+	 * auth_secret - Precomputed shared secret state for auth_server
+	 */
+	struct radius_secret_state *auth_secret;
+
+	/**
+	 * acct_secret - Precomputed shared secret state for acct_server
+	 */
+	struct radius_secret_state *acct_secret;
 };
 
 
@@ -238,6 +299,11 @@ static int radius_client_init_acct(struct radius_client_data *radius);
 static int radius_client_init_auth(struct radius_client_data *radius);
 static void radius_client_auth_failover(struct radius_client_data *radius);
 static void radius_client_acct_failover(struct radius_client_data *radius);
+static int radius_client_send_msg(struct radius_client_data *radius,
+				  struct radius_msg *msg, RadiusType msg_type,
+				  const u8 *addr);
+static void radius_client_acct_drop(struct radius_client_data *radius,
+				    struct radius_msg_list *entry);
 
 
 static void radius_client_msg_free(struct radius_msg_list *req)
@@ -434,6 +500,7 @@ static void radius_client_timer(void *eloop_ctx, void *timeout_ctx)
 
 			tmp = entry;
 			entry = entry->next;
+			radius_client_acct_drop(radius, tmp);
 			radius_client_msg_free(tmp);
 			radius->num_msgs--;
 			continue;
@@ -618,6 +685,7 @@ static void radius_client_list_add(struct radius_client_data *radius,
 		}
 		if (prev) {
 			prev->next = NULL;
+			radius_client_acct_drop(radius, entry);
 			radius_client_msg_free(entry);
 		}
 	} else
@@ -658,6 +726,306 @@ static void radius_client_list_del(struct radius_client_data *radius,
 }
 
 
+static size_t radius_client_num_acct_pending(struct radius_client_data *radius)
+{
+	struct radius_msg_list *entry;
+	size_t pending = 0;
+
+	for (entry = radius->msgs; entry; entry = entry->next) {
+		if (entry->msg_type == RADIUS_ACCT ||
+		    entry->msg_type == RADIUS_ACCT_INTERIM)
+			pending++;
+	}
+
+	return pending;
+}
+
+
+static void radius_client_acct_queue_timer(void *eloop_ctx, void *timeout_ctx);
+
+static void radius_client_acct_kick(struct radius_client_data *radius)
+{
+	if (dl_list_empty(&radius->acct_queue) && !radius->conf->acct_spool)
+		return;
+
+	eloop_cancel_timeout(radius_client_acct_queue_timer, radius, NULL);
+	eloop_register_timeout(0, 0, radius_client_acct_queue_timer, radius,
+			       NULL);
+}
+
+
+static void radius_client_acct_spool(struct radius_client_data *radius,
+				     struct radius_msg *msg)
+{
+	const char *fname = radius->conf->acct_spool;
+	struct wpabuf *buf = radius_msg_get_buf(msg);
+	struct os_time now;
+	u32 status, delay = 0;
+	u8 hdr[6], *pos;
+	size_t len;
+	long size;
+	FILE *f;
+
+	if (radius_msg_get_attr_int32(msg, RADIUS_ATTR_ACCT_STATUS_TYPE,
+				      &status) == 0 &&
+	    (status == RADIUS_ACCT_STATUS_TYPE_ACCOUNTING_ON ||
+	     status == RADIUS_ACCT_STATUS_TYPE_ACCOUNTING_OFF)) {
+		/* These describe the current state and are not replayed */
+		return;
+	}
+
+	if (fname == NULL) {
+		wpa_printf(MSG_INFO,
+			   "RADIUS: Accounting message (id=%d) lost - no spool file configured",
+			   radius_msg_get_hdr(msg)->identifier);
+		return;
+	}
+
+	/* Keep the time of the original event if the message has already
+	 * been through the spool once */
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_ACCT_DELAY_TIME, &pos,
+				    &len, NULL) == 0 && len == 4)
+		delay = WPA_GET_BE32(pos);
+	os_get_time(&now);
+	WPA_PUT_BE32(hdr, now.sec - delay);
+	WPA_PUT_BE16(hdr + 4, wpabuf_len(buf));
+	radius_msg_get_hdr(msg)->length = host_to_be16(wpabuf_len(buf));
+
+	f = fopen(fname, "ab");
+	if (f == NULL) {
+		wpa_printf(MSG_INFO, "RADIUS: Could not open %s: %s",
+			   fname, strerror(errno));
+		return;
+	}
+
+	if (fseek(f, 0, SEEK_END) < 0 || (size = ftell(f)) < 0 ||
+	    size + sizeof(hdr) + wpabuf_len(buf) >
+	    RADIUS_CLIENT_ACCT_SPOOL_MAX) {
+		wpa_printf(MSG_INFO,
+			   "RADIUS: Accounting spool %s is full - message (id=%d) lost",
+			   fname, radius_msg_get_hdr(msg)->identifier);
+	} else if (fwrite(hdr, sizeof(hdr), 1, f) != 1 ||
+		   fwrite(wpabuf_head(buf), wpabuf_len(buf), 1, f) != 1) {
+		wpa_printf(MSG_INFO, "RADIUS: Could not write to %s", fname);
+	} else {
+		wpa_printf(MSG_DEBUG,
+			   "RADIUS: Accounting message (id=%d) written to spool",
+			   radius_msg_get_hdr(msg)->identifier);
+	}
+	fclose(f);
+}
+
+
+/* Called for accounting messages that are removed without a response */
+static void radius_client_acct_drop(struct radius_client_data *radius,
+				    struct radius_msg_list *entry)
+{
+	if (entry->msg_type != RADIUS_ACCT &&
+	    entry->msg_type != RADIUS_ACCT_INTERIM)
+		return;
+
+	radius->acct_server_ok = 0;
+	radius_client_acct_spool(radius, entry->msg);
+	radius_client_acct_kick(radius);
+}
+
+
+static void radius_client_acct_enqueue(struct radius_client_data *radius,
+				       struct radius_msg *msg,
+				       RadiusType msg_type, const u8 *addr)
+{
+	struct radius_acct_queued *q = NULL;
+
+	if (radius->acct_queue_len < RADIUS_CLIENT_ACCT_QUEUE_MAX)
+		q = os_zalloc(sizeof(*q));
+	if (q == NULL) {
+		radius_client_acct_spool(radius, msg);
+		radius_msg_free(msg);
+		return;
+	}
+
+	q->msg = msg;
+	q->msg_type = msg_type;
+	if (addr) {
+		os_memcpy(q->addr, addr, ETH_ALEN);
+		q->has_addr = 1;
+	}
+	dl_list_add_tail(&radius->acct_queue, &q->list);
+	radius->acct_queue_len++;
+}
+
+
+/* Remove queued interim updates that are superseded by a newer message */
+static void radius_client_acct_queue_del(struct radius_client_data *radius,
+					 const u8 *addr)
+{
+	struct radius_acct_queued *q, *tmp;
+
+	dl_list_for_each_safe(q, tmp, &radius->acct_queue,
+			      struct radius_acct_queued, list) {
+		if (q->msg_type != RADIUS_ACCT_INTERIM || !q->has_addr ||
+		    os_memcmp(q->addr, addr, ETH_ALEN) != 0)
+			continue;
+		hostapd_logger(radius->ctx, addr, HOSTAPD_MODULE_RADIUS,
+			       HOSTAPD_LEVEL_DEBUG,
+			       "Removing queued interim accounting update");
+		dl_list_del(&q->list);
+		radius->acct_queue_len--;
+		radius_msg_free(q->msg);
+		os_free(q);
+	}
+}
+
+
+static void radius_client_acct_replay(struct radius_client_data *radius)
+{
+	const char *fname = radius->conf->acct_spool;
+	struct radius_msg *msg;
+	struct os_time now;
+	u8 hdr[6], *buf, *pos;
+	size_t len, alen;
+	long size;
+	u32 delay;
+	int count = 0;
+	FILE *f;
+
+	f = fopen(fname, "rb");
+	if (f == NULL)
+		return;
+	if (fseek(f, 0, SEEK_END) < 0 || (size = ftell(f)) < 0 ||
+	    fseek(f, radius->acct_spool_pos, SEEK_SET) < 0) {
+		fclose(f);
+		return;
+	}
+
+	os_get_time(&now);
+	while (radius->acct_spool_pos < size &&
+	       radius->acct_queue_len < RADIUS_CLIENT_ACCT_QUEUE_MAX / 2) {
+		buf = NULL;
+		if (fread(hdr, sizeof(hdr), 1, f) == 1) {
+			len = WPA_GET_BE16(hdr + 4);
+			if (len >= sizeof(struct radius_hdr))
+				buf = os_malloc(len);
+		}
+		if (buf == NULL || fread(buf, len, 1, f) != 1) {
+			wpa_printf(MSG_INFO,
+				   "RADIUS: Invalid record in %s at offset %ld - ignoring rest of the file",
+				   fname, radius->acct_spool_pos);
+			os_free(buf);
+			radius->acct_spool_pos = size;
+			break;
+		}
+		radius->acct_spool_pos += sizeof(hdr) + len;
+
+		msg = radius_msg_parse(buf, len);
+		os_free(buf);
+		if (msg == NULL)
+			continue;
+
+		delay = now.sec > (os_time_t) WPA_GET_BE32(hdr) ?
+			now.sec - WPA_GET_BE32(hdr) : 0;
+		if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_ACCT_DELAY_TIME,
+					    &pos, &alen, NULL) == 0 &&
+		    alen == 4) {
+			WPA_PUT_BE32(pos, delay);
+		} else if (!radius_msg_add_attr_int32(
+				   msg, RADIUS_ATTR_ACCT_DELAY_TIME, delay)) {
+			radius_msg_free(msg);
+			continue;
+		}
+		radius_client_acct_enqueue(radius, msg, RADIUS_ACCT, NULL);
+		count++;
+	}
+	fclose(f);
+
+	if (count)
+		wpa_printf(MSG_DEBUG,
+			   "RADIUS: Queued %d accounting messages from %s",
+			   count, fname);
+
+	if (radius->acct_spool_pos >= size &&
+	    dl_list_empty(&radius->acct_queue)) {
+		/* All spooled messages have been sent */
+		if (size > 0) {
+			f = fopen(fname, "wb");
+			if (f)
+				fclose(f);
+		}
+		radius->acct_spool_pos = 0;
+	}
+}
+
+
+static void radius_client_acct_queue_run(struct radius_client_data *radius)
+{
+	struct hostapd_radius_servers *conf = radius->conf;
+	struct radius_acct_queued *q;
+	size_t pending, max_pending;
+
+	if (conf->acct_spool && radius->acct_server_ok)
+		radius_client_acct_replay(radius);
+
+	/* Spooled messages are paced even without acct_max_pending to avoid
+	 * evicting them from the retransmit list right away */
+	if (conf->acct_max_pending > 0)
+		max_pending = conf->acct_max_pending;
+	else
+		max_pending = RADIUS_CLIENT_MAX_ENTRIES / 2;
+
+	pending = radius_client_num_acct_pending(radius);
+	while (pending < max_pending &&
+	       (q = dl_list_first(&radius->acct_queue,
+				  struct radius_acct_queued, list))) {
+		dl_list_del(&q->list);
+		radius->acct_queue_len--;
+
+		/* The identifier may have been reused while this was queued */
+		radius_msg_get_hdr(q->msg)->identifier =
+			radius_client_get_id(radius);
+		if (radius_client_send_msg(radius, q->msg, q->msg_type,
+					   q->has_addr ? q->addr : NULL) < 0) {
+			radius_client_acct_spool(radius, q->msg);
+			radius_msg_free(q->msg);
+		}
+		os_free(q);
+		pending++;
+	}
+}
+
+
+static void radius_client_acct_queue_timer(void *eloop_ctx, void *timeout_ctx)
+{
+	radius_client_acct_queue_run(eloop_ctx);
+}
+
+
+/* Store the messages that were not acknowledged before deinit */
+static void radius_client_acct_flush(struct radius_client_data *radius)
+{
+	struct radius_msg_list *entry;
+	struct radius_acct_queued *q;
+
+	eloop_cancel_timeout(radius_client_acct_queue_timer, radius, NULL);
+
+	if (radius->conf->acct_spool) {
+		for (entry = radius->msgs; entry; entry = entry->next) {
+			if (entry->msg_type == RADIUS_ACCT ||
+			    entry->msg_type == RADIUS_ACCT_INTERIM)
+				radius_client_acct_spool(radius, entry->msg);
+		}
+	}
+
+	while ((q = dl_list_first(&radius->acct_queue,
+				  struct radius_acct_queued, list))) {
+		dl_list_del(&q->list);
+		radius_client_acct_spool(radius, q->msg);
+		radius_msg_free(q->msg);
+		os_free(q);
+	}
+	radius->acct_queue_len = 0;
+}
+
+
 /**
  * radius_client_send - Send a RADIUS request
  * @radius: RADIUS client context from radius_client_init()
@@ -679,12 +1047,82 @@ static void radius_client_list_del(struct radius_client_data *radius,
  * The related device MAC address can be used to identify pending messages that
  * can be removed with radius_client_flush_auth() or with interim accounting
  * updates.
+ *
+ * If acct_max_pending is configured and that many accounting requests are
+ * already pending, accounting messages are queued and sent as responses to the
+ * earlier requests are received. Queued interim updates for the device are
+ * removed when a new accounting message for the same device is sent.
  */
 int radius_client_send(struct radius_client_data *radius,
 		       struct radius_msg *msg, RadiusType msg_type,
 		       const u8 *addr)
 {
 	struct hostapd_radius_servers *conf = radius->conf;
+
+	if ((msg_type == RADIUS_ACCT || msg_type == RADIUS_ACCT_INTERIM) &&
+	    conf->acct_max_pending > 0) {
+		if (addr)
+			radius_client_acct_queue_del(radius, addr);
+		if (!dl_list_empty(&radius->acct_queue) ||
+		    radius_client_num_acct_pending(radius) >=
+		    (size_t) conf->acct_max_pending) {
+			if (conf->acct_server == NULL ||
+			    conf->acct_server->shared_secret == NULL) {
+				hostapd_logger(radius->ctx, NULL,
+					       HOSTAPD_MODULE_RADIUS,
+					       HOSTAPD_LEVEL_INFO,
+					       "No accounting server configured");
+				return -1;
+			}
+			hostapd_logger(radius->ctx, NULL, HOSTAPD_MODULE_RADIUS,
+				       HOSTAPD_LEVEL_DEBUG,
+				       "Queueing RADIUS accounting message (%u already queued)",
+				       (unsigned int) radius->acct_queue_len);
+			radius_client_acct_enqueue(radius, msg, msg_type,
+						   addr);
+			return 0;
+		}
+	}
+
+	return radius_client_send_msg(radius, msg, msg_type, addr);
+}
+
+
+/*
+ * Get the precomputed shared secret state for the current authentication or
+ * accounting server. The state is replaced if the server secret has changed
+ * and the pending messages of the same kind are updated to use the new state
+ * so that they never point to a freed one.
+ */
+static const struct radius_secret_state *
+radius_client_secret_state(struct radius_client_data *radius,
+			   struct hostapd_radius_server *serv, int auth)
+{
+	struct radius_secret_state **state;
+	struct radius_msg_list *entry;
+
+	state = auth ? &radius->auth_secret : &radius->acct_secret;
+	if (radius_secret_state_match(*state, serv->shared_secret,
+				      serv->shared_secret_len))
+		return *state;
+
+	radius_secret_state_free(*state);
+	*state = radius_secret_state_init(serv->shared_secret,
+					  serv->shared_secret_len);
+	for (entry = radius->msgs; entry; entry = entry->next) {
+		if ((entry->msg_type == RADIUS_AUTH) == !!auth)
+			radius_msg_set_secret_state(entry->msg, *state);
+	}
+
+	return *state;
+}
+
+
+static int radius_client_send_msg(struct radius_client_data *radius,
+				  struct radius_msg *msg, RadiusType msg_type,
+				  const u8 *addr)
+{
+	struct hostapd_radius_servers *conf = radius->conf;
 	const u8 *shared_secret;
 	size_t shared_secret_len;
 	char *name;
@@ -710,6 +1148,9 @@ int radius_client_send(struct radius_client_data *radius,
 		}
 		shared_secret = conf->acct_server->shared_secret;
 		shared_secret_len = conf->acct_server->shared_secret_len;
+		radius_msg_set_secret_state(
+			msg, radius_client_secret_state(radius,
+							conf->acct_server, 0));
 		radius_msg_finish_acct(msg, shared_secret, shared_secret_len);
 		name = "accounting";
 		s = radius->acct_sock;
@@ -728,6 +1169,9 @@ int radius_client_send(struct radius_client_data *radius,
 		}
 		shared_secret = conf->auth_server->shared_secret;
 		shared_secret_len = conf->auth_server->shared_secret_len;
+		radius_msg_set_secret_state(
+			msg, radius_client_secret_state(radius,
+							conf->auth_server, 1));
 		radius_msg_finish(msg, shared_secret, shared_secret_len);
 		name = "authentication";
 		s = radius->auth_sock;
@@ -861,6 +1305,11 @@ static void radius_client_receive(int sock, void *eloop_ctx, void *sock_ctx)
 		radius->msgs = req->next;
 	radius->num_msgs--;
 
+	if (msg_type == RADIUS_ACCT) {
+		radius->acct_server_ok = 1;
+		radius_client_acct_kick(radius);
+	}
+
 	for (i = 0; i < num_handlers; i++) {
 		RadiusRxResult res;
 		res = handlers[i].handler(msg, req->msg, req->shared_secret,
@@ -934,8 +1383,10 @@ u8 radius_client_get_id(struct radius_client_data *radius)
 		}
 		entry = entry->next;
 
-		if (_remove)
+		if (_remove) {
+			radius_client_acct_drop(radius, _remove);
 			radius_client_msg_free(_remove);
+		}
 	}
 
 	return id;
@@ -1023,6 +1474,8 @@ radius_change_server(struct radius_client_data *radius,
 		       hostapd_ip_txt(&nserv->addr, abuf, sizeof(abuf)),
 		       nserv->port);
 
+	radius_client_secret_state(radius, nserv, auth);
+
 	if (oserv && oserv != nserv &&
 	    (nserv->shared_secret_len != oserv->shared_secret_len ||
 	     os_memcmp(nserv->shared_secret, oserv->shared_secret,
@@ -1394,6 +1847,7 @@ radius_client_init(void *ctx, struct hostapd_radius_servers *conf)
 
 	radius->ctx = ctx;
 	radius->conf = conf;
+	dl_list_init(&radius->acct_queue);
 	radius->auth_serv_sock = radius->acct_serv_sock =
 		radius->auth_serv_sock6 = radius->acct_serv_sock6 =
 		radius->auth_sock = radius->acct_sock = -1;
@@ -1431,9 +1885,12 @@ void radius_client_deinit(struct radius_client_data *radius)
 
 	eloop_cancel_timeout(radius_retry_primary_timer, radius, NULL);
 
+	radius_client_acct_flush(radius);
 	radius_client_flush(radius, 0);
 	os_free(radius->auth_handlers);
 	os_free(radius->acct_handlers);
+	radius_secret_state_free(radius->auth_secret);
+	radius_secret_state_free(radius->acct_secret);
 	os_free(radius);
 }
 
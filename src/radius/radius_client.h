@@ -174,6 +174,27 @@ struct hostapd_radius_servers {
 	 * force_client_addr - Whether to force client (local) address
 	 */
 	int force_client_addr;
+
+	/**
+	 * acct_max_pending - Maximum number of pending accounting requests
+	 *
+	 * If this is set (non-zero), no more than this many accounting
+	 * requests are waiting for a response from the server at any time.
+	 * Additional requests are queued and sent as responses are received.
+	 * Interim updates that are still in the queue are replaced with newer
+	 * ones for the same station.
+	 */
+	int acct_max_pending;
+
+	/**
+	 * acct_spool - File for storing accounting requests that were not sent
+	 *
+	 * If this is set, accounting requests that do not fit in the queue or
+	 * that are dropped after too many retransmissions are appended to this
+	 * file. They are sent again once the accounting server responds to
+	 * requests, including after a restart.
+	 */
+	char *acct_spool;
 };
 
 
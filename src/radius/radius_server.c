@@ -104,6 +104,7 @@ struct radius_client {
 #endif /* CONFIG_IPV6 */
 	char *shared_secret;
 	int shared_secret_len;
+	struct radius_secret_state *secret_state;
 	struct radius_session *sessions;
 	struct radius_server_counters counters;
 };
@@ -734,6 +735,7 @@ radius_server_encapsulate_eap(struct radius_server_data *data,
 		RADIUS_DEBUG("Failed to allocate reply message");
 		return NULL;
 	}
+	radius_msg_set_secret_state(msg, client->secret_state);
 
 	sess_id = htonl(sess->sess_id);
 	if (code == RADIUS_CODE_ACCESS_CHALLENGE &&
@@ -891,6 +893,7 @@ radius_server_macacl(struct radius_server_data *data,
 		RADIUS_DEBUG("Failed to allocate reply message");
 		return NULL;
 	}
+	radius_msg_set_secret_state(msg, client->secret_state);
 
 	if (radius_msg_copy_attr(msg, request, RADIUS_ATTR_PROXY_STATE) < 0) {
 		RADIUS_DEBUG("Failed to copy Proxy-State attribute(s)");
@@ -940,6 +943,7 @@ static int radius_server_reject(struct radius_server_data *data,
 	if (msg == NULL) {
 		return -1;
 	}
+	radius_msg_set_secret_state(msg, client->secret_state);
 
 	os_memset(&eapfail, 0, sizeof(eapfail));
 	eapfail.code = EAP_CODE_FAILURE;
@@ -1269,6 +1273,7 @@ static void radius_server_receive_auth(int sock, void *eloop_ctx,
 	data->counters.access_requests++;
 	client->counters.access_requests++;
 
+	radius_msg_set_secret_state(msg, client->secret_state);
 	if (radius_msg_verify_msg_auth(msg, (u8 *) client->shared_secret,
 				       client->shared_secret_len, NULL)) {
 		RADIUS_DEBUG("Invalid Message-Authenticator from %s", abuf);
@@ -1518,6 +1523,7 @@ static void radius_server_free_clients(struct radius_server_data *data,
 
 		radius_server_free_sessions(data, prev->sessions);
 		os_free(prev->shared_secret);
+		radius_secret_state_free(prev->secret_state);
 		os_free(prev);
 	}
 }
@@ -1635,6 +1641,8 @@ radius_server_read_clients(const char *client_file, int ipv6)
 			break;
 		}
 		entry->shared_secret_len = os_strlen(entry->shared_secret);
+		entry->secret_state = radius_secret_state_init(
+			(u8 *) entry->shared_secret, entry->shared_secret_len);
 		if (!ipv6) {
 			entry->addr.s_addr = addr.s_addr;
 			val = 0;
@@ -2103,6 +2111,14 @@ static int radius_server_erp_add_key(void *ctx, struct eap_server_erp_key *erp)
 #endif /* CONFIG_ERP */
 
 
+static void radius_server_pending_done(void *ctx)
+{
+	struct radius_session *sess = ctx;
+
+	radius_server_eap_pending_cb(sess->server, sess->eap);
+}
+
+
 static const struct eapol_callbacks radius_server_eapol_cb =
 {
 	.get_eap_user = radius_server_get_eap_user,
@@ -2114,6 +2130,7 @@ static const struct eapol_callbacks radius_server_eapol_cb =
 	.erp_get_key = radius_server_erp_get_key,
 	.erp_add_key = radius_server_erp_add_key,
 #endif /* CONFIG_ERP */
+	.pending_done = radius_server_pending_done,
 };
 
 
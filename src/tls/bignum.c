@@ -222,3 +222,332 @@ int bignum_exptmod(const struct bignum *a, const struct bignum *b,
 	}
 	return 0;
 }
+
+
+#ifdef LTM_FAST
+
+/*
+ * Fixed-base exponentiation for bases that are used with many different
+ * exponents, i.e., the generator of a Diffie-Hellman group. This uses the
+ * Lim-Lee comb method on top of Montgomery multiplication of fixed length
+ * digit arrays. The exponent of b bits is split into h rows of a = b / h
+ * bits and a table of the 2^h products of g^(2^(i*a)) is precomputed. An
+ * exponentiation then needs only a squarings and a multiplications instead
+ * of the about b squarings and b / 5 multiplications in mp_exptmod().
+ *
+ * All operations with the exponent are done in constant time: every column
+ * uses a squaring and a multiplication, table entries are selected by
+ * scanning the full table, and the final subtraction of the Montgomery
+ * multiplication is done with a mask.
+ */
+
+/*
+ * mp_word has 8 bits more than 2 * DIGIT_BIT, so a column of up to 2 * 127
+ * digit products fits in bignum_mont_mul() without overflow.
+ */
+#define BIGNUM_FIXED_BASE_MAX_DIGITS 127
+
+struct bignum_fixed_base {
+	int n; /* number of digits in the modulus */
+	mp_digit rho; /* -1/m mod 2^DIGIT_BIT */
+	int rows; /* table has 1 << rows entries */
+	int cols; /* exponent bits per row */
+	mp_digit *m; /* modulus; n digits */
+	mp_digit *one; /* R mod m; n digits */
+	mp_digit *table; /* (1 << rows) entries of n digits */
+};
+
+
+static mp_digit bignum_mont_rho(mp_digit m0)
+{
+	mp_digit x = m0; /* m0 * m0 == 1 mod 8 for odd m0 */
+	int bits;
+
+	for (bits = 3; bits < DIGIT_BIT; bits *= 2)
+		x *= 2 - m0 * x;
+	return (0 - x) & MP_MASK;
+}
+
+
+/*
+ * r = a * b / R mod m; q is scratch of n digits; r may alias a or b
+ *
+ * This interleaves the multiplication and the reduction column by column
+ * (product scanning) so that each column is summed up in a single mp_word.
+ * bignum_fixed_base_init() limits n so that this cannot overflow.
+ */
+static void bignum_mont_mul(const struct bignum_fixed_base *fb, mp_digit *r,
+			    const mp_digit *a, const mp_digit *b, mp_digit *q)
+{
+	const mp_digit *m = fb->m;
+	int n = fb->n, i, j;
+	mp_digit c, top, borrow, mask;
+	mp_word acc = 0;
+
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < i; j++) {
+			acc += (mp_word) a[j] * b[i - j];
+			acc += (mp_word) q[j] * m[i - j];
+		}
+		acc += (mp_word) a[i] * b[0];
+		q[i] = ((mp_digit) acc * fb->rho) & MP_MASK;
+		acc += (mp_word) q[i] * m[0];
+		acc >>= DIGIT_BIT;
+	}
+	for (i = n; i < 2 * n - 1; i++) {
+		for (j = i - n + 1; j < n; j++) {
+			acc += (mp_word) a[j] * b[i - j];
+			acc += (mp_word) q[j] * m[i - j];
+		}
+		r[i - n] = (mp_digit) acc & MP_MASK;
+		acc >>= DIGIT_BIT;
+	}
+	r[n - 1] = (mp_digit) acc & MP_MASK;
+	top = (mp_digit) (acc >> DIGIT_BIT);
+
+	/* r < 2m; subtract m unless that underflows */
+	borrow = 0;
+	for (j = 0; j < n; j++) {
+		c = r[j] - m[j] - borrow;
+		borrow = c >> (sizeof(mp_digit) * 8 - 1);
+		q[j] = c & MP_MASK;
+	}
+	mask = 0 - (borrow & (top ^ 1));
+	for (j = 0; j < n; j++)
+		r[j] = (r[j] & mask) | (q[j] & ~mask);
+}
+
+
+/* r = table[idx] without idx dependent memory access */
+static void bignum_fixed_base_select(const struct bignum_fixed_base *fb,
+				     mp_digit *r, unsigned int idx)
+{
+	const mp_digit *pos = fb->table;
+	unsigned int i;
+	mp_digit diff, mask;
+	int j;
+
+	os_memset(r, 0, fb->n * sizeof(mp_digit));
+	for (i = 0; i < (1U << fb->rows); i++, pos += fb->n) {
+		diff = i ^ idx;
+		mask = ((diff | (0 - diff)) >> (sizeof(mp_digit) * 8 - 1)) - 1;
+		for (j = 0; j < fb->n; j++)
+			r[j] |= pos[j] & mask;
+	}
+}
+
+
+/* r = a * R mod m as n digits */
+static int bignum_mont_to(const struct bignum_fixed_base *fb, mp_int *a,
+			  mp_int *m, mp_digit *r)
+{
+	mp_int t;
+	int res;
+
+	if (mp_init(&t) != MP_OKAY)
+		return -1;
+	res = mp_mul_2d(a, DIGIT_BIT * fb->n, &t);
+	if (res == MP_OKAY)
+		res = mp_mod(&t, m, &t);
+	if (res == MP_OKAY && t.used <= fb->n) {
+		os_memset(r, 0, fb->n * sizeof(mp_digit));
+		os_memcpy(r, t.dp, t.used * sizeof(mp_digit));
+	} else {
+		res = MP_VAL;
+	}
+	mp_clear(&t);
+	return res == MP_OKAY ? 0 : -1;
+}
+
+
+/**
+ * bignum_fixed_base_init - Precompute a table for fixed-base exponentiation
+ * @g: Bignum from bignum_init(); base
+ * @m: Bignum from bignum_init(); modulus, must be odd
+ * @exp_bits: Maximum length of the exponents in bits
+ * Returns: Pointer to the table or %NULL on failure
+ */
+struct bignum_fixed_base * bignum_fixed_base_init(const struct bignum *g,
+						  const struct bignum *m,
+						  int exp_bits)
+{
+	mp_int *mm = (mp_int *) m;
+	struct bignum_fixed_base *fb;
+	mp_digit *pos, *t;
+	unsigned int i, low;
+	int j;
+
+	if (exp_bits <= 0 || mm->used < 1 ||
+	    mm->used > BIGNUM_FIXED_BASE_MAX_DIGITS || mm->sign != MP_ZPOS ||
+	    !(mm->dp[0] & 1) || mp_cmp_d(mm, 1) != MP_GT ||
+	    mp_cmp((mp_int *) g, mm) != MP_LT)
+		return NULL;
+
+	fb = os_zalloc(sizeof(*fb));
+	if (fb == NULL)
+		return NULL;
+	fb->n = mm->used;
+	fb->rho = bignum_mont_rho(mm->dp[0]);
+	fb->rows = exp_bits > 256 ? 6 : 4;
+	fb->cols = (exp_bits + fb->rows - 1) / fb->rows;
+	fb->m = os_calloc(fb->n, sizeof(mp_digit));
+	fb->one = os_calloc(fb->n, sizeof(mp_digit));
+	fb->table = os_calloc((size_t) fb->n << fb->rows, sizeof(mp_digit));
+	t = os_calloc(fb->n, sizeof(mp_digit));
+	if (fb->m == NULL || fb->one == NULL || fb->table == NULL || t == NULL)
+		goto fail;
+	os_memcpy(fb->m, mm->dp, fb->n * sizeof(mp_digit));
+
+	/* table[1 << i] = g^(2^(i * cols)) */
+	if (bignum_mont_to(fb, (mp_int *) g, mm, fb->table + fb->n) < 0)
+		goto fail;
+	for (i = 1; i < (unsigned int) fb->rows; i++) {
+		pos = fb->table + ((size_t) fb->n << i);
+		os_memcpy(pos, fb->table + ((size_t) fb->n << (i - 1)),
+			  fb->n * sizeof(mp_digit));
+		for (j = 0; j < fb->cols; j++)
+			bignum_mont_mul(fb, pos, pos, pos, t);
+	}
+
+	/* table[0] = 1 and other entries are products of the above */
+	{
+		mp_int one;
+
+		if (mp_init(&one) != MP_OKAY)
+			goto fail;
+		mp_set(&one, 1);
+		j = bignum_mont_to(fb, &one, mm, fb->one);
+		mp_clear(&one);
+		if (j < 0)
+			goto fail;
+	}
+	os_memcpy(fb->table, fb->one, fb->n * sizeof(mp_digit));
+	for (i = 3; i < (1U << fb->rows); i++) {
+		low = i & (0 - i);
+		if (low == i)
+			continue;
+		bignum_mont_mul(fb, fb->table + (size_t) fb->n * i,
+				fb->table + (size_t) fb->n * (i - low),
+				fb->table + (size_t) fb->n * low, t);
+	}
+
+	os_free(t);
+	return fb;
+
+fail:
+	wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
+	os_free(t);
+	bignum_fixed_base_deinit(fb);
+	return NULL;
+}
+
+
+/**
+ * bignum_fixed_base_deinit - Free a fixed-base exponentiation table
+ * @fb: Table from bignum_fixed_base_init()
+ */
+void bignum_fixed_base_deinit(struct bignum_fixed_base *fb)
+{
+	if (fb == NULL)
+		return;
+	os_free(fb->m);
+	os_free(fb->one);
+	bin_clear_free(fb->table, ((size_t) fb->n << fb->rows) *
+		       sizeof(mp_digit));
+	os_free(fb);
+}
+
+
+/**
+ * bignum_fixed_base_exptmod - Modular exponentiation with a fixed base
+ * @fb: Table from bignum_fixed_base_init()
+ * @b: Bignum from bignum_init(); exponent
+ * @d: Bignum from bignum_init(); used to store the result of g^b (mod m)
+ * Returns: 0 on success, -1 on failure (e.g., if the exponent is longer than
+ * the exp_bits value used with bignum_fixed_base_init())
+ */
+int bignum_fixed_base_exptmod(const struct bignum_fixed_base *fb,
+			      const struct bignum *b, struct bignum *d)
+{
+	mp_int *e = (mp_int *) b, *r = (mp_int *) d;
+	int n = fb->n, exp_bits = fb->rows * fb->cols;
+	int edigits = (exp_bits + DIGIT_BIT - 1) / DIGIT_BIT;
+	mp_digit *buf, *acc, *sel, *t, *ebuf, high;
+	size_t buf_len;
+	unsigned int idx;
+	int i, k, pos, ret = -1;
+
+	if (e->sign != MP_ZPOS || e->used > edigits)
+		return -1;
+
+	buf_len = (3 * n + edigits) * sizeof(mp_digit);
+	buf = os_zalloc(buf_len);
+	if (buf == NULL)
+		return -1;
+	acc = buf;
+	sel = acc + n;
+	t = sel + n;
+	ebuf = t + n;
+	os_memcpy(ebuf, e->dp, e->used * sizeof(mp_digit));
+	high = exp_bits % DIGIT_BIT ?
+		ebuf[edigits - 1] >> (exp_bits % DIGIT_BIT) : 0;
+	if (high)
+		goto fail;
+
+	os_memcpy(acc, fb->one, n * sizeof(mp_digit));
+	for (i = fb->cols - 1; i >= 0; i--) {
+		idx = 0;
+		for (k = 0; k < fb->rows; k++) {
+			pos = k * fb->cols + i;
+			idx |= ((ebuf[pos / DIGIT_BIT] >> (pos % DIGIT_BIT)) &
+				1) << k;
+		}
+		bignum_mont_mul(fb, acc, acc, acc, t);
+		bignum_fixed_base_select(fb, sel, idx);
+		bignum_mont_mul(fb, acc, acc, sel, t);
+	}
+
+	/* Convert out of the Montgomery domain */
+	os_memset(sel, 0, n * sizeof(mp_digit));
+	sel[0] = 1;
+	bignum_mont_mul(fb, acc, acc, sel, t);
+
+	if (mp_grow(r, n) != MP_OKAY)
+		goto fail;
+	os_memcpy(r->dp, acc, n * sizeof(mp_digit));
+	for (i = n; i < r->alloc; i++)
+		r->dp[i] = 0;
+	r->used = n;
+	r->sign = MP_ZPOS;
+	mp_clamp(r);
+	ret = 0;
+
+fail:
+	bin_clear_free(buf, buf_len);
+	if (ret < 0)
+		wpa_printf(MSG_DEBUG, "BIGNUM: %s failed", __func__);
+	return ret;
+}
+
+#else /* LTM_FAST */
+
+struct bignum_fixed_base * bignum_fixed_base_init(const struct bignum *g,
+						  const struct bignum *m,
+						  int exp_bits)
+{
+	return NULL;
+}
+
+
+void bignum_fixed_base_deinit(struct bignum_fixed_base *fb)
+{
+}
+
+
+int bignum_fixed_base_exptmod(const struct bignum_fixed_base *fb,
+			      const struct bignum *b, struct bignum *d)
+{
+	return -1;
+}
+
+#endif /* LTM_FAST */
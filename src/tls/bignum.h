@@ -10,6 +10,7 @@
 #define BIGNUM_H
 
 struct bignum;
+struct bignum_fixed_base;
 
 struct bignum * bignum_init(void);
 void bignum_deinit(struct bignum *n);
@@ -28,5 +29,11 @@ int bignum_mulmod(const struct bignum *a, const struct bignum *b,
 		  const struct bignum *c, struct bignum *d);
 int bignum_exptmod(const struct bignum *a, const struct bignum *b,
 		   const struct bignum *c, struct bignum *d);
+struct bignum_fixed_base * bignum_fixed_base_init(const struct bignum *g,
+						  const struct bignum *m,
+						  int exp_bits);
+void bignum_fixed_base_deinit(struct bignum_fixed_base *fb);
+int bignum_fixed_base_exptmod(const struct bignum_fixed_base *fb,
+			      const struct bignum *b, struct bignum *d);
 
 #endif /* BIGNUM_H */
@@ -0,0 +1,152 @@
+/*
+ * Buffer pool for transmitted management frames
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "frame_pool.h"
+
+
+/* Maximum frame length that fits in a pool buffer */
+#define FRAME_POOL_FRAME_LEN 2048
+/* Number of pool buffers */
+#define FRAME_POOL_BUFS 16
+
+#define FRAME_POOL_BUF_LEN (FRAME_POOL_HEADROOM + FRAME_POOL_FRAME_LEN)
+
+static struct {
+	u8 *bufs; /* FRAME_POOL_BUFS * FRAME_POOL_BUF_LEN octets */
+	u8 free[FRAME_POOL_BUFS]; /* indexes of unused buffers */
+	unsigned int num_free;
+	struct frame_pool_stats stats;
+} pool;
+
+
+static int frame_pool_index(const void *frame)
+{
+	const u8 *pos = frame;
+	size_t offset;
+
+	if (!pool.bufs || !pos || pos < pool.bufs ||
+	    pos >= pool.bufs + FRAME_POOL_BUFS * FRAME_POOL_BUF_LEN)
+		return -1;
+	offset = pos - pool.bufs;
+	if (offset % FRAME_POOL_BUF_LEN != FRAME_POOL_HEADROOM)
+		return -1;
+	return offset / FRAME_POOL_BUF_LEN;
+}
+
+
+static int frame_pool_init(void)
+{
+	unsigned int i;
+
+	pool.bufs = os_malloc(FRAME_POOL_BUFS * FRAME_POOL_BUF_LEN);
+	if (!pool.bufs)
+		return -1;
+	for (i = 0; i < FRAME_POOL_BUFS; i++)
+		pool.free[i] = FRAME_POOL_BUFS - 1 - i;
+	pool.num_free = FRAME_POOL_BUFS;
+	return 0;
+}
+
+
+/**
+ * frame_pool_alloc - Allocate a zeroed buffer for a frame
+ * @len: Maximum length of the frame
+ * Returns: Pointer to the frame buffer or %NULL on failure
+ *
+ * The returned buffer must be freed with frame_pool_free(). If the pool is
+ * exhausted or the frame does not fit in a pool buffer, the frame is
+ * allocated from the heap without headroom.
+ */
+void * frame_pool_alloc(size_t len)
+{
+	u8 *frame;
+
+	if (len > FRAME_POOL_FRAME_LEN ||
+	    (!pool.bufs && frame_pool_init() < 0) ||
+	    pool.num_free == 0) {
+		frame = os_zalloc(len);
+		if (frame)
+			pool.stats.heap_allocs++;
+		return frame;
+	}
+
+	frame = pool.bufs + pool.free[--pool.num_free] * FRAME_POOL_BUF_LEN +
+		FRAME_POOL_HEADROOM;
+	os_memset(frame, 0, len);
+	pool.stats.pool_allocs++;
+	pool.stats.in_use++;
+	if (pool.stats.in_use > pool.stats.max_in_use)
+		pool.stats.max_in_use = pool.stats.in_use;
+	return frame;
+}
+
+
+/**
+ * frame_pool_free - Free a frame buffer
+ * @frame: Frame buffer from frame_pool_alloc() or %NULL
+ */
+void frame_pool_free(void *frame)
+{
+	int idx;
+
+	idx = frame_pool_index(frame);
+	if (idx < 0) {
+		os_free(frame);
+		return;
+	}
+	pool.free[pool.num_free++] = idx;
+	pool.stats.in_use--;
+}
+
+
+/**
+ * frame_pool_headroom - Get the space available in front of a frame
+ * @frame: Pointer to the beginning of a frame
+ * Returns: Number of octets in front of the frame that can be overwritten
+ *
+ * This returns 0 for any buffer that was not allocated from the pool, e.g.,
+ * for frames on the stack or in a struct wpabuf, so it can be called for any
+ * frame passed to the driver wrapper.
+ */
+size_t frame_pool_headroom(const void *frame)
+{
+	return frame_pool_index(frame) < 0 ? 0 : FRAME_POOL_HEADROOM;
+}
+
+
+void frame_pool_get_stats(struct frame_pool_stats *stats)
+{
+	*stats = pool.stats;
+}
+
+
+/**
+ * frame_pool_deinit - Free the pool buffers
+ *
+ * This is called when the process is terminating. The buffers are not freed
+ * if any of them is still in use.
+ */
+void frame_pool_deinit(void)
+{
+	if (!pool.bufs)
+		return;
+	wpa_printf(MSG_DEBUG,
+		   "frame_pool: %lu pool and %lu heap allocations (at most %u buffers in use)",
+		   pool.stats.pool_allocs, pool.stats.heap_allocs,
+		   pool.stats.max_in_use);
+	if (pool.stats.in_use) {
+		wpa_printf(MSG_INFO, "frame_pool: %u buffers still in use",
+			   pool.stats.in_use);
+		return;
+	}
+	os_free(pool.bufs);
+	pool.bufs = NULL;
+}
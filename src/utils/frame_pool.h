@@ -0,0 +1,70 @@
+/*
+ * Buffer pool for transmitted management frames
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * Frames that are built for a single send_mlme() call (e.g., Probe Response,
+ * Authentication, and (Re)Association Response frames in AP mode) can be
+ * allocated from this pool instead of the heap. Each pool buffer has
+ * FRAME_POOL_HEADROOM octets of space in front of the frame and the driver
+ * wrapper is allowed to use that space for its own message headers when the
+ * frame is passed to it. This allows driver_nl80211 to build the
+ * NL80211_CMD_FRAME message around the frame instead of copying the frame into
+ * a newly allocated netlink message.
+ *
+ * The pool is used only from the eloop thread and is not thread-safe. Builds
+ * without CONFIG_FRAME_POOL allocate the frames from the heap.
+ */
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+/* Space reserved in front of each pool frame for the driver wrapper */
+#define FRAME_POOL_HEADROOM 64
+
+struct frame_pool_stats {
+	unsigned long pool_allocs; /* frames allocated from the pool */
+	unsigned long heap_allocs; /* frames that did not fit in the pool */
+	unsigned int in_use; /* pool buffers currently allocated */
+	unsigned int max_in_use;
+};
+
+#ifdef CONFIG_FRAME_POOL
+
+void * frame_pool_alloc(size_t len);
+void frame_pool_free(void *frame);
+size_t frame_pool_headroom(const void *frame);
+void frame_pool_get_stats(struct frame_pool_stats *stats);
+void frame_pool_deinit(void);
+
+#else /* CONFIG_FRAME_POOL */
+
+static inline void * frame_pool_alloc(size_t len)
+{
+	return os_zalloc(len);
+}
+
+static inline void frame_pool_free(void *frame)
+{
+	os_free(frame);
+}
+
+static inline size_t frame_pool_headroom(const void *frame)
+{
+	return 0;
+}
+
+static inline void frame_pool_get_stats(struct frame_pool_stats *stats)
+{
+	os_memset(stats, 0, sizeof(*stats));
+}
+
+static inline void frame_pool_deinit(void)
+{
+}
+
+#endif /* CONFIG_FRAME_POOL */
+
+#endif /* FRAME_POOL_H */
@@ -260,6 +260,36 @@ static int ext_password_tests(void)
 }
 
 
+static int wpabuf_tests(void)
+{
+	struct wpabuf *buf, *ref;
+	int ret = 0;
+
+	wpa_printf(MSG_INFO, "wpabuf tests");
+
+	buf = wpabuf_alloc_copy("test", 4);
+	if (!buf)
+		return -1;
+	ref = wpabuf_ref(buf);
+	if (ref != buf || buf->refcount != 1)
+		ret = -1;
+	/* A shared buffer cannot be reallocated */
+	if (wpabuf_resize(&ref, 100) == 0 || ref != buf)
+		ret = -1;
+	wpabuf_clear_free(buf);
+	if (ref->refcount != 0 || os_memcmp(wpabuf_head(ref), "test", 4) != 0)
+		ret = -1;
+	if (wpabuf_resize(&ref, 100) < 0)
+		ret = -1;
+	wpabuf_free(ref);
+
+	if (wpabuf_ref(NULL) != NULL)
+		ret = -1;
+
+	return ret;
+}
+
+
 static int trace_tests(void)
 {
 	wpa_printf(MSG_INFO, "trace tests");
@@ -425,6 +455,7 @@ int utils_module_tests(void)
 	wpa_printf(MSG_INFO, "utils module tests");
 
 	if (printf_encode_decode_tests() < 0 ||
+	    wpabuf_tests() < 0 ||
 	    ext_password_tests() < 0 ||
 	    trace_tests() < 0 ||
 	    bitfield_tests() < 0 ||
@@ -0,0 +1,500 @@
+/*
+ * Worker threads for offloading CPU intensive operations from eloop
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+#include <fcntl.h>
+#include <pthread.h>
+
+#include "common.h"
+#include "list.h"
+#include "eloop.h"
+#include "worker.h"
+
+
+struct worker_job {
+	struct dl_list list;
+	worker_func func;
+	worker_done done;
+	void *ctx;
+	int cancelled;
+};
+
+/* Jobs that were completed synchronously and wait for delivery */
+static struct dl_list worker_sync_done = DL_LIST_HEAD_INIT(worker_sync_done);
+
+
+struct worker_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t job_cond;
+	pthread_cond_t idle_cond;
+	struct dl_list queue; /* struct worker_job::list */
+	struct dl_list running; /* struct worker_job::list */
+	struct dl_list completed; /* struct worker_job::list */
+	unsigned int queue_len;
+	unsigned int max_queue;
+	pthread_t *threads;
+	unsigned int num_threads;
+	int notify[2];
+	int notified;
+	int stop;
+};
+
+static struct worker_pool *pool = NULL;
+
+
+static void * worker_thread(void *arg)
+{
+	struct worker_pool *p = arg;
+	struct worker_job *job;
+
+	pthread_mutex_lock(&p->lock);
+	while (!p->stop) {
+		job = dl_list_first(&p->queue, struct worker_job, list);
+		if (!job) {
+			pthread_cond_wait(&p->job_cond, &p->lock);
+			continue;
+		}
+		dl_list_del(&job->list);
+		dl_list_add_tail(&p->running, &job->list);
+		pthread_mutex_unlock(&p->lock);
+
+		job->func(job->ctx);
+
+		pthread_mutex_lock(&p->lock);
+		dl_list_del(&job->list);
+		dl_list_add_tail(&p->completed, &job->list);
+		p->queue_len--;
+		if (!p->notified) {
+			char c = 0;
+
+			p->notified = 1;
+			if (write(p->notify[1], &c, 1) < 0) {
+				/* eloop will pick this up on worker_wait() */
+			}
+		}
+		pthread_cond_broadcast(&p->idle_cond);
+	}
+	pthread_mutex_unlock(&p->lock);
+
+	return NULL;
+}
+
+
+static void worker_deliver(struct dl_list *list)
+{
+	struct worker_job *job;
+
+	while ((job = dl_list_first(list, struct worker_job, list))) {
+		dl_list_del(&job->list);
+		job->done(job->ctx, job->cancelled);
+		os_free(job);
+	}
+}
+
+
+static void worker_collect(struct dl_list *done)
+{
+	struct worker_job *job;
+	char buf[32];
+
+	pthread_mutex_lock(&pool->lock);
+	while (read(pool->notify[0], buf, sizeof(buf)) == (int) sizeof(buf))
+		;
+	pool->notified = 0;
+	while ((job = dl_list_first(&pool->completed, struct worker_job,
+				    list))) {
+		dl_list_del(&job->list);
+		dl_list_add_tail(done, &job->list);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+
+static void worker_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct dl_list done;
+
+	dl_list_init(&done);
+	worker_collect(&done);
+	worker_deliver(&done);
+}
+
+
+static void worker_sync_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct worker_job *job;
+
+	while ((job = dl_list_first(&worker_sync_done, struct worker_job,
+				    list))) {
+		dl_list_del(&job->list);
+		job->done(job->ctx, job->cancelled);
+		os_free(job);
+	}
+}
+
+
+/**
+ * worker_init - Start worker threads
+ * @num_threads: Number of threads or 0 to use the number of online CPUs
+ * @max_queue: Maximum number of pending jobs or 0 for no limit
+ * Returns: 0 on success, -1 on failure
+ *
+ * This must be called after eloop_init(). In WPA_TRACE builds, this is a
+ * no-op and jobs are executed synchronously.
+ */
+int worker_init(unsigned int num_threads, unsigned int max_queue)
+{
+	unsigned int i;
+
+#ifdef WPA_TRACE
+	wpa_printf(MSG_DEBUG,
+		   "worker: WPA_TRACE build - run jobs synchronously");
+	return 0;
+#endif /* WPA_TRACE */
+
+	if (pool)
+		return 0;
+
+	if (num_threads == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		num_threads = cpus > 0 ? cpus : 1;
+	}
+
+	pool = os_zalloc(sizeof(*pool));
+	if (!pool)
+		return -1;
+	dl_list_init(&pool->queue);
+	dl_list_init(&pool->running);
+	dl_list_init(&pool->completed);
+	pool->max_queue = max_queue;
+	pool->threads = os_calloc(num_threads, sizeof(pthread_t));
+	if (!pool->threads || pipe(pool->notify) < 0) {
+		os_free(pool->threads);
+		os_free(pool);
+		pool = NULL;
+		return -1;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->job_cond, NULL);
+	pthread_cond_init(&pool->idle_cond, NULL);
+	fcntl(pool->notify[0], F_SETFL, O_NONBLOCK);
+
+	if (eloop_register_read_sock(pool->notify[0], worker_receive,
+				     NULL, NULL) < 0) {
+		worker_deinit();
+		return -1;
+	}
+
+	for (i = 0; i < num_threads; i++) {
+		if (pthread_create(&pool->threads[i], NULL, worker_thread,
+				   pool) != 0) {
+			wpa_printf(MSG_INFO,
+				   "worker: Failed to create thread %u", i);
+			break;
+		}
+		pool->num_threads++;
+	}
+	if (pool->num_threads == 0) {
+		worker_deinit();
+		return -1;
+	}
+
+	wpa_printf(MSG_DEBUG, "worker: Started %u thread(s)",
+		   pool->num_threads);
+
+	return 0;
+}
+
+
+/**
+ * worker_deinit - Stop worker threads
+ *
+ * Jobs that have not been started are cancelled. Jobs that are in progress
+ * are allowed to complete and their completion callbacks are called before
+ * this function returns.
+ */
+void worker_deinit(void)
+{
+	struct dl_list done;
+	struct worker_job *job;
+	unsigned int i;
+
+	if (pool) {
+		pthread_mutex_lock(&pool->lock);
+		pool->stop = 1;
+		pthread_cond_broadcast(&pool->job_cond);
+		pthread_mutex_unlock(&pool->lock);
+		for (i = 0; i < pool->num_threads; i++)
+			pthread_join(pool->threads[i], NULL);
+
+		dl_list_for_each(job, &pool->queue, struct worker_job, list)
+			job->cancelled = 1;
+		worker_deliver(&pool->queue);
+		dl_list_init(&done);
+		worker_collect(&done);
+		worker_deliver(&done);
+
+		eloop_unregister_read_sock(pool->notify[0]);
+		close(pool->notify[0]);
+		close(pool->notify[1]);
+		pthread_cond_destroy(&pool->idle_cond);
+		pthread_cond_destroy(&pool->job_cond);
+		pthread_mutex_destroy(&pool->lock);
+		os_free(pool->threads);
+		os_free(pool);
+		pool = NULL;
+	}
+
+	eloop_cancel_timeout(worker_sync_timeout, NULL, NULL);
+	worker_sync_timeout(NULL, NULL);
+}
+
+
+/**
+ * worker_submit - Submit a job
+ * @func: Function to run
+ * @done: Completion callback (called from eloop)
+ * @ctx: Job context
+ * Returns: 0 on success, -1 on failure (e.g., queue full)
+ *
+ * The completion callback is never called before this function returns.
+ */
+int worker_submit(worker_func func, worker_done done, void *ctx)
+{
+	struct worker_job *job;
+
+	job = os_zalloc(sizeof(*job));
+	if (!job)
+		return -1;
+	job->func = func;
+	job->done = done;
+	job->ctx = ctx;
+
+	if (pool) {
+		pthread_mutex_lock(&pool->lock);
+		if (pool->max_queue && pool->queue_len >= pool->max_queue) {
+			pthread_mutex_unlock(&pool->lock);
+			os_free(job);
+			return -1;
+		}
+		dl_list_add_tail(&pool->queue, &job->list);
+		pool->queue_len++;
+		pthread_cond_signal(&pool->job_cond);
+		pthread_mutex_unlock(&pool->lock);
+		return 0;
+	}
+
+	func(ctx);
+	dl_list_add_tail(&worker_sync_done, &job->list);
+	if (!eloop_is_timeout_registered(worker_sync_timeout, NULL, NULL))
+		eloop_register_timeout(0, 0, worker_sync_timeout, NULL, NULL);
+	return 0;
+}
+
+
+static int worker_cancel_list(struct dl_list *list, void *ctx)
+{
+	struct worker_job *job;
+
+	dl_list_for_each(job, list, struct worker_job, list) {
+		if (job->ctx == ctx) {
+			dl_list_del(&job->list);
+			job->done(job->ctx, 1);
+			os_free(job);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * worker_cancel - Cancel a job
+ * @ctx: Job context from worker_submit()
+ *
+ * If the job has not yet been started or it has already been completed, the
+ * completion callback is called from within this function with cancelled=1.
+ * If the job is in progress, the completion callback will be called with
+ * cancelled=1 from eloop once the job function returns.
+ */
+void worker_cancel(void *ctx)
+{
+	if (pool) {
+		struct worker_job *job, *found = NULL;
+
+		pthread_mutex_lock(&pool->lock);
+		dl_list_for_each(job, &pool->queue, struct worker_job, list) {
+			if (job->ctx == ctx) {
+				found = job;
+				pool->queue_len--;
+				break;
+			}
+		}
+		if (!found) {
+			dl_list_for_each(job, &pool->completed,
+					 struct worker_job, list) {
+				if (job->ctx == ctx) {
+					found = job;
+					break;
+				}
+			}
+		}
+		if (found) {
+			dl_list_del(&found->list);
+		} else {
+			dl_list_for_each(job, &pool->running,
+					 struct worker_job, list) {
+				if (job->ctx == ctx)
+					job->cancelled = 1;
+			}
+		}
+		pthread_mutex_unlock(&pool->lock);
+
+		if (found) {
+			found->done(found->ctx, 1);
+			os_free(found);
+		}
+		return;
+	}
+
+	worker_cancel_list(&worker_sync_done, ctx);
+}
+
+
+/**
+ * worker_wait - Wait for all submitted jobs to complete
+ *
+ * This blocks the calling (eloop) thread until all jobs have been completed
+ * and their completion callbacks have been called. This is meant for
+ * operations like configuration loading that need the results before
+ * continuing, but can still benefit from parallel execution.
+ */
+void worker_wait(void)
+{
+	if (pool) {
+		struct dl_list done;
+
+		pthread_mutex_lock(&pool->lock);
+		while (pool->queue_len)
+			pthread_cond_wait(&pool->idle_cond, &pool->lock);
+		pthread_mutex_unlock(&pool->lock);
+
+		dl_list_init(&done);
+		worker_collect(&done);
+		worker_deliver(&done);
+	}
+
+	eloop_cancel_timeout(worker_sync_timeout, NULL, NULL);
+	worker_sync_timeout(NULL, NULL);
+}
+
+
+/**
+ * worker_wait_func - Wait for jobs using a specific job function
+ * @func: Job function that was passed to worker_submit()
+ *
+ * This is like worker_wait(), but only the jobs that run @func are waited
+ * for and only their completion callbacks are called from within this
+ * function. Other completed jobs are left for delivery from eloop, so the
+ * caller does not end up running unrelated completion callbacks.
+ */
+void worker_wait_func(worker_func func)
+{
+	struct dl_list done;
+	struct worker_job *job, *tmp;
+
+	dl_list_init(&done);
+
+	if (pool) {
+		int pending;
+
+		pthread_mutex_lock(&pool->lock);
+		for (;;) {
+			pending = 0;
+			dl_list_for_each(job, &pool->queue, struct worker_job,
+					 list) {
+				if (job->func == func) {
+					pending = 1;
+					break;
+				}
+			}
+			dl_list_for_each(job, &pool->running, struct worker_job,
+					 list) {
+				if (job->func == func) {
+					pending = 1;
+					break;
+				}
+			}
+			if (!pending)
+				break;
+			pthread_cond_wait(&pool->idle_cond, &pool->lock);
+		}
+		/*
+		 * Leave the notification pending so that any remaining
+		 * completed jobs get delivered from eloop.
+		 */
+		dl_list_for_each_safe(job, tmp, &pool->completed,
+				      struct worker_job, list) {
+			if (job->func == func) {
+				dl_list_del(&job->list);
+				dl_list_add_tail(&done, &job->list);
+			}
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	dl_list_for_each_safe(job, tmp, &worker_sync_done, struct worker_job,
+			      list) {
+		if (job->func == func) {
+			dl_list_del(&job->list);
+			dl_list_add_tail(&done, &job->list);
+		}
+	}
+	if (dl_list_empty(&worker_sync_done))
+		eloop_cancel_timeout(worker_sync_timeout, NULL, NULL);
+
+	while ((job = dl_list_first(&done, struct worker_job, list))) {
+		dl_list_del(&job->list);
+		job->done(job->ctx, job->cancelled);
+		os_free(job);
+	}
+}
+
+
+/**
+ * worker_queue_len - Number of jobs that have not yet been completed
+ * Returns: Number of queued and in-progress jobs
+ */
+unsigned int worker_queue_len(void)
+{
+	if (pool) {
+		unsigned int len;
+
+		pthread_mutex_lock(&pool->lock);
+		len = pool->queue_len;
+		pthread_mutex_unlock(&pool->lock);
+		return len;
+	}
+
+	return 0;
+}
+
+
+/**
+ * worker_threads - Number of worker threads
+ * Returns: Number of running worker threads or 0 if jobs are run
+ * synchronously
+ */
+int worker_threads(void)
+{
+	if (pool)
+		return pool->num_threads;
+	return 0;
+}
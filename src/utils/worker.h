@@ -0,0 +1,99 @@
+/*
+ * Worker threads for offloading CPU intensive operations from eloop
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This module allows expensive and self-contained computations (e.g., key
+ * derivation or bignum operations) to be run outside the main event loop.
+ * Jobs are executed on a small pool of worker threads once the pool has been
+ * initialized with worker_init() (or synchronously at submission time in
+ * WPA_TRACE builds). In both cases, the completion callback is called from the
+ * eloop thread. Builds without CONFIG_WORKER_THREADS do not include this
+ * module; worker_submit() fails and the callers run the operations themselves.
+ *
+ * The job function runs without any locks held and must only touch the
+ * memory it was given in the job context. In particular, it must not call
+ * eloop functions. Debug prints and random_get_bytes() can be used since the
+ * random pool is locked in builds with CONFIG_WORKER_THREADS and worker
+ * threads are not used in WPA_TRACE builds (os_malloc() is not thread-safe
+ * with allocation tracking).
+ */
+
+#ifndef WORKER_H
+#define WORKER_H
+
+/**
+ * worker_func - Job function
+ * @ctx: Job context from worker_submit()
+ *
+ * This is called in a worker thread (or in the calling thread if worker
+ * threads are not available).
+ */
+typedef void (*worker_func)(void *ctx);
+
+/**
+ * worker_done - Job completion callback
+ * @ctx: Job context from worker_submit()
+ * @cancelled: Whether the job was cancelled with worker_cancel()
+ *
+ * This is called from the eloop thread once the job has been completed or
+ * cancelled. The callback is responsible for freeing the job context.
+ */
+typedef void (*worker_done)(void *ctx, int cancelled);
+
+#ifdef CONFIG_WORKER_THREADS
+
+int worker_init(unsigned int num_threads, unsigned int max_queue);
+void worker_deinit(void);
+int worker_submit(worker_func func, worker_done done, void *ctx);
+void worker_cancel(void *ctx);
+void worker_wait(void);
+void worker_wait_func(worker_func func);
+unsigned int worker_queue_len(void);
+int worker_threads(void);
+
+#else /* CONFIG_WORKER_THREADS */
+
+static inline int worker_init(unsigned int num_threads,
+			      unsigned int max_queue)
+{
+	return 0;
+}
+
+static inline void worker_deinit(void)
+{
+}
+
+static inline int worker_submit(worker_func func, worker_done done,
+				void *ctx)
+{
+	return -1;
+}
+
+static inline void worker_cancel(void *ctx)
+{
+}
+
+static inline void worker_wait(void)
+{
+}
+
+static inline void worker_wait_func(worker_func func)
+{
+}
+
+static inline unsigned int worker_queue_len(void)
+{
+	return 0;
+}
+
+static inline int worker_threads(void)
+{
+	return 0;
+}
+
+#endif /* CONFIG_WORKER_THREADS */
+
+#endif /* WORKER_H */
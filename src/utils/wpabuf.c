@@ -68,6 +68,11 @@ int wpabuf_resize(struct wpabuf **_buf, size_t add_len)
 
 	if (buf->used + add_len > buf->size) {
 		unsigned char *nbuf;
+		if (buf->refcount) {
+			wpa_printf(MSG_ERROR,
+				   "wpabuf: Cannot resize a shared buffer");
+			return -1;
+		}
 		if (buf->flags & WPABUF_FLAG_EXT_DATA) {
 			nbuf = os_realloc(buf->buf, buf->used + add_len);
 			if (nbuf == NULL)
@@ -175,9 +180,30 @@ struct wpabuf * wpabuf_dup(const struct wpabuf *src)
 }
 
 
+/**
+ * wpabuf_ref - Add a reference to a wpabuf
+ * @buf: wpabuf buffer allocated with wpabuf_alloc*() or %NULL
+ * Returns: buf
+ *
+ * This can be used instead of wpabuf_dup() when the copy would not be
+ * modified. The buffer is freed once wpabuf_free() has been called for the
+ * original pointer and for each added reference. A buffer that has references
+ * must be treated as read-only by all its users.
+ */
+struct wpabuf * wpabuf_ref(struct wpabuf *buf)
+{
+	if (buf)
+		buf->refcount++;
+	return buf;
+}
+
+
 /**
  * wpabuf_free - Free a wpabuf
  * @buf: wpabuf buffer
+ *
+ * If references have been added with wpabuf_ref(), this only drops one of
+ * them.
  */
 void wpabuf_free(struct wpabuf *buf)
 {
@@ -192,12 +218,20 @@ void wpabuf_free(struct wpabuf *buf)
 		wpa_trace_show("wpabuf_free magic mismatch");
 		abort();
 	}
+	if (buf->refcount) {
+		buf->refcount--;
+		return;
+	}
 	if (buf->flags & WPABUF_FLAG_EXT_DATA)
 		os_free(buf->buf);
 	os_free(trace);
 #else /* WPA_TRACE */
 	if (buf == NULL)
 		return;
+	if (buf->refcount) {
+		buf->refcount--;
+		return;
+	}
 	if (buf->flags & WPABUF_FLAG_EXT_DATA)
 		os_free(buf->buf);
 	os_free(buf);
@@ -208,7 +242,9 @@ void wpabuf_free(struct wpabuf *buf)
 void wpabuf_clear_free(struct wpabuf *buf)
 {
 	if (buf) {
-		os_memset(wpabuf_mhead(buf), 0, wpabuf_len(buf));
+		/* Other users of a shared buffer may still need the data */
+		if (!buf->refcount)
+			os_memset(wpabuf_mhead(buf), 0, wpabuf_len(buf));
 		wpabuf_free(buf);
 	}
 }
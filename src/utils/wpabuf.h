@@ -22,6 +22,7 @@ struct wpabuf {
 	size_t used; /* length of data in the buffer */
 	u8 *buf; /* pointer to the head of the buffer */
 	unsigned int flags;
+	unsigned int refcount; /* number of references added with wpabuf_ref() */
 	/* optionally followed by the allocated buffer */
 };
 
@@ -31,6 +32,7 @@ struct wpabuf * wpabuf_alloc(size_t len);
 struct wpabuf * wpabuf_alloc_ext_data(u8 *data, size_t len);
 struct wpabuf * wpabuf_alloc_copy(const void *data, size_t len);
 struct wpabuf * wpabuf_dup(const struct wpabuf *src);
+struct wpabuf * wpabuf_ref(struct wpabuf *buf);
 void wpabuf_free(struct wpabuf *buf);
 void wpabuf_clear_free(struct wpabuf *buf);
 void * wpabuf_put(struct wpabuf *buf, size_t len);
@@ -153,6 +155,7 @@ static inline void wpabuf_set(struct wpabuf *buf, const void *data, size_t len)
 	buf->buf = (u8 *) data;
 	buf->flags = WPABUF_FLAG_EXT_DATA;
 	buf->size = buf->used = len;
+	buf->refcount = 0;
 }
 
 static inline void wpabuf_put_str(struct wpabuf *dst, const char *str)
@@ -145,6 +145,9 @@ struct wps_data * wps_init(const struct wps_config *cfg)
 		data->peer_pubkey_hash_set = 1;
 	}
 
+	data->pending_cb = cfg->pending_cb;
+	data->pending_cb_ctx = cfg->pending_cb_ctx;
+
 	return data;
 }
 
@@ -170,6 +173,7 @@ void wps_deinit(struct wps_data *data)
 	} else if (data->registrar)
 		wps_registrar_unlock_pin(data->wps->registrar, data->uuid_e);
 
+	wps_derive_shared_cancel(data);
 	wpabuf_free(data->dh_privkey);
 	wpabuf_free(data->dh_pubkey_e);
 	wpabuf_free(data->dh_pubkey_r);
@@ -26,6 +26,7 @@ enum wsc_op_code {
 };
 
 struct wps_registrar;
+struct wps_dh_pool;
 struct upnp_wps_device_sm;
 struct wps_er;
 struct wps_parse_attr;
@@ -187,6 +188,22 @@ struct wps_config {
 	 * peer_pubkey_hash - Peer public key hash or %NULL if not known
 	 */
 	const u8 *peer_pubkey_hash;
+
+	/**
+	 * pending_cb - Callback for completion of pending processing
+	 * @ctx: Callback context (pending_cb_ctx)
+	 *
+	 * If this is set, the Registrar can derive the DH shared secret in a
+	 * worker thread. wps_process_msg() returns %WPS_PENDING in that case
+	 * and this callback is called from eloop once the message can be
+	 * processed again.
+	 */
+	void (*pending_cb)(void *ctx);
+
+	/**
+	 * pending_cb_ctx - Context data for pending_cb
+	 */
+	void *pending_cb_ctx;
 };
 
 struct wps_data * wps_init(const struct wps_config *cfg);
@@ -651,6 +668,11 @@ struct wps_context {
 	 */
 	struct wpabuf *dh_pubkey;
 
+	/**
+	 * dh_pool - Pool of precomputed Diffie-Hellman keypairs or %NULL
+	 */
+	struct wps_dh_pool *dh_pool;
+
 	/**
 	 * config_methods - Enabled configuration methods
 	 *
@@ -830,6 +852,8 @@ unsigned int wps_pin_valid(unsigned int pin);
 unsigned int wps_generate_pin(void);
 int wps_pin_str_valid(const char *pin);
 void wps_free_pending_msgs(struct upnp_pending_message *msgs);
+int wps_dh_pool_init(struct wps_context *wps, unsigned int size);
+void wps_dh_pool_deinit(struct wps_context *wps);
 
 struct wpabuf * wps_get_oob_cred(struct wps_context *wps, int rf_band,
 				 int channel);
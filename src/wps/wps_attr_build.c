@@ -18,11 +18,11 @@
 #include "wps_i.h"
 
 
-int wps_build_public_key(struct wps_data *wps, struct wpabuf *msg)
+int wps_prepare_public_key(struct wps_data *wps)
 {
 	struct wpabuf *pubkey;
+	int pooled = 0;
 
-	wpa_printf(MSG_DEBUG, "WPS:  * Public Key");
 	wpabuf_free(wps->dh_privkey);
 	wps->dh_privkey = NULL;
 	if (wps->dev_pw_id != DEV_PW_DEFAULT && wps->wps->dh_privkey &&
@@ -62,13 +62,19 @@ int wps_build_public_key(struct wps_data *wps, struct wpabuf *msg)
 		pubkey = wpabuf_dup(wps->wps->ap_nfc_dh_pubkey);
 		wps->dh_ctx = dh5_init_fixed(wps->dh_privkey, pubkey);
 #endif /* CONFIG_WPS_NFC */
+	} else if (wps_dh_pool_get(wps->wps, &wps->dh_privkey, &pubkey) == 0) {
+		wpa_printf(MSG_DEBUG, "WPS: Using precomputed DH keys");
+		dh5_free(wps->dh_ctx);
+		wps->dh_ctx = NULL;
+		pooled = 1;
 	} else {
 		wpa_printf(MSG_DEBUG, "WPS: Generate new DH keys");
 		dh5_free(wps->dh_ctx);
 		wps->dh_ctx = dh5_init(&wps->dh_privkey, &pubkey);
 		pubkey = wpabuf_zeropad(pubkey, 192);
 	}
-	if (wps->dh_ctx == NULL || wps->dh_privkey == NULL || pubkey == NULL) {
+	if ((wps->dh_ctx == NULL && !pooled) || wps->dh_privkey == NULL ||
+	    pubkey == NULL) {
 		wpa_printf(MSG_DEBUG, "WPS: Failed to initialize "
 			   "Diffie-Hellman handshake");
 		wpabuf_free(pubkey);
@@ -77,10 +83,6 @@ int wps_build_public_key(struct wps_data *wps, struct wpabuf *msg)
 	wpa_hexdump_buf_key(MSG_DEBUG, "WPS: DH Private Key", wps->dh_privkey);
 	wpa_hexdump_buf(MSG_DEBUG, "WPS: DH own Public Key", pubkey);
 
-	wpabuf_put_be16(msg, ATTR_PUBLIC_KEY);
-	wpabuf_put_be16(msg, wpabuf_len(pubkey));
-	wpabuf_put_buf(msg, pubkey);
-
 	if (wps->registrar) {
 		wpabuf_free(wps->dh_pubkey_r);
 		wps->dh_pubkey_r = pubkey;
@@ -93,6 +95,25 @@ int wps_build_public_key(struct wps_data *wps, struct wpabuf *msg)
 }
 
 
+int wps_build_public_key(struct wps_data *wps, struct wpabuf *msg)
+{
+	struct wpabuf *pubkey;
+
+	wpa_printf(MSG_DEBUG, "WPS:  * Public Key");
+	if (wps->dh_key_prepared)
+		wps->dh_key_prepared = 0; /* selected in wps_derive_shared_start() */
+	else if (wps_prepare_public_key(wps) < 0)
+		return -1;
+
+	pubkey = wps->registrar ? wps->dh_pubkey_r : wps->dh_pubkey_e;
+	wpabuf_put_be16(msg, ATTR_PUBLIC_KEY);
+	wpabuf_put_be16(msg, wpabuf_len(pubkey));
+	wpabuf_put_buf(msg, pubkey);
+
+	return 0;
+}
+
+
 int wps_build_req_type(struct wpabuf *msg, enum wps_request_type type)
 {
 	wpa_printf(MSG_DEBUG, "WPS:  * Request Type");
@@ -9,10 +9,13 @@
 #include "includes.h"
 
 #include "common.h"
+#include "utils/list.h"
+#include "utils/worker.h"
 #include "common/defs.h"
 #include "common/ieee802_11_common.h"
 #include "crypto/aes_wrap.h"
 #include "crypto/crypto.h"
+#include "crypto/dh_groups.h"
 #include "crypto/dh_group5.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
@@ -59,6 +62,331 @@ void wps_kdf(const u8 *key, const u8 *label_prefix, size_t label_prefix_len,
 }
 
 
+/*
+ * Diffie-Hellman operations are by far the most expensive part of WPS with
+ * the internal crypto implementation. Keypairs are precomputed into a small
+ * per-context pool in the background and the Registrar can derive the shared
+ * secret in a worker thread while the EAP session waits in pending state.
+ * Job functions use only crypto_mod_exp() on data owned by the job since they
+ * may be run outside the eloop thread; with the internal crypto implementation,
+ * its cache of generator tables is protected with a lock.
+ */
+
+struct wps_dh_keypair {
+	struct dl_list list;
+	struct wps_dh_pool *pool; /* set while the keypair is being generated */
+	struct wpabuf *priv;
+	struct wpabuf *pub;
+};
+
+struct wps_dh_pool {
+	struct dl_list keys; /* struct wps_dh_keypair::list */
+	unsigned int count;
+	unsigned int size;
+	struct wps_dh_keypair *refill; /* keypair being generated */
+};
+
+struct wps_dh_job {
+	struct wps_data *wps; /* NULL if the job has been abandoned */
+	struct wpabuf *peer;
+	struct wpabuf *priv;
+	struct wpabuf *shared;
+};
+
+
+/* Append base^priv mod p zero padded to the length of p to buf */
+static int wps_dh_mod_exp(const u8 *base, size_t base_len,
+			  const struct wpabuf *priv, struct wpabuf *buf)
+{
+	const struct dh_group *dh = dh_groups_get(WPS_DH_GROUP);
+	size_t len;
+	u8 *pos;
+
+	if (!dh || wpabuf_tailroom(buf) < dh->prime_len)
+		return -1;
+	len = dh->prime_len;
+	pos = wpabuf_put(buf, 0);
+	if (crypto_mod_exp(base, base_len, wpabuf_head(priv), wpabuf_len(priv),
+			   dh->prime, dh->prime_len, pos, &len) < 0)
+		return -1;
+	if (len < dh->prime_len) {
+		os_memmove(pos + dh->prime_len - len, pos, len);
+		os_memset(pos, 0, dh->prime_len - len);
+	}
+	wpabuf_put(buf, dh->prime_len);
+	return 0;
+}
+
+
+static void wps_dh_keypair_free(struct wps_dh_keypair *key)
+{
+	wpabuf_clear_free(key->priv);
+	wpabuf_free(key->pub);
+	os_free(key);
+}
+
+
+static void wps_dh_keygen(void *ctx)
+{
+	struct wps_dh_keypair *key = ctx;
+	const struct dh_group *dh = dh_groups_get(WPS_DH_GROUP);
+
+	/* An empty public key buffer indicates failure */
+	wps_dh_mod_exp(dh->generator, dh->generator_len, key->priv, key->pub);
+}
+
+
+static void wps_dh_pool_refill(struct wps_dh_pool *pool);
+
+static void wps_dh_keygen_done(void *ctx, int cancelled)
+{
+	struct wps_dh_keypair *key = ctx;
+	struct wps_dh_pool *pool = key->pool;
+
+	if (pool)
+		pool->refill = NULL;
+	if (!pool || cancelled || wpabuf_len(key->pub) == 0) {
+		/* Failures are retried on the next wps_dh_pool_get() */
+		wps_dh_keypair_free(key);
+		return;
+	}
+
+	key->pool = NULL;
+	dl_list_add_tail(&pool->keys, &key->list);
+	pool->count++;
+	wps_dh_pool_refill(pool);
+}
+
+
+static void wps_dh_pool_refill(struct wps_dh_pool *pool)
+{
+	const struct dh_group *dh = dh_groups_get(WPS_DH_GROUP);
+	struct wps_dh_keypair *key;
+
+	if (!dh || pool->refill || pool->count >= pool->size)
+		return;
+
+	key = os_zalloc(sizeof(*key));
+	if (!key)
+		return;
+	key->priv = wpabuf_alloc(dh->prime_len);
+	key->pub = wpabuf_alloc(dh->prime_len);
+	if (!key->priv || !key->pub ||
+	    random_get_bytes(wpabuf_put(key->priv, dh->prime_len),
+			     dh->prime_len)) {
+		wps_dh_keypair_free(key);
+		return;
+	}
+	if (os_memcmp(wpabuf_head(key->priv), dh->prime, dh->prime_len) > 0) {
+		/* Make sure private value is smaller than prime */
+		*(wpabuf_mhead_u8(key->priv)) = 0;
+	}
+
+	key->pool = pool;
+	pool->refill = key;
+	if (worker_submit(wps_dh_keygen, wps_dh_keygen_done, key) < 0) {
+		pool->refill = NULL;
+		wps_dh_keypair_free(key);
+	}
+}
+
+
+/**
+ * wps_dh_pool_init - Start maintaining a pool of precomputed DH keypairs
+ * @wps: WPS context
+ * @size: Number of keypairs to keep available
+ * Returns: 0 on success, -1 on failure
+ *
+ * The pool is filled in the background (in a worker thread if available) and
+ * refilled whenever a keypair is taken into use for a new registration run.
+ */
+int wps_dh_pool_init(struct wps_context *wps, unsigned int size)
+{
+	struct wps_dh_pool *pool;
+
+	if (wps->dh_pool || size == 0)
+		return 0;
+	pool = os_zalloc(sizeof(*pool));
+	if (!pool)
+		return -1;
+	dl_list_init(&pool->keys);
+	pool->size = size;
+	wps->dh_pool = pool;
+	wps_dh_pool_refill(pool);
+	return 0;
+}
+
+
+/**
+ * wps_dh_pool_deinit - Free the DH keypair pool
+ * @wps: WPS context
+ */
+void wps_dh_pool_deinit(struct wps_context *wps)
+{
+	struct wps_dh_pool *pool = wps->dh_pool;
+	struct wps_dh_keypair *key;
+
+	if (!pool)
+		return;
+	wps->dh_pool = NULL;
+	key = pool->refill;
+	if (key) {
+		/* The completion callback frees the keypair */
+		key->pool = NULL;
+		pool->refill = NULL;
+		worker_cancel(key);
+	}
+	while ((key = dl_list_first(&pool->keys, struct wps_dh_keypair,
+				    list))) {
+		dl_list_del(&key->list);
+		wps_dh_keypair_free(key);
+	}
+	os_free(pool);
+}
+
+
+/**
+ * wps_dh_pool_get - Take a precomputed DH keypair from the pool
+ * @wps: WPS context
+ * @priv: Buffer for returning the private key
+ * @pub: Buffer for returning the public key (zero padded to 192 octets)
+ * Returns: 0 on success, -1 if no keypair is available
+ */
+int wps_dh_pool_get(struct wps_context *wps, struct wpabuf **priv,
+		    struct wpabuf **pub)
+{
+	struct wps_dh_pool *pool = wps->dh_pool;
+	struct wps_dh_keypair *key;
+
+	if (!pool)
+		return -1;
+	key = dl_list_first(&pool->keys, struct wps_dh_keypair, list);
+	if (key) {
+		dl_list_del(&key->list);
+		pool->count--;
+		*priv = key->priv;
+		*pub = key->pub;
+		os_free(key);
+	}
+	wps_dh_pool_refill(pool);
+
+	return key ? 0 : -1;
+}
+
+
+static void wps_dh_job_free(struct wps_dh_job *job)
+{
+	wpabuf_free(job->peer);
+	wpabuf_clear_free(job->priv);
+	wpabuf_clear_free(job->shared);
+	os_free(job);
+}
+
+
+static void wps_dh_shared(void *ctx)
+{
+	struct wps_dh_job *job = ctx;
+
+	/* An empty shared secret buffer indicates failure */
+	wps_dh_mod_exp(wpabuf_head(job->peer), wpabuf_len(job->peer),
+		       job->priv, job->shared);
+}
+
+
+static void wps_dh_shared_done(void *ctx, int cancelled)
+{
+	struct wps_dh_job *job = ctx;
+	struct wps_data *wps = job->wps;
+
+	if (!wps) {
+		wps_dh_job_free(job);
+		return;
+	}
+
+	wps->dh_job = NULL;
+	wps->dh_job_done = 1;
+	if (!cancelled && wpabuf_len(job->shared) > 0) {
+		wps->dh_shared = job->shared;
+		job->shared = NULL;
+	} else {
+		/* wps_derive_keys() falls back to synchronous derivation */
+		wpa_printf(MSG_DEBUG,
+			   "WPS: DH shared secret derivation in worker failed");
+	}
+	wps_dh_job_free(job);
+
+	if (!cancelled && wps->pending_cb)
+		wps->pending_cb(wps->pending_cb_ctx);
+}
+
+
+/**
+ * wps_derive_shared_start - Start DH shared secret derivation in a worker
+ * @wps: WPS Registration protocol data
+ * Returns: 0 if the derivation was started and the caller should wait for the
+ * pending callback or -1 if keys are to be derived synchronously
+ *
+ * This selects the own DH keypair (to be used when building the next message)
+ * and derives the shared secret with the peer public key in a worker thread.
+ * Nothing is done if worker threads are not available or the caller did not
+ * register a pending callback.
+ */
+int wps_derive_shared_start(struct wps_data *wps)
+{
+	struct wps_dh_job *job;
+	struct wpabuf *peer;
+
+	if (!wps->pending_cb || worker_threads() == 0 || wps->dh_job)
+		return -1;
+
+	peer = wps->registrar ? wps->dh_pubkey_e : wps->dh_pubkey_r;
+	if (!peer || wps_prepare_public_key(wps) < 0)
+		return -1;
+	wps->dh_key_prepared = 1;
+
+	job = os_zalloc(sizeof(*job));
+	if (!job)
+		return -1;
+	job->wps = wps;
+	job->peer = wpabuf_dup(peer);
+	job->priv = wpabuf_dup(wps->dh_privkey);
+	job->shared = wpabuf_alloc(192);
+	if (!job->peer || !job->priv || !job->shared) {
+		wps_dh_job_free(job);
+		return -1;
+	}
+
+	wps->dh_job_done = 0;
+	wps->dh_job = job;
+	if (worker_submit(wps_dh_shared, wps_dh_shared_done, job) < 0) {
+		wps->dh_job = NULL;
+		wps_dh_job_free(job);
+		return -1;
+	}
+
+	wpa_printf(MSG_DEBUG, "WPS: Deriving DH shared secret in a worker");
+	return 0;
+}
+
+
+/**
+ * wps_derive_shared_cancel - Abandon DH shared secret derivation
+ * @wps: WPS Registration protocol data
+ */
+void wps_derive_shared_cancel(struct wps_data *wps)
+{
+	struct wps_dh_job *job = wps->dh_job;
+
+	wps->dh_job = NULL;
+	if (job) {
+		job->wps = NULL;
+		worker_cancel(job);
+	}
+	wpabuf_clear_free(wps->dh_shared);
+	wps->dh_shared = NULL;
+}
+
+
 int wps_derive_keys(struct wps_data *wps)
 {
 	struct wpabuf *pubkey, *dh_shared;
@@ -80,7 +408,18 @@ int wps_derive_keys(struct wps_data *wps)
 
 	wpa_hexdump_buf_key(MSG_DEBUG, "WPS: DH Private Key", wps->dh_privkey);
 	wpa_hexdump_buf(MSG_DEBUG, "WPS: DH peer Public Key", pubkey);
-	dh_shared = dh5_derive_shared(wps->dh_ctx, pubkey, wps->dh_privkey);
+	if (wps->dh_shared) {
+		/* Derived in a worker thread */
+		dh_shared = wps->dh_shared;
+		wps->dh_shared = NULL;
+	} else if (wps->dh_ctx) {
+		dh_shared = dh5_derive_shared(wps->dh_ctx, pubkey,
+					      wps->dh_privkey);
+	} else {
+		/* Keypair taken from the precomputed pool */
+		dh_shared = dh_derive_shared(pubkey, wps->dh_privkey,
+					     dh_groups_get(WPS_DH_GROUP));
+	}
 	dh5_free(wps->dh_ctx);
 	wps->dh_ctx = NULL;
 	dh_shared = wpabuf_zeropad(dh_shared, 192);
@@ -114,6 +114,15 @@ struct wps_data {
 
 	void *dh_ctx;
 
+	/* Own DH key has been selected before building the message */
+	int dh_key_prepared;
+	/* Shared secret derivation in a worker thread */
+	struct wps_dh_job *dh_job;
+	int dh_job_done;
+	struct wpabuf *dh_shared;
+	void (*pending_cb)(void *ctx);
+	void *pending_cb_ctx;
+
 	void (*ap_settings_cb)(void *ctx, const struct wps_credential *cred);
 	void *ap_settings_cb_ctx;
 
@@ -132,6 +141,10 @@ struct wps_data {
 void wps_kdf(const u8 *key, const u8 *label_prefix, size_t label_prefix_len,
 	     const char *label, u8 *res, size_t res_len);
 int wps_derive_keys(struct wps_data *wps);
+int wps_dh_pool_get(struct wps_context *wps, struct wpabuf **priv,
+		    struct wpabuf **pub);
+int wps_derive_shared_start(struct wps_data *wps);
+void wps_derive_shared_cancel(struct wps_data *wps);
 void wps_derive_psk(struct wps_data *wps, const u8 *dev_passwd,
 		    size_t dev_passwd_len);
 struct wpabuf * wps_decrypt_encr_settings(struct wps_data *wps, const u8 *encr,
@@ -150,6 +163,7 @@ struct wpabuf * wps_build_wsc_ack(struct wps_data *wps);
 struct wpabuf * wps_build_wsc_nack(struct wps_data *wps);
 
 /* wps_attr_build.c */
+int wps_prepare_public_key(struct wps_data *wps);
 int wps_build_public_key(struct wps_data *wps, struct wpabuf *msg);
 int wps_build_req_type(struct wpabuf *msg, enum wps_request_type type);
 int wps_build_resp_type(struct wpabuf *msg, enum wps_response_type type);
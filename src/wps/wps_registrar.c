@@ -3006,6 +3006,10 @@ static enum wps_process_res wps_process_wsc_msg(struct wps_data *wps,
 		 */
 		wpabuf_free(wps->last_msg);
 		wps->last_msg = wpabuf_dup(msg);
+
+		if (*attr.msg_type == WPS_M1 && wps->state == SEND_M2 &&
+		    wps_derive_shared_start(wps) == 0)
+			ret = WPS_PENDING;
 	}
 
 	return ret;
@@ -3332,6 +3336,13 @@ enum wps_process_res wps_registrar_process_msg(struct wps_data *wps,
 
 	switch (op_code) {
 	case WSC_MSG:
+		if (wps->dh_job)
+			return WPS_PENDING;
+		if (wps->dh_job_done) {
+			/* M1 was processed before the DH derivation started */
+			wps->dh_job_done = 0;
+			return WPS_CONTINUE;
+		}
 		return wps_process_wsc_msg(wps, msg);
 	case WSC_ACK:
 		if (wps_validate_wsc_ack(msg) < 0)
@@ -142,6 +142,17 @@ ifdef CONFIG_ELOOP_EPOLL
 L_CFLAGS += -DCONFIG_ELOOP_EPOLL
 endif
 
+ifdef CONFIG_WORKER_THREADS
+L_CFLAGS += -DCONFIG_WORKER_THREADS
+OBJS += src/utils/worker.c
+endif
+
+ifdef CONFIG_FRAME_POOL
+L_CFLAGS += -DCONFIG_FRAME_POOL
+OBJS += src/utils/frame_pool.c
+OBJS_priv += src/utils/frame_pool.c
+endif
+
 ifdef CONFIG_EAPOL_TEST
 L_CFLAGS += -Werror -DEAPOL_TEST
 endif
@@ -311,6 +322,8 @@ endif
 
 ifdef CONFIG_INTERWORKING
 OBJS += interworking.c
+OBJS += anqp_cache.c
+OBJS += anqp_match.c
 L_CFLAGS += -DCONFIG_INTERWORKING
 NEED_GAS=y
 endif
@@ -1217,6 +1230,7 @@ endif
 ifdef NEED_MD5
 ifdef CONFIG_INTERNAL_MD5
 MD5OBJS += src/crypto/md5-internal.c
+L_CFLAGS += -DCONFIG_INTERNAL_MD5
 endif
 OBJS += $(MD5OBJS)
 OBJS_p += $(MD5OBJS)
@@ -1481,6 +1495,16 @@ L_CFLAGS += -DCONFIG_AUTOSCAN
 OBJS += autoscan.c
 endif
 
+ifdef CONFIG_SCAN_PLAN
+L_CFLAGS += -DCONFIG_SCAN_PLAN
+OBJS += scan_plan.c
+endif
+
+ifdef CONFIG_ROAM_CAND
+L_CFLAGS += -DCONFIG_ROAM_CAND
+OBJS += roam_cand.c
+endif
+
 ifdef CONFIG_EXT_PASSWORD_TEST
 OBJS += src/utils/ext_password_test.c
 L_CFLAGS += -DCONFIG_EXT_PASSWORD_TEST
@@ -0,0 +1,533 @@
+/*
+ * wpa_supplicant - Persistent ANQP information cache
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * ANQP information fetched from APs is kept in a bounded cache that is stored
+ * in a text file over restarts. The cached information is used for new BSS
+ * entries with the same BSSID or in the same ANQP domain until a fresh ANQP
+ * response has been received from the AP.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/list.h"
+#include "wpa_supplicant_i.h"
+#include "bss.h"
+#include "anqp_cache.h"
+
+
+/**
+ * struct anqp_cache_entry - Cached ANQP information of a BSS
+ */
+struct anqp_cache_entry {
+	struct dl_list list;
+	u8 bssid[ETH_ALEN];
+	u8 hessid[ETH_ALEN];
+	u8 ssid[SSID_MAX_LEN];
+	size_t ssid_len;
+	int domain_id; /* -1 if not advertised */
+	os_time_t updated;
+	struct wpa_bss_anqp *anqp;
+};
+
+/**
+ * struct anqp_cache - ANQP information cache
+ */
+struct anqp_cache {
+	struct dl_list entries; /* struct anqp_cache_entry; most recent first */
+	unsigned int num_entries;
+	unsigned int max_entries;
+	unsigned int ttl; /* seconds */
+	char *fname;
+	int changed;
+};
+
+
+#define ANQP_CACHE_FIELD(f) { #f, offsetof(struct wpa_bss_anqp, f) }
+
+static const struct {
+	const char *name;
+	size_t offset;
+} anqp_cache_fields[] = {
+	ANQP_CACHE_FIELD(capability_list),
+	ANQP_CACHE_FIELD(venue_name),
+	ANQP_CACHE_FIELD(network_auth_type),
+	ANQP_CACHE_FIELD(roaming_consortium),
+	ANQP_CACHE_FIELD(ip_addr_type_availability),
+	ANQP_CACHE_FIELD(nai_realm),
+	ANQP_CACHE_FIELD(anqp_3gpp),
+	ANQP_CACHE_FIELD(domain_name),
+#ifdef CONFIG_HS20
+	ANQP_CACHE_FIELD(hs20_capability_list),
+	ANQP_CACHE_FIELD(hs20_operator_friendly_name),
+	ANQP_CACHE_FIELD(hs20_wan_metrics),
+	ANQP_CACHE_FIELD(hs20_connection_capability),
+	ANQP_CACHE_FIELD(hs20_operating_class),
+	ANQP_CACHE_FIELD(hs20_osu_providers_list),
+#endif /* CONFIG_HS20 */
+};
+
+#undef ANQP_CACHE_FIELD
+
+
+static struct wpabuf ** anqp_cache_field(struct wpa_bss_anqp *anqp, size_t i)
+{
+	return (struct wpabuf **) ((u8 *) anqp + anqp_cache_fields[i].offset);
+}
+
+
+static os_time_t anqp_cache_now(void)
+{
+	struct os_time now;
+
+	os_get_time(&now);
+	return now.sec;
+}
+
+
+static int anqp_cache_expired(struct anqp_cache *cache,
+			      struct anqp_cache_entry *e, os_time_t now)
+{
+	return now > e->updated && now - e->updated > (os_time_t) cache->ttl;
+}
+
+
+static void anqp_cache_entry_free(struct anqp_cache *cache,
+				  struct anqp_cache_entry *e)
+{
+	dl_list_del(&e->list);
+	cache->num_entries--;
+	wpa_bss_anqp_free(e->anqp);
+	os_free(e);
+}
+
+
+static struct anqp_cache_entry * anqp_cache_entry_add(struct anqp_cache *cache)
+{
+	struct anqp_cache_entry *e;
+
+	e = os_zalloc(sizeof(*e));
+	if (e == NULL)
+		return NULL;
+	e->anqp = wpa_bss_anqp_alloc();
+	if (e->anqp == NULL) {
+		os_free(e);
+		return NULL;
+	}
+	e->domain_id = -1;
+	dl_list_add(&cache->entries, &e->list);
+	cache->num_entries++;
+
+	return e;
+}
+
+
+static void anqp_cache_evict(struct anqp_cache *cache)
+{
+	struct anqp_cache_entry *e;
+
+	while (cache->num_entries > cache->max_entries) {
+		e = dl_list_last(&cache->entries, struct anqp_cache_entry,
+				 list);
+		wpa_printf(MSG_DEBUG, "ANQP cache: Remove oldest entry " MACSTR,
+			   MAC2STR(e->bssid));
+		anqp_cache_entry_free(cache, e);
+		cache->changed = 1;
+	}
+}
+
+
+static int anqp_cache_parse_hex(const char *hex, u8 *buf, size_t buflen)
+{
+	size_t len = os_strlen(hex);
+
+	if (len & 1 || len / 2 > buflen || hexstr2bin(hex, buf, len / 2) < 0)
+		return -1;
+	return len / 2;
+}
+
+
+static struct anqp_cache_entry *
+anqp_cache_parse_entry(struct anqp_cache *cache, const char *line, int lineno)
+{
+	struct anqp_cache_entry *e;
+	const char *hessid, *domain_id, *time, *ssid;
+	int len;
+
+	hessid = os_strstr(line, " hessid=");
+	domain_id = os_strstr(line, " domain_id=");
+	time = os_strstr(line, " time=");
+	ssid = os_strstr(line, " ssid=");
+	if (hessid == NULL || domain_id == NULL || time == NULL ||
+	    ssid == NULL) {
+		wpa_printf(MSG_INFO, "ANQP cache: Invalid entry on line %d",
+			   lineno);
+		return NULL;
+	}
+
+	e = anqp_cache_entry_add(cache);
+	if (e == NULL)
+		return NULL;
+	e->domain_id = atoi(domain_id + 11);
+	e->updated = strtol(time + 6, NULL, 10);
+	len = anqp_cache_parse_hex(ssid + 6, e->ssid, sizeof(e->ssid));
+	if (hwaddr_aton(line + 4, e->bssid) < 0 ||
+	    hwaddr_aton(hessid + 8, e->hessid) < 0 || len < 0) {
+		wpa_printf(MSG_INFO, "ANQP cache: Invalid entry on line %d",
+			   lineno);
+		anqp_cache_entry_free(cache, e);
+		return NULL;
+	}
+	e->ssid_len = len;
+
+	/* Keep the order of the file; the most recently used entry is first */
+	dl_list_del(&e->list);
+	dl_list_add_tail(&cache->entries, &e->list);
+
+	return e;
+}
+
+
+static int anqp_cache_parse_field(struct anqp_cache_entry *e, char *line)
+{
+	struct wpabuf **field, *buf;
+	char *value;
+	size_t i, len;
+
+	value = os_strchr(line, '=');
+	if (value == NULL)
+		return -1;
+	*value++ = '\0';
+
+	for (i = 0; i < ARRAY_SIZE(anqp_cache_fields); i++) {
+		if (os_strcmp(line, anqp_cache_fields[i].name) == 0)
+			break;
+	}
+	if (i == ARRAY_SIZE(anqp_cache_fields))
+		return 0; /* not supported in this build */
+
+	len = os_strlen(value) / 2;
+	buf = wpabuf_alloc(len);
+	if (buf == NULL)
+		return -1;
+	if (anqp_cache_parse_hex(value, wpabuf_put(buf, len), len) < 0) {
+		wpabuf_free(buf);
+		return -1;
+	}
+
+	field = anqp_cache_field(e->anqp, i);
+	wpabuf_free(*field);
+	*field = buf;
+	return 0;
+}
+
+
+static void anqp_cache_load(struct anqp_cache *cache)
+{
+	char *buf, *pos, *end, *eol;
+	struct anqp_cache_entry *e = NULL;
+	size_t len;
+	int lineno = 0;
+	os_time_t now = anqp_cache_now();
+
+	buf = os_readfile(cache->fname, &len);
+	if (buf == NULL) {
+		wpa_printf(MSG_DEBUG, "ANQP cache: Could not read '%s'",
+			   cache->fname);
+		return;
+	}
+
+	end = buf + len;
+	for (pos = buf; pos < end; pos = eol + 1) {
+		for (eol = pos; eol < end && *eol != '\n'; eol++)
+			;
+		if (eol == end)
+			break; /* truncated line */
+		*eol = '\0';
+		lineno++;
+
+		if (*pos == '#' || *pos == '\0')
+			continue;
+		if (os_strncmp(pos, "bss=", 4) == 0) {
+			e = anqp_cache_parse_entry(cache, pos, lineno);
+			if (e && anqp_cache_expired(cache, e, now)) {
+				anqp_cache_entry_free(cache, e);
+				e = NULL;
+				cache->changed = 1;
+			}
+			continue;
+		}
+		if (e && anqp_cache_parse_field(e, pos) < 0) {
+			wpa_printf(MSG_INFO,
+				   "ANQP cache: Invalid field on line %d",
+				   lineno);
+			anqp_cache_entry_free(cache, e);
+			e = NULL;
+		}
+	}
+
+	os_free(buf);
+	anqp_cache_evict(cache);
+
+	wpa_printf(MSG_DEBUG, "ANQP cache: Loaded %u entries from '%s'",
+		   cache->num_entries, cache->fname);
+}
+
+
+/**
+ * anqp_cache_init - Initialize ANQP cache
+ * @fname: File for storing the cache
+ * @max_entries: Maximum number of cached BSSes
+ * @ttl: Maximum age of the cached information in seconds
+ * Returns: Pointer to the ANQP cache or %NULL on failure
+ *
+ * The previously stored entries that have not yet expired are loaded from
+ * @fname.
+ */
+struct anqp_cache * anqp_cache_init(const char *fname,
+				    unsigned int max_entries,
+				    unsigned int ttl)
+{
+	struct anqp_cache *cache;
+
+	cache = os_zalloc(sizeof(*cache));
+	if (cache == NULL)
+		return NULL;
+	dl_list_init(&cache->entries);
+	cache->max_entries = max_entries;
+	cache->ttl = ttl;
+	cache->fname = os_strdup(fname);
+	if (cache->fname == NULL) {
+		os_free(cache);
+		return NULL;
+	}
+
+	anqp_cache_load(cache);
+
+	return cache;
+}
+
+
+/**
+ * anqp_cache_deinit - Store and free ANQP cache
+ * @cache: ANQP cache from anqp_cache_init()
+ */
+void anqp_cache_deinit(struct anqp_cache *cache)
+{
+	struct anqp_cache_entry *e, *prev;
+
+	if (cache == NULL)
+		return;
+
+	anqp_cache_save(cache);
+	dl_list_for_each_safe(e, prev, &cache->entries,
+			      struct anqp_cache_entry, list)
+		anqp_cache_entry_free(cache, e);
+	os_free(cache->fname);
+	os_free(cache);
+}
+
+
+static void anqp_cache_write_hex(FILE *f, const u8 *data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		fprintf(f, "%02x", data[i]);
+}
+
+
+/**
+ * anqp_cache_save - Store ANQP cache into a file
+ * @cache: ANQP cache from anqp_cache_init()
+ * Returns: 0 on success (or if nothing was changed) or -1 on failure
+ *
+ * The file is replaced atomically, so an interrupted write does not lose the
+ * previously stored entries.
+ */
+int anqp_cache_save(struct anqp_cache *cache)
+{
+	struct anqp_cache_entry *e;
+	struct wpabuf *buf;
+	char *tmp;
+	size_t len, i;
+	FILE *f;
+	os_time_t now;
+	int ret = 0;
+
+	if (cache == NULL || !cache->changed)
+		return 0;
+
+	len = os_strlen(cache->fname) + 5;
+	tmp = os_malloc(len);
+	if (tmp == NULL)
+		return -1;
+	os_snprintf(tmp, len, "%s.tmp", cache->fname);
+
+	f = fopen(tmp, "w");
+	if (f == NULL) {
+		wpa_printf(MSG_INFO, "ANQP cache: Could not open '%s': %s",
+			   tmp, strerror(errno));
+		os_free(tmp);
+		return -1;
+	}
+
+	fprintf(f, "# ANQP cache; do not edit while wpa_supplicant is running\n");
+	now = anqp_cache_now();
+	dl_list_for_each(e, &cache->entries, struct anqp_cache_entry, list) {
+		if (anqp_cache_expired(cache, e, now))
+			continue;
+		fprintf(f, "bss=" MACSTR " hessid=" MACSTR
+			" domain_id=%d time=%ld ssid=",
+			MAC2STR(e->bssid), MAC2STR(e->hessid), e->domain_id,
+			(long) e->updated);
+		anqp_cache_write_hex(f, e->ssid, e->ssid_len);
+		fprintf(f, "\n");
+		for (i = 0; i < ARRAY_SIZE(anqp_cache_fields); i++) {
+			buf = *anqp_cache_field(e->anqp, i);
+			if (buf == NULL)
+				continue;
+			fprintf(f, "%s=", anqp_cache_fields[i].name);
+			anqp_cache_write_hex(f, wpabuf_head(buf),
+					     wpabuf_len(buf));
+			fprintf(f, "\n");
+		}
+	}
+
+	if (ferror(f) || fclose(f) != 0 || rename(tmp, cache->fname) < 0) {
+		wpa_printf(MSG_INFO, "ANQP cache: Could not write '%s': %s",
+			   cache->fname, strerror(errno));
+		unlink(tmp);
+		ret = -1;
+	} else {
+		cache->changed = 0;
+		wpa_printf(MSG_DEBUG, "ANQP cache: Stored %u entries to '%s'",
+			   cache->num_entries, cache->fname);
+	}
+	os_free(tmp);
+
+	return ret;
+}
+
+
+static int anqp_cache_same_ssid(struct anqp_cache_entry *e,
+				struct wpa_bss *bss)
+{
+	return e->ssid_len == bss->ssid_len &&
+		os_memcmp(e->ssid, bss->ssid, bss->ssid_len) == 0;
+}
+
+
+static struct anqp_cache_entry * anqp_cache_get(struct anqp_cache *cache,
+						struct wpa_bss *bss)
+{
+	struct anqp_cache_entry *e, *prev, *shared = NULL;
+	int domain_id = wpa_bss_get_anqp_domain_id(bss);
+	os_time_t now = anqp_cache_now();
+
+	dl_list_for_each_safe(e, prev, &cache->entries,
+			      struct anqp_cache_entry, list) {
+		if (anqp_cache_expired(cache, e, now)) {
+			anqp_cache_entry_free(cache, e);
+			cache->changed = 1;
+			continue;
+		}
+		if (!anqp_cache_same_ssid(e, bss) ||
+		    os_memcmp(e->hessid, bss->hessid, ETH_ALEN) != 0)
+			continue;
+		if (e->domain_id >= 0 && domain_id >= 0 &&
+		    e->domain_id != domain_id)
+			continue; /* ANQP domain has changed */
+		if (os_memcmp(e->bssid, bss->bssid, ETH_ALEN) == 0)
+			return e;
+		if (shared)
+			continue;
+		/* Same rules as interworking_match_anqp_info() */
+		if ((e->domain_id >= 0 && domain_id >= 0) ?
+		    domain_id != 0 : !is_zero_ether_addr(bss->hessid))
+			shared = e;
+	}
+
+	return shared;
+}
+
+
+/**
+ * anqp_cache_preload - Use cached ANQP information for a new BSS entry
+ * @cache: ANQP cache from anqp_cache_init() or %NULL
+ * @bss: BSS table entry without ANQP information
+ * Returns: 1 if cached information was found or 0 if not
+ */
+int anqp_cache_preload(struct anqp_cache *cache, struct wpa_bss *bss)
+{
+	struct anqp_cache_entry *e;
+
+	if (cache == NULL || bss->anqp)
+		return 0;
+
+	e = anqp_cache_get(cache, bss);
+	if (e == NULL)
+		return 0;
+
+	wpa_printf(MSG_DEBUG, "ANQP cache: Use information of " MACSTR
+		   " for " MACSTR " (age %ld s)",
+		   MAC2STR(e->bssid), MAC2STR(bss->bssid),
+		   (long) (anqp_cache_now() - e->updated));
+	dl_list_del(&e->list);
+	dl_list_add(&cache->entries, &e->list);
+	e->anqp->users++;
+	bss->anqp = e->anqp;
+
+	return 1;
+}
+
+
+/**
+ * anqp_cache_store - Update ANQP cache with fresh information of a BSS
+ * @cache: ANQP cache from anqp_cache_init() or %NULL
+ * @bss: BSS table entry that has received an ANQP response
+ *
+ * The cache shares the ANQP data structure with the BSS entry. ANQP requests
+ * unshare the BSS entry with wpa_bss_anqp_unshare_alloc() before the response
+ * is received, so the cached copy is not modified before the next call.
+ */
+void anqp_cache_store(struct anqp_cache *cache, struct wpa_bss *bss)
+{
+	struct anqp_cache_entry *e;
+
+	if (cache == NULL || bss->anqp == NULL)
+		return;
+
+	dl_list_for_each(e, &cache->entries, struct anqp_cache_entry, list) {
+		if (os_memcmp(e->bssid, bss->bssid, ETH_ALEN) == 0 &&
+		    anqp_cache_same_ssid(e, bss))
+			break;
+	}
+	if (&e->list == &cache->entries) {
+		e = anqp_cache_entry_add(cache);
+		if (e == NULL)
+			return;
+	} else {
+		dl_list_del(&e->list);
+		dl_list_add(&cache->entries, &e->list);
+	}
+
+	os_memcpy(e->bssid, bss->bssid, ETH_ALEN);
+	os_memcpy(e->hessid, bss->hessid, ETH_ALEN);
+	os_memcpy(e->ssid, bss->ssid, bss->ssid_len);
+	e->ssid_len = bss->ssid_len;
+	e->domain_id = wpa_bss_get_anqp_domain_id(bss);
+	e->updated = anqp_cache_now();
+	if (e->anqp != bss->anqp) {
+		wpa_bss_anqp_free(e->anqp);
+		e->anqp = bss->anqp;
+		e->anqp->users++;
+	}
+	cache->changed = 1;
+
+	anqp_cache_evict(cache);
+}
@@ -0,0 +1,23 @@
+/*
+ * wpa_supplicant - Persistent ANQP information cache
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef ANQP_CACHE_H
+#define ANQP_CACHE_H
+
+struct anqp_cache;
+struct wpa_bss;
+
+struct anqp_cache * anqp_cache_init(const char *fname,
+				    unsigned int max_entries,
+				    unsigned int ttl);
+void anqp_cache_deinit(struct anqp_cache *cache);
+int anqp_cache_save(struct anqp_cache *cache);
+int anqp_cache_preload(struct anqp_cache *cache, struct wpa_bss *bss);
+void anqp_cache_store(struct anqp_cache *cache, struct wpa_bss *bss);
+
+#endif /* ANQP_CACHE_H */
@@ -0,0 +1,802 @@
+/*
+ * wpa_supplicant - Credential matching against parsed ANQP information
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * NAI Realm, Roaming Consortium, and 3GPP Cellular Network information is
+ * parsed once per ANQP data instance instead of once per credential and
+ * selection pass. The credentials are compiled into lookup tables, so that
+ * the cost of matching a BSS depends on the number of realms, OIs, and PLMNs
+ * it advertises rather than on the number of configured credentials.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/list.h"
+#include "common/ieee802_11_defs.h"
+#include "eap_common/eap_defs.h"
+#include "wpa_supplicant_i.h"
+#include "config.h"
+#include "bss.h"
+#include "anqp_match.h"
+
+
+static void nai_realm_free(struct nai_realm *realms, u16 count)
+{
+	u16 i;
+
+	if (realms == NULL)
+		return;
+	for (i = 0; i < count; i++) {
+		os_free(realms[i].eap);
+		os_free(realms[i].realm);
+	}
+	os_free(realms);
+}
+
+
+static const u8 * nai_realm_parse_eap(struct nai_realm_eap *e, const u8 *pos,
+				      const u8 *end)
+{
+	u8 elen, auth_count, a;
+	const u8 *e_end;
+
+	if (pos + 3 > end) {
+		wpa_printf(MSG_DEBUG, "No room for EAP Method fixed fields");
+		return NULL;
+	}
+
+	elen = *pos++;
+	if (pos + elen > end || elen < 2) {
+		wpa_printf(MSG_DEBUG, "No room for EAP Method subfield");
+		return NULL;
+	}
+	e_end = pos + elen;
+	e->method = *pos++;
+	auth_count = *pos++;
+	wpa_printf(MSG_DEBUG, "EAP Method: len=%u method=%u auth_count=%u",
+		   elen, e->method, auth_count);
+
+	for (a = 0; a < auth_count; a++) {
+		u8 id, len;
+
+		if (pos + 2 > end || pos + 2 + pos[1] > end) {
+			wpa_printf(MSG_DEBUG, "No room for Authentication "
+				   "Parameter subfield");
+			return NULL;
+		}
+
+		id = *pos++;
+		len = *pos++;
+
+		switch (id) {
+		case NAI_REALM_EAP_AUTH_NON_EAP_INNER_AUTH:
+			if (len < 1)
+				break;
+			e->inner_non_eap = *pos;
+			if (e->method != EAP_TYPE_TTLS)
+				break;
+			switch (*pos) {
+			case NAI_REALM_INNER_NON_EAP_PAP:
+				wpa_printf(MSG_DEBUG, "EAP-TTLS/PAP");
+				break;
+			case NAI_REALM_INNER_NON_EAP_CHAP:
+				wpa_printf(MSG_DEBUG, "EAP-TTLS/CHAP");
+				break;
+			case NAI_REALM_INNER_NON_EAP_MSCHAP:
+				wpa_printf(MSG_DEBUG, "EAP-TTLS/MSCHAP");
+				break;
+			case NAI_REALM_INNER_NON_EAP_MSCHAPV2:
+				wpa_printf(MSG_DEBUG, "EAP-TTLS/MSCHAPV2");
+				break;
+			}
+			break;
+		case NAI_REALM_EAP_AUTH_INNER_AUTH_EAP_METHOD:
+			if (len < 1)
+				break;
+			e->inner_method = *pos;
+			wpa_printf(MSG_DEBUG, "Inner EAP method: %u",
+				   e->inner_method);
+			break;
+		case NAI_REALM_EAP_AUTH_CRED_TYPE:
+			if (len < 1)
+				break;
+			e->cred_type = *pos;
+			wpa_printf(MSG_DEBUG, "Credential Type: %u",
+				   e->cred_type);
+			break;
+		case NAI_REALM_EAP_AUTH_TUNNELED_CRED_TYPE:
+			if (len < 1)
+				break;
+			e->tunneled_cred_type = *pos;
+			wpa_printf(MSG_DEBUG, "Tunneled EAP Method Credential "
+				   "Type: %u", e->tunneled_cred_type);
+			break;
+		default:
+			wpa_printf(MSG_DEBUG, "Unsupported Authentication "
+				   "Parameter: id=%u len=%u", id, len);
+			wpa_hexdump(MSG_DEBUG, "Authentication Parameter "
+				    "Value", pos, len);
+			break;
+		}
+
+		pos += len;
+	}
+
+	return e_end;
+}
+
+
+static const u8 * nai_realm_parse_realm(struct nai_realm *r, const u8 *pos,
+					const u8 *end)
+{
+	u16 len;
+	const u8 *f_end;
+	u8 realm_len, e;
+
+	if (end - pos < 4) {
+		wpa_printf(MSG_DEBUG, "No room for NAI Realm Data "
+			   "fixed fields");
+		return NULL;
+	}
+
+	len = WPA_GET_LE16(pos); /* NAI Realm Data field Length */
+	pos += 2;
+	if (pos + len > end || len < 3) {
+		wpa_printf(MSG_DEBUG, "No room for NAI Realm Data "
+			   "(len=%u; left=%u)",
+			   len, (unsigned int) (end - pos));
+		return NULL;
+	}
+	f_end = pos + len;
+
+	r->encoding = *pos++;
+	realm_len = *pos++;
+	if (pos + realm_len > f_end) {
+		wpa_printf(MSG_DEBUG, "No room for NAI Realm "
+			   "(len=%u; left=%u)",
+			   realm_len, (unsigned int) (f_end - pos));
+		return NULL;
+	}
+	wpa_hexdump_ascii(MSG_DEBUG, "NAI Realm", pos, realm_len);
+	r->realm = dup_binstr(pos, realm_len);
+	if (r->realm == NULL)
+		return NULL;
+	pos += realm_len;
+
+	if (pos + 1 > f_end) {
+		wpa_printf(MSG_DEBUG, "No room for EAP Method Count");
+		return NULL;
+	}
+	r->eap_count = *pos++;
+	wpa_printf(MSG_DEBUG, "EAP Count: %u", r->eap_count);
+	if (pos + r->eap_count * 3 > f_end) {
+		wpa_printf(MSG_DEBUG, "No room for EAP Methods");
+		return NULL;
+	}
+	r->eap = os_calloc(r->eap_count, sizeof(struct nai_realm_eap));
+	if (r->eap == NULL)
+		return NULL;
+
+	for (e = 0; e < r->eap_count; e++) {
+		pos = nai_realm_parse_eap(&r->eap[e], pos, f_end);
+		if (pos == NULL)
+			return NULL;
+	}
+
+	return f_end;
+}
+
+
+static struct nai_realm * nai_realm_parse(struct wpabuf *anqp, u16 *count)
+{
+	struct nai_realm *realm;
+	const u8 *pos, *end;
+	u16 i, num;
+	size_t left;
+
+	if (anqp == NULL)
+		return NULL;
+	left = wpabuf_len(anqp);
+	if (left < 2)
+		return NULL;
+
+	pos = wpabuf_head_u8(anqp);
+	end = pos + left;
+	num = WPA_GET_LE16(pos);
+	wpa_printf(MSG_DEBUG, "NAI Realm Count: %u", num);
+	pos += 2;
+	left -= 2;
+
+	if (num > left / 5) {
+		wpa_printf(MSG_DEBUG, "Invalid NAI Realm Count %u - not "
+			   "enough data (%u octets) for that many realms",
+			   num, (unsigned int) left);
+		return NULL;
+	}
+
+	realm = os_calloc(num, sizeof(struct nai_realm));
+	if (realm == NULL)
+		return NULL;
+
+	for (i = 0; i < num; i++) {
+		pos = nai_realm_parse_realm(&realm[i], pos, end);
+		if (pos == NULL) {
+			nai_realm_free(realm, num);
+			return NULL;
+		}
+	}
+
+	*count = num;
+	return realm;
+}
+
+
+/* Index of the first entry not sorting before key */
+static size_t lower_bound(const void *base, size_t num, size_t size,
+			  const void *key,
+			  int (*cmp)(const void *key, const void *entry))
+{
+	const u8 *entries = base;
+	size_t lo = 0, hi = num, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (cmp(key, entries + mid * size) > 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+
+/* Number of entries from first on that compare equal to key */
+static size_t equal_range(const void *base, size_t num, size_t size,
+			  const void *key,
+			  int (*cmp)(const void *key, const void *entry),
+			  size_t *first)
+{
+	const u8 *entries = base;
+	size_t i;
+
+	i = *first = lower_bound(base, num, size, key, cmp);
+	while (i < num && cmp(key, entries + i * size) == 0)
+		i++;
+
+	return i - *first;
+}
+
+
+static int oi_cmp(const u8 *a, size_t a_len, const u8 *b, size_t b_len)
+{
+	if (a_len != b_len)
+		return a_len < b_len ? -1 : 1;
+	return os_memcmp(a, b, a_len);
+}
+
+
+static int realm_name_key_cmp(const void *key, const void *entry)
+{
+	const struct anqp_realm_name *n = entry;
+
+	return os_strcasecmp(key, n->name);
+}
+
+
+static int realm_name_cmp(const void *a, const void *b)
+{
+	const struct anqp_realm_name *na = a, *nb = b;
+	int res;
+
+	res = os_strcasecmp(na->name, nb->name);
+	if (res)
+		return res;
+	return (int) na->realm - (int) nb->realm;
+}
+
+
+static int anqp_oi_cmp(const void *a, const void *b)
+{
+	const struct anqp_oi *oa = a, *ob = b;
+
+	return oi_cmp(oa->oi, oa->len, ob->oi, ob->len);
+}
+
+
+static int plmn_cmp(const void *a, const void *b)
+{
+	return os_memcmp(a, b, 3);
+}
+
+
+static int anqp_parse_realm_names(struct anqp_parsed *p)
+{
+	size_t len = 0, n = 0;
+	char *pos, *start;
+	u16 i;
+
+	for (i = 0; i < p->realm_count; i++)
+		len += os_strlen(p->realm[i].realm) + 1;
+	if (len == 0)
+		return 0;
+
+	p->name_buf = os_malloc(len);
+	p->name = os_calloc(len, sizeof(struct anqp_realm_name));
+	if (p->name_buf == NULL || p->name == NULL)
+		return -1;
+
+	pos = p->name_buf;
+	for (i = 0; i < p->realm_count; i++) {
+		len = os_strlen(p->realm[i].realm);
+		os_memcpy(pos, p->realm[i].realm, len + 1);
+		start = pos;
+		for (;;) {
+			if (*pos == ';' || *pos == '\0') {
+				int last = *pos == '\0';
+
+				*pos = '\0';
+				if (pos > start) {
+					p->name[n].name = start;
+					p->name[n].realm = i;
+					n++;
+				}
+				start = pos + 1;
+				if (last)
+					break;
+			}
+			pos++;
+		}
+		pos = start;
+	}
+
+	p->num_name = n;
+	qsort(p->name, n, sizeof(struct anqp_realm_name), realm_name_cmp);
+	return 0;
+}
+
+
+static int anqp_parse_oi(struct anqp_parsed *p, const struct wpabuf *anqp)
+{
+	const u8 *pos, *end;
+	u8 len;
+
+	if (anqp == NULL)
+		return 0;
+
+	/* Set of <OI Length, OI> duples (at least two octets each) */
+	p->oi = os_calloc(wpabuf_len(anqp) / 2 + 1, sizeof(struct anqp_oi));
+	if (p->oi == NULL)
+		return -1;
+
+	pos = wpabuf_head(anqp);
+	end = pos + wpabuf_len(anqp);
+	while (pos < end) {
+		len = *pos++;
+		if (pos + len > end)
+			break;
+		if (len > 0 && len <= sizeof(p->oi[0].oi)) {
+			os_memcpy(p->oi[p->num_oi].oi, pos, len);
+			p->oi[p->num_oi].len = len;
+			p->num_oi++;
+		}
+		pos += len;
+	}
+
+	qsort(p->oi, p->num_oi, sizeof(struct anqp_oi), anqp_oi_cmp);
+	return 0;
+}
+
+
+static int anqp_parse_plmn(struct anqp_parsed *p, const struct wpabuf *anqp)
+{
+	const u8 *pos, *end;
+	u8 udhl;
+
+	if (anqp == NULL)
+		return 0;
+	pos = wpabuf_head_u8(anqp);
+	end = pos + wpabuf_len(anqp);
+	if (pos + 2 > end)
+		return 0;
+	if (*pos != 0) {
+		wpa_printf(MSG_DEBUG, "Unsupported GUD version 0x%x", *pos);
+		return 0;
+	}
+	pos++;
+	udhl = *pos++;
+	if (pos + udhl > end) {
+		wpa_printf(MSG_DEBUG, "Invalid UDHL");
+		return 0;
+	}
+	end = pos + udhl;
+
+	p->plmn = os_calloc(udhl / 3 + 1, 3);
+	if (p->plmn == NULL)
+		return -1;
+
+	while (pos + 2 <= end) {
+		u8 iei, len;
+		const u8 *l_end;
+		iei = *pos++;
+		len = *pos++ & 0x7f;
+		if (pos + len > end)
+			break;
+		l_end = pos + len;
+
+		if (iei == 0 && len > 0) {
+			/* PLMN List */
+			u8 num, i;
+			wpa_hexdump(MSG_DEBUG, "Interworking: PLMN List information element",
+				    pos, len);
+			num = *pos++;
+			for (i = 0; i < num; i++) {
+				if (pos + 3 > l_end)
+					break;
+				os_memcpy(p->plmn[p->num_plmn++], pos, 3);
+				pos += 3;
+			}
+		} else {
+			wpa_hexdump(MSG_DEBUG, "Interworking: Unrecognized 3GPP information element",
+				    pos, len);
+		}
+
+		pos = l_end;
+	}
+
+	qsort(p->plmn, p->num_plmn, 3, plmn_cmp);
+	return 0;
+}
+
+
+/**
+ * anqp_parsed_get - Get parsed form of ANQP information
+ * @anqp: ANQP information
+ * Returns: Parsed information or %NULL on failure
+ *
+ * The information is parsed on the first call and stored in @anqp until the
+ * ANQP information is freed or anqp_parsed_flush() is called.
+ */
+struct anqp_parsed * anqp_parsed_get(struct wpa_bss_anqp *anqp)
+{
+	struct anqp_parsed *p;
+
+	if (anqp == NULL)
+		return NULL;
+	if (anqp->parsed)
+		return anqp->parsed;
+
+	p = os_zalloc(sizeof(*p));
+	if (p == NULL)
+		return NULL;
+
+	if (anqp->nai_realm) {
+		p->realm = nai_realm_parse(anqp->nai_realm, &p->realm_count);
+		if (p->realm == NULL)
+			wpa_printf(MSG_DEBUG,
+				   "Interworking: Could not parse NAI Realm list");
+	}
+
+	if (anqp_parse_realm_names(p) < 0 ||
+	    anqp_parse_oi(p, anqp->roaming_consortium) < 0 ||
+	    anqp_parse_plmn(p, anqp->anqp_3gpp) < 0) {
+		anqp_parsed_free(p);
+		return NULL;
+	}
+
+	anqp->parsed = p;
+	return p;
+}
+
+
+/**
+ * anqp_parsed_flush - Drop parsed form of ANQP information
+ * @anqp: ANQP information
+ *
+ * This needs to be called whenever the NAI Realm, Roaming Consortium, or 3GPP
+ * Cellular Network information in @anqp is changed.
+ */
+void anqp_parsed_flush(struct wpa_bss_anqp *anqp)
+{
+	anqp_parsed_free(anqp->parsed);
+	anqp->parsed = NULL;
+}
+
+
+void anqp_parsed_free(struct anqp_parsed *parsed)
+{
+	if (parsed == NULL)
+		return;
+	nai_realm_free(parsed->realm, parsed->realm_count);
+	os_free(parsed->name);
+	os_free(parsed->name_buf);
+	os_free(parsed->oi);
+	os_free(parsed->plmn);
+	os_free(parsed);
+}
+
+
+/**
+ * anqp_parsed_find_realm - Find NAI Realm entries for a realm name
+ * @parsed: Parsed ANQP information
+ * @realm: Realm name (matched case insensitively)
+ * @first: Buffer for the index of the first matching parsed->name entry
+ * Returns: Number of matching parsed->name entries (in NAI Realm order)
+ */
+size_t anqp_parsed_find_realm(const struct anqp_parsed *parsed,
+			      const char *realm, size_t *first)
+{
+	if (parsed == NULL || realm == NULL) {
+		*first = 0;
+		return 0;
+	}
+	return equal_range(parsed->name, parsed->num_name,
+			   sizeof(struct anqp_realm_name), realm,
+			   realm_name_key_cmp, first);
+}
+
+
+int anqp_parsed_has_oi(const struct anqp_parsed *parsed, const u8 *oi,
+		       size_t len)
+{
+	struct anqp_oi key;
+	size_t first;
+
+	if (parsed == NULL || len == 0 || len > sizeof(key.oi))
+		return 0;
+	os_memcpy(key.oi, oi, len);
+	key.len = len;
+	return equal_range(parsed->oi, parsed->num_oi, sizeof(struct anqp_oi),
+			   &key, anqp_oi_cmp, &first) > 0;
+}
+
+
+int anqp_parsed_has_plmn(const struct anqp_parsed *parsed, const u8 *plmn)
+{
+	size_t first;
+
+	if (parsed == NULL)
+		return 0;
+	return equal_range(parsed->plmn, parsed->num_plmn, 3, plmn, plmn_cmp,
+			   &first) > 0;
+}
+
+
+/**
+ * anqp_imsi_plmn - Get PLMN IDs for an IMSI
+ * @imsi: IMSI as a string of digits
+ * @plmn: Buffer for the PLMN ID assuming three digit MNC
+ * @plmn2: Buffer for the PLMN ID assuming two digit MNC
+ * Returns: 0 on success, -1 if the IMSI is too short
+ *
+ * See Annex A of 3GPP TS 24.234 v8.1.0 for description. The network operator
+ * is allowed to include only two digits of the MNC, so allow matches based on
+ * both two and three digit MNC assumptions. Since some SIM/USIM cards may not
+ * expose MNC length conveniently, we may be provided the default MNC length 3
+ * here and as such, checking with MNC length 2 is justifiable even though
+ * 3GPP TS 24.234 does not mention that case. Anyway, MCC/MNC pair where both
+ * 2 and 3 digit MNC is used with otherwise matching values would not be good
+ * idea in general, so this should not result in selecting incorrect networks.
+ */
+int anqp_imsi_plmn(const char *imsi, u8 *plmn, u8 *plmn2)
+{
+	if (os_strlen(imsi) < 6)
+		return -1;
+
+	/* Match with 3 digit MNC */
+	plmn[0] = (imsi[0] - '0') | ((imsi[1] - '0') << 4);
+	plmn[1] = (imsi[2] - '0') | ((imsi[5] - '0') << 4);
+	plmn[2] = (imsi[3] - '0') | ((imsi[4] - '0') << 4);
+	/* Match with 2 digit MNC */
+	plmn2[0] = (imsi[0] - '0') | ((imsi[1] - '0') << 4);
+	plmn2[1] = (imsi[2] - '0') | 0xf0;
+	plmn2[2] = (imsi[3] - '0') | ((imsi[4] - '0') << 4);
+
+	return 0;
+}
+
+
+static int cred_imsi(const struct wpa_cred *cred, char *imsi_buf,
+		     size_t buflen)
+{
+	const char *sep;
+	int mnc_len;
+	size_t msin_len;
+
+	if (cred->imsi == NULL || !cred->imsi[0])
+		return -1;
+
+	sep = os_strchr(cred->imsi, '-');
+	if (sep == NULL ||
+	    (sep - cred->imsi != 5 && sep - cred->imsi != 6))
+		return -1;
+	mnc_len = sep - cred->imsi - 3;
+	os_memcpy(imsi_buf, cred->imsi, 3 + mnc_len);
+	sep++;
+	msin_len = os_strlen(sep);
+	if (3 + mnc_len + msin_len >= buflen - 1)
+		msin_len = buflen - 3 - mnc_len - 1;
+	os_memcpy(&imsi_buf[3 + mnc_len], sep, msin_len);
+	imsi_buf[3 + mnc_len + msin_len] = '\0';
+
+	return mnc_len;
+}
+
+
+static int cred_realm_key_cmp(const void *key, const void *entry)
+{
+	const struct anqp_cred_realm *r = entry;
+
+	return os_strcasecmp(key, r->realm);
+}
+
+
+static int cred_realm_cmp(const void *a, const void *b)
+{
+	const struct anqp_cred_realm *ra = a, *rb = b;
+	int res;
+
+	res = os_strcasecmp(ra->realm, rb->realm);
+	if (res)
+		return res;
+	return (int) ra->cred - (int) rb->cred;
+}
+
+
+static int cred_oi_key_cmp(const void *key, const void *entry)
+{
+	const struct anqp_oi *k = key;
+	const struct anqp_cred_oi *o = entry;
+
+	return oi_cmp(k->oi, k->len, o->oi, o->len);
+}
+
+
+static int cred_oi_cmp(const void *a, const void *b)
+{
+	const struct anqp_cred_oi *oa = a, *ob = b;
+	int res;
+
+	res = oi_cmp(oa->oi, oa->len, ob->oi, ob->len);
+	if (res)
+		return res;
+	return (int) oa->cred - (int) ob->cred;
+}
+
+
+static int cred_plmn_cmp(const void *a, const void *b)
+{
+	const struct anqp_cred_plmn *pa = a, *pb = b;
+	int res;
+
+	res = os_memcmp(pa->plmn, pb->plmn, 3);
+	if (res)
+		return res;
+	return (int) pa->cred - (int) pb->cred;
+}
+
+
+/**
+ * anqp_cred_match_compile - Compile credentials for matching
+ * @creds: List of configured credentials
+ * Returns: Compiled credentials or %NULL on failure
+ *
+ * PLMN IDs are derived from the configured IMSI of each credential. Whether
+ * the credential is usable with it (e.g., has Milenage parameters or uses a
+ * SIM card instead) is left for the caller to check.
+ */
+struct anqp_cred_match * anqp_cred_match_compile(struct wpa_cred *creds)
+{
+	struct anqp_cred_match *m;
+	struct wpa_cred *cred;
+	unsigned int n = 0, i;
+	char imsi[16];
+
+	m = os_zalloc(sizeof(*m));
+	if (m == NULL)
+		return NULL;
+
+	for (cred = creds; cred; cred = cred->next)
+		n++;
+	m->cred = os_calloc(n + 1, sizeof(struct wpa_cred *));
+	m->hit = os_zalloc(n + 1);
+	m->realm = os_calloc(n + 1, sizeof(struct anqp_cred_realm));
+	m->oi = os_calloc(n + 1, sizeof(struct anqp_cred_oi));
+	m->plmn = os_calloc(2 * n + 1, sizeof(struct anqp_cred_plmn));
+	if (m->cred == NULL || m->hit == NULL || m->realm == NULL ||
+	    m->oi == NULL || m->plmn == NULL) {
+		anqp_cred_match_free(m);
+		return NULL;
+	}
+
+	for (cred = creds, i = 0; cred; cred = cred->next, i++) {
+		m->cred[i] = cred;
+
+		if (cred->realm) {
+			m->realm[m->num_realm].realm = cred->realm;
+			m->realm[m->num_realm].cred = i;
+			m->num_realm++;
+		}
+
+		if (cred->roaming_consortium_len) {
+			m->oi[m->num_oi].oi = cred->roaming_consortium;
+			m->oi[m->num_oi].len = cred->roaming_consortium_len;
+			m->oi[m->num_oi].cred = i;
+			m->num_oi++;
+		}
+
+		if (cred_imsi(cred, imsi, sizeof(imsi)) >= 0 &&
+		    anqp_imsi_plmn(imsi, m->plmn[m->num_plmn].plmn,
+				   m->plmn[m->num_plmn + 1].plmn) == 0) {
+			m->plmn[m->num_plmn++].cred = i;
+			m->plmn[m->num_plmn++].cred = i;
+		}
+	}
+	m->num_cred = n;
+
+	qsort(m->realm, m->num_realm, sizeof(struct anqp_cred_realm),
+	      cred_realm_cmp);
+	qsort(m->oi, m->num_oi, sizeof(struct anqp_cred_oi), cred_oi_cmp);
+	qsort(m->plmn, m->num_plmn, sizeof(struct anqp_cred_plmn),
+	      cred_plmn_cmp);
+
+	return m;
+}
+
+
+void anqp_cred_match_free(struct anqp_cred_match *match)
+{
+	if (match == NULL)
+		return;
+	os_free(match->cred);
+	os_free(match->hit);
+	os_free(match->realm);
+	os_free(match->oi);
+	os_free(match->plmn);
+	os_free(match);
+}
+
+
+/**
+ * anqp_cred_match_realm - Find credentials for a realm name
+ * @match: Compiled credentials
+ * @realm: Realm name (matched case insensitively)
+ * @first: Buffer for the index of the first matching match->realm entry
+ * Returns: Number of matching match->realm entries (in configuration order)
+ */
+size_t anqp_cred_match_realm(const struct anqp_cred_match *match,
+			     const char *realm, size_t *first)
+{
+	return equal_range(match->realm, match->num_realm,
+			   sizeof(struct anqp_cred_realm), realm,
+			   cred_realm_key_cmp, first);
+}
+
+
+size_t anqp_cred_match_oi(const struct anqp_cred_match *match,
+			  const u8 *oi, size_t len, size_t *first)
+{
+	struct anqp_oi key;
+
+	*first = 0;
+	if (len == 0 || len > sizeof(key.oi))
+		return 0;
+	os_memcpy(key.oi, oi, len);
+	key.len = len;
+	return equal_range(match->oi, match->num_oi,
+			   sizeof(struct anqp_cred_oi), &key, cred_oi_key_cmp,
+			   first);
+}
+
+
+size_t anqp_cred_match_plmn(const struct anqp_cred_match *match,
+			    const u8 *plmn, size_t *first)
+{
+	return equal_range(match->plmn, match->num_plmn,
+			   sizeof(struct anqp_cred_plmn), plmn, plmn_cmp,
+			   first);
+}
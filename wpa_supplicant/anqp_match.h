@@ -0,0 +1,119 @@
+/*
+ * wpa_supplicant - Credential matching against parsed ANQP information
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef ANQP_MATCH_H
+#define ANQP_MATCH_H
+
+struct wpa_bss_anqp;
+struct wpa_cred;
+
+struct nai_realm_eap {
+	u8 method;
+	u8 inner_method;
+	enum nai_realm_eap_auth_inner_non_eap inner_non_eap;
+	u8 cred_type;
+	u8 tunneled_cred_type;
+};
+
+struct nai_realm {
+	u8 encoding;
+	char *realm;
+	u8 eap_count;
+	struct nai_realm_eap *eap;
+};
+
+struct anqp_realm_name {
+	const char *name;
+	u16 realm; /* index to struct anqp_parsed::realm */
+};
+
+struct anqp_oi {
+	u8 oi[15];
+	u8 len;
+};
+
+/**
+ * struct anqp_parsed - Parsed form of ANQP elements used for matching
+ *
+ * This is built once from the raw ANQP elements of a struct wpa_bss_anqp and
+ * stored with it, so that it is shared by all BSS entries that share the ANQP
+ * information. The lookup tables are sorted for binary search.
+ */
+struct anqp_parsed {
+	/* NAI Realm list */
+	struct nai_realm *realm;
+	u16 realm_count;
+	/* Realm names (a NAI Realm may list several separated by ';') */
+	struct anqp_realm_name *name;
+	size_t num_name;
+	char *name_buf;
+	/* OIs from the ANQP Roaming Consortium list */
+	struct anqp_oi *oi;
+	size_t num_oi;
+	/* PLMN List entries from the 3GPP Cellular Network information */
+	u8 (*plmn)[3];
+	size_t num_plmn;
+};
+
+struct anqp_cred_realm {
+	const char *realm;
+	unsigned int cred; /* index to struct anqp_cred_match::cred */
+};
+
+struct anqp_cred_oi {
+	const u8 *oi;
+	size_t len;
+	unsigned int cred;
+};
+
+struct anqp_cred_plmn {
+	u8 plmn[3];
+	unsigned int cred;
+};
+
+/**
+ * struct anqp_cred_match - Credentials compiled for matching
+ *
+ * Lookup tables from home realm, Roaming Consortium OI, and IMSI based PLMN ID
+ * to the credentials, so that a BSS is matched against all credentials with
+ * one lookup per realm, OI, and PLMN advertised by it. The tables point to
+ * the configured credentials and must be rebuilt whenever those change.
+ */
+struct anqp_cred_match {
+	struct wpa_cred **cred; /* in configuration order */
+	unsigned int num_cred;
+	struct anqp_cred_realm *realm;
+	size_t num_realm;
+	struct anqp_cred_oi *oi;
+	size_t num_oi;
+	struct anqp_cred_plmn *plmn;
+	size_t num_plmn;
+	u8 *hit; /* per credential match flags for the caller */
+};
+
+struct anqp_parsed * anqp_parsed_get(struct wpa_bss_anqp *anqp);
+void anqp_parsed_flush(struct wpa_bss_anqp *anqp);
+void anqp_parsed_free(struct anqp_parsed *parsed);
+size_t anqp_parsed_find_realm(const struct anqp_parsed *parsed,
+			      const char *realm, size_t *first);
+int anqp_parsed_has_oi(const struct anqp_parsed *parsed, const u8 *oi,
+		       size_t len);
+int anqp_parsed_has_plmn(const struct anqp_parsed *parsed, const u8 *plmn);
+
+int anqp_imsi_plmn(const char *imsi, u8 *plmn, u8 *plmn2);
+
+struct anqp_cred_match * anqp_cred_match_compile(struct wpa_cred *creds);
+void anqp_cred_match_free(struct anqp_cred_match *match);
+size_t anqp_cred_match_realm(const struct anqp_cred_match *match,
+			     const char *realm, size_t *first);
+size_t anqp_cred_match_oi(const struct anqp_cred_match *match,
+			  const u8 *oi, size_t len, size_t *first);
+size_t anqp_cred_match_plmn(const struct anqp_cred_match *match,
+			    const u8 *plmn, size_t *first);
+
+#endif /* ANQP_MATCH_H */
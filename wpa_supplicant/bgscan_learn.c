@@ -18,6 +18,7 @@
 #include "driver_i.h"
 #include "scan.h"
 #include "bgscan.h"
+#include "scan_plan.h"
 
 struct bgscan_learn_bss {
 	struct dl_list list;
@@ -283,9 +284,21 @@ static void bgscan_learn_timeout(void *eloop_ctx, void *timeout_ctx)
 	if (data->ssid->scan_freq)
 		params.freqs = data->ssid->scan_freq;
 	else {
+		int *ess_freqs;
+
 		freqs = bgscan_learn_get_freqs(data, &count);
 		wpa_printf(MSG_DEBUG, "bgscan learn: BSSes in this ESS have "
 			   "been seen on %u channels", (unsigned int) count);
+		ess_freqs = scan_plan_ess_freqs(wpa_s->scan_plan,
+						data->ssid->ssid,
+						data->ssid->ssid_len);
+		if (ess_freqs) {
+			/* Include channels from the persistent history */
+			for (i = 0; ess_freqs[i]; i++)
+				int_array_add_unique(&freqs, ess_freqs[i]);
+			os_free(ess_freqs);
+			count = int_array_len(freqs);
+		}
 		freqs = bgscan_learn_get_probe_freq(data, freqs, count);
 
 		msg[0] = '\0';
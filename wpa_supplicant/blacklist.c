@@ -9,9 +9,97 @@
 #include "includes.h"
 
 #include "common.h"
+#include "eloop.h"
 #include "wpa_supplicant_i.h"
 #include "blacklist.h"
 
+static void wpa_blacklist_timeout(void *eloop_ctx, void *timeout_ctx);
+
+
+static unsigned int wpa_blacklist_decay_time(int count)
+{
+	unsigned int t = BLACKLIST_DECAY_TIME;
+
+	while (--count > 0 && t < BLACKLIST_DECAY_MAX)
+		t *= 2;
+
+	return t < BLACKLIST_DECAY_MAX ? t : BLACKLIST_DECAY_MAX;
+}
+
+
+/* Add an entry to the list in order of expiration with manual entries last */
+static void wpa_blacklist_queue(struct wpa_supplicant *wpa_s,
+				struct wpa_blacklist *e)
+{
+	struct wpa_blacklist *pos;
+
+	if (!e->manual) {
+		dl_list_for_each(pos, &wpa_s->blacklist, struct wpa_blacklist,
+				 list) {
+			if (pos->manual ||
+			    os_reltime_before(&e->expire, &pos->expire)) {
+				dl_list_add_tail(&pos->list, &e->list);
+				return;
+			}
+		}
+	}
+
+	dl_list_add_tail(&wpa_s->blacklist, &e->list);
+}
+
+
+/* Schedule the timeout for the first entry to decay */
+static void wpa_blacklist_schedule(struct wpa_supplicant *wpa_s)
+{
+	struct wpa_blacklist *e;
+	struct os_reltime now, left;
+
+	eloop_cancel_timeout(wpa_blacklist_timeout, wpa_s, NULL);
+
+	e = dl_list_first(&wpa_s->blacklist, struct wpa_blacklist, list);
+	if (e == NULL || e->manual)
+		return;
+
+	os_get_reltime(&now);
+	if (os_reltime_before(&now, &e->expire))
+		os_reltime_sub(&e->expire, &now, &left);
+	else
+		left.sec = left.usec = 0;
+	eloop_register_timeout(left.sec, left.usec, wpa_blacklist_timeout,
+			       wpa_s, NULL);
+}
+
+
+static void wpa_blacklist_set_expire(struct wpa_blacklist *e)
+{
+	os_get_reltime(&e->expire);
+	e->expire.sec += wpa_blacklist_decay_time(e->count);
+}
+
+
+static void wpa_blacklist_free(struct wpa_supplicant *wpa_s,
+			       struct wpa_blacklist *e)
+{
+	struct wpa_blacklist **pos;
+
+	pos = &wpa_s->blacklist_hash[BLACKLIST_HASH(e->bssid)];
+	while (*pos && *pos != e)
+		pos = &(*pos)->hnext;
+	if (*pos)
+		*pos = e->hnext;
+	dl_list_del(&e->list);
+	os_free(e);
+}
+
+
+static void wpa_blacklist_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct wpa_supplicant *wpa_s = eloop_ctx;
+
+	wpa_blacklist_update(wpa_s);
+}
+
+
 /**
  * wpa_blacklist_get - Get the blacklist entry for a BSSID
  * @wpa_s: Pointer to wpa_supplicant data
@@ -26,17 +114,36 @@ struct wpa_blacklist * wpa_blacklist_get(struct wpa_supplicant *wpa_s,
 	if (wpa_s == NULL || bssid == NULL)
 		return NULL;
 
-	e = wpa_s->blacklist;
+	e = wpa_s->blacklist_hash[BLACKLIST_HASH(bssid)];
 	while (e) {
 		if (os_memcmp(e->bssid, bssid, ETH_ALEN) == 0)
 			return e;
-		e = e->next;
+		e = e->hnext;
 	}
 
 	return NULL;
 }
 
 
+static struct wpa_blacklist * wpa_blacklist_new(struct wpa_supplicant *wpa_s,
+						const u8 *bssid)
+{
+	struct wpa_blacklist *e;
+
+	e = os_zalloc(sizeof(*e));
+	if (e == NULL)
+		return NULL;
+	os_memcpy(e->bssid, bssid, ETH_ALEN);
+	e->hnext = wpa_s->blacklist_hash[BLACKLIST_HASH(bssid)];
+	wpa_s->blacklist_hash[BLACKLIST_HASH(bssid)] = e;
+	dl_list_init(&e->list);
+	wpa_printf(MSG_DEBUG, "Added BSSID " MACSTR " into blacklist",
+		   MAC2STR(bssid));
+
+	return e;
+}
+
+
 /**
  * wpa_blacklist_add - Add an BSSID to the blacklist
  * @wpa_s: Pointer to wpa_supplicant data
@@ -52,6 +159,10 @@ struct wpa_blacklist * wpa_blacklist_get(struct wpa_supplicant *wpa_s,
  * BSSes before retrying to associate with an BSS that rejected or timed out
  * association. It does not prevent the listed BSS from being used; it only
  * changes the order in which they are tried.
+ *
+ * The count is decremented again after a period without further failures.
+ * The period doubles with each count, so the entry decays away in the reverse
+ * order it was built up.
  */
 int wpa_blacklist_add(struct wpa_supplicant *wpa_s, const u8 *bssid)
 {
@@ -66,18 +177,54 @@ int wpa_blacklist_add(struct wpa_supplicant *wpa_s, const u8 *bssid)
 		wpa_printf(MSG_DEBUG, "BSSID " MACSTR " blacklist count "
 			   "incremented to %d",
 			   MAC2STR(bssid), e->count);
-		return e->count;
+		if (e->manual)
+			return e->count;
+		dl_list_del(&e->list);
+	} else {
+		e = wpa_blacklist_new(wpa_s, bssid);
+		if (e == NULL)
+			return -1;
+		e->count = 1;
 	}
 
-	e = os_zalloc(sizeof(*e));
+	wpa_blacklist_set_expire(e);
+	wpa_blacklist_queue(wpa_s, e);
+	wpa_blacklist_schedule(wpa_s);
+
+	return e->count;
+}
+
+
+/**
+ * wpa_blacklist_add_manual - Add an BSSID to the blacklist until cleared
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @bssid: BSSID to be added to the blacklist
+ * Returns: Current blacklist count on success, -1 on failure
+ *
+ * The count of the entry is set to at least two, causing the BSSID to be
+ * skipped when processing scan results, and it does not decay. This is used
+ * for BSSIDs blacklisted by the user.
+ */
+int wpa_blacklist_add_manual(struct wpa_supplicant *wpa_s, const u8 *bssid)
+{
+	struct wpa_blacklist *e;
+
+	if (wpa_s == NULL || bssid == NULL)
+		return -1;
+
+	e = wpa_blacklist_get(wpa_s, bssid);
+	if (e)
+		dl_list_del(&e->list);
+	else
+		e = wpa_blacklist_new(wpa_s, bssid);
 	if (e == NULL)
 		return -1;
-	os_memcpy(e->bssid, bssid, ETH_ALEN);
-	e->count = 1;
-	e->next = wpa_s->blacklist;
-	wpa_s->blacklist = e;
-	wpa_printf(MSG_DEBUG, "Added BSSID " MACSTR " into blacklist",
-		   MAC2STR(bssid));
+
+	if (e->count < 2)
+		e->count = 2;
+	e->manual = 1;
+	wpa_blacklist_queue(wpa_s, e);
+	wpa_blacklist_schedule(wpa_s);
 
 	return e->count;
 }
@@ -91,28 +238,57 @@ int wpa_blacklist_add(struct wpa_supplicant *wpa_s, const u8 *bssid)
  */
 int wpa_blacklist_del(struct wpa_supplicant *wpa_s, const u8 *bssid)
 {
-	struct wpa_blacklist *e, *prev = NULL;
+	struct wpa_blacklist *e;
 
-	if (wpa_s == NULL || bssid == NULL)
+	e = wpa_blacklist_get(wpa_s, bssid);
+	if (e == NULL)
 		return -1;
 
-	e = wpa_s->blacklist;
-	while (e) {
-		if (os_memcmp(e->bssid, bssid, ETH_ALEN) == 0) {
-			if (prev == NULL) {
-				wpa_s->blacklist = e->next;
-			} else {
-				prev->next = e->next;
-			}
-			wpa_printf(MSG_DEBUG, "Removed BSSID " MACSTR " from "
-				   "blacklist", MAC2STR(bssid));
-			os_free(e);
-			return 0;
+	wpa_printf(MSG_DEBUG, "Removed BSSID " MACSTR " from blacklist",
+		   MAC2STR(bssid));
+	wpa_blacklist_free(wpa_s, e);
+	wpa_blacklist_schedule(wpa_s);
+	return 0;
+}
+
+
+/**
+ * wpa_blacklist_update - Decay blacklist entries that have expired
+ * @wpa_s: Pointer to wpa_supplicant data
+ *
+ * This is called from a timeout when the first entry expires. The count of
+ * each expired entry is decremented and the entry is removed when the count
+ * reaches zero.
+ */
+void wpa_blacklist_update(struct wpa_supplicant *wpa_s)
+{
+	struct wpa_blacklist *e;
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	while ((e = dl_list_first(&wpa_s->blacklist, struct wpa_blacklist,
+				  list)) != NULL) {
+		if (e->manual || os_reltime_before(&now, &e->expire))
+			break;
+
+		dl_list_del(&e->list);
+		e->count--;
+		if (e->count <= 0) {
+			wpa_printf(MSG_DEBUG, "Removed BSSID " MACSTR
+				   " from blacklist (expired)",
+				   MAC2STR(e->bssid));
+			dl_list_init(&e->list);
+			wpa_blacklist_free(wpa_s, e);
+			continue;
 		}
-		prev = e;
-		e = e->next;
+
+		wpa_printf(MSG_DEBUG, "BSSID " MACSTR " blacklist count "
+			   "decremented to %d", MAC2STR(e->bssid), e->count);
+		wpa_blacklist_set_expire(e);
+		wpa_blacklist_queue(wpa_s, e);
 	}
-	return -1;
+
+	wpa_blacklist_schedule(wpa_s);
 }
 
 
@@ -125,17 +301,60 @@ void wpa_blacklist_clear(struct wpa_supplicant *wpa_s)
 	struct wpa_blacklist *e, *prev;
 	int max_count = 0;
 
-	e = wpa_s->blacklist;
-	wpa_s->blacklist = NULL;
-	while (e) {
+	eloop_cancel_timeout(wpa_blacklist_timeout, wpa_s, NULL);
+
+	dl_list_for_each_safe(e, prev, &wpa_s->blacklist, struct wpa_blacklist,
+			      list) {
 		if (e->count > max_count)
 			max_count = e->count;
-		prev = e;
-		e = e->next;
 		wpa_printf(MSG_DEBUG, "Removed BSSID " MACSTR " from "
-			   "blacklist (clear)", MAC2STR(prev->bssid));
-		os_free(prev);
+			   "blacklist (clear)", MAC2STR(e->bssid));
+		os_free(e);
 	}
+	dl_list_init(&wpa_s->blacklist);
+	os_memset(wpa_s->blacklist_hash, 0, sizeof(wpa_s->blacklist_hash));
 
 	wpa_s->extra_blacklist_count += max_count;
 }
+
+
+/**
+ * wpa_blacklist_info - Write blacklist state into a text buffer
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @buf: Buffer for the text
+ * @buflen: Length of the buffer
+ * Returns: Number of bytes written to the buffer
+ *
+ * Each entry is listed on its own line in the order the entries will decay
+ * with its count and the number of seconds until the count is decremented.
+ */
+int wpa_blacklist_info(struct wpa_supplicant *wpa_s, char *buf, size_t buflen)
+{
+	struct wpa_blacklist *e;
+	struct os_reltime now, left;
+	char *pos = buf, *end = buf + buflen;
+	int ret;
+
+	os_get_reltime(&now);
+	dl_list_for_each(e, &wpa_s->blacklist, struct wpa_blacklist, list) {
+		if (e->manual) {
+			ret = os_snprintf(pos, end - pos,
+					  MACSTR " count=%d manual\n",
+					  MAC2STR(e->bssid), e->count);
+		} else {
+			if (os_reltime_before(&now, &e->expire))
+				os_reltime_sub(&e->expire, &now, &left);
+			else
+				left.sec = 0;
+			ret = os_snprintf(pos, end - pos,
+					  MACSTR " count=%d decay=%d\n",
+					  MAC2STR(e->bssid), e->count,
+					  (int) left.sec);
+		}
+		if (os_snprintf_error(end - pos, ret))
+			break;
+		pos += ret;
+	}
+
+	return pos - buf;
+}
@@ -9,16 +9,31 @@
 #ifndef BLACKLIST_H
 #define BLACKLIST_H
 
+/*
+ * The count of a blacklist entry is decremented when it has not been
+ * incremented for BLACKLIST_DECAY_TIME seconds. The time is doubled for each
+ * count above one, so that repeatedly failing BSSes stay blacklisted longer.
+ */
+#define BLACKLIST_DECAY_TIME 30
+#define BLACKLIST_DECAY_MAX 1800
+
 struct wpa_blacklist {
-	struct wpa_blacklist *next;
+	struct wpa_blacklist *hnext; /* next entry in hash table list */
+	struct dl_list list; /* struct wpa_supplicant::blacklist */
 	u8 bssid[ETH_ALEN];
 	int count;
+	/* time of the next count decrement; unused for manual entries */
+	struct os_reltime expire;
+	unsigned int manual:1;
 };
 
 struct wpa_blacklist * wpa_blacklist_get(struct wpa_supplicant *wpa_s,
 					 const u8 *bssid);
 int wpa_blacklist_add(struct wpa_supplicant *wpa_s, const u8 *bssid);
+int wpa_blacklist_add_manual(struct wpa_supplicant *wpa_s, const u8 *bssid);
 int wpa_blacklist_del(struct wpa_supplicant *wpa_s, const u8 *bssid);
+void wpa_blacklist_update(struct wpa_supplicant *wpa_s);
 void wpa_blacklist_clear(struct wpa_supplicant *wpa_s);
+int wpa_blacklist_info(struct wpa_supplicant *wpa_s, char *buf, size_t buflen);
 
 #endif /* BLACKLIST_H */
@@ -17,6 +17,8 @@
 #include "notify.h"
 #include "scan.h"
 #include "bss.h"
+#include "anqp_cache.h"
+#include "anqp_match.h"
 
 
 /**
@@ -144,7 +146,7 @@ int wpa_bss_anqp_unshare_alloc(struct wpa_bss *bss)
  * wpa_bss_anqp_free - Free an ANQP data structure
  * @anqp: ANQP data structure from wpa_bss_anqp_alloc() or wpa_bss_anqp_clone()
  */
-static void wpa_bss_anqp_free(struct wpa_bss_anqp *anqp)
+void wpa_bss_anqp_free(struct wpa_bss_anqp *anqp)
 {
 	if (anqp == NULL)
 		return;
@@ -164,6 +166,7 @@ static void wpa_bss_anqp_free(struct wpa_bss_anqp *anqp)
 	wpabuf_free(anqp->nai_realm);
 	wpabuf_free(anqp->anqp_3gpp);
 	wpabuf_free(anqp->domain_name);
+	anqp_parsed_free(anqp->parsed);
 #endif /* CONFIG_INTERWORKING */
 #ifdef CONFIG_HS20
 	wpabuf_free(anqp->hs20_capability_list);
@@ -222,6 +225,7 @@ static void wpa_bss_remove(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 	wpa_bss_update_pending_connect(wpa_s, bss, NULL);
 	dl_list_del(&bss->list);
 	dl_list_del(&bss->list_id);
+	dl_list_del(&bss->list_hash);
 	wpa_s->num_bss--;
 	wpa_dbg(wpa_s, MSG_DEBUG, "BSS: Remove id %u BSSID " MACSTR
 		" SSID '%s' due to %s", bss->id, MAC2STR(bss->bssid),
@@ -246,7 +250,8 @@ struct wpa_bss * wpa_bss_get(struct wpa_supplicant *wpa_s, const u8 *bssid,
 	struct wpa_bss *bss;
 	if (!wpa_supplicant_filter_bssid_match(wpa_s, bssid))
 		return NULL;
-	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+	dl_list_for_each(bss, &wpa_s->bss_hash[BSS_HASH(bssid)], struct wpa_bss,
+			 list_hash) {
 		if (os_memcmp(bss->bssid, bssid, ETH_ALEN) == 0 &&
 		    bss->ssid_len == ssid_len &&
 		    os_memcmp(bss->ssid, ssid, ssid_len) == 0)
@@ -385,6 +390,10 @@ static struct wpa_bss * wpa_bss_add(struct wpa_supplicant *wpa_s,
 	bss->beacon_ie_len = res->beacon_ie_len;
 	os_memcpy(bss + 1, res + 1, res->ie_len + res->beacon_ie_len);
 	wpa_bss_set_hessid(bss);
+#ifdef CONFIG_INTERWORKING
+	if (anqp_cache_preload(wpa_s->anqp_cache, bss))
+		bss->flags |= WPA_BSS_ANQP_CACHED;
+#endif /* CONFIG_INTERWORKING */
 
 	if (wpa_s->num_bss + 1 > wpa_s->conf->bss_max_count &&
 	    wpa_bss_remove_oldest(wpa_s) != 0) {
@@ -396,6 +405,7 @@ static struct wpa_bss * wpa_bss_add(struct wpa_supplicant *wpa_s,
 
 	dl_list_add_tail(&wpa_s->bss, &bss->list);
 	dl_list_add_tail(&wpa_s->bss_id, &bss->list_id);
+	dl_list_add(&wpa_s->bss_hash[BSS_HASH(bss->bssid)], &bss->list_hash);
 	wpa_s->num_bss++;
 	wpa_dbg(wpa_s, MSG_DEBUG, "BSS: Add new id %u BSSID " MACSTR
 		" SSID '%s'",
@@ -547,6 +557,16 @@ wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 	wpa_bss_copy_res(bss, res, fetch_time);
 	/* Move the entry to the end of the list */
 	dl_list_del(&bss->list);
+	if (!(changes & WPA_BSS_IES_CHANGED_FLAG) &&
+	    bss->beacon_ie_len == res->beacon_ie_len) {
+		/*
+		 * The IEs are unchanged, so there is no need to copy or parse
+		 * them again. Only the Beacon IEs (e.g., TIM) may differ.
+		 */
+		os_memcpy((u8 *) (bss + 1) + bss->ie_len,
+			  (const u8 *) (res + 1) + res->ie_len,
+			  res->beacon_ie_len);
+	} else
 #ifdef CONFIG_P2P
 	if (wpa_bss_get_vendor_ie(bss, P2P_IE_VENDOR_TYPE) &&
 	    !wpa_scan_get_vendor_ie(res, P2P_IE_VENDOR_TYPE)) {
@@ -571,7 +591,9 @@ wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 	} else {
 		struct wpa_bss *nbss;
 		struct dl_list *prev = bss->list_id.prev;
+		struct dl_list *prev_hash = bss->list_hash.prev;
 		dl_list_del(&bss->list_id);
+		dl_list_del(&bss->list_hash);
 		nbss = os_realloc(bss, sizeof(*bss) + res->ie_len +
 				  res->beacon_ie_len);
 		if (nbss) {
@@ -592,6 +614,7 @@ wpa_bss_update(struct wpa_supplicant *wpa_s, struct wpa_bss *bss,
 			bss->beacon_ie_len = res->beacon_ie_len;
 		}
 		dl_list_add(prev, &bss->list_id);
+		dl_list_add(prev_hash, &bss->list_hash);
 	}
 	if (changes & WPA_BSS_IES_CHANGED_FLAG)
 		wpa_bss_set_hessid(bss);
@@ -694,16 +717,15 @@ void wpa_bss_update_scan_res(struct wpa_supplicant *wpa_s,
 	if (bss == NULL)
 		bss = wpa_bss_add(wpa_s, ssid + 2, ssid[1], res, fetch_time);
 	else {
+		/*
+		 * An entry that was already updated in this round is already
+		 * in the last_scan_res list.
+		 */
+		int seen = bss->last_update_idx == wpa_s->bss_update_idx;
+
 		bss = wpa_bss_update(wpa_s, bss, res, fetch_time);
-		if (wpa_s->last_scan_res) {
-			unsigned int i;
-			for (i = 0; i < wpa_s->last_scan_res_used; i++) {
-				if (bss == wpa_s->last_scan_res[i]) {
-					/* Already in the list */
-					return;
-				}
-			}
-		}
+		if (seen)
+			return;
 	}
 
 	if (bss == NULL)
@@ -856,8 +878,12 @@ static void wpa_bss_timeout(void *eloop_ctx, void *timeout_ctx)
  */
 int wpa_bss_init(struct wpa_supplicant *wpa_s)
 {
+	unsigned int i;
+
 	dl_list_init(&wpa_s->bss);
 	dl_list_init(&wpa_s->bss_id);
+	for (i = 0; i < BSS_HASH_SIZE; i++)
+		dl_list_init(&wpa_s->bss_hash[i]);
 	eloop_register_timeout(WPA_BSS_EXPIRATION_PERIOD, 0,
 			       wpa_bss_timeout, wpa_s, NULL);
 	return 0;
@@ -1248,3 +1274,28 @@ int wpa_bss_get_bit_rates(const struct wpa_bss *bss, u8 **rates)
 	*rates = r;
 	return len;
 }
+
+
+/**
+ * wpa_bss_get_anqp_domain_id - Get ANQP Domain ID of a BSS
+ * @bss: BSS table entry
+ * Returns: ANQP Domain ID from the Hotspot 2.0 indication element or -1 if not
+ * advertised
+ */
+int wpa_bss_get_anqp_domain_id(const struct wpa_bss *bss)
+{
+	const u8 *ie, *pos, *end;
+	u8 conf;
+
+	ie = wpa_bss_get_vendor_ie(bss, HS20_IE_VENDOR_TYPE);
+	if (ie == NULL || ie[1] < 5)
+		return -1;
+	end = ie + 2 + ie[1];
+	pos = ie + 6;
+	conf = *pos++;
+	if (conf & HS20_PPS_MO_ID_PRESENT)
+		pos += 2;
+	if (!(conf & HS20_ANQP_DOMAIN_ID_PRESENT) || end - pos < 2)
+		return -1;
+	return WPA_GET_LE16(pos);
+}
@@ -18,6 +18,8 @@ struct wpa_scan_res;
 #define WPA_BSS_AUTHENTICATED		BIT(4)
 #define WPA_BSS_ASSOCIATED		BIT(5)
 #define WPA_BSS_ANQP_FETCH_TRIED	BIT(6)
+#define WPA_BSS_ANQP_FETCH_PENDING	BIT(7)
+#define WPA_BSS_ANQP_CACHED		BIT(8)
 
 /**
  * struct wpa_bss_anqp - ANQP data for a BSS entry (struct wpa_bss)
@@ -34,6 +36,8 @@ struct wpa_bss_anqp {
 	struct wpabuf *nai_realm;
 	struct wpabuf *anqp_3gpp;
 	struct wpabuf *domain_name;
+	/** Parsed form of the above for credential matching (anqp_match.c) */
+	struct anqp_parsed *parsed;
 #endif /* CONFIG_INTERWORKING */
 #ifdef CONFIG_HS20
 	struct wpabuf *hs20_capability_list;
@@ -56,6 +60,8 @@ struct wpa_bss {
 	struct dl_list list;
 	/** List entry for struct wpa_supplicant::bss_id */
 	struct dl_list list_id;
+	/** List entry for struct wpa_supplicant::bss_hash */
+	struct dl_list list_hash;
 	/** Unique identifier for this BSS entry */
 	unsigned int id;
 	/** Number of counts without seeing this BSS */
@@ -133,8 +139,10 @@ struct wpabuf * wpa_bss_get_vendor_ie_multi_beacon(const struct wpa_bss *bss,
 						   u32 vendor_type);
 int wpa_bss_get_max_rate(const struct wpa_bss *bss);
 int wpa_bss_get_bit_rates(const struct wpa_bss *bss, u8 **rates);
+int wpa_bss_get_anqp_domain_id(const struct wpa_bss *bss);
 struct wpa_bss_anqp * wpa_bss_anqp_alloc(void);
 int wpa_bss_anqp_unshare_alloc(struct wpa_bss *bss);
+void wpa_bss_anqp_free(struct wpa_bss_anqp *anqp);
 
 static inline int bss_is_dmg(const struct wpa_bss *bss)
 {
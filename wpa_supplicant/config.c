@@ -2268,6 +2268,8 @@ void wpa_config_free(struct wpa_config *config)
 	os_free(config->sae_groups);
 	wpabuf_free(config->ap_vendor_elements);
 	os_free(config->osu_dir);
+	os_free(config->anqp_cache_file);
+	os_free(config->scan_plan_file);
 	os_free(config->bgscan);
 	os_free(config->wowlan_triggers);
 	os_free(config->fst_group_id);
@@ -3529,6 +3531,9 @@ struct wpa_config * wpa_config_alloc_empty(const char *ctrl_interface,
 	config->max_num_sta = DEFAULT_MAX_NUM_STA;
 	config->access_network_type = DEFAULT_ACCESS_NETWORK_TYPE;
 	config->scan_cur_freq = DEFAULT_SCAN_CUR_FREQ;
+	config->scan_plan_full_interval = DEFAULT_SCAN_PLAN_FULL_INTERVAL;
+	config->anqp_cache_size = DEFAULT_ANQP_CACHE_SIZE;
+	config->anqp_cache_ttl = DEFAULT_ANQP_CACHE_TTL;
 	config->wmm_ac_params[0] = ac_be;
 	config->wmm_ac_params[1] = ac_bk;
 	config->wmm_ac_params[2] = ac_vi;
@@ -4224,9 +4229,16 @@ static const struct global_parse_data global_fields[] = {
 	{ INT_RANGE(ignore_old_scan_res, 0, 1), 0 },
 	{ FUNC(freq_list), 0 },
 	{ INT(scan_cur_freq), 0 },
+	{ INT_RANGE(scan_plan, 0, 1), 0 },
+	{ STR(scan_plan_file), 0 },
+	{ INT_RANGE(scan_plan_full_interval, 1, 86400), 0 },
+	{ INT_RANGE(roam_cand, 0, 1), 0 },
 	{ INT(sched_scan_interval), 0 },
 	{ INT(tdls_external_control), 0},
 	{ STR(osu_dir), 0 },
+	{ STR(anqp_cache_file), 0 },
+	{ INT_RANGE(anqp_cache_size, 1, 10000), 0 },
+	{ INT(anqp_cache_ttl), 0 },
 	{ STR(wowlan_triggers), 0 },
 	{ INT(p2p_search_delay), 0},
 	{ INT(mac_addr), 0 },
@@ -34,6 +34,9 @@
 #define DEFAULT_KEY_MGMT_OFFLOAD 1
 #define DEFAULT_CERT_IN_CB 1
 #define DEFAULT_P2P_GO_CTWINDOW 0
+#define DEFAULT_ANQP_CACHE_SIZE 256
+#define DEFAULT_ANQP_CACHE_TTL (7 * 24 * 60 * 60)
+#define DEFAULT_SCAN_PLAN_FULL_INTERVAL 300
 
 #include "config_ssid.h"
 #include "wps/wps.h"
@@ -802,6 +805,38 @@ struct wpa_config {
 	 */
 	int scan_cur_freq;
 
+	/**
+	 * scan_plan - Whether to limit scans to channels seen in the past
+	 *
+	 * If true, scans for connection and PNO are limited to the channels
+	 * on which the SSIDs of the enabled networks have been seen before.
+	 * All channels are scanned if any of the networks has no channel
+	 * history or if the previous limited scan did not find a network to
+	 * connect to.
+	 */
+	int scan_plan;
+
+	/**
+	 * scan_plan_file - File for storing the channel history
+	 */
+	char *scan_plan_file;
+
+	/**
+	 * scan_plan_full_interval - Maximum time in seconds between full scans
+	 */
+	unsigned int scan_plan_full_interval;
+
+	/**
+	 * roam_cand - Whether to maintain a roaming candidate cache
+	 *
+	 * If true, the BSSes of the current ESS are collected from scan
+	 * results, neighbor reports and BSS Transition Management Requests
+	 * and ranked by signal level, signal trend, and AP preference. When
+	 * the signal of the current AP drops, only the channel of the best
+	 * candidate is scanned for roaming.
+	 */
+	int roam_cand;
+
 	/**
 	 * changed_parameters - Bitmap of changed parameters since last update
 	 */
@@ -1072,6 +1107,25 @@ struct wpa_config {
 	 */
 	char *osu_dir;
 
+	/**
+	 * anqp_cache_file - File for storing ANQP information over restarts
+	 *
+	 * If set, ANQP information received from APs is stored in this file
+	 * and used for BSSes in the same ANQP domain when they are seen again
+	 * until a new ANQP response has been received.
+	 */
+	char *anqp_cache_file;
+
+	/**
+	 * anqp_cache_size - Maximum number of BSSes in the ANQP cache
+	 */
+	unsigned int anqp_cache_size;
+
+	/**
+	 * anqp_cache_ttl - Maximum age of cached ANQP information in seconds
+	 */
+	unsigned int anqp_cache_ttl;
+
 	/**
 	 * wowlan_triggers - Wake-on-WLAN triggers
 	 *
@@ -1233,6 +1233,15 @@ static void wpa_config_write_global(FILE *f, struct wpa_config *config)
 	}
 	if (config->scan_cur_freq != DEFAULT_SCAN_CUR_FREQ)
 		fprintf(f, "scan_cur_freq=%d\n", config->scan_cur_freq);
+	if (config->scan_plan)
+		fprintf(f, "scan_plan=%d\n", config->scan_plan);
+	if (config->scan_plan_file)
+		fprintf(f, "scan_plan_file=%s\n", config->scan_plan_file);
+	if (config->scan_plan_full_interval != DEFAULT_SCAN_PLAN_FULL_INTERVAL)
+		fprintf(f, "scan_plan_full_interval=%u\n",
+			config->scan_plan_full_interval);
+	if (config->roam_cand)
+		fprintf(f, "roam_cand=%d\n", config->roam_cand);
 
 	if (config->sched_scan_interval)
 		fprintf(f, "sched_scan_interval=%u\n",
@@ -1249,6 +1258,13 @@ static void wpa_config_write_global(FILE *f, struct wpa_config *config)
 		fprintf(f, "wowlan_triggers=%s\n",
 			config->wowlan_triggers);
 
+	if (config->anqp_cache_file)
+		fprintf(f, "anqp_cache_file=%s\n", config->anqp_cache_file);
+	if (config->anqp_cache_size != DEFAULT_ANQP_CACHE_SIZE)
+		fprintf(f, "anqp_cache_size=%u\n", config->anqp_cache_size);
+	if (config->anqp_cache_ttl != DEFAULT_ANQP_CACHE_TTL)
+		fprintf(f, "anqp_cache_ttl=%u\n", config->anqp_cache_ttl);
+
 	if (config->bgscan)
 		fprintf(f, "bgscan=\"%s\"\n", config->bgscan);
 
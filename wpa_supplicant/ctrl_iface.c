@@ -51,6 +51,8 @@
 #include "offchannel.h"
 #include "drivers/driver.h"
 #include "mesh.h"
+#include "scan_plan.h"
+#include "roam_cand.h"
 
 static int wpa_supplicant_global_iface_list(struct wpa_global *global,
 					    char *buf, int len);
@@ -2092,18 +2094,17 @@ static int wpa_supplicant_ctrl_iface_blacklist(struct wpa_supplicant *wpa_s,
 	char *pos, *end;
 	int ret;
 
-	/* cmd: "BLACKLIST [<BSSID>]" */
+	/* cmd: "BLACKLIST [<BSSID>|clear|info]" */
 	if (*cmd == '\0') {
 		pos = buf;
 		end = buf + buflen;
-		e = wpa_s->blacklist;
-		while (e) {
+		dl_list_for_each(e, &wpa_s->blacklist, struct wpa_blacklist,
+				 list) {
 			ret = os_snprintf(pos, end - pos, MACSTR "\n",
 					  MAC2STR(e->bssid));
 			if (os_snprintf_error(end - pos, ret))
 				return pos - buf;
 			pos += ret;
-			e = e->next;
 		}
 		return pos - buf;
 	}
@@ -2115,6 +2116,9 @@ static int wpa_supplicant_ctrl_iface_blacklist(struct wpa_supplicant *wpa_s,
 		return 3;
 	}
 
+	if (os_strcmp(cmd, "info") == 0)
+		return wpa_blacklist_info(wpa_s, buf, buflen);
+
 	wpa_printf(MSG_DEBUG, "CTRL_IFACE: BLACKLIST bssid='%s'", cmd);
 	if (hwaddr_aton(cmd, bssid)) {
 		wpa_printf(MSG_DEBUG, "CTRL_IFACE: invalid BSSID '%s'", cmd);
@@ -2122,13 +2126,10 @@ static int wpa_supplicant_ctrl_iface_blacklist(struct wpa_supplicant *wpa_s,
 	}
 
 	/*
-	 * Add the BSSID twice, so its count will be 2, causing it to be
-	 * skipped when processing scan results.
+	 * The count of a manually added BSSID will be at least 2, causing it
+	 * to be skipped when processing scan results until cleared.
 	 */
-	ret = wpa_blacklist_add(wpa_s, bssid);
-	if (ret < 0)
-		return -1;
-	ret = wpa_blacklist_add(wpa_s, bssid);
+	ret = wpa_blacklist_add_manual(wpa_s, bssid);
 	if (ret < 0)
 		return -1;
 	os_memcpy(buf, "OK\n", 3);
@@ -3168,6 +3169,9 @@ static int wpa_supplicant_ctrl_iface_add_cred(struct wpa_supplicant *wpa_s,
 	cred = wpa_config_add_cred(wpa_s->conf);
 	if (cred == NULL)
 		return -1;
+#ifdef CONFIG_INTERWORKING
+	interworking_cred_changed(wpa_s);
+#endif /* CONFIG_INTERWORKING */
 
 	wpa_msg(wpa_s, MSG_INFO, CRED_ADDED "%d", cred->id);
 
@@ -3195,6 +3199,9 @@ static int wpas_ctrl_remove_cred(struct wpa_supplicant *wpa_s,
 		wpa_printf(MSG_DEBUG, "CTRL_IFACE: Could not find cred");
 		return -1;
 	}
+#ifdef CONFIG_INTERWORKING
+	interworking_cred_changed(wpa_s);
+#endif /* CONFIG_INTERWORKING */
 
 	wpa_msg(wpa_s, MSG_INFO, CRED_REMOVED "%d", id);
 
@@ -3317,6 +3324,9 @@ static int wpa_supplicant_ctrl_iface_set_cred(struct wpa_supplicant *wpa_s,
 			   "variable '%s'", name);
 		return -1;
 	}
+#ifdef CONFIG_INTERWORKING
+	interworking_cred_changed(wpa_s);
+#endif /* CONFIG_INTERWORKING */
 
 	wpa_msg(wpa_s, MSG_INFO, CRED_MODIFIED "%d %s", cred->id, name);
 
@@ -6919,6 +6929,8 @@ static int wpas_ctrl_radio_work(struct wpa_supplicant *wpa_s, char *cmd,
 {
 	if (os_strcmp(cmd, "show") == 0)
 		return wpas_ctrl_radio_work_show(wpa_s, buf, buflen);
+	if (os_strcmp(cmd, "stats") == 0)
+		return radio_work_stats(wpa_s->radio, buf, buflen);
 	if (os_strncmp(cmd, "add ", 4) == 0)
 		return wpas_ctrl_radio_work_add(wpa_s, cmd + 4, buf, buflen);
 	if (os_strncmp(cmd, "done ", 5) == 0)
@@ -8424,6 +8436,12 @@ char * wpa_supplicant_ctrl_iface_process(struct wpa_supplicant *wpa_s,
 	} else if (os_strcmp(buf, "SCAN_RESULTS") == 0) {
 		reply_len = wpa_supplicant_ctrl_iface_scan_results(
 			wpa_s, reply, reply_size);
+	} else if (os_strcmp(buf, "SCAN_PLAN") == 0) {
+		reply_len = scan_plan_status(wpa_s->scan_plan, reply,
+					     reply_size);
+	} else if (os_strcmp(buf, "ROAM_CAND") == 0) {
+		reply_len = roam_cand_status(wpa_s->roam_cand, reply,
+					     reply_size);
 	} else if (os_strncmp(buf, "SELECT_NETWORK ", 15) == 0) {
 		if (wpa_supplicant_ctrl_iface_select_network(wpa_s, buf + 15))
 			reply_len = -1;
@@ -46,6 +46,8 @@
 #include "mesh.h"
 #include "mesh_mpm.h"
 #include "wmm_ac.h"
+#include "scan_plan.h"
+#include "roam_cand.h"
 
 
 #ifndef CONFIG_NO_SCAN_PROCESSING
@@ -1132,7 +1134,8 @@ struct wpa_bss * wpa_supplicant_pick_network(struct wpa_supplicant *wpa_s,
 				break;
 		}
 
-		if (selected == NULL && wpa_s->blacklist &&
+		if (selected == NULL &&
+		    !dl_list_empty(&wpa_s->blacklist) &&
 		    !wpa_s->countermeasures) {
 			wpa_dbg(wpa_s, MSG_DEBUG, "No APs found - clear "
 				"blacklist and try again");
@@ -1443,6 +1446,9 @@ static int _wpa_supplicant_event_scan_results(struct wpa_supplicant *wpa_s,
 	}
 #endif /* CONFIG_NO_RANDOM_POOL */
 
+	scan_plan_update(wpa_s->scan_plan, scan_res);
+	roam_cand_scan_results(wpa_s->roam_cand, scan_res);
+
 	if (own_request && wpa_s->scan_res_handler &&
 	    (wpa_s->own_scan_running || !wpa_s->radio->external_scan_running)) {
 		void (*scan_res_handler)(struct wpa_supplicant *wpa_s,
@@ -1478,6 +1484,18 @@ static int _wpa_supplicant_event_scan_results(struct wpa_supplicant *wpa_s,
 
 	wpas_notify_scan_done(wpa_s, 1);
 
+	if (wpa_s->scan_work && wpa_s->scan_work->preempted) {
+		/*
+		 * The scan was aborted to release the radio for a higher
+		 * priority radio work. Keep the partial results in the BSS
+		 * table, but do not use them as a full scan.
+		 */
+		wpa_dbg(wpa_s, MSG_DEBUG,
+			"Scan was preempted - do not use partial results for network selection");
+		ret = -1;
+		goto scan_work_done;
+	}
+
 	if (!wpa_s->own_scan_running && wpa_s->radio->external_scan_running) {
 		wpa_dbg(wpa_s, MSG_DEBUG, "Do not use results from externally requested scan operation for network selection");
 		wpa_scan_results_free(scan_res);
@@ -1559,6 +1577,11 @@ static int wpas_select_network_from_last_scan(struct wpa_supplicant *wpa_s,
 			return 0;
 		}
 
+		if (wpa_s->wpa_state >= WPA_ASSOCIATED &&
+		    wpa_s->current_ssid == ssid)
+			roam_cand_roam_started(wpa_s->roam_cand, "scan",
+					       &wpa_s->scan_trigger_time);
+
 		if (wpa_supplicant_connect(wpa_s, selected, ssid) < 0) {
 			wpa_dbg(wpa_s, MSG_DEBUG, "Connect failed");
 			return -1;
@@ -1626,6 +1649,7 @@ static int wpas_select_network_from_last_scan(struct wpa_supplicant *wpa_s,
 					"networks found");
 				wpa_s->network_select = 1;
 				wpa_s->auto_network_select = 1;
+				os_get_reltime(&wpa_s->network_select_start);
 				interworking_start_fetch_anqp(wpa_s);
 				return 1;
 			}
@@ -3756,6 +3780,9 @@ void wpa_supplicant_event(void *ctx, enum wpa_event_type event,
 			data->signal_change.current_signal,
 			data->signal_change.current_noise,
 			data->signal_change.current_txrate);
+		roam_cand_signal_change(wpa_s->roam_cand,
+					data->signal_change.above_threshold,
+					data->signal_change.current_signal);
 		break;
 	case EVENT_INTERFACE_ENABLED:
 		wpa_dbg(wpa_s, MSG_DEBUG, "Interface was enabled");
@@ -25,6 +25,9 @@
 /** GAS query timeout in seconds */
 #define GAS_QUERY_TIMEOUT_PERIOD 2
 
+/** Maximum number of queries waiting for a response on one channel */
+#define GAS_QUERY_MAX_PARALLEL 4
+
 
 /**
  * struct gas_query_pending - Pending GAS query
@@ -36,7 +39,7 @@ struct gas_query_pending {
 	u8 dialog_token;
 	u8 next_frag_id;
 	unsigned int wait_comeback:1;
-	unsigned int offchannel_tx_started:1;
+	unsigned int started:1;
 	int freq;
 	u16 status_code;
 	struct wpabuf *req;
@@ -48,6 +51,23 @@ struct gas_query_pending {
 		   const struct wpabuf *adv_proto,
 		   const struct wpabuf *resp, u16 status_code);
 	void *ctx;
+	struct gas_query_dwell *dwell;
+};
+
+/**
+ * struct gas_query_dwell - Radio work shared by the queries on one channel
+ *
+ * All queries to the same channel that were requested before the radio work
+ * got started are sent during that work. The frames are transmitted one at a
+ * time, but up to GAS_QUERY_MAX_PARALLEL queries may be waiting for a response
+ * at the same time.
+ */
+struct gas_query_dwell {
+	struct dl_list list;
+	struct gas_query *gas;
+	int freq;
+	struct wpa_radio_work *work;
+	unsigned int offchannel_tx_started:1;
 };
 
 /**
@@ -56,13 +76,15 @@ struct gas_query_pending {
 struct gas_query {
 	struct wpa_supplicant *wpa_s;
 	struct dl_list pending; /* struct gas_query_pending */
-	struct gas_query_pending *current;
-	struct wpa_radio_work *work;
+	struct dl_list dwells; /* struct gas_query_dwell */
+	struct gas_query_pending *current; /* query waiting for TX status */
+	struct gas_query_dwell *dwell; /* started radio work */
 };
 
 
 static void gas_query_tx_comeback_timeout(void *eloop_data, void *user_ctx);
 static void gas_query_timeout(void *eloop_data, void *user_ctx);
+static void gas_query_tx_next(struct gas_query *gas);
 
 
 static int ms_from_time(struct os_reltime *last)
@@ -90,6 +112,7 @@ struct gas_query * gas_query_init(struct wpa_supplicant *wpa_s)
 
 	gas->wpa_s = wpa_s;
 	dl_list_init(&gas->pending);
+	dl_list_init(&gas->dwells);
 
 	return gas;
 }
@@ -120,15 +143,11 @@ static const char * gas_result_txt(enum gas_query_result result)
 
 static void gas_query_free(struct gas_query_pending *query, int del_list)
 {
-	struct gas_query *gas = query->gas;
-
 	if (del_list)
 		dl_list_del(&query->list);
 
-	if (gas->work && gas->work->ctx == query) {
-		radio_work_done(gas->work);
-		gas->work = NULL;
-	}
+	if (query->gas->current == query)
+		query->gas->current = NULL;
 
 	wpabuf_free(query->req);
 	wpabuf_free(query->adv_proto);
@@ -147,14 +166,29 @@ static void gas_query_done(struct gas_query *gas,
 		query->status_code, gas_result_txt(result));
 	if (gas->current == query)
 		gas->current = NULL;
-	if (query->offchannel_tx_started)
-		offchannel_send_action_done(gas->wpa_s);
 	eloop_cancel_timeout(gas_query_tx_comeback_timeout, gas, query);
 	eloop_cancel_timeout(gas_query_timeout, gas, query);
 	dl_list_del(&query->list);
 	query->cb(query->ctx, query->addr, query->dialog_token, result,
 		  query->adv_proto, query->resp, query->status_code);
 	gas_query_free(query, 0);
+	if (result != GAS_QUERY_DELETED_AT_DEINIT)
+		gas_query_tx_next(gas);
+}
+
+
+static void gas_query_dwell_done(struct gas_query *gas,
+				 struct gas_query_dwell *dwell)
+{
+	wpa_printf(MSG_DEBUG, "GAS: No more queries on freq %d", dwell->freq);
+	if (dwell->offchannel_tx_started)
+		offchannel_send_action_done(gas->wpa_s);
+	if (gas->dwell == dwell)
+		gas->dwell = NULL;
+	dl_list_del(&dwell->list);
+	if (dwell->work)
+		radio_work_done(dwell->work);
+	os_free(dwell);
 }
 
 
@@ -165,6 +199,7 @@ static void gas_query_done(struct gas_query *gas,
 void gas_query_deinit(struct gas_query *gas)
 {
 	struct gas_query_pending *query, *next;
+	struct gas_query_dwell *dwell, *dwell_next;
 
 	if (gas == NULL)
 		return;
@@ -173,6 +208,10 @@ void gas_query_deinit(struct gas_query *gas)
 			      struct gas_query_pending, list)
 		gas_query_done(gas, query, GAS_QUERY_DELETED_AT_DEINIT);
 
+	dl_list_for_each_safe(dwell, dwell_next, &gas->dwells,
+			      struct gas_query_dwell, list)
+		gas_query_dwell_done(gas, dwell);
+
 	os_free(gas);
 }
 
@@ -240,6 +279,10 @@ static void gas_query_tx_status(struct wpa_supplicant *wpa_s,
 		eloop_cancel_timeout(gas_query_timeout, gas, query);
 		eloop_register_timeout(0, 0, gas_query_timeout, gas, query);
 	}
+
+	/* Continue with the next query while still on the channel */
+	gas->current = NULL;
+	gas_query_tx_next(gas);
 }
 
 
@@ -275,8 +318,10 @@ static int gas_query_tx(struct gas_query *gas, struct gas_query_pending *query,
 				     gas->wpa_s->own_addr, query->addr,
 				     wpabuf_head(req), wpabuf_len(req),
 				     wait_time, gas_query_tx_status, 0);
-	if (res == 0)
-		query->offchannel_tx_started = 1;
+	if (res == 0) {
+		query->dwell->offchannel_tx_started = 1;
+		gas->current = query;
+	}
 	return res;
 }
 
@@ -286,6 +331,14 @@ static void gas_query_tx_comeback_req(struct gas_query *gas,
 {
 	struct wpabuf *req;
 
+	if (gas->current && gas->current != query) {
+		/* Wait for the TX status of the previous frame */
+		eloop_cancel_timeout(gas_query_tx_comeback_timeout, gas, query);
+		eloop_register_timeout(0, 10000, gas_query_tx_comeback_timeout,
+				       gas, query);
+		return;
+	}
+
 	req = gas_build_comeback_req(query->dialog_token);
 	if (req == NULL) {
 		gas_query_done(gas, query, GAS_QUERY_INTERNAL_ERROR);
@@ -594,46 +647,127 @@ static int gas_query_dialog_token_available(struct gas_query *gas,
 }
 
 
+static void gas_query_tx_next(struct gas_query *gas)
+{
+	struct gas_query_dwell *dwell = gas->dwell;
+	struct gas_query_pending *query, *next = NULL;
+	unsigned int active = 0;
+
+	if (dwell == NULL || gas->current)
+		return;
+
+	/* New queries are added to the head of the list */
+	dl_list_for_each(query, &gas->pending, struct gas_query_pending, list) {
+		if (query->dwell != dwell)
+			continue;
+		if (query->started)
+			active++;
+		else
+			next = query;
+	}
+
+	if (next == NULL) {
+		if (active == 0)
+			gas_query_dwell_done(gas, dwell);
+		return;
+	}
+	if (active >= GAS_QUERY_MAX_PARALLEL)
+		return;
+
+	next->started = 1;
+	if (gas_query_tx(gas, next, next->req) < 0) {
+		wpa_printf(MSG_DEBUG, "GAS: Failed to send Action frame to "
+			   MACSTR, MAC2STR(next->addr));
+		gas_query_done(gas, next, GAS_QUERY_INTERNAL_ERROR);
+		return;
+	}
+
+	wpa_printf(MSG_DEBUG, "GAS: Starting query timeout for dialog token %u",
+		   next->dialog_token);
+	eloop_register_timeout(GAS_QUERY_TIMEOUT_PERIOD, 0,
+			       gas_query_timeout, gas, next);
+}
+
+
+static void gas_query_free_dwell_queries(struct gas_query *gas,
+					 struct gas_query_dwell *dwell)
+{
+	struct gas_query_pending *query, *next;
+
+	dl_list_for_each_safe(query, next, &gas->pending,
+			      struct gas_query_pending, list) {
+		if (query->dwell == dwell)
+			gas_query_free(query, 1);
+	}
+}
+
+
 static void gas_query_start_cb(struct wpa_radio_work *work, int deinit)
 {
-	struct gas_query_pending *query = work->ctx;
-	struct gas_query *gas = query->gas;
+	struct gas_query_dwell *dwell = work->ctx;
+	struct gas_query *gas = dwell->gas;
 	struct wpa_supplicant *wpa_s = gas->wpa_s;
+	struct gas_query_pending *query, *next;
 
 	if (deinit) {
+		dl_list_del(&dwell->list);
 		if (work->started) {
-			gas->work = NULL;
-			gas_query_done(gas, query, GAS_QUERY_DELETED_AT_DEINIT);
-			return;
+			if (gas->dwell == dwell)
+				gas->dwell = NULL;
+			dl_list_for_each_safe(query, next, &gas->pending,
+					      struct gas_query_pending, list) {
+				if (query->dwell == dwell)
+					gas_query_done(
+						gas, query,
+						GAS_QUERY_DELETED_AT_DEINIT);
+			}
+			if (dwell->offchannel_tx_started)
+				offchannel_send_action_done(wpa_s);
+		} else {
+			gas_query_free_dwell_queries(gas, dwell);
 		}
-
-		gas_query_free(query, 1);
+		os_free(dwell);
 		return;
 	}
 
+	dwell->work = work;
+
 	if (wpas_update_random_addr_disassoc(wpa_s) < 0) {
 		wpa_msg(wpa_s, MSG_INFO,
 			"Failed to assign random MAC address for GAS");
-		gas_query_free(query, 1);
-		radio_work_done(work);
+		gas_query_free_dwell_queries(gas, dwell);
+		gas_query_dwell_done(gas, dwell);
 		return;
 	}
 
-	gas->work = work;
+	gas->dwell = dwell;
+	gas_query_tx_next(gas);
+}
 
-	if (gas_query_tx(gas, query, query->req) < 0) {
-		wpa_printf(MSG_DEBUG, "GAS: Failed to send Action frame to "
-			   MACSTR, MAC2STR(query->addr));
-		gas_query_free(query, 1);
-		return;
+
+static struct gas_query_dwell * gas_query_get_dwell(struct gas_query *gas,
+						    int freq)
+{
+	struct gas_query_dwell *dwell;
+
+	dl_list_for_each(dwell, &gas->dwells, struct gas_query_dwell, list) {
+		if (dwell->freq == freq && dwell->work == NULL)
+			return dwell;
 	}
-	gas->current = query;
 
-	wpa_printf(MSG_DEBUG, "GAS: Starting query timeout for dialog token %u",
-		   query->dialog_token);
-	eloop_register_timeout(GAS_QUERY_TIMEOUT_PERIOD, 0,
-			       gas_query_timeout, gas, query);
+	dwell = os_zalloc(sizeof(*dwell));
+	if (dwell == NULL)
+		return NULL;
+	dwell->gas = gas;
+	dwell->freq = freq;
+	if (radio_add_work(gas->wpa_s, freq, "gas-query", 0, gas_query_start_cb,
+			   dwell) < 0) {
+		os_free(dwell);
+		return NULL;
+	}
+	dl_list_add_tail(&gas->dwells, &dwell->list);
 
+	return dwell;
 }
 
 
@@ -683,6 +817,11 @@ int gas_query_req(struct gas_query *gas, const u8 *dst, int freq,
 	query->freq = freq;
 	query->cb = cb;
 	query->ctx = ctx;
+	query->dwell = gas_query_get_dwell(gas, freq);
+	if (query->dwell == NULL) {
+		os_free(query);
+		return -1;
+	}
 	query->req = req;
 	dl_list_add(&gas->pending, &query->list);
 
@@ -692,12 +831,6 @@ int gas_query_req(struct gas_query *gas, const u8 *dst, int freq,
 		" dialog_token=%u freq=%d",
 		MAC2STR(query->addr), query->dialog_token, query->freq);
 
-	if (radio_add_work(gas->wpa_s, freq, "gas-query", 0, gas_query_start_cb,
-			   query) < 0) {
-		gas_query_free(query, 1);
-		return -1;
-	}
-
 	return dialog_token;
 }
 
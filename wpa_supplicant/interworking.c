@@ -30,6 +30,8 @@
 #include "driver_i.h"
 #include "gas_query.h"
 #include "hs20_supplicant.h"
+#include "anqp_cache.h"
+#include "anqp_match.h"
 #include "interworking.h"
 
 
@@ -45,6 +47,9 @@
 #endif
 #endif
 
+/* Maximum number of ANQP queries to one channel that are sent at a time */
+#define INTERWORKING_ANQP_BATCH 8
+
 static void interworking_next_anqp_fetch(struct wpa_supplicant *wpa_s);
 static struct wpa_cred * interworking_credentials_available_realm(
 	struct wpa_supplicant *wpa_s, struct wpa_bss *bss, int ignore_bw,
@@ -127,12 +132,20 @@ static void interworking_anqp_resp_cb(void *ctx, const u8 *dst,
 				      u16 status_code)
 {
 	struct wpa_supplicant *wpa_s = ctx;
+	struct wpa_bss *bss;
 
 	wpa_printf(MSG_DEBUG, "ANQP: Response callback dst=" MACSTR
 		   " dialog_token=%u result=%d status_code=%u",
 		   MAC2STR(dst), dialog_token, result, status_code);
 	anqp_resp_cb(wpa_s, dst, dialog_token, result, adv_proto, resp,
 		     status_code);
+	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+		if ((bss->flags & WPA_BSS_ANQP_FETCH_PENDING) &&
+		    os_memcmp(bss->bssid, dst, ETH_ALEN) == 0) {
+			bss->flags &= ~WPA_BSS_ANQP_FETCH_PENDING;
+			break;
+		}
+	}
 	interworking_next_anqp_fetch(wpa_s);
 }
 
@@ -254,6 +267,8 @@ static int interworking_anqp_send_req(struct wpa_supplicant *wpa_s,
 	wpa_msg(wpa_s, MSG_DEBUG, "Interworking: ANQP Query Request to " MACSTR,
 		MAC2STR(bss->bssid));
 	wpa_s->interworking_gas_bss = bss;
+	/* The response must not modify ANQP data from the ANQP cache */
+	wpa_bss_anqp_unshare_alloc(bss);
 
 	info_ids[num_info_ids++] = ANQP_CAPABILITY_LIST;
 	if (all) {
@@ -318,273 +333,14 @@ static int interworking_anqp_send_req(struct wpa_supplicant *wpa_s,
 		ret = -1;
 		eloop_register_timeout(0, 0, interworking_continue_anqp, wpa_s,
 				       NULL);
-	} else
+	} else {
 		wpa_msg(wpa_s, MSG_DEBUG,
 			"ANQP: Query started with dialog token %u", res);
-
-	return ret;
-}
-
-
-struct nai_realm_eap {
-	u8 method;
-	u8 inner_method;
-	enum nai_realm_eap_auth_inner_non_eap inner_non_eap;
-	u8 cred_type;
-	u8 tunneled_cred_type;
-};
-
-struct nai_realm {
-	u8 encoding;
-	char *realm;
-	u8 eap_count;
-	struct nai_realm_eap *eap;
-};
-
-
-static void nai_realm_free(struct nai_realm *realms, u16 count)
-{
-	u16 i;
-
-	if (realms == NULL)
-		return;
-	for (i = 0; i < count; i++) {
-		os_free(realms[i].eap);
-		os_free(realms[i].realm);
-	}
-	os_free(realms);
-}
-
-
-static const u8 * nai_realm_parse_eap(struct nai_realm_eap *e, const u8 *pos,
-				      const u8 *end)
-{
-	u8 elen, auth_count, a;
-	const u8 *e_end;
-
-	if (pos + 3 > end) {
-		wpa_printf(MSG_DEBUG, "No room for EAP Method fixed fields");
-		return NULL;
-	}
-
-	elen = *pos++;
-	if (pos + elen > end || elen < 2) {
-		wpa_printf(MSG_DEBUG, "No room for EAP Method subfield");
-		return NULL;
-	}
-	e_end = pos + elen;
-	e->method = *pos++;
-	auth_count = *pos++;
-	wpa_printf(MSG_DEBUG, "EAP Method: len=%u method=%u auth_count=%u",
-		   elen, e->method, auth_count);
-
-	for (a = 0; a < auth_count; a++) {
-		u8 id, len;
-
-		if (pos + 2 > end || pos + 2 + pos[1] > end) {
-			wpa_printf(MSG_DEBUG, "No room for Authentication "
-				   "Parameter subfield");
-			return NULL;
-		}
-
-		id = *pos++;
-		len = *pos++;
-
-		switch (id) {
-		case NAI_REALM_EAP_AUTH_NON_EAP_INNER_AUTH:
-			if (len < 1)
-				break;
-			e->inner_non_eap = *pos;
-			if (e->method != EAP_TYPE_TTLS)
-				break;
-			switch (*pos) {
-			case NAI_REALM_INNER_NON_EAP_PAP:
-				wpa_printf(MSG_DEBUG, "EAP-TTLS/PAP");
-				break;
-			case NAI_REALM_INNER_NON_EAP_CHAP:
-				wpa_printf(MSG_DEBUG, "EAP-TTLS/CHAP");
-				break;
-			case NAI_REALM_INNER_NON_EAP_MSCHAP:
-				wpa_printf(MSG_DEBUG, "EAP-TTLS/MSCHAP");
-				break;
-			case NAI_REALM_INNER_NON_EAP_MSCHAPV2:
-				wpa_printf(MSG_DEBUG, "EAP-TTLS/MSCHAPV2");
-				break;
-			}
-			break;
-		case NAI_REALM_EAP_AUTH_INNER_AUTH_EAP_METHOD:
-			if (len < 1)
-				break;
-			e->inner_method = *pos;
-			wpa_printf(MSG_DEBUG, "Inner EAP method: %u",
-				   e->inner_method);
-			break;
-		case NAI_REALM_EAP_AUTH_CRED_TYPE:
-			if (len < 1)
-				break;
-			e->cred_type = *pos;
-			wpa_printf(MSG_DEBUG, "Credential Type: %u",
-				   e->cred_type);
-			break;
-		case NAI_REALM_EAP_AUTH_TUNNELED_CRED_TYPE:
-			if (len < 1)
-				break;
-			e->tunneled_cred_type = *pos;
-			wpa_printf(MSG_DEBUG, "Tunneled EAP Method Credential "
-				   "Type: %u", e->tunneled_cred_type);
-			break;
-		default:
-			wpa_printf(MSG_DEBUG, "Unsupported Authentication "
-				   "Parameter: id=%u len=%u", id, len);
-			wpa_hexdump(MSG_DEBUG, "Authentication Parameter "
-				    "Value", pos, len);
-			break;
-		}
-
-		pos += len;
-	}
-
-	return e_end;
-}
-
-
-static const u8 * nai_realm_parse_realm(struct nai_realm *r, const u8 *pos,
-					const u8 *end)
-{
-	u16 len;
-	const u8 *f_end;
-	u8 realm_len, e;
-
-	if (end - pos < 4) {
-		wpa_printf(MSG_DEBUG, "No room for NAI Realm Data "
-			   "fixed fields");
-		return NULL;
-	}
-
-	len = WPA_GET_LE16(pos); /* NAI Realm Data field Length */
-	pos += 2;
-	if (pos + len > end || len < 3) {
-		wpa_printf(MSG_DEBUG, "No room for NAI Realm Data "
-			   "(len=%u; left=%u)",
-			   len, (unsigned int) (end - pos));
-		return NULL;
-	}
-	f_end = pos + len;
-
-	r->encoding = *pos++;
-	realm_len = *pos++;
-	if (pos + realm_len > f_end) {
-		wpa_printf(MSG_DEBUG, "No room for NAI Realm "
-			   "(len=%u; left=%u)",
-			   realm_len, (unsigned int) (f_end - pos));
-		return NULL;
-	}
-	wpa_hexdump_ascii(MSG_DEBUG, "NAI Realm", pos, realm_len);
-	r->realm = dup_binstr(pos, realm_len);
-	if (r->realm == NULL)
-		return NULL;
-	pos += realm_len;
-
-	if (pos + 1 > f_end) {
-		wpa_printf(MSG_DEBUG, "No room for EAP Method Count");
-		return NULL;
-	}
-	r->eap_count = *pos++;
-	wpa_printf(MSG_DEBUG, "EAP Count: %u", r->eap_count);
-	if (pos + r->eap_count * 3 > f_end) {
-		wpa_printf(MSG_DEBUG, "No room for EAP Methods");
-		return NULL;
-	}
-	r->eap = os_calloc(r->eap_count, sizeof(struct nai_realm_eap));
-	if (r->eap == NULL)
-		return NULL;
-
-	for (e = 0; e < r->eap_count; e++) {
-		pos = nai_realm_parse_eap(&r->eap[e], pos, f_end);
-		if (pos == NULL)
-			return NULL;
-	}
-
-	return f_end;
-}
-
-
-static struct nai_realm * nai_realm_parse(struct wpabuf *anqp, u16 *count)
-{
-	struct nai_realm *realm;
-	const u8 *pos, *end;
-	u16 i, num;
-	size_t left;
-
-	if (anqp == NULL)
-		return NULL;
-	left = wpabuf_len(anqp);
-	if (left < 2)
-		return NULL;
-
-	pos = wpabuf_head_u8(anqp);
-	end = pos + left;
-	num = WPA_GET_LE16(pos);
-	wpa_printf(MSG_DEBUG, "NAI Realm Count: %u", num);
-	pos += 2;
-	left -= 2;
-
-	if (num > left / 5) {
-		wpa_printf(MSG_DEBUG, "Invalid NAI Realm Count %u - not "
-			   "enough data (%u octets) for that many realms",
-			   num, (unsigned int) left);
-		return NULL;
+		bss->flags |= WPA_BSS_ANQP_FETCH_PENDING;
+		wpa_s->anqp_fetch_queries++;
 	}
 
-	realm = os_calloc(num, sizeof(struct nai_realm));
-	if (realm == NULL)
-		return NULL;
-
-	for (i = 0; i < num; i++) {
-		pos = nai_realm_parse_realm(&realm[i], pos, end);
-		if (pos == NULL) {
-			nai_realm_free(realm, num);
-			return NULL;
-		}
-	}
-
-	*count = num;
-	return realm;
-}
-
-
-static int nai_realm_match(struct nai_realm *realm, const char *home_realm)
-{
-	char *tmp, *pos, *end;
-	int match = 0;
-
-	if (realm->realm == NULL || home_realm == NULL)
-		return 0;
-
-	if (os_strchr(realm->realm, ';') == NULL)
-		return os_strcasecmp(realm->realm, home_realm) == 0;
-
-	tmp = os_strdup(realm->realm);
-	if (tmp == NULL)
-		return 0;
-
-	pos = tmp;
-	while (*pos) {
-		end = os_strchr(pos, ';');
-		if (end)
-			*end = '\0';
-		if (os_strcasecmp(pos, home_realm) == 0) {
-			match = 1;
-			break;
-		}
-		if (end == NULL)
-			break;
-		pos = end + 1;
-	}
-
-	os_free(tmp);
-
-	return match;
+	return ret;
 }
 
 
@@ -716,87 +472,23 @@ static struct nai_realm_eap * nai_realm_find_eap(struct wpa_supplicant *wpa_s,
 
 #ifdef INTERWORKING_3GPP
 
-static int plmn_id_match(struct wpabuf *anqp, const char *imsi, int mnc_len)
+#if defined(PCSC_FUNCS) || defined(CONFIG_EAP_PROXY)
+static int plmn_id_match(const struct anqp_parsed *parsed, const char *imsi,
+			 int mnc_len)
 {
 	u8 plmn[3], plmn2[3];
-	const u8 *pos, *end;
-	u8 udhl;
 
-	/*
-	 * See Annex A of 3GPP TS 24.234 v8.1.0 for description. The network
-	 * operator is allowed to include only two digits of the MNC, so allow
-	 * matches based on both two and three digit MNC assumptions. Since some
-	 * SIM/USIM cards may not expose MNC length conveniently, we may be
-	 * provided the default MNC length 3 here and as such, checking with MNC
-	 * length 2 is justifiable even though 3GPP TS 24.234 does not mention
-	 * that case. Anyway, MCC/MNC pair where both 2 and 3 digit MNC is used
-	 * with otherwise matching values would not be good idea in general, so
-	 * this should not result in selecting incorrect networks.
-	 */
-	/* Match with 3 digit MNC */
-	plmn[0] = (imsi[0] - '0') | ((imsi[1] - '0') << 4);
-	plmn[1] = (imsi[2] - '0') | ((imsi[5] - '0') << 4);
-	plmn[2] = (imsi[3] - '0') | ((imsi[4] - '0') << 4);
-	/* Match with 2 digit MNC */
-	plmn2[0] = (imsi[0] - '0') | ((imsi[1] - '0') << 4);
-	plmn2[1] = (imsi[2] - '0') | 0xf0;
-	plmn2[2] = (imsi[3] - '0') | ((imsi[4] - '0') << 4);
-
-	if (anqp == NULL)
-		return 0;
-	pos = wpabuf_head_u8(anqp);
-	end = pos + wpabuf_len(anqp);
-	if (pos + 2 > end)
-		return 0;
-	if (*pos != 0) {
-		wpa_printf(MSG_DEBUG, "Unsupported GUD version 0x%x", *pos);
+	if (parsed == NULL || anqp_imsi_plmn(imsi, plmn, plmn2) < 0)
 		return 0;
-	}
-	pos++;
-	udhl = *pos++;
-	if (pos + udhl > end) {
-		wpa_printf(MSG_DEBUG, "Invalid UDHL");
-		return 0;
-	}
-	end = pos + udhl;
 
 	wpa_printf(MSG_DEBUG, "Interworking: Matching against MCC/MNC alternatives: %02x:%02x:%02x or %02x:%02x:%02x (IMSI %s, MNC length %d)",
 		   plmn[0], plmn[1], plmn[2], plmn2[0], plmn2[1], plmn2[2],
 		   imsi, mnc_len);
 
-	while (pos + 2 <= end) {
-		u8 iei, len;
-		const u8 *l_end;
-		iei = *pos++;
-		len = *pos++ & 0x7f;
-		if (pos + len > end)
-			break;
-		l_end = pos + len;
-
-		if (iei == 0 && len > 0) {
-			/* PLMN List */
-			u8 num, i;
-			wpa_hexdump(MSG_DEBUG, "Interworking: PLMN List information element",
-				    pos, len);
-			num = *pos++;
-			for (i = 0; i < num; i++) {
-				if (pos + 3 > l_end)
-					break;
-				if (os_memcmp(pos, plmn, 3) == 0 ||
-				    os_memcmp(pos, plmn2, 3) == 0)
-					return 1; /* Found matching PLMN */
-				pos += 3;
-			}
-		} else {
-			wpa_hexdump(MSG_DEBUG, "Interworking: Unrecognized 3GPP information element",
-				    pos, len);
-		}
-
-		pos = l_end;
-	}
-
-	return 0;
+	return anqp_parsed_has_plmn(parsed, plmn) ||
+		anqp_parsed_has_plmn(parsed, plmn2);
 }
+#endif /* PCSC_FUNCS || CONFIG_EAP_PROXY */
 
 
 static int build_root_nai(char *nai, size_t nai_len, const char *imsi,
@@ -1064,11 +756,13 @@ fail:
 }
 
 
-static int roaming_consortium_element_match(const u8 *ie, const u8 *rc_id,
-					    size_t rc_len)
+static unsigned int roaming_consortium_element_ois(const u8 *ie,
+						   const u8 *oi[3],
+						   size_t oi_len[3])
 {
 	const u8 *pos, *end;
 	u8 lens;
+	unsigned int num = 0;
 
 	if (ie == NULL)
 		return 0;
@@ -1090,53 +784,42 @@ static int roaming_consortium_element_match(const u8 *ie, const u8 *rc_id,
 	if (pos + (lens & 0x0f) + (lens >> 4) > end)
 		return 0;
 
-	if ((lens & 0x0f) == rc_len && os_memcmp(pos, rc_id, rc_len) == 0)
-		return 1;
+	if (lens & 0x0f) {
+		oi[num] = pos;
+		oi_len[num++] = lens & 0x0f;
+	}
 	pos += lens & 0x0f;
 
-	if ((lens >> 4) == rc_len && os_memcmp(pos, rc_id, rc_len) == 0)
-		return 1;
+	if (lens >> 4) {
+		oi[num] = pos;
+		oi_len[num++] = lens >> 4;
+	}
 	pos += lens >> 4;
 
-	if (pos < end && (size_t) (end - pos) == rc_len &&
-	    os_memcmp(pos, rc_id, rc_len) == 0)
-		return 1;
+	if (pos < end) {
+		oi[num] = pos;
+		oi_len[num++] = end - pos;
+	}
 
-	return 0;
+	return num;
 }
 
 
-static int roaming_consortium_anqp_match(const struct wpabuf *anqp,
-					 const u8 *rc_id, size_t rc_len)
+static int roaming_consortium_match(const u8 *ie,
+				    const struct anqp_parsed *parsed,
+				    const u8 *rc_id, size_t rc_len)
 {
-	const u8 *pos, *end;
-	u8 len;
-
-	if (anqp == NULL)
-		return 0;
-
-	pos = wpabuf_head(anqp);
-	end = pos + wpabuf_len(anqp);
+	const u8 *oi[3];
+	size_t oi_len[3];
+	unsigned int i, num;
 
-	/* Set of <OI Length, OI> duples */
-	while (pos < end) {
-		len = *pos++;
-		if (pos + len > end)
-			break;
-		if (len == rc_len && os_memcmp(pos, rc_id, rc_len) == 0)
+	num = roaming_consortium_element_ois(ie, oi, oi_len);
+	for (i = 0; i < num; i++) {
+		if (oi_len[i] == rc_len && os_memcmp(oi[i], rc_id, rc_len) == 0)
 			return 1;
-		pos += len;
 	}
 
-	return 0;
-}
-
-
-static int roaming_consortium_match(const u8 *ie, const struct wpabuf *anqp,
-				    const u8 *rc_id, size_t rc_len)
-{
-	return roaming_consortium_element_match(ie, rc_id, rc_len) ||
-		roaming_consortium_anqp_match(anqp, rc_id, rc_len);
+	return anqp_parsed_has_oi(parsed, rc_id, rc_len);
 }
 
 
@@ -1153,9 +836,7 @@ static int cred_no_required_oi_match(struct wpa_cred *cred, struct wpa_bss *bss)
 	    (bss->anqp == NULL || bss->anqp->roaming_consortium == NULL))
 		return 1;
 
-	return !roaming_consortium_match(ie,
-					 bss->anqp ?
-					 bss->anqp->roaming_consortium : NULL,
+	return !roaming_consortium_match(ie, anqp_parsed_get(bss->anqp),
 					 cred->required_roaming_consortium,
 					 cred->required_roaming_consortium_len);
 }
@@ -1330,34 +1011,50 @@ static int cred_conn_capab_missing(struct wpa_supplicant *wpa_s,
 }
 
 
-static struct wpa_cred * interworking_credentials_available_roaming_consortium(
-	struct wpa_supplicant *wpa_s, struct wpa_bss *bss, int ignore_bw,
-	int *excluded)
+/**
+ * interworking_cred_match - Get credentials compiled for matching
+ * @wpa_s: Pointer to wpa_supplicant data
+ * Returns: Compiled credentials or %NULL on failure
+ *
+ * The credentials are compiled on first use after interworking_cred_changed()
+ * has been called.
+ */
+static struct anqp_cred_match *
+interworking_cred_match(struct wpa_supplicant *wpa_s)
 {
-	struct wpa_cred *cred, *selected = NULL;
-	const u8 *ie;
-	int is_excluded = 0;
+	if (wpa_s->cred_match == NULL && wpa_s->conf->cred)
+		wpa_s->cred_match = anqp_cred_match_compile(wpa_s->conf->cred);
+	return wpa_s->cred_match;
+}
 
-	ie = wpa_bss_get_ie(bss, WLAN_EID_ROAMING_CONSORTIUM);
 
-	if (ie == NULL &&
-	    (bss->anqp == NULL || bss->anqp->roaming_consortium == NULL))
-		return NULL;
+/**
+ * interworking_cred_changed - Notify Interworking of credential changes
+ * @wpa_s: Pointer to wpa_supplicant data
+ *
+ * This needs to be called whenever credentials are added, removed, or
+ * modified, or the configuration is reloaded.
+ */
+void interworking_cred_changed(struct wpa_supplicant *wpa_s)
+{
+	anqp_cred_match_free(wpa_s->cred_match);
+	wpa_s->cred_match = NULL;
+}
 
-	if (wpa_s->conf->cred == NULL)
-		return NULL;
 
-	for (cred = wpa_s->conf->cred; cred; cred = cred->next) {
-		if (cred->roaming_consortium_len == 0)
-			continue;
+/* Select the best credential among the ones with match->hit[] set */
+static struct wpa_cred * interworking_select_cred_hit(
+	struct wpa_supplicant *wpa_s, struct anqp_cred_match *match,
+	struct wpa_bss *bss, int ignore_bw, int *excluded)
+{
+	struct wpa_cred *cred, *selected = NULL;
+	int is_excluded = 0;
+	unsigned int i;
 
-		if (!roaming_consortium_match(ie,
-					      bss->anqp ?
-					      bss->anqp->roaming_consortium :
-					      NULL,
-					      cred->roaming_consortium,
-					      cred->roaming_consortium_len))
+	for (i = 0; i < match->num_cred; i++) {
+		if (!match->hit[i])
 			continue;
+		cred = match->cred[i];
 
 		if (cred_no_required_oi_match(cred, bss))
 			continue;
@@ -1390,6 +1087,49 @@ static struct wpa_cred * interworking_credentials_available_roaming_consortium(
 }
 
 
+static struct wpa_cred * interworking_credentials_available_roaming_consortium(
+	struct wpa_supplicant *wpa_s, struct wpa_bss *bss, int ignore_bw,
+	int *excluded)
+{
+	struct anqp_cred_match *match;
+	struct anqp_parsed *parsed;
+	const u8 *ie;
+	const u8 *oi[3];
+	size_t oi_len[3], first, num, j;
+	unsigned int i, num_ie;
+
+	ie = wpa_bss_get_ie(bss, WLAN_EID_ROAMING_CONSORTIUM);
+
+	if (ie == NULL &&
+	    (bss->anqp == NULL || bss->anqp->roaming_consortium == NULL))
+		return NULL;
+
+	match = interworking_cred_match(wpa_s);
+	if (match == NULL || match->num_oi == 0)
+		return NULL;
+
+	os_memset(match->hit, 0, match->num_cred);
+
+	num_ie = roaming_consortium_element_ois(ie, oi, oi_len);
+	for (i = 0; i < num_ie; i++) {
+		num = anqp_cred_match_oi(match, oi[i], oi_len[i], &first);
+		for (j = first; j < first + num; j++)
+			match->hit[match->oi[j].cred] = 1;
+	}
+
+	parsed = anqp_parsed_get(bss->anqp);
+	for (i = 0; parsed && i < parsed->num_oi; i++) {
+		num = anqp_cred_match_oi(match, parsed->oi[i].oi,
+					 parsed->oi[i].len, &first);
+		for (j = first; j < first + num; j++)
+			match->hit[match->oi[j].cred] = 1;
+	}
+
+	return interworking_select_cred_hit(wpa_s, match, bss, ignore_bw,
+					    excluded);
+}
+
+
 static int interworking_set_eap_params(struct wpa_ssid *ssid,
 				       struct wpa_cred *cred, int ttls)
 {
@@ -1566,9 +1306,9 @@ static int interworking_connect_helper(struct wpa_supplicant *wpa_s,
 {
 	struct wpa_cred *cred, *cred_rc, *cred_3gpp;
 	struct wpa_ssid *ssid;
-	struct nai_realm *realm;
+	struct anqp_parsed *parsed;
 	struct nai_realm_eap *eap = NULL;
-	u16 count, i;
+	size_t i, first, num;
 	char buf[100];
 	int excluded = 0, *excl = allow_excluded ? &excluded : NULL;
 	const char *name;
@@ -1679,19 +1419,18 @@ static int interworking_connect_helper(struct wpa_supplicant *wpa_s,
 		return -1;
 	}
 
-	realm = nai_realm_parse(bss->anqp ? bss->anqp->nai_realm : NULL,
-				&count);
-	if (realm == NULL) {
+	parsed = anqp_parsed_get(bss->anqp);
+	if (parsed == NULL || parsed->realm == NULL) {
 		wpa_msg(wpa_s, MSG_DEBUG,
 			"Interworking: Could not parse NAI Realm list from "
 			MACSTR, MAC2STR(bss->bssid));
 		return -1;
 	}
 
-	for (i = 0; i < count; i++) {
-		if (!nai_realm_match(&realm[i], cred->realm))
-			continue;
-		eap = nai_realm_find_eap(wpa_s, cred, &realm[i]);
+	num = anqp_parsed_find_realm(parsed, cred->realm, &first);
+	for (i = first; i < first + num; i++) {
+		eap = nai_realm_find_eap(wpa_s, cred,
+					 &parsed->realm[parsed->name[i].realm]);
 		if (eap)
 			break;
 	}
@@ -1700,7 +1439,6 @@ static int interworking_connect_helper(struct wpa_supplicant *wpa_s,
 		wpa_msg(wpa_s, MSG_DEBUG,
 			"Interworking: No matching credentials and EAP method found for "
 			MACSTR, MAC2STR(bss->bssid));
-		nai_realm_free(realm, count);
 		return -1;
 	}
 
@@ -1710,7 +1448,6 @@ static int interworking_connect_helper(struct wpa_supplicant *wpa_s,
 	if (already_connected(wpa_s, cred, bss)) {
 		wpa_msg(wpa_s, MSG_INFO, INTERWORKING_ALREADY_CONNECTED MACSTR,
 			MAC2STR(bss->bssid));
-		nai_realm_free(realm, count);
 		return 0;
 	}
 
@@ -1718,7 +1455,6 @@ static int interworking_connect_helper(struct wpa_supplicant *wpa_s,
 
 	ssid = wpa_config_add_network(wpa_s->conf);
 	if (ssid == NULL) {
-		nai_realm_free(realm, count);
 		return -1;
 	}
 	ssid->parent_cred = cred;
@@ -1803,8 +1539,6 @@ static int interworking_connect_helper(struct wpa_supplicant *wpa_s,
 					eap->method == EAP_TYPE_TTLS) < 0)
 		goto fail;
 
-	nai_realm_free(realm, count);
-
 	wpa_s->next_ssid = ssid;
 	wpa_config_update_prio_list(wpa_s->conf);
 	if (!only_add)
@@ -1815,7 +1549,6 @@ static int interworking_connect_helper(struct wpa_supplicant *wpa_s,
 fail:
 	wpas_notify_network_removed(wpa_s, ssid);
 	wpa_config_remove_network(wpa_s->conf, ssid->id);
-	nai_realm_free(realm, count);
 	return -1;
 }
 
@@ -1858,9 +1591,10 @@ static struct wpa_cred * interworking_credentials_available_3gpp(
 {
 	struct wpa_cred *selected = NULL;
 #ifdef INTERWORKING_3GPP
+	struct anqp_cred_match *match;
+	struct anqp_parsed *parsed;
 	struct wpa_cred *cred;
-	int ret;
-	int is_excluded = 0;
+	size_t i, j, first, num;
 
 	if (bss->anqp == NULL || bss->anqp->anqp_3gpp == NULL) {
 		wpa_msg(wpa_s, MSG_DEBUG,
@@ -1869,6 +1603,11 @@ static struct wpa_cred * interworking_credentials_available_3gpp(
 		return NULL;
 	}
 
+	match = interworking_cred_match(wpa_s);
+	parsed = anqp_parsed_get(bss->anqp);
+	if (match == NULL || parsed == NULL)
+		return NULL;
+
 #ifdef CONFIG_EAP_PROXY
 	if (!wpa_s->imsi[0]) {
 		size_t len;
@@ -1889,89 +1628,49 @@ static struct wpa_cred * interworking_credentials_available_3gpp(
 	}
 #endif /* CONFIG_EAP_PROXY */
 
-	for (cred = wpa_s->conf->cred; cred; cred = cred->next) {
-		char *sep;
-		const char *imsi;
-		int mnc_len;
-		char imsi_buf[16];
-		size_t msin_len;
+	wpa_msg(wpa_s, MSG_DEBUG,
+		"Interworking: Matching 3GPP info from " MACSTR,
+		MAC2STR(bss->bssid));
+
+	os_memset(match->hit, 0, match->num_cred);
+	for (i = 0; i < parsed->num_plmn; i++) {
+		num = anqp_cred_match_plmn(match, parsed->plmn[i], &first);
+		for (j = first; j < first + num; j++)
+			match->hit[match->plmn[j].cred] = 1;
+	}
+
+	for (i = 0; i < match->num_cred; i++) {
+		cred = match->cred[i];
 
 #ifdef PCSC_FUNCS
 		if (cred->pcsc && wpa_s->scard) {
-			if (interworking_pcsc_read_imsi(wpa_s) < 0)
-				continue;
-			imsi = wpa_s->imsi;
-			mnc_len = wpa_s->mnc_len;
-			goto compare;
+			match->hit[i] =
+				interworking_pcsc_read_imsi(wpa_s) == 0 &&
+				plmn_id_match(parsed, wpa_s->imsi,
+					      wpa_s->mnc_len);
+			continue;
 		}
 #endif /* PCSC_FUNCS */
 #ifdef CONFIG_EAP_PROXY
 		if (cred->pcsc && wpa_s->mnc_len > 0 && wpa_s->imsi[0]) {
-			imsi = wpa_s->imsi;
-			mnc_len = wpa_s->mnc_len;
-			goto compare;
+			match->hit[i] = plmn_id_match(parsed, wpa_s->imsi,
+						      wpa_s->mnc_len);
+			continue;
 		}
 #endif /* CONFIG_EAP_PROXY */
 
-		if (cred->imsi == NULL || !cred->imsi[0] ||
-		    (!wpa_s->conf->external_sim &&
-		     (cred->milenage == NULL || !cred->milenage[0])))
-			continue;
-
-		sep = os_strchr(cred->imsi, '-');
-		if (sep == NULL ||
-		    (sep - cred->imsi != 5 && sep - cred->imsi != 6))
-			continue;
-		mnc_len = sep - cred->imsi - 3;
-		os_memcpy(imsi_buf, cred->imsi, 3 + mnc_len);
-		sep++;
-		msin_len = os_strlen(cred->imsi);
-		if (3 + mnc_len + msin_len >= sizeof(imsi_buf) - 1)
-			msin_len = sizeof(imsi_buf) - 3 - mnc_len - 1;
-		os_memcpy(&imsi_buf[3 + mnc_len], sep, msin_len);
-		imsi_buf[3 + mnc_len + msin_len] = '\0';
-		imsi = imsi_buf;
-
-#if defined(PCSC_FUNCS) || defined(CONFIG_EAP_PROXY)
-	compare:
-#endif /* PCSC_FUNCS || CONFIG_EAP_PROXY */
-		wpa_msg(wpa_s, MSG_DEBUG,
-			"Interworking: Parsing 3GPP info from " MACSTR,
-			MAC2STR(bss->bssid));
-		ret = plmn_id_match(bss->anqp->anqp_3gpp, imsi, mnc_len);
-		wpa_msg(wpa_s, MSG_DEBUG, "PLMN match %sfound",
-			ret ? "" : "not ");
-		if (ret) {
-			if (cred_no_required_oi_match(cred, bss))
-				continue;
-			if (!ignore_bw &&
-			    cred_below_min_backhaul(wpa_s, cred, bss))
-				continue;
-			if (!ignore_bw &&
-			    cred_over_max_bss_load(wpa_s, cred, bss))
-				continue;
-			if (!ignore_bw &&
-			    cred_conn_capab_missing(wpa_s, cred, bss))
-				continue;
-			if (cred_excluded_ssid(cred, bss)) {
-				if (excluded == NULL)
-					continue;
-				if (selected == NULL) {
-					selected = cred;
-					is_excluded = 1;
-				}
-			} else {
-				if (selected == NULL || is_excluded ||
-				    cred_prio_cmp(selected, cred) < 0) {
-					selected = cred;
-					is_excluded = 0;
-				}
-			}
-		}
+		/* PLMN IDs were compiled from the configured IMSI */
+		if (match->hit[i] && !wpa_s->conf->external_sim &&
+		    (cred->milenage == NULL || !cred->milenage[0]))
+			match->hit[i] = 0;
+		if (match->hit[i])
+			wpa_msg(wpa_s, MSG_DEBUG,
+				"Interworking: PLMN match found for cred %d",
+				cred->id);
 	}
 
-	if (excluded)
-		*excluded = is_excluded;
+	selected = interworking_select_cred_hit(wpa_s, match, bss, ignore_bw,
+						excluded);
 #endif /* INTERWORKING_3GPP */
 	return selected;
 }
@@ -1981,75 +1680,50 @@ static struct wpa_cred * interworking_credentials_available_realm(
 	struct wpa_supplicant *wpa_s, struct wpa_bss *bss, int ignore_bw,
 	int *excluded)
 {
-	struct wpa_cred *cred, *selected = NULL;
-	struct nai_realm *realm;
-	u16 count, i;
-	int is_excluded = 0;
+	struct anqp_cred_match *match;
+	struct anqp_parsed *parsed;
+	struct wpa_cred *cred;
+	size_t i, j, first, num;
 
 	if (bss->anqp == NULL || bss->anqp->nai_realm == NULL)
 		return NULL;
 
-	if (wpa_s->conf->cred == NULL)
+	match = interworking_cred_match(wpa_s);
+	if (match == NULL || match->num_realm == 0)
 		return NULL;
 
-	wpa_msg(wpa_s, MSG_DEBUG, "Interworking: Parsing NAI Realm list from "
-		MACSTR, MAC2STR(bss->bssid));
-	realm = nai_realm_parse(bss->anqp->nai_realm, &count);
-	if (realm == NULL) {
+	parsed = anqp_parsed_get(bss->anqp);
+	if (parsed == NULL || parsed->realm == NULL) {
 		wpa_msg(wpa_s, MSG_DEBUG,
 			"Interworking: Could not parse NAI Realm list from "
 			MACSTR, MAC2STR(bss->bssid));
 		return NULL;
 	}
 
-	for (cred = wpa_s->conf->cred; cred; cred = cred->next) {
-		if (cred->realm == NULL)
-			continue;
-
-		for (i = 0; i < count; i++) {
-			if (!nai_realm_match(&realm[i], cred->realm))
+	/*
+	 * A credential matches if any of the NAI Realms with its home realm
+	 * includes an EAP method that can be used with it.
+	 */
+	os_memset(match->hit, 0, match->num_cred);
+	for (i = 0; i < parsed->num_name; i++) {
+		struct nai_realm *realm = &parsed->realm[parsed->name[i].realm];
+
+		num = anqp_cred_match_realm(match, parsed->name[i].name,
+					    &first);
+		for (j = first; j < first + num; j++) {
+			if (match->hit[match->realm[j].cred])
 				continue;
-			if (nai_realm_find_eap(wpa_s, cred, &realm[i])) {
-				if (cred_no_required_oi_match(cred, bss))
-					continue;
-				if (!ignore_bw &&
-				    cred_below_min_backhaul(wpa_s, cred, bss))
-					continue;
-				if (!ignore_bw &&
-				    cred_over_max_bss_load(wpa_s, cred, bss))
-					continue;
-				if (!ignore_bw &&
-				    cred_conn_capab_missing(wpa_s, cred, bss))
-					continue;
-				if (cred_excluded_ssid(cred, bss)) {
-					if (excluded == NULL)
-						continue;
-					if (selected == NULL) {
-						selected = cred;
-						is_excluded = 1;
-					}
-				} else {
-					if (selected == NULL || is_excluded ||
-					    cred_prio_cmp(selected, cred) < 0)
-					{
-						selected = cred;
-						is_excluded = 0;
-					}
-				}
-				break;
-			} else {
+			cred = match->cred[match->realm[j].cred];
+			if (nai_realm_find_eap(wpa_s, cred, realm))
+				match->hit[match->realm[j].cred] = 1;
+			else
 				wpa_msg(wpa_s, MSG_DEBUG,
 					"Interworking: realm-find-eap returned false");
-			}
 		}
 	}
 
-	nai_realm_free(realm, count);
-
-	if (excluded)
-		*excluded = is_excluded;
-
-	return selected;
+	return interworking_select_cred_hit(wpa_s, match, bss, ignore_bw,
+					    excluded);
 }
 
 
@@ -2099,7 +1773,7 @@ static struct wpa_cred * interworking_credentials_available_helper(
 }
 
 
-static struct wpa_cred * interworking_credentials_available(
+struct wpa_cred * interworking_credentials_available(
 	struct wpa_supplicant *wpa_s, struct wpa_bss *bss, int *excluded)
 {
 	struct wpa_cred *cred;
@@ -2350,6 +2024,16 @@ static struct wpa_bss * pick_best_roaming_partner(struct wpa_supplicant *wpa_s,
 }
 
 
+static unsigned int interworking_ms_since(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	return diff.sec * 1000 + diff.usec / 1000;
+}
+
+
 static void interworking_select_network(struct wpa_supplicant *wpa_s)
 {
 	struct wpa_bss *bss, *selected = NULL, *selected_home = NULL;
@@ -2366,6 +2050,10 @@ static void interworking_select_network(struct wpa_supplicant *wpa_s)
 
 	wpa_printf(MSG_DEBUG, "Interworking: Select network (auto_select=%d)",
 		   wpa_s->auto_select);
+	wpa_msg(wpa_s, MSG_DEBUG,
+		"Interworking: Network selection started %u ms ago (ANQP fetch %u ms)",
+		interworking_ms_since(&wpa_s->network_select_start),
+		wpa_s->anqp_fetch_time);
 	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
 		int excluded = 0;
 		int bh, bss_load, conn_capab;
@@ -2510,14 +2198,34 @@ static void interworking_select_network(struct wpa_supplicant *wpa_s)
 }
 
 
+/*
+ * APs that advertise the same ANQP Domain ID (in the same HESSID, or the same
+ * SSID without HESSID) have identical ANQP information. Without the ANQP
+ * Domain ID, the data is shared within a homogenous ESS.
+ */
+static int interworking_same_anqp_domain(struct wpa_bss *a, struct wpa_bss *b)
+{
+	int id_a, id_b;
+
+	if (a->ssid_len != b->ssid_len ||
+	    os_memcmp(a->ssid, b->ssid, a->ssid_len) != 0 ||
+	    os_memcmp(a->hessid, b->hessid, ETH_ALEN) != 0)
+		return 0;
+
+	id_a = wpa_bss_get_anqp_domain_id(a);
+	id_b = wpa_bss_get_anqp_domain_id(b);
+	if (id_a >= 0 && id_b >= 0)
+		return id_a != 0 && id_a == id_b;
+
+	return !is_zero_ether_addr(a->hessid);
+}
+
+
 static struct wpa_bss_anqp *
 interworking_match_anqp_info(struct wpa_supplicant *wpa_s, struct wpa_bss *bss)
 {
 	struct wpa_bss *other;
 
-	if (is_zero_ether_addr(bss->hessid))
-		return NULL; /* Cannot be in the same homegenous ESS */
-
 	dl_list_for_each(other, &wpa_s->bss, struct wpa_bss, list) {
 		if (other == bss)
 			continue;
@@ -2530,10 +2238,7 @@ interworking_match_anqp_info(struct wpa_supplicant *wpa_s, struct wpa_bss *bss)
 			continue;
 		if (!(other->flags & WPA_BSS_ANQP_FETCH_TRIED))
 			continue;
-		if (os_memcmp(bss->hessid, other->hessid, ETH_ALEN) != 0)
-			continue;
-		if (bss->ssid_len != other->ssid_len ||
-		    os_memcmp(bss->ssid, other->ssid, bss->ssid_len) != 0)
+		if (!interworking_same_anqp_domain(bss, other))
 			continue;
 
 		wpa_msg(wpa_s, MSG_DEBUG,
@@ -2548,11 +2253,64 @@ interworking_match_anqp_info(struct wpa_supplicant *wpa_s, struct wpa_bss *bss)
 }
 
 
+static int interworking_anqp_candidate(struct wpa_supplicant *wpa_s,
+				       struct wpa_bss *bss)
+{
+	const u8 *ie;
+
+	if (!(bss->caps & IEEE80211_CAP_ESS))
+		return 0;
+	ie = wpa_bss_get_ie(bss, WLAN_EID_EXT_CAPAB);
+	if (ie == NULL || ie[1] < 4 || !(ie[5] & 0x80))
+		return 0; /* AP does not support Interworking */
+	if (disallowed_bssid(wpa_s, bss->bssid) ||
+	    disallowed_ssid(wpa_s, bss->ssid, bss->ssid_len))
+		return 0; /* Disallowed BSS */
+	return 1;
+}
+
+
+/* Whether cached ANQP information of a BSS matches a credential */
+static int interworking_cached_match(struct wpa_supplicant *wpa_s)
+{
+	struct wpa_bss *bss;
+	int excluded;
+
+	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
+		if (!(bss->flags & WPA_BSS_ANQP_CACHED) ||
+		    !interworking_anqp_candidate(wpa_s, bss))
+			continue;
+		excluded = 0;
+		if (interworking_credentials_available(wpa_s, bss, &excluded) &&
+		    !excluded)
+			return 1;
+	}
+
+	return 0;
+}
+
+
+/* Whether a query to a BSS with the same ANQP information is in progress */
+static int interworking_anqp_pending(struct wpa_supplicant *wpa_s,
+				     struct wpa_bss *bss)
+{
+	struct wpa_bss *other;
+
+	dl_list_for_each(other, &wpa_s->bss, struct wpa_bss, list) {
+		if (!(other->flags & WPA_BSS_ANQP_FETCH_PENDING))
+			continue;
+		if (bss == NULL || interworking_same_anqp_domain(bss, other))
+			return 1;
+	}
+
+	return 0;
+}
+
+
 static void interworking_next_anqp_fetch(struct wpa_supplicant *wpa_s)
 {
 	struct wpa_bss *bss;
-	int found = 0;
-	const u8 *ie;
+	int found = 0, freq = 0;
 
 	wpa_printf(MSG_DEBUG, "Interworking: next_anqp_fetch - "
 		   "fetch_anqp_in_progress=%d fetch_osu_icon_in_progress=%d",
@@ -2570,22 +2328,50 @@ static void interworking_next_anqp_fetch(struct wpa_supplicant *wpa_s)
 		return;
 	}
 
+	if (wpa_s->network_select && wpa_s->auto_select &&
+	    wpa_s->anqp_fetch_queries == 0 &&
+	    interworking_cached_match(wpa_s)) {
+		/*
+		 * Do not wait for the ANQP responses if the cached information
+		 * is sufficient for connecting automatically. Without
+		 * auto_select, the results for all BSSes need to be reported,
+		 * so the full fetch is completed in that case.
+		 */
+		wpa_msg(wpa_s, MSG_DEBUG,
+			"Interworking: Select network based on cached ANQP information");
+		interworking_select_network(wpa_s);
+		interworking_stop_fetch_anqp(wpa_s);
+		return;
+	}
+
+	/*
+	 * Queries are sent to all the BSSes on one channel at a time so that
+	 * they can be completed during a single offchannel operation. The next
+	 * channel is started only once all the responses have been received to
+	 * allow BSSes in the same ANQP domain to share the fetched data.
+	 */
+	if (interworking_anqp_pending(wpa_s, NULL)) {
+		wpa_printf(MSG_DEBUG,
+			   "Interworking: Wait for pending ANQP queries");
+		return;
+	}
+
 	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list) {
-		if (!(bss->caps & IEEE80211_CAP_ESS))
+		if (!interworking_anqp_candidate(wpa_s, bss))
 			continue;
-		ie = wpa_bss_get_ie(bss, WLAN_EID_EXT_CAPAB);
-		if (ie == NULL || ie[1] < 4 || !(ie[5] & 0x80))
-			continue; /* AP does not support Interworking */
-		if (disallowed_bssid(wpa_s, bss->bssid) ||
-		    disallowed_ssid(wpa_s, bss->ssid, bss->ssid_len))
-			continue; /* Disallowed BSS */
 
 		if (!(bss->flags & WPA_BSS_ANQP_FETCH_TRIED)) {
+			if (freq && bss->freq != freq)
+				continue;
+			if (interworking_anqp_pending(wpa_s, bss))
+				continue; /* Share data once fetched */
 			if (bss->anqp == NULL) {
 				bss->anqp = interworking_match_anqp_info(wpa_s,
 									 bss);
 				if (bss->anqp) {
 					/* Shared data already fetched */
+					bss->flags |= WPA_BSS_ANQP_FETCH_TRIED;
+					wpa_s->anqp_fetch_shared++;
 					continue;
 				}
 				bss->anqp = wpa_bss_anqp_alloc();
@@ -2593,14 +2379,19 @@ static void interworking_next_anqp_fetch(struct wpa_supplicant *wpa_s)
 					break;
 			}
 			found++;
+			freq = bss->freq;
 			bss->flags |= WPA_BSS_ANQP_FETCH_TRIED;
 			wpa_msg(wpa_s, MSG_INFO, "Starting ANQP fetch for "
 				MACSTR, MAC2STR(bss->bssid));
 			interworking_anqp_send_req(wpa_s, bss);
-			break;
+			if (found >= INTERWORKING_ANQP_BATCH)
+				break;
 		}
 	}
 
+	if (found)
+		wpa_s->anqp_fetch_channels++;
+
 	if (found == 0) {
 		if (wpa_s->fetch_osu_info) {
 			if (wpa_s->num_prov_found == 0 &&
@@ -2615,6 +2406,13 @@ static void interworking_next_anqp_fetch(struct wpa_supplicant *wpa_s)
 			return;
 		}
 		wpa_msg(wpa_s, MSG_INFO, "ANQP fetch completed");
+		wpa_s->anqp_fetch_time =
+			interworking_ms_since(&wpa_s->anqp_fetch_start);
+		wpa_msg(wpa_s, MSG_DEBUG,
+			"Interworking: ANQP fetch took %u ms: %u queries on %u channels, %u BSSes shared ANQP data",
+			wpa_s->anqp_fetch_time, wpa_s->anqp_fetch_queries,
+			wpa_s->anqp_fetch_channels, wpa_s->anqp_fetch_shared);
+		anqp_cache_save(wpa_s->anqp_cache);
 		wpa_s->fetch_anqp_in_progress = 0;
 		if (wpa_s->network_select)
 			interworking_select_network(wpa_s);
@@ -2627,9 +2425,14 @@ void interworking_start_fetch_anqp(struct wpa_supplicant *wpa_s)
 	struct wpa_bss *bss;
 
 	dl_list_for_each(bss, &wpa_s->bss, struct wpa_bss, list)
-		bss->flags &= ~WPA_BSS_ANQP_FETCH_TRIED;
+		bss->flags &= ~(WPA_BSS_ANQP_FETCH_TRIED |
+				WPA_BSS_ANQP_FETCH_PENDING);
 
 	wpa_s->fetch_anqp_in_progress = 1;
+	os_get_reltime(&wpa_s->anqp_fetch_start);
+	wpa_s->anqp_fetch_queries = 0;
+	wpa_s->anqp_fetch_channels = 0;
+	wpa_s->anqp_fetch_shared = 0;
 
 	/*
 	 * Start actual ANQP operation from eloop call to make sure the loop
@@ -2769,6 +2572,7 @@ static void interworking_parse_rx_anqp_resp(struct wpa_supplicant *wpa_s,
 		if (anqp) {
 			wpabuf_free(anqp->roaming_consortium);
 			anqp->roaming_consortium = wpabuf_alloc_copy(pos, slen);
+			anqp_parsed_flush(anqp);
 		}
 		break;
 	case ANQP_IP_ADDR_TYPE_AVAILABILITY:
@@ -2790,6 +2594,7 @@ static void interworking_parse_rx_anqp_resp(struct wpa_supplicant *wpa_s,
 		if (anqp) {
 			wpabuf_free(anqp->nai_realm);
 			anqp->nai_realm = wpabuf_alloc_copy(pos, slen);
+			anqp_parsed_flush(anqp);
 		}
 		break;
 	case ANQP_3GPP_CELLULAR_NETWORK:
@@ -2800,6 +2605,7 @@ static void interworking_parse_rx_anqp_resp(struct wpa_supplicant *wpa_s,
 		if (anqp) {
 			wpabuf_free(anqp->anqp_3gpp);
 			anqp->anqp_3gpp = wpabuf_alloc_copy(pos, slen);
+			anqp_parsed_flush(anqp);
 		}
 		break;
 	case ANQP_DOMAIN_NAME:
@@ -2894,7 +2700,8 @@ void anqp_resp_cb(void *ctx, const u8 *dst, u8 dialog_token,
 	 * may exist for the same AP.
 	 */
 	dl_list_for_each_reverse(tmp, &wpa_s->bss, struct wpa_bss, list) {
-		if (tmp == wpa_s->interworking_gas_bss &&
+		if ((tmp == wpa_s->interworking_gas_bss ||
+		     (tmp->flags & WPA_BSS_ANQP_FETCH_PENDING)) &&
 		    os_memcmp(tmp->bssid, dst, ETH_ALEN) == 0) {
 			bss = tmp;
 			break;
@@ -2932,6 +2739,10 @@ void anqp_resp_cb(void *ctx, const u8 *dst, u8 dialog_token,
 	}
 
 out_parse_done:
+	if (bss && os_strcmp(anqp_result, "SUCCESS") == 0) {
+		bss->flags &= ~WPA_BSS_ANQP_CACHED;
+		anqp_cache_store(wpa_s->anqp_cache, bss);
+	}
 	hs20_notify_parse_done(wpa_s);
 out:
 	wpa_msg(wpa_s, MSG_INFO, ANQP_QUERY_DONE "addr=" MACSTR " result=%s",
@@ -2953,6 +2764,7 @@ int interworking_select(struct wpa_supplicant *wpa_s, int auto_select,
 {
 	interworking_stop_fetch_anqp(wpa_s);
 	wpa_s->network_select = 1;
+	os_get_reltime(&wpa_s->network_select_start);
 	wpa_s->auto_network_select = 0;
 	wpa_s->auto_select = !!auto_select;
 	wpa_s->fetch_all_anqp = 0;
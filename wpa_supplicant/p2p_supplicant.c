@@ -1616,6 +1616,8 @@ static void wpas_p2p_add_psk_list(struct wpa_supplicant *wpa_s,
 		hpsk->next = hapd->conf->ssid.wpa_psk;
 		hapd->conf->ssid.wpa_psk = hpsk;
 	}
+
+	hostapd_wpa_psk_index_update(&hapd->conf->ssid);
 }
 
 
@@ -7324,6 +7326,7 @@ static void wpas_p2p_remove_client_go(struct wpa_supplicant *wpa_s,
 	struct hostapd_data *hapd;
 	struct hostapd_wpa_psk *psk, *prev, *rem;
 	struct sta_info *sta;
+	int removed = 0;
 
 	if (wpa_s->ap_iface == NULL || wpa_s->current_ssid == NULL ||
 	    wpa_s->current_ssid->mode != WPAS_MODE_P2P_GO)
@@ -7347,11 +7350,14 @@ static void wpas_p2p_remove_client_go(struct wpa_supplicant *wpa_s,
 			rem = psk;
 			psk = psk->next;
 			os_free(rem);
+			removed = 1;
 		} else {
 			prev = psk;
 			psk = psk->next;
 		}
 	}
+	if (removed)
+		hostapd_wpa_psk_index_update(&hapd->conf->ssid);
 
 	/* Disconnect from group */
 	if (iface_addr)
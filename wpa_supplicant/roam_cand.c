@@ -0,0 +1,709 @@
+/*
+ * wpa_supplicant - Roaming candidate cache
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * The BSSes of the currently used ESS are collected from scan results,
+ * neighbor reports and BSS Transition Management candidate lists into a list
+ * that is kept ranked by a score combining the last signal level, its trend,
+ * and the preference advertised by the AP. When the signal of the current AP
+ * drops below the configured threshold (or is falling towards a weak level)
+ * and the best candidate is clearly better, only the channel of that
+ * candidate is scanned instead of waiting for a full scan. The time from the
+ * roam trigger to association with the new AP is recorded.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/list.h"
+#include "common/ieee802_11_defs.h"
+#include "common/ieee802_11_common.h"
+#include "drivers/driver.h"
+#include "config.h"
+#include "wpa_supplicant_i.h"
+#include "bss.h"
+#include "blacklist.h"
+#include "scan.h"
+#include "roam_cand.h"
+
+
+/* Maximum number of candidates */
+#define ROAM_CAND_MAX 32
+/* Candidates not refreshed for this many seconds are removed */
+#define ROAM_CAND_MAX_AGE 120
+/* Signal level (dBm) assumed for reported BSSes that have not been seen */
+#define ROAM_CAND_UNKNOWN_LEVEL -85
+/* Number of observations the signal trend is extrapolated for in scoring */
+#define ROAM_CAND_TREND_SAMPLES 2
+/* Current AP signal level (dBm) below which a falling trend triggers a probe */
+#define ROAM_CAND_WEAK_LEVEL -75
+/* Minimum score difference (dB) to the current AP for a probe */
+#define ROAM_CAND_MIN_DIFF 5
+/* Minimum time in seconds between candidate probes */
+#define ROAM_CAND_PROBE_INTERVAL 10
+/* Roams not completed in this many seconds from the trigger are not counted */
+#define ROAM_CAND_ROAM_TIMEOUT 10
+
+#define ROAM_CAND_SRC_SCAN BIT(0)
+#define ROAM_CAND_SRC_NEIGHBOR BIT(1)
+#define ROAM_CAND_SRC_BTM BIT(2)
+
+/**
+ * struct roam_cand_entry - Roaming candidate
+ */
+struct roam_cand_entry {
+	struct dl_list list; /* ranked by score, best first */
+	u8 bssid[ETH_ALEN];
+	int freq; /* 0 if not known */
+	int level; /* last seen signal level in dBm; 0 if not seen */
+	int trend; /* signal level change per observation in 0.1 dB */
+	int pref; /* preference advertised by the AP or -1 if none */
+	unsigned int src; /* ROAM_CAND_SRC_* */
+	struct os_reltime last_update;
+	int score;
+};
+
+/**
+ * struct roam_cand - Roaming candidate cache for an interface
+ */
+struct roam_cand {
+	struct wpa_supplicant *wpa_s;
+	struct dl_list cands; /* struct roam_cand_entry */
+	unsigned int num_cands;
+	u8 ssid[SSID_MAX_LEN];
+	size_t ssid_len;
+
+	/* Current AP */
+	u8 cur_bssid[ETH_ALEN];
+	int cur_freq;
+	int cur_level;
+	int cur_trend;
+
+	struct os_reltime last_probe;
+	unsigned int probes;
+
+	/* AP of the association for which a neighbor report was requested */
+	u8 nr_bssid[ETH_ALEN];
+
+	/* Roam latency */
+	int roaming;
+	const char *roam_reason;
+	struct os_reltime roam_start;
+	u8 roam_from[ETH_ALEN];
+	unsigned int roam_assoc_ms;
+	unsigned int roams;
+	unsigned long total_roam_ms;
+	unsigned int last_roam_ms;
+	unsigned int last_roam_assoc_ms;
+	const char *last_roam_reason;
+};
+
+
+static int roam_cand_score(int level, int trend, int pref)
+{
+	int score;
+
+	score = level ? level : ROAM_CAND_UNKNOWN_LEVEL;
+	score += trend * ROAM_CAND_TREND_SAMPLES / 10;
+	if (pref > 0)
+		score += (pref - 128) / 16;
+
+	return score;
+}
+
+
+static void roam_cand_level(int *level, int *trend, int new_level)
+{
+	if (*level)
+		*trend = (3 * *trend + 10 * (new_level - *level)) / 4;
+	*level = new_level;
+}
+
+
+static void roam_cand_rank(struct roam_cand *rc, struct roam_cand_entry *e)
+{
+	struct roam_cand_entry *o;
+	struct dl_list *pos = &rc->cands;
+
+	e->score = roam_cand_score(e->level, e->trend, e->pref);
+	dl_list_del(&e->list);
+	dl_list_for_each(o, &rc->cands, struct roam_cand_entry, list) {
+		if (o->score < e->score)
+			break;
+		pos = &o->list;
+	}
+	dl_list_add(pos, &e->list);
+}
+
+
+static void roam_cand_remove(struct roam_cand *rc, struct roam_cand_entry *e)
+{
+	dl_list_del(&e->list);
+	rc->num_cands--;
+	os_free(e);
+}
+
+
+static void roam_cand_flush(struct roam_cand *rc)
+{
+	struct roam_cand_entry *e, *prev;
+
+	dl_list_for_each_safe(e, prev, &rc->cands, struct roam_cand_entry,
+			      list)
+		roam_cand_remove(rc, e);
+}
+
+
+static void roam_cand_expire(struct roam_cand *rc, struct os_reltime *now)
+{
+	struct roam_cand_entry *e, *prev;
+
+	dl_list_for_each_safe(e, prev, &rc->cands, struct roam_cand_entry,
+			      list) {
+		if (os_reltime_expired(now, &e->last_update, ROAM_CAND_MAX_AGE))
+			roam_cand_remove(rc, e);
+	}
+}
+
+
+static struct roam_cand_entry * roam_cand_get(struct roam_cand *rc,
+					      const u8 *bssid, int add)
+{
+	struct roam_cand_entry *e;
+
+	dl_list_for_each(e, &rc->cands, struct roam_cand_entry, list) {
+		if (os_memcmp(e->bssid, bssid, ETH_ALEN) == 0)
+			return e;
+	}
+
+	if (!add)
+		return NULL;
+
+	if (rc->num_cands >= ROAM_CAND_MAX) {
+		/* Replace the lowest ranked candidate */
+		e = dl_list_last(&rc->cands, struct roam_cand_entry, list);
+		roam_cand_remove(rc, e);
+	}
+
+	e = os_zalloc(sizeof(*e));
+	if (e == NULL)
+		return NULL;
+	os_memcpy(e->bssid, bssid, ETH_ALEN);
+	e->pref = -1;
+	dl_list_add_tail(&rc->cands, &e->list);
+	rc->num_cands++;
+
+	return e;
+}
+
+
+/*
+ * Make sure the cache is for the ESS of the current connection. Returns 1 if
+ * there is a connection to an ESS with a known SSID.
+ */
+static int roam_cand_ess(struct roam_cand *rc)
+{
+	struct wpa_supplicant *wpa_s = rc->wpa_s;
+	struct wpa_ssid *ssid = wpa_s->current_ssid;
+
+	if (wpa_s->wpa_state < WPA_ASSOCIATED || ssid == NULL ||
+	    ssid->ssid == NULL || ssid->ssid_len == 0 ||
+	    ssid->ssid_len > SSID_MAX_LEN)
+		return 0;
+
+	if (ssid->ssid_len == rc->ssid_len &&
+	    os_memcmp(ssid->ssid, rc->ssid, rc->ssid_len) == 0)
+		return 1;
+
+	wpa_dbg(wpa_s, MSG_DEBUG, "Roam cand: New ESS %s",
+		wpa_ssid_txt(ssid->ssid, ssid->ssid_len));
+	roam_cand_flush(rc);
+	os_memcpy(rc->ssid, ssid->ssid, ssid->ssid_len);
+	rc->ssid_len = ssid->ssid_len;
+	os_memset(rc->cur_bssid, 0, ETH_ALEN);
+	rc->cur_freq = 0;
+	rc->cur_level = 0;
+	rc->cur_trend = 0;
+
+	return 1;
+}
+
+
+/*
+ * Move the current AP out of the candidates when the connection moves to
+ * another BSS and keep the previous AP as a candidate.
+ */
+static void roam_cand_set_current(struct roam_cand *rc)
+{
+	struct wpa_supplicant *wpa_s = rc->wpa_s;
+	struct roam_cand_entry *e;
+	int level = 0, trend = 0;
+
+	if (os_memcmp(rc->cur_bssid, wpa_s->bssid, ETH_ALEN) == 0)
+		return;
+
+	e = roam_cand_get(rc, wpa_s->bssid, 0);
+	if (e) {
+		level = e->level;
+		trend = e->trend;
+		roam_cand_remove(rc, e);
+	}
+
+	if (!is_zero_ether_addr(rc->cur_bssid)) {
+		e = roam_cand_get(rc, rc->cur_bssid, 1);
+		if (e) {
+			if (rc->cur_freq > 0)
+				e->freq = rc->cur_freq;
+			e->level = rc->cur_level;
+			e->trend = rc->cur_trend;
+			e->src |= ROAM_CAND_SRC_SCAN;
+			os_get_reltime(&e->last_update);
+			roam_cand_rank(rc, e);
+		}
+	}
+
+	os_memcpy(rc->cur_bssid, wpa_s->bssid, ETH_ALEN);
+	rc->cur_freq = wpa_s->assoc_freq;
+	rc->cur_level = level;
+	rc->cur_trend = trend;
+}
+
+
+static void roam_cand_reported(struct roam_cand *rc, const u8 *bssid,
+			       int freq, int pref, unsigned int src)
+{
+	struct roam_cand_entry *e;
+
+	if (os_memcmp(bssid, rc->wpa_s->bssid, ETH_ALEN) == 0)
+		return;
+
+	if (pref == 0) {
+		/* The AP indicates that this BSS is not to be used */
+		e = roam_cand_get(rc, bssid, 0);
+		if (e)
+			roam_cand_remove(rc, e);
+		return;
+	}
+
+	e = roam_cand_get(rc, bssid, 1);
+	if (e == NULL)
+		return;
+	if (freq > 0)
+		e->freq = freq;
+	if (pref > 0)
+		e->pref = pref;
+	e->src |= src;
+	os_get_reltime(&e->last_update);
+	roam_cand_rank(rc, e);
+}
+
+
+/**
+ * roam_cand_init - Initialize roaming candidate cache for an interface
+ * @wpa_s: Pointer to wpa_supplicant data
+ * Returns: Pointer to the cache or %NULL on failure
+ */
+struct roam_cand * roam_cand_init(struct wpa_supplicant *wpa_s)
+{
+	struct roam_cand *rc;
+
+	rc = os_zalloc(sizeof(*rc));
+	if (rc == NULL)
+		return NULL;
+	rc->wpa_s = wpa_s;
+	dl_list_init(&rc->cands);
+
+	return rc;
+}
+
+
+/**
+ * roam_cand_deinit - Free roaming candidate cache
+ * @rc: Cache from roam_cand_init()
+ */
+void roam_cand_deinit(struct roam_cand *rc)
+{
+	if (rc == NULL)
+		return;
+
+	roam_cand_flush(rc);
+	os_free(rc);
+}
+
+
+/**
+ * roam_cand_scan_results - Update candidates from scan results
+ * @rc: Cache from roam_cand_init()
+ * @scan_res: Scan results from the driver
+ */
+void roam_cand_scan_results(struct roam_cand *rc,
+			    struct wpa_scan_results *scan_res)
+{
+	struct roam_cand_entry *e;
+	struct os_reltime now;
+	const u8 *ie;
+	size_t i;
+	int level;
+
+	if (rc == NULL || !roam_cand_ess(rc))
+		return;
+	roam_cand_set_current(rc);
+
+	os_get_reltime(&now);
+	for (i = 0; i < scan_res->num; i++) {
+		struct wpa_scan_res *res = scan_res->res[i];
+
+		ie = wpa_scan_get_ie(res, WLAN_EID_SSID);
+		if (ie == NULL || ie[1] != rc->ssid_len ||
+		    os_memcmp(ie + 2, rc->ssid, rc->ssid_len) != 0)
+			continue;
+
+		if ((res->flags & WPA_SCAN_LEVEL_DBM) &&
+		    !(res->flags & WPA_SCAN_LEVEL_INVALID))
+			level = res->level;
+		else
+			level = 0;
+
+		if (os_memcmp(res->bssid, rc->cur_bssid, ETH_ALEN) == 0) {
+			if (level)
+				roam_cand_level(&rc->cur_level, &rc->cur_trend,
+						level);
+			continue;
+		}
+
+		e = roam_cand_get(rc, res->bssid, 1);
+		if (e == NULL)
+			continue;
+		e->freq = res->freq;
+		if (level)
+			roam_cand_level(&e->level, &e->trend, level);
+		e->src |= ROAM_CAND_SRC_SCAN;
+		e->last_update = now;
+		roam_cand_rank(rc, e);
+	}
+}
+
+
+static void roam_cand_neighbor(struct roam_cand *rc, const u8 *pos, u8 len)
+{
+	const u8 *end = pos + len, *sub, *country = NULL;
+	struct wpa_bss *bss = rc->wpa_s->current_bss;
+	int pref = -1, freq;
+
+	for (sub = pos + 13; end - sub >= 2; sub += 2 + sub[1]) {
+		if (sub[1] > end - sub - 2)
+			break;
+		if (sub[0] == WNM_NEIGHBOR_BSS_TRANSITION_CANDIDATE &&
+		    sub[1] >= 1)
+			pref = sub[2];
+	}
+
+	if (bss) {
+		const u8 *elem = wpa_bss_get_ie(bss, WLAN_EID_COUNTRY);
+
+		if (elem && elem[1] >= 2)
+			country = elem + 2;
+	}
+	freq = ieee80211_chan_to_freq((const char *) country, pos[10],
+				      pos[11]);
+
+	wpa_dbg(rc->wpa_s, MSG_DEBUG,
+		"Roam cand: Neighbor " MACSTR " freq=%d pref=%d",
+		MAC2STR(pos), freq, pref);
+	roam_cand_reported(rc, pos, freq, pref, ROAM_CAND_SRC_NEIGHBOR);
+}
+
+
+/**
+ * roam_cand_neighbor_report - Add candidates from a neighbor report
+ * @rc: Cache from roam_cand_init()
+ * @buf: Neighbor Report elements
+ * @len: Length of @buf
+ */
+void roam_cand_neighbor_report(struct roam_cand *rc, const u8 *buf,
+			       size_t len)
+{
+	const u8 *pos = buf, *end = buf + len;
+
+	if (rc == NULL || !roam_cand_ess(rc))
+		return;
+
+	while (end - pos >= 2) {
+		u8 id = pos[0], elen = pos[1];
+
+		pos += 2;
+		if (elen > end - pos)
+			break;
+		if (id == WLAN_EID_NEIGHBOR_REPORT && elen >= 13)
+			roam_cand_neighbor(rc, pos, elen);
+		pos += elen;
+	}
+}
+
+
+/**
+ * roam_cand_btm_cand - Add a candidate from a BSS Transition Management Request
+ * @rc: Cache from roam_cand_init()
+ * @bssid: BSSID of the candidate
+ * @freq: Operating frequency of the candidate or 0 if not known
+ * @pref: Preference of the candidate or -1 if not included
+ */
+void roam_cand_btm_cand(struct roam_cand *rc, const u8 *bssid, int freq,
+			int pref)
+{
+	if (rc == NULL || !roam_cand_ess(rc))
+		return;
+
+	roam_cand_reported(rc, bssid, freq, pref, ROAM_CAND_SRC_BTM);
+}
+
+
+static void roam_cand_probe(struct roam_cand *rc)
+{
+	struct wpa_supplicant *wpa_s = rc->wpa_s;
+	struct roam_cand_entry *e, *best = NULL;
+	struct os_reltime now;
+	int cur, *freqs;
+
+	if (wpa_s->wpa_state != WPA_COMPLETED ||
+	    wpas_driver_bss_selection(wpa_s) ||
+	    wpa_s->scanning || wpa_s->scan_work)
+		return;
+
+	os_get_reltime(&now);
+	if (os_reltime_initialized(&rc->last_probe) &&
+	    !os_reltime_expired(&now, &rc->last_probe,
+				ROAM_CAND_PROBE_INTERVAL))
+		return;
+
+	roam_cand_expire(rc, &now);
+	dl_list_for_each(e, &rc->cands, struct roam_cand_entry, list) {
+		if (e->freq > 0 && !wpa_blacklist_get(wpa_s, e->bssid)) {
+			best = e;
+			break;
+		}
+	}
+
+	cur = roam_cand_score(rc->cur_level, rc->cur_trend, -1);
+	if (best == NULL || best->score < cur + ROAM_CAND_MIN_DIFF) {
+		wpa_dbg(wpa_s, MSG_DEBUG,
+			"Roam cand: No candidate better than the current AP (score %d)",
+			cur);
+		return;
+	}
+
+	freqs = os_calloc(2, sizeof(int));
+	if (freqs == NULL)
+		return;
+	freqs[0] = best->freq;
+	os_free(wpa_s->next_scan_freqs);
+	wpa_s->next_scan_freqs = freqs;
+
+	wpa_dbg(wpa_s, MSG_DEBUG,
+		"Roam cand: Probe %d MHz for " MACSTR
+		" (score %d, current AP score %d)",
+		best->freq, MAC2STR(best->bssid), best->score, cur);
+	rc->last_probe = now;
+	rc->probes++;
+	roam_cand_roam_started(rc, "candidate", &now);
+	wpa_supplicant_req_scan(wpa_s, 0, 0);
+}
+
+
+/**
+ * roam_cand_signal_change - Notify the cache of current AP signal change
+ * @rc: Cache from roam_cand_init()
+ * @above_threshold: Whether the signal is above the configured threshold
+ * @signal: Current signal level in dBm or 0 if not known
+ *
+ * The channel of the best candidate is probed if the signal of the current AP
+ * is below the threshold or falling towards a weak level.
+ */
+void roam_cand_signal_change(struct roam_cand *rc, int above_threshold,
+			     int signal)
+{
+	if (rc == NULL || !roam_cand_ess(rc))
+		return;
+	roam_cand_set_current(rc);
+
+	if (signal)
+		roam_cand_level(&rc->cur_level, &rc->cur_trend, signal);
+
+	if (!above_threshold ||
+	    (rc->cur_trend < 0 &&
+	     roam_cand_score(rc->cur_level, rc->cur_trend, -1) <
+	     ROAM_CAND_WEAK_LEVEL))
+		roam_cand_probe(rc);
+}
+
+
+/**
+ * roam_cand_roam_started - Start measuring roam latency
+ * @rc: Cache from roam_cand_init()
+ * @reason: Text describing the roam trigger
+ * @trigger: Time of the trigger or %NULL to use the current time
+ *
+ * An earlier trigger that has not yet resulted in a roam is kept.
+ */
+void roam_cand_roam_started(struct roam_cand *rc, const char *reason,
+			    const struct os_reltime *trigger)
+{
+	struct os_reltime now;
+
+	if (rc == NULL)
+		return;
+
+	os_get_reltime(&now);
+	if (rc->roaming &&
+	    !os_reltime_expired(&now, &rc->roam_start, ROAM_CAND_ROAM_TIMEOUT))
+		return;
+
+	rc->roaming = 1;
+	rc->roam_reason = reason;
+	rc->roam_start = trigger && (trigger->sec || trigger->usec) ?
+		*trigger : now;
+	rc->roam_assoc_ms = 0;
+	os_memcpy(rc->roam_from, rc->wpa_s->bssid, ETH_ALEN);
+	wpa_dbg(rc->wpa_s, MSG_DEBUG, "Roam cand: Roam triggered (%s)",
+		reason);
+}
+
+
+static void roam_cand_neighbor_rep_cb(void *ctx, struct wpabuf *neighbor_rep)
+{
+	/* The report was already processed in roam_cand_neighbor_report() */
+	wpabuf_free(neighbor_rep);
+}
+
+
+/**
+ * roam_cand_state_changed - Notify the cache of a state change
+ * @rc: Cache from roam_cand_init()
+ * @state: New wpa_supplicant state
+ */
+void roam_cand_state_changed(struct roam_cand *rc, enum wpa_states state)
+{
+	struct wpa_supplicant *wpa_s;
+	struct os_reltime now, diff;
+	unsigned int ms;
+
+	if (rc == NULL)
+		return;
+	wpa_s = rc->wpa_s;
+
+	if (state < WPA_ASSOCIATED)
+		os_memset(rc->nr_bssid, 0, ETH_ALEN);
+
+	if (state == WPA_INACTIVE || state == WPA_INTERFACE_DISABLED) {
+		rc->roaming = 0;
+		return;
+	}
+
+	if (state == WPA_COMPLETED && roam_cand_ess(rc)) {
+		roam_cand_set_current(rc);
+		/*
+		 * Request a neighbor report once per association, not on each
+		 * return to WPA_COMPLETED after a group rekey.
+		 */
+		if (os_memcmp(rc->nr_bssid, wpa_s->bssid, ETH_ALEN) != 0) {
+			os_memcpy(rc->nr_bssid, wpa_s->bssid, ETH_ALEN);
+			if (wpa_s->rrm.rrm_used &&
+			    !wpa_s->rrm.notify_neighbor_rep)
+				wpas_rrm_send_neighbor_rep_request(
+					wpa_s, NULL, roam_cand_neighbor_rep_cb,
+					NULL);
+		}
+	}
+
+	if (!rc->roaming || (state != WPA_ASSOCIATED && state != WPA_COMPLETED) ||
+	    os_memcmp(wpa_s->bssid, rc->roam_from, ETH_ALEN) == 0)
+		return;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, &rc->roam_start, &diff);
+	if (diff.sec >= ROAM_CAND_ROAM_TIMEOUT) {
+		wpa_dbg(wpa_s, MSG_DEBUG,
+			"Roam cand: Ignore roam trigger from %ld seconds ago",
+			(long) diff.sec);
+		rc->roaming = 0;
+		return;
+	}
+	ms = diff.sec * 1000 + diff.usec / 1000;
+
+	if (state == WPA_ASSOCIATED) {
+		rc->roam_assoc_ms = ms;
+		return;
+	}
+
+	rc->roaming = 0;
+	rc->roams++;
+	rc->last_roam_ms = ms;
+	rc->last_roam_assoc_ms = rc->roam_assoc_ms ? rc->roam_assoc_ms : ms;
+	rc->last_roam_reason = rc->roam_reason;
+	rc->total_roam_ms += ms;
+	wpa_msg(wpa_s, MSG_INFO, "Roam cand: Roamed from " MACSTR " to " MACSTR
+		" in %u ms (associated after %u ms, trigger: %s)",
+		MAC2STR(rc->roam_from), MAC2STR(wpa_s->bssid), ms,
+		rc->last_roam_assoc_ms, rc->roam_reason);
+}
+
+
+/**
+ * roam_cand_status - Write roam statistics and candidates into a buffer
+ * @rc: Cache from roam_cand_init()
+ * @buf: Buffer for the status text
+ * @buflen: Length of the buffer
+ * Returns: Number of characters written or -1 on failure
+ *
+ * Signal level trends are reported in 0.1 dB per observation.
+ */
+int roam_cand_status(struct roam_cand *rc, char *buf, size_t buflen)
+{
+	struct roam_cand_entry *e;
+	char *pos = buf, *end = buf + buflen;
+	struct os_reltime now;
+	int ret;
+
+	if (rc == NULL)
+		return -1;
+
+	ret = os_snprintf(pos, end - pos,
+			  "roams=%u\n"
+			  "avg_roam_ms=%lu\n"
+			  "last_roam_ms=%u\n"
+			  "last_roam_assoc_ms=%u\n"
+			  "last_roam_trigger=%s\n"
+			  "probes=%u\n"
+			  "current=" MACSTR " level=%d trend=%d\n",
+			  rc->roams,
+			  rc->roams ? rc->total_roam_ms / rc->roams : 0,
+			  rc->last_roam_ms, rc->last_roam_assoc_ms,
+			  rc->last_roam_reason ? rc->last_roam_reason : "",
+			  rc->probes, MAC2STR(rc->cur_bssid), rc->cur_level,
+			  rc->cur_trend);
+	if (os_snprintf_error(end - pos, ret))
+		return pos - buf;
+	pos += ret;
+
+	os_get_reltime(&now);
+	dl_list_for_each(e, &rc->cands, struct roam_cand_entry, list) {
+		ret = os_snprintf(pos, end - pos,
+				  "bssid=" MACSTR " freq=%d level=%d trend=%d "
+				  "pref=%d score=%d age=%ld src=%s%s%s\n",
+				  MAC2STR(e->bssid), e->freq, e->level,
+				  e->trend, e->pref, e->score,
+				  (long) (now.sec - e->last_update.sec),
+				  e->src & ROAM_CAND_SRC_SCAN ? "[SCAN]" : "",
+				  e->src & ROAM_CAND_SRC_NEIGHBOR ?
+				  "[NEIGHBOR]" : "",
+				  e->src & ROAM_CAND_SRC_BTM ? "[BTM]" : "");
+		if (os_snprintf_error(end - pos, ret))
+			return pos - buf;
+		pos += ret;
+	}
+
+	return pos - buf;
+}
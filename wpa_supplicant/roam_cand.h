@@ -0,0 +1,82 @@
+/*
+ * wpa_supplicant - Roaming candidate cache
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef ROAM_CAND_H
+#define ROAM_CAND_H
+
+struct roam_cand;
+struct wpa_scan_results;
+
+#ifdef CONFIG_ROAM_CAND
+
+struct roam_cand * roam_cand_init(struct wpa_supplicant *wpa_s);
+void roam_cand_deinit(struct roam_cand *rc);
+void roam_cand_scan_results(struct roam_cand *rc,
+			    struct wpa_scan_results *scan_res);
+void roam_cand_neighbor_report(struct roam_cand *rc, const u8 *buf,
+			       size_t len);
+void roam_cand_btm_cand(struct roam_cand *rc, const u8 *bssid, int freq,
+			int pref);
+void roam_cand_signal_change(struct roam_cand *rc, int above_threshold,
+			     int signal);
+void roam_cand_roam_started(struct roam_cand *rc, const char *reason,
+			    const struct os_reltime *trigger);
+void roam_cand_state_changed(struct roam_cand *rc, enum wpa_states state);
+int roam_cand_status(struct roam_cand *rc, char *buf, size_t buflen);
+
+#else /* CONFIG_ROAM_CAND */
+
+static inline struct roam_cand * roam_cand_init(struct wpa_supplicant *wpa_s)
+{
+	return NULL;
+}
+
+static inline void roam_cand_deinit(struct roam_cand *rc)
+{
+}
+
+static inline void roam_cand_scan_results(struct roam_cand *rc,
+					  struct wpa_scan_results *scan_res)
+{
+}
+
+static inline void roam_cand_neighbor_report(struct roam_cand *rc,
+					     const u8 *buf, size_t len)
+{
+}
+
+static inline void roam_cand_btm_cand(struct roam_cand *rc, const u8 *bssid,
+				      int freq, int pref)
+{
+}
+
+static inline void roam_cand_signal_change(struct roam_cand *rc,
+					   int above_threshold, int signal)
+{
+}
+
+static inline void roam_cand_roam_started(struct roam_cand *rc,
+					  const char *reason,
+					  const struct os_reltime *trigger)
+{
+}
+
+static inline void roam_cand_state_changed(struct roam_cand *rc,
+					   enum wpa_states state)
+{
+}
+
+static inline int roam_cand_status(struct roam_cand *rc, char *buf,
+				   size_t buflen)
+{
+	return -1;
+}
+
+#endif /* CONFIG_ROAM_CAND */
+
+#endif /* ROAM_CAND_H */
@@ -23,6 +23,7 @@
 #include "bss.h"
 #include "scan.h"
 #include "mesh.h"
+#include "scan_plan.h"
 
 
 static void wpa_supplicant_gen_assoc_event(struct wpa_supplicant *wpa_s)
@@ -238,6 +239,8 @@ int wpa_supplicant_trigger_scan(struct wpa_supplicant *wpa_s,
 		return -1;
 	}
 
+	scan_plan_scan_started(wpa_s->scan_plan, params->freqs);
+
 	return 0;
 }
 
@@ -987,6 +990,11 @@ ssid_list_set:
 		}
 	}
 
+	/* Limit the scan to the channels the networks have been seen on */
+	if (!params.freqs && wpa_s->last_scan_req != MANUAL_SCAN_REQ)
+		params.freqs = scan_plan_freqs(wpa_s->scan_plan,
+					       SCAN_PLAN_CONNECT);
+
 	params.filter_ssids = wpa_supplicant_build_filter_ssids(
 		wpa_s->conf, &params.num_filter_ssids);
 	if (extra_ie) {
@@ -2265,6 +2273,7 @@ int wpas_start_pno(struct wpa_supplicant *wpa_s)
 	size_t i, num_ssid, num_match_ssid;
 	struct wpa_ssid *ssid;
 	struct wpa_driver_scan_params params;
+	int *plan_freqs = NULL;
 
 	if (!wpa_s->sched_scan_supported)
 		return -1;
@@ -2366,6 +2375,10 @@ int wpas_start_pno(struct wpa_supplicant *wpa_s)
 		params.freqs = wpa_s->manual_sched_scan_freqs;
 	}
 
+	if (params.freqs == NULL)
+		params.freqs = plan_freqs = scan_plan_freqs(wpa_s->scan_plan,
+							    SCAN_PLAN_PNO);
+
 	if (wpa_s->mac_addr_rand_enable & MAC_ADDR_RAND_PNO) {
 		params.mac_addr_rand = 1;
 		if (wpa_s->mac_addr_pno) {
@@ -2376,6 +2389,7 @@ int wpas_start_pno(struct wpa_supplicant *wpa_s)
 
 	ret = wpa_supplicant_start_sched_scan(wpa_s, &params, interval);
 	os_free(params.filter_ssids);
+	os_free(plan_freqs);
 	if (ret == 0)
 		wpa_s->pno = 1;
 	else
@@ -0,0 +1,784 @@
+/*
+ * wpa_supplicant - Scan planning based on channel history
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * The channels on which the ESSs of the configured networks have been seen
+ * are recorded from all scan results and optionally stored in a text file
+ * over restarts. Scans for connection and PNO are limited to those channels
+ * when every enabled network has a channel history. A full scan is used when
+ * that is not the case, when the previous limited scan did not result in a
+ * connection, and at least once every scan_plan_full_interval seconds.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "utils/list.h"
+#include "common/ieee802_11_defs.h"
+#include "drivers/driver.h"
+#include "config.h"
+#include "wpa_supplicant_i.h"
+#include "scan.h"
+#include "scan_plan.h"
+
+
+/* Maximum number of ESSs and channels per ESS in the history */
+#define SCAN_PLAN_MAX_ESS 64
+#define SCAN_PLAN_MAX_CHAN 16
+/* Channels not seen for this many seconds are not scanned (30 days) */
+#define SCAN_PLAN_MAX_AGE (30 * 24 * 60 * 60)
+/* Time in seconds a full channel PNO runs before returning to history */
+#define SCAN_PLAN_PNO_FULL_TIME 60
+
+struct scan_plan_chan {
+	int freq;
+	unsigned int hits; /* number of scans in which the ESS was seen */
+	os_time_t last_seen;
+};
+
+/**
+ * struct scan_plan_ess - Channel history of an ESS
+ */
+struct scan_plan_ess {
+	struct dl_list list;
+	u8 ssid[SSID_MAX_LEN];
+	size_t ssid_len;
+	struct scan_plan_chan chan[SCAN_PLAN_MAX_CHAN];
+	unsigned int num_chan;
+};
+
+/**
+ * struct scan_plan - Scan planner data for an interface
+ */
+struct scan_plan {
+	struct wpa_supplicant *wpa_s;
+	struct dl_list ess; /* struct scan_plan_ess; most recently seen first */
+	unsigned int num_ess;
+	char *fname;
+	int changed;
+
+	struct os_reltime last_full;
+	int partial_pending; /* limited connection scan without connection */
+	int pno_partial;
+
+	/* Statistics of scans and connections */
+	unsigned int partial_scans;
+	unsigned int full_scans;
+	unsigned long channels;
+	int connecting;
+	struct os_reltime connect_start;
+	unsigned int connect_scans;
+	unsigned int connect_channels;
+	unsigned int connections;
+	unsigned long total_connect_ms;
+	unsigned long total_connect_channels;
+	unsigned int last_connect_ms;
+	unsigned int last_connect_scans;
+	unsigned int last_connect_channels;
+};
+
+
+static os_time_t scan_plan_now(void)
+{
+	struct os_time now;
+
+	os_get_time(&now);
+	return now.sec;
+}
+
+
+static int scan_plan_chan_fresh(const struct scan_plan_chan *chan,
+				os_time_t now)
+{
+	return now <= chan->last_seen ||
+		now - chan->last_seen <= SCAN_PLAN_MAX_AGE;
+}
+
+
+static struct scan_plan_ess * scan_plan_get_ess(struct scan_plan *plan,
+						const u8 *ssid,
+						size_t ssid_len)
+{
+	struct scan_plan_ess *ess;
+
+	dl_list_for_each(ess, &plan->ess, struct scan_plan_ess, list) {
+		if (ess->ssid_len == ssid_len &&
+		    os_memcmp(ess->ssid, ssid, ssid_len) == 0)
+			return ess;
+	}
+
+	return NULL;
+}
+
+
+static struct scan_plan_ess * scan_plan_add_ess(struct scan_plan *plan,
+						const u8 *ssid,
+						size_t ssid_len)
+{
+	struct scan_plan_ess *ess;
+
+	if (ssid_len > SSID_MAX_LEN)
+		return NULL;
+
+	if (plan->num_ess >= SCAN_PLAN_MAX_ESS) {
+		ess = dl_list_last(&plan->ess, struct scan_plan_ess, list);
+		wpa_printf(MSG_DEBUG, "Scan plan: Remove least recently seen "
+			   "SSID %s", wpa_ssid_txt(ess->ssid, ess->ssid_len));
+		dl_list_del(&ess->list);
+		os_memset(ess, 0, sizeof(*ess));
+	} else {
+		ess = os_zalloc(sizeof(*ess));
+		if (ess == NULL)
+			return NULL;
+		plan->num_ess++;
+	}
+
+	os_memcpy(ess->ssid, ssid, ssid_len);
+	ess->ssid_len = ssid_len;
+	dl_list_add(&plan->ess, &ess->list);
+
+	return ess;
+}
+
+
+static void scan_plan_seen(struct scan_plan_ess *ess, int freq,
+			   os_time_t now)
+{
+	struct scan_plan_chan *chan = NULL;
+	unsigned int i;
+
+	for (i = 0; i < ess->num_chan; i++) {
+		if (ess->chan[i].freq == freq) {
+			chan = &ess->chan[i];
+			break;
+		}
+	}
+
+	if (chan == NULL && ess->num_chan < SCAN_PLAN_MAX_CHAN) {
+		chan = &ess->chan[ess->num_chan++];
+		chan->hits = 0;
+	} else if (chan == NULL) {
+		/* Replace the least used channel */
+		chan = &ess->chan[0];
+		for (i = 1; i < ess->num_chan; i++) {
+			if (ess->chan[i].hits < chan->hits ||
+			    (ess->chan[i].hits == chan->hits &&
+			     ess->chan[i].last_seen < chan->last_seen))
+				chan = &ess->chan[i];
+		}
+		chan->hits = 0;
+	}
+
+	chan->freq = freq;
+	chan->last_seen = now;
+	if (++chan->hits >= 10000) {
+		/* Keep the counts comparable with the new channels */
+		for (i = 0; i < ess->num_chan; i++)
+			ess->chan[i].hits = (ess->chan[i].hits + 1) / 2;
+	}
+}
+
+
+static int scan_plan_configured(struct scan_plan *plan, const u8 *ssid,
+				size_t ssid_len)
+{
+	struct wpa_ssid *s;
+
+	for (s = plan->wpa_s->conf->ssid; s; s = s->next) {
+		if (s->ssid_len == ssid_len &&
+		    os_memcmp(s->ssid, ssid, ssid_len) == 0)
+			return 1;
+	}
+
+	return 0;
+}
+
+
+static unsigned int scan_plan_num_channels(struct wpa_supplicant *wpa_s)
+{
+	struct hostapd_hw_modes *modes = wpa_s->hw.modes;
+	int i, j, *freqs = NULL;
+	unsigned int count;
+
+	for (i = 0; modes && i < wpa_s->hw.num_modes; i++) {
+		for (j = 0; j < modes[i].num_channels; j++) {
+			if (modes[i].channels[j].flag & HOSTAPD_CHAN_DISABLED)
+				continue;
+			int_array_add_unique(&freqs, modes[i].channels[j].freq);
+		}
+	}
+
+	count = freqs ? int_array_len(freqs) : 0;
+	os_free(freqs);
+
+	return count;
+}
+
+
+static int scan_plan_parse_ess(struct scan_plan *plan, const char *line,
+			       struct scan_plan_ess **ess)
+{
+	u8 ssid[SSID_MAX_LEN];
+	size_t len = os_strlen(line);
+
+	*ess = NULL;
+	if (len & 1 || len / 2 > sizeof(ssid) ||
+	    hexstr2bin(line, ssid, len / 2) < 0)
+		return -1;
+
+	*ess = scan_plan_get_ess(plan, ssid, len / 2);
+	if (*ess == NULL) {
+		*ess = scan_plan_add_ess(plan, ssid, len / 2);
+		if (*ess == NULL)
+			return -1;
+		/* Keep the order of the file; most recently seen is first */
+		dl_list_del(&(*ess)->list);
+		dl_list_add_tail(&plan->ess, &(*ess)->list);
+	}
+
+	return 0;
+}
+
+
+static int scan_plan_parse_chan(struct scan_plan_ess *ess, const char *line,
+				os_time_t now)
+{
+	struct scan_plan_chan *chan;
+	unsigned int freq, hits;
+	long last_seen;
+
+	if (sscanf(line, "%u %u %ld", &freq, &hits, &last_seen) != 3 ||
+	    freq == 0 || ess->num_chan >= SCAN_PLAN_MAX_CHAN)
+		return -1;
+
+	chan = &ess->chan[ess->num_chan];
+	chan->freq = freq;
+	chan->hits = hits;
+	chan->last_seen = last_seen;
+	if (scan_plan_chan_fresh(chan, now))
+		ess->num_chan++;
+
+	return 0;
+}
+
+
+static void scan_plan_load(struct scan_plan *plan)
+{
+	char *buf, *pos, *end, *eol;
+	struct scan_plan_ess *ess = NULL;
+	size_t len;
+	int lineno = 0;
+	os_time_t now = scan_plan_now();
+
+	buf = os_readfile(plan->fname, &len);
+	if (buf == NULL) {
+		wpa_printf(MSG_DEBUG, "Scan plan: Could not read '%s'",
+			   plan->fname);
+		return;
+	}
+
+	end = buf + len;
+	for (pos = buf; pos < end; pos = eol + 1) {
+		for (eol = pos; eol < end && *eol != '\n'; eol++)
+			;
+		if (eol == end)
+			break; /* truncated line */
+		*eol = '\0';
+		lineno++;
+
+		if (*pos == '#' || *pos == '\0')
+			continue;
+		if ((os_strncmp(pos, "ess=", 4) == 0 &&
+		     scan_plan_parse_ess(plan, pos + 4, &ess) < 0) ||
+		    (os_strncmp(pos, "chan=", 5) == 0 &&
+		     (ess == NULL || scan_plan_parse_chan(ess, pos + 5, now) < 0)))
+			wpa_printf(MSG_INFO, "Scan plan: Invalid line %d in '%s'",
+				   lineno, plan->fname);
+	}
+
+	os_free(buf);
+
+	wpa_printf(MSG_DEBUG, "Scan plan: Loaded %u SSIDs from '%s'",
+		   plan->num_ess, plan->fname);
+}
+
+
+/**
+ * scan_plan_init - Initialize scan planner for an interface
+ * @wpa_s: Pointer to wpa_supplicant data
+ * @fname: File for storing the channel history or %NULL
+ * Returns: Pointer to the scan planner or %NULL on failure
+ *
+ * The previously stored channel history is loaded from @fname.
+ */
+struct scan_plan * scan_plan_init(struct wpa_supplicant *wpa_s,
+				  const char *fname)
+{
+	struct scan_plan *plan;
+
+	plan = os_zalloc(sizeof(*plan));
+	if (plan == NULL)
+		return NULL;
+	plan->wpa_s = wpa_s;
+	dl_list_init(&plan->ess);
+	/* Start with the stored history instead of a full scan */
+	os_get_reltime(&plan->last_full);
+
+	if (fname) {
+		plan->fname = os_strdup(fname);
+		if (plan->fname == NULL) {
+			os_free(plan);
+			return NULL;
+		}
+		scan_plan_load(plan);
+	}
+
+	return plan;
+}
+
+
+static void scan_plan_pno_refresh(void *eloop_ctx, void *timeout_ctx)
+{
+	struct scan_plan *plan = eloop_ctx;
+	struct wpa_supplicant *wpa_s = plan->wpa_s;
+
+	if (!wpa_s->pno)
+		return;
+
+	wpa_dbg(wpa_s, MSG_DEBUG, "Scan plan: Restart PNO to update channels");
+	wpas_stop_pno(wpa_s);
+	wpas_start_pno(wpa_s);
+}
+
+
+/**
+ * scan_plan_deinit - Store and free scan planner data
+ * @plan: Scan planner from scan_plan_init()
+ */
+void scan_plan_deinit(struct scan_plan *plan)
+{
+	struct scan_plan_ess *ess, *prev;
+
+	if (plan == NULL)
+		return;
+
+	eloop_cancel_timeout(scan_plan_pno_refresh, plan, NULL);
+	scan_plan_save(plan);
+	dl_list_for_each_safe(ess, prev, &plan->ess, struct scan_plan_ess,
+			      list) {
+		dl_list_del(&ess->list);
+		os_free(ess);
+	}
+	os_free(plan->fname);
+	os_free(plan);
+}
+
+
+/**
+ * scan_plan_save - Store channel history into a file
+ * @plan: Scan planner from scan_plan_init()
+ * Returns: 0 on success (or if nothing was changed) or -1 on failure
+ *
+ * The file is replaced atomically, so an interrupted write does not lose the
+ * previously stored history.
+ */
+int scan_plan_save(struct scan_plan *plan)
+{
+	struct scan_plan_ess *ess;
+	char *tmp;
+	size_t len, i;
+	FILE *f;
+	os_time_t now;
+	int ret = 0;
+
+	if (plan == NULL || plan->fname == NULL || !plan->changed)
+		return 0;
+
+	len = os_strlen(plan->fname) + 5;
+	tmp = os_malloc(len);
+	if (tmp == NULL)
+		return -1;
+	os_snprintf(tmp, len, "%s.tmp", plan->fname);
+
+	f = fopen(tmp, "w");
+	if (f == NULL) {
+		wpa_printf(MSG_INFO, "Scan plan: Could not open '%s': %s",
+			   tmp, strerror(errno));
+		os_free(tmp);
+		return -1;
+	}
+
+	fprintf(f, "# Channel history; do not edit while wpa_supplicant is running\n");
+	now = scan_plan_now();
+	dl_list_for_each(ess, &plan->ess, struct scan_plan_ess, list) {
+		fprintf(f, "ess=");
+		for (i = 0; i < ess->ssid_len; i++)
+			fprintf(f, "%02x", ess->ssid[i]);
+		fprintf(f, "\n");
+		for (i = 0; i < ess->num_chan; i++) {
+			if (!scan_plan_chan_fresh(&ess->chan[i], now))
+				continue;
+			fprintf(f, "chan=%d %u %ld\n", ess->chan[i].freq,
+				ess->chan[i].hits,
+				(long) ess->chan[i].last_seen);
+		}
+	}
+
+	if (ferror(f) || fclose(f) != 0 || rename(tmp, plan->fname) < 0) {
+		wpa_printf(MSG_INFO, "Scan plan: Could not write '%s': %s",
+			   plan->fname, strerror(errno));
+		unlink(tmp);
+		ret = -1;
+	} else {
+		plan->changed = 0;
+		wpa_printf(MSG_DEBUG, "Scan plan: Stored %u SSIDs to '%s'",
+			   plan->num_ess, plan->fname);
+	}
+	os_free(tmp);
+
+	return ret;
+}
+
+
+/**
+ * scan_plan_update - Record the channels of configured ESSs in scan results
+ * @plan: Scan planner from scan_plan_init()
+ * @scan_res: Scan results from the driver
+ */
+void scan_plan_update(struct scan_plan *plan,
+		      struct wpa_scan_results *scan_res)
+{
+	struct scan_plan_ess *ess;
+	os_time_t now;
+	const u8 *ie;
+	size_t i;
+
+	if (plan == NULL)
+		return;
+
+	now = scan_plan_now();
+	for (i = 0; i < scan_res->num; i++) {
+		struct wpa_scan_res *res = scan_res->res[i];
+
+		ie = wpa_scan_get_ie(res, WLAN_EID_SSID);
+		if (ie == NULL || ie[1] == 0 || res->freq <= 0 ||
+		    !scan_plan_configured(plan, ie + 2, ie[1]))
+			continue;
+
+		ess = scan_plan_get_ess(plan, ie + 2, ie[1]);
+		if (ess == NULL) {
+			wpa_printf(MSG_DEBUG, "Scan plan: New SSID %s",
+				   wpa_ssid_txt(ie + 2, ie[1]));
+			ess = scan_plan_add_ess(plan, ie + 2, ie[1]);
+			if (ess == NULL)
+				continue;
+		} else if (&ess->list != plan->ess.next) {
+			dl_list_del(&ess->list);
+			dl_list_add(&plan->ess, &ess->list);
+		}
+		scan_plan_seen(ess, res->freq, now);
+		plan->changed = 1;
+	}
+}
+
+
+static int scan_plan_add_ess_freqs(struct scan_plan_ess *ess, int **freqs,
+				   os_time_t now)
+{
+	unsigned int i;
+	int added = 0;
+
+	for (i = 0; ess && i < ess->num_chan; i++) {
+		if (!scan_plan_chan_fresh(&ess->chan[i], now))
+			continue;
+		int_array_add_unique(freqs, ess->chan[i].freq);
+		if (*freqs == NULL)
+			return -1;
+		added++;
+	}
+
+	return added;
+}
+
+
+/**
+ * scan_plan_freqs - Select the channels for a scan
+ * @plan: Scan planner from scan_plan_init()
+ * @type: Type of the scan (SCAN_PLAN_*)
+ * Returns: Zero terminated list of frequencies (to be freed with os_free())
+ * or %NULL if all channels are to be scanned
+ */
+int * scan_plan_freqs(struct scan_plan *plan, enum scan_plan_type type)
+{
+	struct wpa_supplicant *wpa_s;
+	struct wpa_ssid *ssid;
+	struct os_reltime now;
+	const char *reason;
+	int *freqs = NULL;
+	os_time_t t;
+
+	if (plan == NULL)
+		return NULL;
+	wpa_s = plan->wpa_s;
+
+	os_get_reltime(&now);
+	if (os_reltime_expired(&now, &plan->last_full,
+			       wpa_s->conf->scan_plan_full_interval)) {
+		reason = "periodic full scan";
+		goto full;
+	}
+	if (type == SCAN_PLAN_CONNECT && plan->partial_pending) {
+		reason = "no connection after the previous scan";
+		goto full;
+	}
+	if (wpa_s->conf->auto_interworking && wpa_s->conf->cred) {
+		reason = "Interworking network selection";
+		goto full;
+	}
+
+	t = scan_plan_now();
+	for (ssid = wpa_s->conf->ssid; ssid; ssid = ssid->next) {
+		if (wpas_network_disabled(wpa_s, ssid) ||
+		    ssid->mode != WPAS_MODE_INFRA)
+			continue;
+		if (ssid->ssid_len == 0) {
+			reason = "network without SSID enabled";
+			goto full;
+		}
+		if (ssid->scan_freq) {
+			int_array_concat(&freqs, ssid->scan_freq);
+			continue;
+		}
+		if (scan_plan_add_ess_freqs(scan_plan_get_ess(
+						    plan, ssid->ssid,
+						    ssid->ssid_len),
+					    &freqs, t) <= 0) {
+			wpa_dbg(wpa_s, MSG_DEBUG,
+				"Scan plan: No channel history for SSID %s",
+				wpa_ssid_txt(ssid->ssid, ssid->ssid_len));
+			reason = "no channel history";
+			goto full;
+		}
+	}
+
+	if (freqs == NULL) {
+		reason = "no enabled networks";
+		goto full;
+	}
+
+	if (wpa_s->wpa_state >= WPA_ASSOCIATED && wpa_s->assoc_freq)
+		int_array_add_unique(&freqs, wpa_s->assoc_freq);
+	int_array_sort_unique(freqs);
+	if (freqs == NULL)
+		return NULL;
+
+	wpa_dbg(wpa_s, MSG_DEBUG, "Scan plan: %s scan on %d channels",
+		type == SCAN_PLAN_PNO ? "PNO" : "Connection",
+		int_array_len(freqs));
+	if (type == SCAN_PLAN_CONNECT && wpa_s->wpa_state != WPA_COMPLETED)
+		plan->partial_pending = 1;
+	if (type == SCAN_PLAN_PNO) {
+		plan->pno_partial = 1;
+		eloop_cancel_timeout(scan_plan_pno_refresh, plan, NULL);
+		eloop_register_timeout(wpa_s->conf->scan_plan_full_interval, 0,
+				       scan_plan_pno_refresh, plan, NULL);
+	}
+
+	return freqs;
+
+full:
+	os_free(freqs);
+	wpa_dbg(wpa_s, MSG_DEBUG, "Scan plan: %s scan on all channels (%s)",
+		type == SCAN_PLAN_PNO ? "PNO" : "Connection", reason);
+	plan->last_full = now;
+	if (type == SCAN_PLAN_CONNECT)
+		plan->partial_pending = 0;
+	if (type == SCAN_PLAN_PNO) {
+		/*
+		 * Return to the channel history once the full scan has had
+		 * time to complete if the history was not the reason for the
+		 * full scan.
+		 */
+		eloop_cancel_timeout(scan_plan_pno_refresh, plan, NULL);
+		eloop_register_timeout(plan->pno_partial ?
+				       SCAN_PLAN_PNO_FULL_TIME :
+				       wpa_s->conf->scan_plan_full_interval,
+				       0, scan_plan_pno_refresh, plan, NULL);
+		plan->pno_partial = 0;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * scan_plan_ess_freqs - Get the channels an ESS has been seen on
+ * @plan: Scan planner from scan_plan_init()
+ * @ssid: SSID of the ESS
+ * @ssid_len: Length of the SSID
+ * Returns: Zero terminated list of frequencies (to be freed with os_free())
+ * or %NULL if the ESS has not been seen
+ */
+int * scan_plan_ess_freqs(struct scan_plan *plan, const u8 *ssid,
+			  size_t ssid_len)
+{
+	int *freqs = NULL;
+
+	if (plan == NULL)
+		return NULL;
+
+	scan_plan_add_ess_freqs(scan_plan_get_ess(plan, ssid, ssid_len),
+				&freqs, scan_plan_now());
+
+	return freqs;
+}
+
+
+/**
+ * scan_plan_scan_started - Account for a scan in connection statistics
+ * @plan: Scan planner from scan_plan_init()
+ * @freqs: Scanned frequencies or %NULL for all channels
+ */
+void scan_plan_scan_started(struct scan_plan *plan, const int *freqs)
+{
+	struct wpa_supplicant *wpa_s;
+	unsigned int num;
+
+	if (plan == NULL)
+		return;
+	wpa_s = plan->wpa_s;
+
+	if (freqs) {
+		num = int_array_len(freqs);
+		plan->partial_scans++;
+	} else {
+		num = scan_plan_num_channels(wpa_s);
+		plan->full_scans++;
+	}
+	plan->channels += num;
+
+	if (wpa_s->wpa_state == WPA_COMPLETED)
+		return;
+
+	if (!plan->connecting) {
+		plan->connecting = 1;
+		os_get_reltime(&plan->connect_start);
+		plan->connect_scans = 0;
+		plan->connect_channels = 0;
+	}
+	plan->connect_scans++;
+	plan->connect_channels += num;
+}
+
+
+/**
+ * scan_plan_state_changed - Notify scan planner of a state change
+ * @plan: Scan planner from scan_plan_init()
+ * @state: New wpa_supplicant state
+ *
+ * The time from the first scan to completed connection and the number of
+ * scans and channels scanned are recorded when a connection is completed.
+ */
+void scan_plan_state_changed(struct scan_plan *plan, enum wpa_states state)
+{
+	struct os_reltime now, diff;
+
+	if (plan == NULL)
+		return;
+
+	if (state == WPA_INACTIVE || state == WPA_INTERFACE_DISABLED) {
+		plan->connecting = 0;
+		return;
+	}
+
+	if (state != WPA_COMPLETED)
+		return;
+
+	plan->partial_pending = 0;
+	if (!plan->connecting)
+		return;
+	plan->connecting = 0;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, &plan->connect_start, &diff);
+	plan->last_connect_ms = diff.sec * 1000 + diff.usec / 1000;
+	plan->last_connect_scans = plan->connect_scans;
+	plan->last_connect_channels = plan->connect_channels;
+	plan->connections++;
+	plan->total_connect_ms += plan->last_connect_ms;
+	plan->total_connect_channels += plan->connect_channels;
+
+	wpa_dbg(plan->wpa_s, MSG_INFO,
+		"Scan plan: Connected %u ms after the first scan (%u scans, %u channels)",
+		plan->last_connect_ms, plan->last_connect_scans,
+		plan->last_connect_channels);
+
+	scan_plan_save(plan);
+}
+
+
+/**
+ * scan_plan_status - Write scan planner statistics and history into a buffer
+ * @plan: Scan planner from scan_plan_init()
+ * @buf: Buffer for the status text
+ * @buflen: Length of the buffer
+ * Returns: Number of characters written or -1 on failure
+ */
+int scan_plan_status(struct scan_plan *plan, char *buf, size_t buflen)
+{
+	struct scan_plan_ess *ess;
+	char *pos = buf, *end = buf + buflen;
+	unsigned int i;
+	int ret;
+
+	if (plan == NULL)
+		return -1;
+
+	ret = os_snprintf(pos, end - pos,
+			  "connections=%u\n"
+			  "avg_connect_ms=%lu\n"
+			  "avg_connect_channels=%lu\n"
+			  "last_connect_ms=%u\n"
+			  "last_connect_scans=%u\n"
+			  "last_connect_channels=%u\n"
+			  "partial_scans=%u\n"
+			  "full_scans=%u\n"
+			  "channels_scanned=%lu\n",
+			  plan->connections,
+			  plan->connections ?
+			  plan->total_connect_ms / plan->connections : 0,
+			  plan->connections ?
+			  plan->total_connect_channels / plan->connections : 0,
+			  plan->last_connect_ms, plan->last_connect_scans,
+			  plan->last_connect_channels, plan->partial_scans,
+			  plan->full_scans, plan->channels);
+	if (os_snprintf_error(end - pos, ret))
+		return pos - buf;
+	pos += ret;
+
+	dl_list_for_each(ess, &plan->ess, struct scan_plan_ess, list) {
+		ret = os_snprintf(pos, end - pos, "ssid=%s channels=",
+				  wpa_ssid_txt(ess->ssid, ess->ssid_len));
+		if (os_snprintf_error(end - pos, ret))
+			return pos - buf;
+		pos += ret;
+		for (i = 0; i < ess->num_chan; i++) {
+			ret = os_snprintf(pos, end - pos, "%s%d:%u",
+					  i ? "," : "", ess->chan[i].freq,
+					  ess->chan[i].hits);
+			if (os_snprintf_error(end - pos, ret))
+				return pos - buf;
+			pos += ret;
+		}
+		ret = os_snprintf(pos, end - pos, "\n");
+		if (os_snprintf_error(end - pos, ret))
+			return pos - buf;
+		pos += ret;
+	}
+
+	return pos - buf;
+}
@@ -0,0 +1,87 @@
+/*
+ * wpa_supplicant - Scan planning based on channel history
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef SCAN_PLAN_H
+#define SCAN_PLAN_H
+
+struct scan_plan;
+struct wpa_scan_results;
+
+enum scan_plan_type {
+	SCAN_PLAN_CONNECT,
+	SCAN_PLAN_PNO,
+};
+
+#ifdef CONFIG_SCAN_PLAN
+
+struct scan_plan * scan_plan_init(struct wpa_supplicant *wpa_s,
+				  const char *fname);
+void scan_plan_deinit(struct scan_plan *plan);
+int scan_plan_save(struct scan_plan *plan);
+void scan_plan_update(struct scan_plan *plan,
+		      struct wpa_scan_results *scan_res);
+int * scan_plan_freqs(struct scan_plan *plan, enum scan_plan_type type);
+int * scan_plan_ess_freqs(struct scan_plan *plan, const u8 *ssid,
+			  size_t ssid_len);
+void scan_plan_scan_started(struct scan_plan *plan, const int *freqs);
+void scan_plan_state_changed(struct scan_plan *plan, enum wpa_states state);
+int scan_plan_status(struct scan_plan *plan, char *buf, size_t buflen);
+
+#else /* CONFIG_SCAN_PLAN */
+
+static inline struct scan_plan * scan_plan_init(struct wpa_supplicant *wpa_s,
+						const char *fname)
+{
+	return NULL;
+}
+
+static inline void scan_plan_deinit(struct scan_plan *plan)
+{
+}
+
+static inline int scan_plan_save(struct scan_plan *plan)
+{
+	return 0;
+}
+
+static inline void scan_plan_update(struct scan_plan *plan,
+				    struct wpa_scan_results *scan_res)
+{
+}
+
+static inline int * scan_plan_freqs(struct scan_plan *plan,
+				    enum scan_plan_type type)
+{
+	return NULL;
+}
+
+static inline int * scan_plan_ess_freqs(struct scan_plan *plan,
+					const u8 *ssid, size_t ssid_len)
+{
+	return NULL;
+}
+
+static inline void scan_plan_scan_started(struct scan_plan *plan,
+					  const int *freqs)
+{
+}
+
+static inline void scan_plan_state_changed(struct scan_plan *plan,
+					   enum wpa_states state)
+{
+}
+
+static inline int scan_plan_status(struct scan_plan *plan, char *buf,
+				   size_t buflen)
+{
+	return -1;
+}
+
+#endif /* CONFIG_SCAN_PLAN */
+
+#endif /* SCAN_PLAN_H */
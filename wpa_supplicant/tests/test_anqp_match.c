@@ -0,0 +1,511 @@
+/*
+ * Test program for Interworking credential selection
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * A set of BSSes with NAI Realm, Roaming Consortium, and 3GPP Cellular
+ * Network information is matched against a set of credentials with
+ * interworking_credentials_available(), i.e., the selection done for each BSS
+ * in Interworking network selection. This is linked with the wpa_supplicant
+ * objects, so the production code is measured.
+ *
+ * As a reference, each selection pass is first run with the raw ANQP elements
+ * parsed for each credential (and the NAI Realm list once per BSS) the way
+ * the selection was done before anqp_match.c. The production selection is
+ * then run both with the credentials compiled and the ANQP elements parsed
+ * again in each pass ("cold") and with the cached tables ("cached"). All must
+ * select the same credential for each BSS; the time per selection pass is
+ * reported for each:
+ *
+ * test_anqp_match [-b BSSes] [-c credentials] [-r realms per BSS]
+ *                 [-p passes] [-d]
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "common/ieee802_11_defs.h"
+#include "eap_common/eap_defs.h"
+#include "eap_peer/eap_methods.h"
+#include "../wpa_supplicant_i.h"
+#include "../config.h"
+#include "../bss.h"
+#include "../interworking.h"
+#include "../anqp_match.h"
+
+/* Same condition as in interworking.c */
+#if defined(EAP_SIM) | defined(EAP_SIM_DYNAMIC)
+#define INTERWORKING_3GPP
+#else
+#if defined(EAP_AKA) | defined(EAP_AKA_DYNAMIC)
+#define INTERWORKING_3GPP
+#else
+#if defined(EAP_AKA_PRIME) | defined(EAP_AKA_PRIME_DYNAMIC)
+#define INTERWORKING_3GPP
+#endif
+#endif
+#endif
+
+static struct wpa_bss **bss;
+static unsigned int num_bss;
+static unsigned int num_cred;
+
+
+static unsigned int elapsed_usec(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	return diff.sec * 1000000 + diff.usec;
+}
+
+
+static void oi_id(unsigned int id, u8 *oi)
+{
+	oi[0] = 0x50;
+	WPA_PUT_BE16(&oi[1], id);
+}
+
+
+static void plmn_id(unsigned int id, u8 *plmn)
+{
+	/* MCC 3xy, three digit MNC */
+	plmn[0] = 0x03 | ((id / 100 % 10) << 4);
+	plmn[1] = (id / 10 % 10) | ((id / 1000 % 10) << 4);
+	plmn[2] = (id % 10) | ((id / 10000 % 10) << 4);
+}
+
+
+/*
+ * About half of the advertised operators have a matching credential. Every
+ * third BSS advertises only NAI Realms and every fifth one has no Roaming
+ * Consortium list, so that all three kinds of matches get selected.
+ */
+static struct wpa_bss * gen_bss(unsigned int idx, unsigned int realms)
+{
+	struct wpa_bss *b;
+	struct wpabuf *buf;
+	char name[100];
+	unsigned int i, id, len;
+	u8 *len_pos;
+
+	b = os_zalloc(sizeof(*b));
+	if (b == NULL)
+		return NULL;
+	b->bssid[0] = 0x02;
+	WPA_PUT_BE32(&b->bssid[2], idx);
+	b->ssid_len = os_snprintf((char *) b->ssid, sizeof(b->ssid), "hs20-%u",
+				  idx);
+	b->anqp = wpa_bss_anqp_alloc();
+	if (b->anqp == NULL)
+		return b;
+
+	buf = wpabuf_alloc(2 + realms * 120);
+	if (buf == NULL)
+		return b;
+	wpabuf_put_le16(buf, realms);
+	for (i = 0; i < realms; i++) {
+		id = (idx * 7 + i * 13) % (2 * num_cred);
+		if (i % 4 == 3)
+			len = os_snprintf(name, sizeof(name),
+					  "realm%u.example.com;Realm%u.example.com",
+					  id, (id + 1) % (2 * num_cred));
+		else
+			len = os_snprintf(name, sizeof(name),
+					  "realm%u.example.com", id);
+		len_pos = wpabuf_put(buf, 2);
+		wpabuf_put_u8(buf, 0); /* NAI Realm Encoding */
+		wpabuf_put_u8(buf, len);
+		wpabuf_put_data(buf, name, len);
+		wpabuf_put_u8(buf, 1); /* EAP Method Count */
+		wpabuf_put_u8(buf, 5); /* EAP Method Length */
+		wpabuf_put_u8(buf, EAP_TYPE_TTLS);
+		wpabuf_put_u8(buf, 1); /* Authentication Parameter Count */
+		wpabuf_put_u8(buf, NAI_REALM_EAP_AUTH_NON_EAP_INNER_AUTH);
+		wpabuf_put_u8(buf, 1);
+		wpabuf_put_u8(buf, NAI_REALM_INNER_NON_EAP_MSCHAPV2);
+		WPA_PUT_LE16(len_pos, (u8 *) wpabuf_put(buf, 0) - len_pos - 2);
+	}
+	b->anqp->nai_realm = buf;
+
+	if (idx % 3 == 0)
+		return b;
+
+	if (idx % 5 != 0) {
+		buf = wpabuf_alloc(3 * 4);
+		if (buf == NULL)
+			return b;
+		for (i = 0; i < 3; i++) {
+			wpabuf_put_u8(buf, 3);
+			oi_id((idx * 5 + i * 11) % (2 * num_cred),
+			      wpabuf_put(buf, 3));
+		}
+		b->anqp->roaming_consortium = buf;
+	}
+
+	buf = wpabuf_alloc(5 + 4 * 3);
+	if (buf == NULL)
+		return b;
+	wpabuf_put_u8(buf, 0); /* GUD version */
+	wpabuf_put_u8(buf, 3 + 4 * 3); /* UDHL */
+	wpabuf_put_u8(buf, 0); /* PLMN List IEI */
+	wpabuf_put_u8(buf, 1 + 4 * 3);
+	wpabuf_put_u8(buf, 4);
+	for (i = 0; i < 4; i++)
+		plmn_id((idx * 3 + i * 17) % (2 * num_cred),
+			wpabuf_put(buf, 3));
+	b->anqp->anqp_3gpp = buf;
+
+	return b;
+}
+
+
+static void free_bss(struct wpa_bss *b)
+{
+	if (b == NULL)
+		return;
+	wpa_bss_anqp_free(b->anqp);
+	os_free(b);
+}
+
+
+static int gen_creds(struct wpa_config *conf)
+{
+	struct wpa_cred *cred, *last = NULL;
+	char buf[100];
+	u8 plmn[3];
+	unsigned int i;
+
+	for (i = 0; i < num_cred; i++) {
+		cred = os_zalloc(sizeof(*cred));
+		if (cred == NULL)
+			return -1;
+		cred->id = i;
+		cred->priority = 1;
+		if (last)
+			last->next = cred;
+		else
+			conf->cred = cred;
+		last = cred;
+
+		os_snprintf(buf, sizeof(buf), "realm%u.example.com", i);
+		cred->realm = os_strdup(buf);
+		cred->username = os_strdup("user");
+		cred->password = os_strdup("password");
+		oi_id(i, cred->roaming_consortium);
+		cred->roaming_consortium_len = 3;
+		plmn_id(i, plmn);
+		os_snprintf(buf, sizeof(buf), "%x%x%x%x%x%x-0123456789",
+			     plmn[0] & 0x0f, plmn[0] >> 4, plmn[1] & 0x0f,
+			     plmn[2] & 0x0f, plmn[2] >> 4, plmn[1] >> 4);
+		cred->imsi = os_strdup(buf);
+		cred->milenage = os_strdup("milenage");
+		if (cred->realm == NULL || cred->username == NULL ||
+		    cred->password == NULL || cred->imsi == NULL ||
+		    cred->milenage == NULL)
+			return -1;
+	}
+
+	return 0;
+}
+
+
+/* NAI Realm match on the unsplit realm string, as done per credential */
+static int ref_realm_match(const char *realm, const char *home_realm)
+{
+	char *tmp, *pos, *end;
+	int match = 0;
+
+	tmp = os_strdup(realm);
+	if (tmp == NULL)
+		return 0;
+
+	pos = tmp;
+	while (*pos) {
+		end = os_strchr(pos, ';');
+		if (end)
+			*end = '\0';
+		if (os_strcasecmp(pos, home_realm) == 0) {
+			match = 1;
+			break;
+		}
+		if (end == NULL)
+			break;
+		pos = end + 1;
+	}
+
+	os_free(tmp);
+	return match;
+}
+
+
+static int ref_oi_match(const struct wpabuf *buf, const u8 *oi, size_t oi_len)
+{
+	const u8 *pos, *end;
+	u8 len;
+
+	if (buf == NULL)
+		return 0;
+	pos = wpabuf_head(buf);
+	end = pos + wpabuf_len(buf);
+	while (pos < end) {
+		len = *pos++;
+		if (pos + len > end)
+			break;
+		if (len == oi_len && os_memcmp(pos, oi, oi_len) == 0)
+			return 1;
+		pos += len;
+	}
+
+	return 0;
+}
+
+
+#ifdef INTERWORKING_3GPP
+static int ref_plmn_match(const struct wpabuf *buf, const struct wpa_cred *cred)
+{
+	u8 plmn[3], plmn2[3], num, i, iei, len;
+	const u8 *pos, *end, *l_end;
+	const char *sep;
+	char imsi[20];
+
+	if (buf == NULL)
+		return 0;
+	sep = os_strchr(cred->imsi, '-');
+	os_snprintf(imsi, sizeof(imsi), "%.*s%s",
+		    (int) (sep - cred->imsi), cred->imsi, sep + 1);
+	if (anqp_imsi_plmn(imsi, plmn, plmn2) < 0)
+		return 0;
+	pos = wpabuf_head_u8(buf);
+	end = pos + wpabuf_len(buf);
+	if (end - pos < 2 || *pos != 0 || pos + 2 + pos[1] > end)
+		return 0;
+	end = pos + 2 + pos[1];
+	pos += 2;
+
+	while (pos + 2 <= end) {
+		iei = *pos++;
+		len = *pos++ & 0x7f;
+		if (pos + len > end)
+			break;
+		l_end = pos + len;
+		if (iei == 0 && len > 0) {
+			num = *pos++;
+			for (i = 0; i < num && pos + 3 <= l_end; i++) {
+				if (os_memcmp(pos, plmn, 3) == 0 ||
+				    os_memcmp(pos, plmn2, 3) == 0)
+					return 1;
+				pos += 3;
+			}
+		}
+		pos = l_end;
+	}
+
+	return 0;
+}
+#endif /* INTERWORKING_3GPP */
+
+
+/*
+ * All credentials have the same priority, so the first matching credential in
+ * configuration order is selected and a Roaming Consortium match wins over a
+ * 3GPP match, which wins over a NAI Realm match.
+ */
+static void run_reference(struct wpa_cred *creds, struct wpa_cred **sel)
+{
+	struct wpa_bss_anqp *anqp;
+	struct anqp_parsed *parsed;
+	struct wpa_cred *cred, *realm, *plmn, *oi;
+	unsigned int b;
+	u16 i;
+
+	for (b = 0; b < num_bss; b++) {
+		anqp = bss[b]->anqp;
+		anqp_parsed_flush(anqp);
+		parsed = anqp_parsed_get(anqp);
+		realm = plmn = oi = NULL;
+		for (cred = creds; cred; cred = cred->next) {
+			for (i = 0; !realm && parsed && i < parsed->realm_count;
+			     i++) {
+				if (ref_realm_match(parsed->realm[i].realm,
+						    cred->realm))
+					realm = cred;
+			}
+			if (!oi &&
+			    ref_oi_match(anqp->roaming_consortium,
+					 cred->roaming_consortium,
+					 cred->roaming_consortium_len))
+				oi = cred;
+#ifdef INTERWORKING_3GPP
+			if (!plmn && ref_plmn_match(anqp->anqp_3gpp, cred))
+				plmn = cred;
+#endif /* INTERWORKING_3GPP */
+		}
+		sel[b] = oi ? oi : (plmn ? plmn : realm);
+		anqp_parsed_flush(anqp);
+	}
+}
+
+
+static void run_production(struct wpa_supplicant *wpa_s, int cold,
+			   struct wpa_cred **sel)
+{
+	unsigned int b;
+
+	if (cold)
+		interworking_cred_changed(wpa_s);
+	for (b = 0; b < num_bss; b++) {
+		if (cold)
+			anqp_parsed_flush(bss[b]->anqp);
+		sel[b] = interworking_credentials_available(wpa_s, bss[b],
+							    NULL);
+	}
+}
+
+
+static int compare(const char *name, unsigned int usec, unsigned int passes,
+		   struct wpa_cred **ref, struct wpa_cred **sel)
+{
+	unsigned int b, selected = 0;
+
+	for (b = 0; b < num_bss; b++) {
+		if (sel[b] != ref[b]) {
+			printf("%s: BSS %u: selected cred %d, expected %d\n",
+			       name, b, sel[b] ? sel[b]->id : -1,
+			       ref[b] ? ref[b]->id : -1);
+			return -1;
+		}
+		if (sel[b])
+			selected++;
+	}
+	printf("%-10s %10.1f us/pass  %6u of %u BSSes selected\n",
+	       name, (double) usec / passes, selected, num_bss);
+	return 0;
+}
+
+
+static void usage(void)
+{
+	printf("usage: test_anqp_match [-b BSSes] [-c credentials] "
+	       "[-r realms per BSS]\n"
+	       "                       [-p passes] [-d]\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct wpa_global global;
+	struct wpa_supplicant wpa_s;
+	struct wpa_config conf;
+	struct wpa_cred **ref = NULL, **sel = NULL;
+	struct wpa_cred *cred, *next;
+	struct os_reltime start;
+	unsigned int i, realms = 8, passes = 10, ref_usec, usec;
+	int c, ret = -1;
+
+	if (os_program_init())
+		return -1;
+
+	num_bss = 200;
+	num_cred = 100;
+	wpa_debug_level = MSG_ERROR;
+
+	for (;;) {
+		c = getopt(argc, argv, "b:c:dp:r:");
+		if (c < 0)
+			break;
+		switch (c) {
+		case 'b':
+			num_bss = atoi(optarg);
+			break;
+		case 'c':
+			num_cred = atoi(optarg);
+			break;
+		case 'd':
+			wpa_debug_level = MSG_DEBUG;
+			break;
+		case 'p':
+			passes = atoi(optarg);
+			break;
+		case 'r':
+			realms = atoi(optarg);
+			break;
+		default:
+			usage();
+			return -1;
+		}
+	}
+
+	if (num_bss == 0 || num_cred == 0 || num_cred > 10000 ||
+	    realms == 0 || realms > 500 || passes == 0) {
+		usage();
+		return -1;
+	}
+
+	os_memset(&global, 0, sizeof(global));
+	os_memset(&wpa_s, 0, sizeof(wpa_s));
+	os_memset(&conf, 0, sizeof(conf));
+	wpa_s.global = &global;
+	wpa_s.conf = &conf;
+	conf.ap_scan = 1;
+
+	bss = os_calloc(num_bss, sizeof(struct wpa_bss *));
+	ref = os_calloc(num_bss, sizeof(struct wpa_cred *));
+	sel = os_calloc(num_bss, sizeof(struct wpa_cred *));
+	if (bss == NULL || ref == NULL || sel == NULL ||
+	    eap_register_methods() < 0 || gen_creds(&conf) < 0)
+		goto out;
+	for (i = 0; i < num_bss; i++) {
+		bss[i] = gen_bss(i, realms);
+		if (bss[i] == NULL || bss[i]->anqp == NULL)
+			goto out;
+	}
+
+	printf("%u BSSes with %u NAI Realms, %u credentials\n",
+	       num_bss, realms, num_cred);
+
+	os_get_reltime(&start);
+	for (i = 0; i < passes; i++)
+		run_reference(conf.cred, ref);
+	ref_usec = elapsed_usec(&start);
+	if (compare("per-cred", ref_usec, passes, ref, ref) < 0)
+		goto out;
+
+	os_get_reltime(&start);
+	for (i = 0; i < passes; i++)
+		run_production(&wpa_s, 1, sel);
+	usec = elapsed_usec(&start);
+	if (compare("cold", usec, passes, ref, sel) < 0)
+		goto out;
+	printf("speedup %.1fx\n", (double) ref_usec / (usec ? usec : 1));
+
+	os_get_reltime(&start);
+	for (i = 0; i < passes; i++)
+		run_production(&wpa_s, 0, sel);
+	usec = elapsed_usec(&start);
+	if (compare("cached", usec, passes, ref, sel) < 0)
+		goto out;
+	printf("speedup %.1fx\n", (double) ref_usec / (usec ? usec : 1));
+
+	ret = 0;
+
+out:
+	interworking_cred_changed(&wpa_s);
+	for (i = 0; bss && i < num_bss; i++)
+		free_bss(bss[i]);
+	os_free(bss);
+	os_free(ref);
+	os_free(sel);
+	for (cred = conf.cred; cred; cred = next) {
+		next = cred->next;
+		wpa_config_free_cred(cred);
+	}
+	eap_peer_unregister_methods();
+	os_program_deinit();
+	printf("%s\n", ret == 0 ? "PASS" : "FAIL");
+
+	return ret;
+}
@@ -0,0 +1,550 @@
+/*
+ * Test program for BSS table updates from large scan results
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * A scan dump of a dense environment is generated once and replayed to the
+ * BSS table (bss.c) as the scan results of a number of scans in the same way
+ * the driver wrapper would deliver them. All BSSes report a new signal level
+ * and Beacon IEs (TIM) in each scan while the IEs of only a part of them
+ * change between scans. The time, the heap allocations, and the octets
+ * allocated per update round are reported and the BSS table contents and the
+ * IE change notifications are verified after each round:
+ *
+ * test_bss_ingest [-n BSSes] [-r rounds] [-c percent of BSSes changing IEs]
+ *                 [-d]
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "eloop.h"
+#include "common/ieee802_11_defs.h"
+#include "common/ieee802_11_common.h"
+#include "drivers/driver.h"
+#include "../wpa_supplicant_i.h"
+#include "../config.h"
+#include "../bss.h"
+
+
+#ifdef __GLIBC__
+/* Count heap allocations by wrapping the C library allocator */
+extern void * __libc_malloc(size_t size);
+extern void * __libc_calloc(size_t nmemb, size_t size);
+extern void * __libc_realloc(void *ptr, size_t size);
+
+static unsigned long num_allocs, alloc_bytes;
+
+void * malloc(size_t size)
+{
+	num_allocs++;
+	alloc_bytes += size;
+	return __libc_malloc(size);
+}
+
+
+void * calloc(size_t nmemb, size_t size)
+{
+	num_allocs++;
+	alloc_bytes += nmemb * size;
+	return __libc_calloc(nmemb, size);
+}
+
+
+void * realloc(void *ptr, size_t size)
+{
+	num_allocs++;
+	alloc_bytes += size;
+	return __libc_realloc(ptr, size);
+}
+#define ALLOC_COUNT() num_allocs
+#define ALLOC_BYTES() alloc_bytes
+#else /* __GLIBC__ */
+#define ALLOC_COUNT() 0
+#define ALLOC_BYTES() 0
+#endif /* __GLIBC__ */
+
+
+#define MAX_IES 400
+
+struct dump_bss {
+	u8 bssid[ETH_ALEN];
+	int freq;
+	unsigned int version; /* changed when the IEs change */
+};
+
+static struct dump_bss *dump;
+static unsigned int num_bss;
+static unsigned int ies_changed;
+
+
+/* Functions used by bss.c from the rest of wpa_supplicant */
+
+int wpa_supplicant_filter_bssid_match(struct wpa_supplicant *wpa_s,
+				      const u8 *bssid)
+{
+	return 1;
+}
+
+
+struct wpa_radio_work * radio_work_pending(struct wpa_supplicant *wpa_s,
+					   const char *type)
+{
+	return NULL;
+}
+
+
+static const u8 * get_ie(const u8 *pos, size_t len, u8 ie, u32 vendor_type)
+{
+	const u8 *end = pos + len;
+
+	while (pos + 1 < end) {
+		if (pos + 2 + pos[1] > end)
+			break;
+		if (pos[0] == ie &&
+		    (ie != WLAN_EID_VENDOR_SPECIFIC ||
+		     (pos[1] >= 4 && vendor_type == WPA_GET_BE32(&pos[2]))))
+			return pos;
+		pos += 2 + pos[1];
+	}
+
+	return NULL;
+}
+
+
+const u8 * wpa_scan_get_ie(const struct wpa_scan_res *res, u8 ie)
+{
+	return get_ie((const u8 *) (res + 1), res->ie_len, ie, 0);
+}
+
+
+const u8 * wpa_scan_get_vendor_ie(const struct wpa_scan_res *res,
+				  u32 vendor_type)
+{
+	return get_ie((const u8 *) (res + 1), res->ie_len,
+		      WLAN_EID_VENDOR_SPECIFIC, vendor_type);
+}
+
+
+struct wpabuf * wpa_scan_get_vendor_ie_multi(const struct wpa_scan_res *res,
+					     u32 vendor_type)
+{
+	const u8 *pos = (const u8 *) (res + 1), *end = pos + res->ie_len;
+	struct wpabuf *buf = NULL;
+
+	while ((pos = get_ie(pos, end - pos, WLAN_EID_VENDOR_SPECIFIC,
+			     vendor_type))) {
+		if (buf == NULL) {
+			buf = wpabuf_alloc(res->ie_len);
+			if (buf == NULL)
+				return NULL;
+		}
+		wpabuf_put_data(buf, pos + 6, pos[1] - 4);
+		pos += 2 + pos[1];
+	}
+
+	return buf;
+}
+
+
+#ifdef CONFIG_P2P
+int p2p_parse_dev_addr(const u8 *ies, size_t ies_len, u8 *dev_addr)
+{
+	return -1;
+}
+#endif /* CONFIG_P2P */
+
+
+#ifdef CONFIG_INTERWORKING
+int anqp_cache_preload(struct anqp_cache *cache, struct wpa_bss *bss)
+{
+	return 0;
+}
+
+
+void anqp_parsed_free(struct anqp_parsed *parsed)
+{
+}
+#endif /* CONFIG_INTERWORKING */
+
+
+void wpas_notify_bss_added(struct wpa_supplicant *wpa_s, u8 bssid[],
+			   unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_removed(struct wpa_supplicant *wpa_s, u8 bssid[],
+			     unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_ies_changed(struct wpa_supplicant *wpa_s,
+				 unsigned int id)
+{
+	ies_changed++;
+}
+
+
+void wpas_notify_bss_freq_changed(struct wpa_supplicant *wpa_s,
+				  unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_signal_changed(struct wpa_supplicant *wpa_s,
+				    unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_privacy_changed(struct wpa_supplicant *wpa_s,
+				     unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_mode_changed(struct wpa_supplicant *wpa_s,
+				  unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_wpaie_changed(struct wpa_supplicant *wpa_s,
+				   unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_rsnie_changed(struct wpa_supplicant *wpa_s,
+				   unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_wps_changed(struct wpa_supplicant *wpa_s,
+				 unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_rates_changed(struct wpa_supplicant *wpa_s,
+				   unsigned int id)
+{
+}
+
+
+void wpas_notify_bss_seen(struct wpa_supplicant *wpa_s, unsigned int id)
+{
+}
+
+
+static unsigned int elapsed_usec(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	return diff.sec * 1000000 + diff.usec;
+}
+
+
+static u8 * add_ie(u8 *pos, u8 eid, const u8 *data, size_t len)
+{
+	*pos++ = eid;
+	*pos++ = len;
+	if (data)
+		os_memcpy(pos, data, len);
+	else
+		os_memset(pos, 0, len);
+	return pos + len;
+}
+
+
+/* Build the IEs of a BSS the way a typical WPA2 AP with HT advertises them */
+static size_t gen_ies(const struct dump_bss *d, unsigned int idx,
+		      unsigned int round, int beacon, u8 *buf)
+{
+	static const u8 rates[] = { 0x82, 0x84, 0x8b, 0x96, 0x0c, 0x12, 0x18,
+				    0x24 };
+	static const u8 rsn[] = { 0x01, 0x00, 0x00, 0x0f, 0xac, 0x04, 0x01,
+				  0x00, 0x00, 0x0f, 0xac, 0x04, 0x01, 0x00,
+				  0x00, 0x0f, 0xac, 0x02, 0x00, 0x00 };
+	static const u8 wmm[] = { 0x00, 0x50, 0xf2, 0x02, 0x01, 0x01, 0x80,
+				  0x00, 0x03, 0xa4, 0x00, 0x00, 0x27, 0xa4,
+				  0x00, 0x00, 0x42, 0x43, 0x5e, 0x00, 0x62,
+				  0x32, 0x2f, 0x00 };
+	static const u8 wps[] = { 0x00, 0x50, 0xf2, 0x04, 0x10, 0x4a, 0x00,
+				  0x01, 0x10, 0x10, 0x44, 0x00, 0x01, 0x02 };
+	u8 *pos = buf, tmp[8];
+	char ssid[SSID_MAX_LEN];
+	int len;
+
+	/* A few BSSes in each ESS */
+	len = os_snprintf(ssid, sizeof(ssid), "ess-%u", idx / 4);
+	pos = add_ie(pos, WLAN_EID_SSID, (u8 *) ssid, len);
+	pos = add_ie(pos, WLAN_EID_SUPP_RATES, rates, sizeof(rates));
+	tmp[0] = d->freq < 5000 ? (d->freq - 2407) / 5 : (d->freq - 5000) / 5;
+	pos = add_ie(pos, WLAN_EID_DS_PARAMS, tmp, 1);
+	if (beacon) {
+		tmp[0] = round % 3; /* DTIM count */
+		tmp[1] = 3;
+		tmp[2] = 0;
+		tmp[3] = 0;
+		pos = add_ie(pos, WLAN_EID_TIM, tmp, 4);
+	}
+	WPA_PUT_LE16(tmp, d->version); /* station count */
+	tmp[2] = d->version * 7;
+	WPA_PUT_LE16(&tmp[3], 0);
+	pos = add_ie(pos, WLAN_EID_BSS_LOAD, tmp, 5);
+	pos = add_ie(pos, WLAN_EID_RSN, rsn, sizeof(rsn));
+	pos = add_ie(pos, WLAN_EID_HT_CAP, NULL, 26);
+	pos = add_ie(pos, WLAN_EID_HT_OPERATION, NULL, 22);
+	pos = add_ie(pos, WLAN_EID_EXT_CAPAB, NULL, 8);
+	pos = add_ie(pos, WLAN_EID_VENDOR_SPECIFIC, wmm, sizeof(wmm));
+	if (idx % 8 == 0)
+		pos = add_ie(pos, WLAN_EID_VENDOR_SPECIFIC, wps, sizeof(wps));
+
+	return pos - buf;
+}
+
+
+/* Deliver the dump as scan results like the driver wrapper does */
+static struct wpa_scan_results * replay_dump(unsigned int round,
+					     size_t *bytes)
+{
+	struct wpa_scan_results *res;
+	u8 ie[MAX_IES], beacon_ie[MAX_IES];
+	size_t ie_len, beacon_ie_len;
+	unsigned int i;
+
+	res = os_zalloc(sizeof(*res));
+	if (res == NULL)
+		return NULL;
+	res->res = os_calloc(num_bss, sizeof(struct wpa_scan_res *));
+	if (res->res == NULL) {
+		os_free(res);
+		return NULL;
+	}
+
+	for (i = 0; i < num_bss; i++) {
+		struct dump_bss *d = &dump[i];
+		struct wpa_scan_res *r;
+
+		ie_len = gen_ies(d, i, round, 0, ie);
+		beacon_ie_len = gen_ies(d, i, round, 1, beacon_ie);
+		r = os_zalloc(sizeof(*r) + ie_len + beacon_ie_len);
+		if (r == NULL)
+			break;
+		os_memcpy(r->bssid, d->bssid, ETH_ALEN);
+		r->freq = d->freq;
+		r->beacon_int = 100;
+		r->caps = IEEE80211_CAP_ESS | IEEE80211_CAP_PRIVACY;
+		r->flags = WPA_SCAN_LEVEL_DBM | WPA_SCAN_QUAL_INVALID |
+			WPA_SCAN_NOISE_INVALID;
+		r->level = -40 - (int) ((i + round) % 50);
+		r->tsf = round * 100000ULL;
+		r->ie_len = ie_len;
+		r->beacon_ie_len = beacon_ie_len;
+		os_memcpy(r + 1, ie, ie_len);
+		os_memcpy((u8 *) (r + 1) + ie_len, beacon_ie, beacon_ie_len);
+		res->res[res->num++] = r;
+		*bytes += sizeof(*r) + ie_len + beacon_ie_len;
+	}
+
+	return res;
+}
+
+
+static int check_table(struct wpa_supplicant *wpa_s, unsigned int round)
+{
+	u8 ie[MAX_IES], beacon_ie[MAX_IES];
+	size_t ie_len, beacon_ie_len;
+	unsigned int i;
+
+	if (wpa_s->num_bss != num_bss) {
+		printf("round %u: %u BSS entries, expected %u\n", round,
+		       (unsigned int) wpa_s->num_bss, num_bss);
+		return -1;
+	}
+
+	for (i = 0; i < num_bss; i++) {
+		struct dump_bss *d = &dump[i];
+		struct wpa_bss *bss;
+
+		bss = wpa_bss_get_bssid(wpa_s, d->bssid);
+		ie_len = gen_ies(d, i, round, 0, ie);
+		beacon_ie_len = gen_ies(d, i, round, 1, beacon_ie);
+		if (bss == NULL || bss->ie_len != ie_len ||
+		    bss->beacon_ie_len != beacon_ie_len ||
+		    os_memcmp(bss + 1, ie, ie_len) != 0 ||
+		    os_memcmp((u8 *) (bss + 1) + ie_len, beacon_ie,
+			      beacon_ie_len) != 0 ||
+		    bss->level != -40 - (int) ((i + round) % 50)) {
+			printf("round %u: BSS " MACSTR " not up to date\n",
+			       round, MAC2STR(d->bssid));
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+static void usage(void)
+{
+	printf("usage: test_bss_ingest [-n BSSes] [-r rounds] "
+	       "[-c percent of BSSes changing IEs] [-d]\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct wpa_supplicant *wpa_s;
+	struct wpa_config *conf;
+	unsigned int i, round, rounds = 20, change = 10, changed;
+	unsigned long total_usec = 0, total_allocs = 0, total_bytes = 0;
+	size_t dump_bytes = 0;
+	int c, ret = 0;
+
+	num_bss = 2000;
+
+	for (;;) {
+		c = getopt(argc, argv, "c:dn:r:");
+		if (c < 0)
+			break;
+		switch (c) {
+		case 'c':
+			change = atoi(optarg);
+			break;
+		case 'd':
+			wpa_debug_level = MSG_DEBUG;
+			break;
+		case 'n':
+			num_bss = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		default:
+			usage();
+			return -1;
+		}
+	}
+
+	if (num_bss == 0 || num_bss > 65536 || change > 100) {
+		usage();
+		return -1;
+	}
+
+	if (os_program_init())
+		return -1;
+	if (eloop_init()) {
+		os_program_deinit();
+		return -1;
+	}
+
+	dump = os_calloc(num_bss, sizeof(*dump));
+	wpa_s = os_zalloc(sizeof(*wpa_s));
+	conf = os_zalloc(sizeof(*conf));
+	if (dump == NULL || wpa_s == NULL || conf == NULL) {
+		ret = -1;
+		goto out;
+	}
+	conf->bss_max_count = num_bss;
+	conf->bss_expiration_age = DEFAULT_BSS_EXPIRATION_AGE;
+	conf->bss_expiration_scan_count = DEFAULT_BSS_EXPIRATION_SCAN_COUNT;
+	wpa_s->conf = conf;
+	os_strlcpy(wpa_s->ifname, "test", sizeof(wpa_s->ifname));
+	wpa_bss_init(wpa_s);
+
+	for (i = 0; i < num_bss; i++) {
+		dump[i].bssid[0] = 0x02;
+		WPA_PUT_BE32(&dump[i].bssid[1], i * 2654435761U);
+		dump[i].bssid[5] = i & 0xff;
+		dump[i].freq = i % 3 ? 5180 + 20 * (i % 8) : 2412 + 25 * (i % 3);
+	}
+
+	for (round = 0; round < rounds; round++) {
+		struct wpa_scan_results *res;
+		struct os_reltime start, fetch_time;
+		unsigned long allocs, bytes;
+		unsigned int usec;
+
+		changed = 0;
+		if (round > 0) {
+			for (i = 0; i < num_bss; i++) {
+				if ((i * 37 + round * 11) % 100 < change) {
+					dump[i].version++;
+					changed++;
+				}
+			}
+		}
+
+		dump_bytes = 0;
+		res = replay_dump(round, &dump_bytes);
+		if (res == NULL) {
+			ret = -1;
+			break;
+		}
+
+		ies_changed = 0;
+		allocs = ALLOC_COUNT();
+		bytes = ALLOC_BYTES();
+		os_get_reltime(&start);
+		fetch_time = start;
+		wpa_bss_update_start(wpa_s);
+		for (i = 0; i < res->num; i++)
+			wpa_bss_update_scan_res(wpa_s, res->res[i],
+						&fetch_time);
+		wpa_bss_update_end(wpa_s, NULL, 1);
+		usec = elapsed_usec(&start);
+		allocs = ALLOC_COUNT() - allocs;
+		bytes = ALLOC_BYTES() - bytes;
+		wpa_scan_results_free(res);
+
+		if (check_table(wpa_s, round) < 0 ||
+		    (round > 0 && ies_changed != changed)) {
+			printf("round %u: %u IE change notifications, "
+			       "expected %u\n", round, ies_changed, changed);
+			ret = -1;
+			break;
+		}
+
+		if (wpa_debug_level <= MSG_DEBUG || round == 0)
+			printf("round %u: %u usec, %lu allocs, %lu octets "
+			       "allocated, %u BSSes with changed IEs\n",
+			       round, usec, allocs, bytes,
+			       round ? changed : num_bss);
+		if (round > 0) {
+			total_usec += usec;
+			total_allocs += allocs;
+			total_bytes += bytes;
+		}
+	}
+
+	if (ret == 0 && rounds > 1) {
+		printf("%u BSSes, %lu octets of scan results per round, %u%% "
+		       "changing IEs\n",
+		       num_bss, (unsigned long) dump_bytes, change);
+		printf("update: %lu usec, %lu allocs, %lu octets allocated "
+		       "per round\n",
+		       total_usec / (rounds - 1), total_allocs / (rounds - 1),
+		       total_bytes / (rounds - 1));
+	}
+
+	wpa_bss_deinit(wpa_s);
+	os_free(wpa_s->last_scan_res);
+out:
+	os_free(wpa_s);
+	os_free(conf);
+	os_free(dump);
+	eloop_destroy();
+	os_program_deinit();
+
+	printf("%s\n", ret == 0 ? "PASS" : "FAIL");
+	return ret;
+}
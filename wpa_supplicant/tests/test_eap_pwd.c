@@ -0,0 +1,300 @@
+/*
+ * Test program and benchmark for the EAP-pwd server
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This runs the EAP-pwd server method up to the Commit/Request, i.e.,
+ * including the password element derivation and the server commit, for a
+ * number of sessions. The sessions are run with new group contexts for each
+ * session, with pooled contexts, and with the password element derived in
+ * worker threads.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "utils/worker.h"
+#include "eap_server/eap_i.h"
+#include "eap_server/eap_methods.h"
+#include "eap_common/eap_pwd_common.h"
+
+
+static const char *password = "test-eap-pwd-password";
+static const char *identity = "user@example.com";
+
+struct test_session {
+	struct eap_sm sm;
+	struct eap_user user;
+	void *priv;
+	struct wpabuf *resp;
+	int done;
+};
+
+static const struct eap_method *m;
+static unsigned int pending;
+
+
+void eap_server_pending_done(struct eap_sm *sm)
+{
+	struct test_session *sess = (struct test_session *) sm;
+
+	if (sm->method_pending == METHOD_PENDING_WAIT)
+		sm->method_pending = METHOD_PENDING_CONT;
+	sess->done = 1;
+	if (--pending == 0)
+		eloop_terminate();
+}
+
+
+static int test_session_init(struct test_session *sess, u16 group)
+{
+	os_memset(sess, 0, sizeof(*sess));
+	sess->user.password = (u8 *) password;
+	sess->user.password_len = os_strlen(password);
+	sess->sm.user = &sess->user;
+	sess->sm.pwd_group = group;
+	sess->priv = m->init(&sess->sm);
+	return sess->priv ? 0 : -1;
+}
+
+
+static void test_session_deinit(struct test_session *sess)
+{
+	if (sess->priv)
+		m->reset(&sess->sm, sess->priv);
+	sess->priv = NULL;
+	wpabuf_free(sess->resp);
+	sess->resp = NULL;
+}
+
+
+static const u8 * test_req_payload(const struct wpabuf *req, u8 exch,
+				   size_t *len)
+{
+	const u8 *pos;
+
+	pos = eap_hdr_validate(EAP_VENDOR_IETF, EAP_TYPE_PWD, req, len);
+	if (pos == NULL || *len < EAP_PWD_HDR_SIZE ||
+	    EAP_PWD_GET_EXCHANGE(*pos) != exch)
+		return NULL;
+	(*len)--;
+	return pos + 1;
+}
+
+
+/* Send the ID/Response to the server; returns 1 if the server is pending */
+static int test_session_start(struct test_session *sess)
+{
+	const struct eap_pwd_id *req_id;
+	struct wpabuf *req;
+	const u8 *pos;
+	size_t len;
+
+	req = m->buildReq(&sess->sm, sess->priv, 1);
+	if (req == NULL)
+		return -1;
+	pos = test_req_payload(req, EAP_PWD_OPCODE_ID_EXCH, &len);
+	if (pos == NULL || len < sizeof(*req_id)) {
+		wpabuf_free(req);
+		return -1;
+	}
+	req_id = (const struct eap_pwd_id *) pos;
+
+	sess->resp = eap_msg_alloc(EAP_VENDOR_IETF, EAP_TYPE_PWD,
+				   EAP_PWD_HDR_SIZE + sizeof(*req_id) +
+				   os_strlen(identity), EAP_CODE_RESPONSE, 1);
+	if (sess->resp == NULL) {
+		wpabuf_free(req);
+		return -1;
+	}
+	wpabuf_put_u8(sess->resp, EAP_PWD_OPCODE_ID_EXCH);
+	wpabuf_put_data(sess->resp, req_id, sizeof(*req_id));
+	wpabuf_put_str(sess->resp, identity);
+	wpabuf_free(req);
+
+	if (m->check(&sess->sm, sess->priv, sess->resp))
+		return -1;
+	m->process(&sess->sm, sess->priv, sess->resp);
+	return sess->sm.method_pending == METHOD_PENDING_WAIT;
+}
+
+
+/* Complete pending processing and verify the Commit/Request */
+static int test_session_commit(struct test_session *sess)
+{
+	struct wpabuf *req;
+	const u8 *pos;
+	size_t len;
+
+	if (sess->sm.method_pending == METHOD_PENDING_CONT) {
+		sess->sm.method_pending = METHOD_PENDING_NONE;
+		m->process(&sess->sm, sess->priv, sess->resp);
+	}
+	if (sess->sm.method_pending != METHOD_PENDING_NONE)
+		return -1;
+
+	req = m->buildReq(&sess->sm, sess->priv, 2);
+	if (req == NULL)
+		return -1;
+	pos = test_req_payload(req, EAP_PWD_OPCODE_COMMIT_EXCH, &len);
+	wpabuf_free(req);
+	return pos ? 0 : -1;
+}
+
+
+static double sessions_per_sec(struct os_reltime *start, int count)
+{
+	struct os_reltime now, diff;
+	double sec;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	sec = diff.sec + diff.usec / 1000000.0;
+	return sec > 0 ? count / sec : 0;
+}
+
+
+static int test_sync(u16 group, int num_sessions, int pooled, double *res)
+{
+	struct test_session sess;
+	struct os_reltime start;
+	int i;
+
+	os_get_reltime(&start);
+	for (i = 0; i < num_sessions; i++) {
+		if (!pooled)
+			eap_pwd_pool_deinit();
+		if (test_session_init(&sess, group) < 0 ||
+		    test_session_start(&sess) != 0 ||
+		    test_session_commit(&sess) < 0) {
+			test_session_deinit(&sess);
+			return -1;
+		}
+		test_session_deinit(&sess);
+	}
+	*res = sessions_per_sec(&start, num_sessions);
+	return 0;
+}
+
+
+static int test_workers(u16 group, int num_sessions, double *res)
+{
+	struct test_session *sess;
+	struct os_reltime start;
+	int i, ret = -1;
+
+	sess = os_calloc(num_sessions, sizeof(*sess));
+	if (sess == NULL)
+		return -1;
+
+	os_get_reltime(&start);
+	for (i = 0; i < num_sessions; i++) {
+		if (test_session_init(&sess[i], group) < 0)
+			goto fail;
+		switch (test_session_start(&sess[i])) {
+		case 0:
+			break;
+		case 1:
+			pending++;
+			break;
+		default:
+			goto fail;
+		}
+	}
+	if (pending)
+		eloop_run();
+	for (i = 0; i < num_sessions; i++) {
+		if (test_session_commit(&sess[i]) < 0)
+			goto fail;
+	}
+	*res = sessions_per_sec(&start, num_sessions);
+	ret = 0;
+
+fail:
+	for (i = 0; i < num_sessions; i++)
+		test_session_deinit(&sess[i]);
+	pending = 0;
+	os_free(sess);
+	return ret;
+}
+
+
+static int test_cancel(u16 group)
+{
+	struct test_session sess;
+	int res;
+
+	/* Free the session while the password element is being derived */
+	if (test_session_init(&sess, group) < 0)
+		return -1;
+	res = test_session_start(&sess);
+	test_session_deinit(&sess);
+	if (res < 0 || sess.done)
+		return -1;
+	worker_wait();
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	static const u16 groups[] = { 19, 20, 21 };
+	double fresh[ARRAY_SIZE(groups)], pooled[ARRAY_SIZE(groups)], workers;
+	int num_sessions = 50;
+	unsigned int i;
+	int ret = 0;
+
+	if (argc > 1)
+		num_sessions = atoi(argv[1]);
+	if (num_sessions < 1)
+		num_sessions = 1;
+
+	if (os_program_init() || eloop_init())
+		return -1;
+	if (eap_server_pwd_register() < 0 ||
+	    (m = eap_server_get_eap_method(EAP_VENDOR_IETF,
+					   EAP_TYPE_PWD)) == NULL) {
+		printf("Failed to register EAP-pwd\n");
+		ret = -1;
+		goto done;
+	}
+
+	printf("Testing EAP-pwd server (%d sessions)\n", num_sessions);
+
+	/* Without worker threads, the password element is derived in place */
+	for (i = 0; i < ARRAY_SIZE(groups); i++) {
+		if (test_sync(groups[i], num_sessions, 0, &fresh[i]) < 0 ||
+		    test_sync(groups[i], num_sessions, 1, &pooled[i]) < 0) {
+			printf("EAP-pwd group %d: test failed\n", groups[i]);
+			ret = -1;
+			goto done;
+		}
+	}
+
+	if (worker_init(0, 0) < 0)
+		printf("Worker threads not available\n");
+	for (i = 0; i < ARRAY_SIZE(groups); i++) {
+		workers = 0;
+		if (worker_threads() > 0 &&
+		    (test_workers(groups[i], num_sessions, &workers) < 0 ||
+		     test_cancel(groups[i]) < 0)) {
+			printf("EAP-pwd group %d: test failed\n", groups[i]);
+			ret = -1;
+			continue;
+		}
+		printf("EAP-pwd group %2d: new contexts %8.1f/s  pooled %8.1f/s  workers(%d) %8.1f/s\n",
+		       groups[i], fresh[i], pooled[i], worker_threads(),
+		       workers);
+	}
+
+done:
+	worker_deinit();
+	eap_server_unregister_methods();
+	eloop_destroy();
+	os_program_deinit();
+
+	return ret;
+}
@@ -0,0 +1,436 @@
+/*
+ * Test program and benchmark for the management frame pool
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This sends Probe Response frames as NL80211_CMD_FRAME commands to a mock
+ * kernel in a child process over a NETLINK_USERSOCK socket (this requires
+ * root privileges). The mock verifies the attributes and the frame contents,
+ * replies with a cookie, and acknowledges each command like the kernel does.
+ *
+ * The frames are sent first like driver_nl80211 does for heap buffers (a new
+ * netlink message is allocated and the frame is copied into it) and then with
+ * the frames allocated from the frame pool and the command built in the
+ * headroom in front of the frame with nl80211_frame_cmd_inplace(). The frame
+ * rate and the frame pool allocation counters are reported.
+ */
+
+#include "utils/includes.h"
+#include <sys/wait.h>
+#include <netlink/genl/genl.h>
+
+#include "utils/common.h"
+#include "utils/frame_pool.h"
+#include "common/ieee802_11_defs.h"
+#include "drivers/driver_nl80211.h"
+
+
+#define TEST_FAMILY 0x20
+#define TEST_IFINDEX 5
+#define TEST_FREQ 2412
+#define TEST_FRAME_LEN 300
+
+
+static void mock_send(int sock, const struct sockaddr_nl *to,
+		      const void *buf, size_t len)
+{
+	sendto(sock, buf, len, 0, (const struct sockaddr *) to, sizeof(*to));
+}
+
+
+static void mock_ack(int sock, const struct sockaddr_nl *to,
+		     const struct nlmsghdr *req, int error)
+{
+	struct {
+		struct nlmsghdr hdr;
+		struct nlmsgerr err;
+	} ack;
+
+	os_memset(&ack, 0, sizeof(ack));
+	ack.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(ack.err));
+	ack.hdr.nlmsg_type = NLMSG_ERROR;
+	ack.hdr.nlmsg_seq = req->nlmsg_seq;
+	ack.hdr.nlmsg_pid = req->nlmsg_pid;
+	ack.err.error = error;
+	ack.err.msg = *req;
+	ack.err.msg.nlmsg_len = NLMSG_HDRLEN;
+	mock_send(sock, to, &ack, sizeof(ack));
+}
+
+
+static void mock_cookie(int sock, const struct sockaddr_nl *to,
+			const struct nlmsghdr *req, u64 cookie)
+{
+	struct {
+		struct nlmsghdr hdr;
+		struct genlmsghdr genl;
+		struct nlattr attr;
+		u64 cookie;
+	} STRUCT_PACKED reply;
+
+	os_memset(&reply, 0, sizeof(reply));
+	reply.hdr.nlmsg_len = sizeof(reply);
+	reply.hdr.nlmsg_type = TEST_FAMILY;
+	reply.hdr.nlmsg_seq = req->nlmsg_seq;
+	reply.hdr.nlmsg_pid = req->nlmsg_pid;
+	reply.genl.cmd = NL80211_CMD_FRAME;
+	reply.attr.nla_len = NLA_HDRLEN + sizeof(u64);
+	reply.attr.nla_type = NL80211_ATTR_COOKIE;
+	reply.cookie = cookie;
+	mock_send(sock, to, &reply, sizeof(reply));
+}
+
+
+/* Verify NL80211_CMD_FRAME like nl80211_tx_mgmt() in cfg80211 */
+static int mock_check_frame(struct nlmsghdr *hdr)
+{
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+	struct genlmsghdr *genl = NLMSG_DATA(hdr);
+	const u8 *frame;
+	int i, len;
+
+	if (genl->cmd != NL80211_CMD_FRAME ||
+	    nla_parse(tb, NL80211_ATTR_MAX, nlmsg_attrdata(hdr, GENL_HDRLEN),
+		      nlmsg_attrlen(hdr, GENL_HDRLEN), NULL) < 0 ||
+	    !tb[NL80211_ATTR_IFINDEX] || !tb[NL80211_ATTR_WIPHY_FREQ] ||
+	    !tb[NL80211_ATTR_TX_NO_CCK_RATE] || !tb[NL80211_ATTR_FRAME] ||
+	    nla_get_u32(tb[NL80211_ATTR_IFINDEX]) != TEST_IFINDEX ||
+	    nla_get_u32(tb[NL80211_ATTR_WIPHY_FREQ]) != TEST_FREQ)
+		return -EINVAL;
+
+	frame = nla_data(tb[NL80211_ATTR_FRAME]);
+	len = nla_len(tb[NL80211_ATTR_FRAME]);
+	if (len != TEST_FRAME_LEN ||
+	    WPA_GET_LE16(frame) != IEEE80211_FC(WLAN_FC_TYPE_MGMT,
+						WLAN_FC_STYPE_PROBE_RESP))
+		return -EINVAL;
+	for (i = IEEE80211_HDRLEN; i < len; i++) {
+		if (frame[i] != (i & 0xff))
+			return -EINVAL;
+	}
+	return 0;
+}
+
+
+static void mock_kernel(int sock)
+{
+	static u8 buf[65536];
+	struct sockaddr_nl from;
+	socklen_t fromlen;
+	struct nlmsghdr *hdr;
+	u64 cookie = 0;
+	int len, err;
+
+	for (;;) {
+		fromlen = sizeof(from);
+		len = recvfrom(sock, buf, sizeof(buf), 0,
+			       (struct sockaddr *) &from, &fromlen);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			_exit(1);
+		}
+
+		for (hdr = (struct nlmsghdr *) buf; NLMSG_OK(hdr, len);
+		     hdr = NLMSG_NEXT(hdr, len)) {
+			if (hdr->nlmsg_len < NLMSG_LENGTH(GENL_HDRLEN))
+				continue;
+			err = mock_check_frame(hdr);
+			if (err == 0)
+				mock_cookie(sock, &from, hdr, ++cookie);
+			mock_ack(sock, &from, hdr, err);
+		}
+	}
+}
+
+
+static struct nl_handle * test_handle(u32 port)
+{
+	struct nl_handle *handle;
+
+	handle = nl_socket_alloc();
+	if (!handle)
+		return NULL;
+	if (nl_connect(handle, NETLINK_USERSOCK) < 0) {
+		nl_socket_free(handle);
+		return NULL;
+	}
+	nl_socket_set_peer_port(handle, port);
+	return handle;
+}
+
+
+static int test_ack(struct nl_msg *msg, void *arg)
+{
+	int *err = arg;
+
+	*err = 0;
+	return NL_STOP;
+}
+
+
+static int test_error(struct sockaddr_nl *nla, struct nlmsgerr *err,
+		      void *arg)
+{
+	int *ret = arg;
+
+	*ret = err->error;
+	return NL_SKIP;
+}
+
+
+static int test_seq_check(struct nl_msg *msg, void *arg)
+{
+	return NL_OK;
+}
+
+
+static int test_cookie(struct nl_msg *msg, void *arg)
+{
+	struct nlmsghdr *hdr = nlmsg_hdr(msg);
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+	u64 *cookie = arg;
+
+	if (nla_parse(tb, NL80211_ATTR_MAX, nlmsg_attrdata(hdr, GENL_HDRLEN),
+		      nlmsg_attrlen(hdr, GENL_HDRLEN), NULL) == 0 &&
+	    tb[NL80211_ATTR_COOKIE])
+		*cookie = nla_get_u64(tb[NL80211_ATTR_COOKIE]);
+	return NL_SKIP;
+}
+
+
+/* Receive the response like send_and_recv() in driver_nl80211 */
+static int test_recv(struct nl_handle *h, u64 *cookie)
+{
+	struct nl_cb *cb;
+	int err = 1;
+
+	cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!cb)
+		return -ENOMEM;
+	nl_cb_set(cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, test_seq_check, NULL);
+	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, test_ack, &err);
+	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, test_cookie, cookie);
+	nl_cb_err(cb, NL_CB_CUSTOM, test_error, &err);
+	while (err > 0)
+		nl_recvmsgs(h, cb);
+	nl_cb_put(cb);
+	return err;
+}
+
+
+static void test_build_frame(u8 *frame, size_t len)
+{
+	struct ieee80211_mgmt *mgmt = (struct ieee80211_mgmt *) frame;
+	size_t i;
+
+	mgmt->frame_control = host_to_le16(
+		IEEE80211_FC(WLAN_FC_TYPE_MGMT, WLAN_FC_STYPE_PROBE_RESP));
+	os_memset(mgmt->da, 0xff, ETH_ALEN);
+	for (i = IEEE80211_HDRLEN; i < len; i++)
+		frame[i] = i & 0xff;
+}
+
+
+/* Heap buffer and a new netlink message for each frame */
+static int test_send_copy(struct nl_handle *h)
+{
+	struct nl_msg *msg;
+	struct nlmsghdr *hdr;
+	struct genlmsghdr *genl;
+	u8 *frame;
+	u64 cookie = 0;
+	int ret = -1;
+
+	frame = os_zalloc(TEST_FRAME_LEN);
+	if (!frame)
+		return -1;
+	test_build_frame(frame, TEST_FRAME_LEN);
+
+	msg = nlmsg_alloc();
+	if (!msg)
+		goto fail;
+	hdr = nlmsg_put(msg, NL_AUTO_PORT, NL_AUTO_SEQ, TEST_FAMILY,
+			GENL_HDRLEN, 0);
+	if (!hdr ||
+	    nla_put_u32(msg, NL80211_ATTR_IFINDEX, TEST_IFINDEX) ||
+	    nla_put_u32(msg, NL80211_ATTR_WIPHY_FREQ, TEST_FREQ) ||
+	    nla_put_flag(msg, NL80211_ATTR_TX_NO_CCK_RATE) ||
+	    nla_put(msg, NL80211_ATTR_FRAME, TEST_FRAME_LEN, frame))
+		goto fail;
+	genl = nlmsg_data(hdr);
+	genl->cmd = NL80211_CMD_FRAME;
+
+	if (nl_send_auto_complete(h, msg) >= 0 &&
+	    test_recv(h, &cookie) == 0 && cookie)
+		ret = 0;
+fail:
+	nlmsg_free(msg);
+	os_free(frame);
+	return ret;
+}
+
+
+/* Pool buffer with the command built in front of the frame */
+static int test_send_inplace(struct nl_handle *h)
+{
+	static const u16 flags[] = { NL80211_ATTR_TX_NO_CCK_RATE };
+	struct nlmsghdr *hdr;
+	u8 *frame;
+	u64 cookie = 0;
+	int ret = -1;
+
+	frame = frame_pool_alloc(TEST_FRAME_LEN);
+	if (!frame)
+		return -1;
+	test_build_frame(frame, TEST_FRAME_LEN);
+
+	hdr = nl80211_frame_cmd_inplace(h, TEST_FAMILY, TEST_IFINDEX, NULL,
+					TEST_FREQ, 0, flags,
+					ARRAY_SIZE(flags), frame,
+					TEST_FRAME_LEN,
+					frame_pool_headroom(frame));
+	if (hdr && nl_sendto(h, hdr, hdr->nlmsg_len) >= 0 &&
+	    test_recv(h, &cookie) == 0 && cookie)
+		ret = 0;
+	frame_pool_free(frame);
+	return ret;
+}
+
+
+static int test_pool(void)
+{
+	struct frame_pool_stats stats;
+	u8 *frames[20], stack[TEST_FRAME_LEN], *large;
+	unsigned int i;
+	int ret = 0;
+
+	if (frame_pool_headroom(stack) != 0)
+		ret = -1;
+
+	/* Pool exhaustion and large frames fall back to the heap */
+	for (i = 0; i < ARRAY_SIZE(frames); i++)
+		frames[i] = frame_pool_alloc(TEST_FRAME_LEN);
+	large = frame_pool_alloc(4000);
+	frame_pool_get_stats(&stats);
+	if (!large || frame_pool_headroom(large) != 0 ||
+	    frame_pool_headroom(frames[0]) < FRAME_POOL_HEADROOM ||
+	    frame_pool_headroom(frames[ARRAY_SIZE(frames) - 1]) != 0 ||
+	    stats.in_use == 0 || stats.heap_allocs == 0)
+		ret = -1;
+	for (i = 0; i < ARRAY_SIZE(frames); i++) {
+		if (!frames[i])
+			ret = -1;
+		frame_pool_free(frames[i]);
+	}
+	frame_pool_free(large);
+	frame_pool_get_stats(&stats);
+	if (stats.in_use)
+		ret = -1;
+
+	if (ret)
+		printf("Frame pool tests failed\n");
+	return ret;
+}
+
+
+static double frames_per_sec(struct os_reltime *start, int count)
+{
+	struct os_reltime now, diff;
+	double sec;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	sec = diff.sec + diff.usec / 1000000.0;
+	return sec > 0 ? count / sec : 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct frame_pool_stats before, after;
+	struct sockaddr_nl addr;
+	socklen_t addrlen;
+	struct os_reltime start;
+	struct nl_handle *h = NULL;
+	int num_frames = 100000, mock, i, status, ret = -1;
+	double copy, inplace;
+	pid_t pid;
+
+	if (argc > 1)
+		num_frames = atoi(argv[1]);
+	if (num_frames < 1)
+		num_frames = 1;
+
+	mock = socket(AF_NETLINK, SOCK_RAW, NETLINK_USERSOCK);
+	os_memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addrlen = sizeof(addr);
+	if (mock < 0 ||
+	    bind(mock, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+	    getsockname(mock, (struct sockaddr *) &addr, &addrlen) < 0) {
+		printf("Failed to create mock netlink socket: %s\n",
+		       strerror(errno));
+		return -1;
+	}
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (pid == 0)
+		mock_kernel(mock);
+	close(mock);
+
+	if (os_program_init())
+		goto fail;
+	h = test_handle(addr.nl_pid);
+	if (!h) {
+		printf("Failed to initialize netlink handle\n");
+		goto fail;
+	}
+
+	if (test_pool() < 0)
+		goto fail;
+
+	printf("Testing NL80211_CMD_FRAME for %d frames\n", num_frames);
+	os_get_reltime(&start);
+	for (i = 0; i < num_frames; i++) {
+		if (test_send_copy(h) < 0) {
+			printf("Frame %d: copied frame command failed\n", i);
+			goto fail;
+		}
+	}
+	copy = frames_per_sec(&start, num_frames);
+
+	frame_pool_get_stats(&before);
+	os_get_reltime(&start);
+	for (i = 0; i < num_frames; i++) {
+		if (test_send_inplace(h) < 0) {
+			printf("Frame %d: in-place frame command failed\n", i);
+			goto fail;
+		}
+	}
+	inplace = frames_per_sec(&start, num_frames);
+	frame_pool_get_stats(&after);
+
+	printf("heap + copy:     %10.1f frames/s\n", copy);
+	printf("pool + in-place: %10.1f frames/s\n", inplace);
+	printf("frame pool: %lu pool and %lu heap allocations, at most %u buffers in use\n",
+	       after.pool_allocs - before.pool_allocs,
+	       after.heap_allocs - before.heap_allocs, after.max_in_use);
+	if (after.pool_allocs - before.pool_allocs != (unsigned long) num_frames ||
+	    after.heap_allocs != before.heap_allocs || after.in_use)
+		goto fail;
+	ret = 0;
+
+fail:
+	if (h)
+		nl_socket_free(h);
+	kill(pid, SIGTERM);
+	waitpid(pid, &status, 0);
+	frame_pool_deinit();
+	os_program_deinit();
+
+	return ret;
+}
@@ -0,0 +1,297 @@
+/*
+ * Benchmark for multicast-to-unicast fan-out and snooping RX with l2_packet
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This sends unicast copies of a broadcast packet to a number of destination
+ * addresses, first one packet at a time with l2_packet_send() (as done for
+ * each station when converting multicast to unicast for proxy ARP) and then
+ * with l2_packet_send_multi(). The packets are sent on one end of a veth
+ * pair and counted on the other end.
+ *
+ * For the receive side, a child process floods the veth pair with Neighbor
+ * Solicitation frames while they are received with the NDISC packet filter
+ * (as done for proxy ARP/NDISC snooping), first with recvfrom() for each
+ * packet and then through l2_packet_enable_rx_ring(). Throughput and the CPU
+ * time used per packet are reported for both:
+ *
+ * ip link add veth0 type veth peer name veth1
+ * ip link set veth0 up; ip link set veth1 up
+ * ./test-l2_packet veth0 veth1 [destinations] [rounds]
+ */
+
+#include "utils/includes.h"
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "l2_packet/l2_packet.h"
+
+
+/* Duration of each receive test in seconds */
+#define RX_TEST_TIME 1
+
+static unsigned int received;
+
+
+static void test_rx(void *ctx, const u8 *src_addr, const u8 *buf, size_t len)
+{
+	if (len >= ETH_ALEN && !(buf[0] & 0x01))
+		received++;
+}
+
+
+static void test_tx_rx(void *ctx, const u8 *src_addr, const u8 *buf,
+		       size_t len)
+{
+}
+
+
+static void test_rx_done(void *eloop_ctx, void *timeout_ctx)
+{
+	eloop_terminate();
+}
+
+
+static void test_receive(void)
+{
+	/* Count what has been queued on the receiving side */
+	eloop_register_timeout(0, 200000, test_rx_done, NULL, NULL);
+	eloop_run();
+}
+
+
+static double pkts_per_sec(struct os_reltime *start, unsigned int count)
+{
+	struct os_reltime now, diff;
+	double sec;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	sec = diff.sec + diff.usec / 1000000.0;
+	return sec > 0 ? count / sec : 0;
+}
+
+
+static double cpu_usec(void)
+{
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_SELF, &ru) < 0)
+		return 0;
+	return ru.ru_utime.tv_sec * 1000000.0 + ru.ru_utime.tv_usec +
+		ru.ru_stime.tv_sec * 1000000.0 + ru.ru_stime.tv_usec;
+}
+
+
+static void test_build_ns(struct l2_packet_data *l2, u8 *pkt, size_t len)
+{
+	static const u8 dst[ETH_ALEN] = {
+		0x33, 0x33, 0xff, 0x00, 0x00, 0x01
+	};
+	u8 *ip6 = &pkt[14], *icmp6 = &pkt[14 + 40];
+
+	/* Neighbor Solicitation to the solicited-node address of ::1 */
+	os_memset(pkt, 0, len);
+	os_memcpy(pkt, dst, ETH_ALEN);
+	l2_packet_get_own_addr(l2, &pkt[ETH_ALEN]);
+	WPA_PUT_BE16(&pkt[2 * ETH_ALEN], 0x86dd);
+	ip6[0] = 0x60;
+	WPA_PUT_BE16(&ip6[4], len - 14 - 40);
+	ip6[6] = 58; /* ICMPv6 */
+	ip6[7] = 255;
+	ip6[8] = 0xfe;
+	ip6[9] = 0x80;
+	os_memcpy(&ip6[18], &pkt[ETH_ALEN], ETH_ALEN);
+	ip6[24] = 0xff;
+	ip6[25] = 0x02;
+	ip6[35] = 0x01;
+	ip6[36] = 0xff;
+	ip6[39] = 0x01;
+	icmp6[0] = 135;
+	icmp6[23] = 0x01;
+}
+
+
+static pid_t test_flood(const char *ifname)
+{
+	struct l2_packet_data *tx;
+	struct os_reltime start, now;
+	u8 pkt[86], dst[64 * ETH_ALEN];
+	unsigned int i;
+	pid_t pid;
+
+	pid = fork();
+	if (pid != 0)
+		return pid;
+
+	tx = l2_packet_init(ifname, NULL, ETH_P_ALL, test_tx_rx, NULL, 1);
+	if (!tx)
+		_exit(1);
+	test_build_ns(tx, pkt, sizeof(pkt));
+	for (i = 0; i < 64; i++)
+		os_memcpy(&dst[i * ETH_ALEN], pkt, ETH_ALEN);
+	os_get_reltime(&start);
+	do {
+		if (l2_packet_send_multi(tx, dst, 64, pkt, sizeof(pkt)) < 0)
+			_exit(1);
+		os_get_reltime(&now);
+	} while (!os_reltime_expired(&now, &start, RX_TEST_TIME));
+	_exit(0);
+}
+
+
+static void test_rx_ndisc(void *ctx, const u8 *src_addr, const u8 *buf,
+			  size_t len)
+{
+	if (len >= 14 + 40 + 1 && buf[14 + 40] == 135)
+		received++;
+}
+
+
+static int test_receive_flood(const char *tx_ifname, const char *rx_ifname,
+			      int ring)
+{
+	struct l2_packet_data *rx;
+	struct os_reltime start;
+	double cpu, rate;
+	pid_t pid;
+	int status;
+
+	rx = l2_packet_init(rx_ifname, NULL, ETH_P_ALL, test_rx_ndisc, NULL, 1);
+	if (!rx ||
+	    l2_packet_set_packet_filter(rx, L2_PACKET_FILTER_NDISC) < 0 ||
+	    (ring && l2_packet_enable_rx_ring(rx) < 0)) {
+		printf("Failed to initialize %s receive\n",
+		       ring ? "RX ring" : "recvfrom()");
+		l2_packet_deinit(rx);
+		return -1;
+	}
+
+	received = 0;
+	pid = test_flood(tx_ifname);
+	if (pid < 0) {
+		l2_packet_deinit(rx);
+		return -1;
+	}
+	os_get_reltime(&start);
+	cpu = cpu_usec();
+	eloop_register_timeout(RX_TEST_TIME, 0, test_rx_done, NULL, NULL);
+	eloop_run();
+	cpu = cpu_usec() - cpu;
+	rate = pkts_per_sec(&start, received);
+	l2_packet_deinit(rx);
+	waitpid(pid, &status, 0);
+
+	printf("%-21s %10.0f pkts/s (received %u, %.2f usec CPU/pkt)\n",
+	       ring ? "RX ring:" : "recvfrom:",
+	       rate, received, received ? cpu / received : 0);
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0 && received ?
+		0 : -1;
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct l2_packet_data *tx, *rx;
+	struct os_reltime start;
+	u8 pkt[342], *addrs, addr[ETH_ALEN];
+	unsigned int num_dst = 1000, rounds = 20, i, r;
+	unsigned int sent;
+	double single, multi;
+	int res, ret = -1;
+
+	if (argc < 3) {
+		printf("usage: test-l2_packet <tx ifname> <rx ifname> [destinations] [rounds]\n");
+		return -1;
+	}
+	if (argc > 3)
+		num_dst = atoi(argv[3]);
+	if (argc > 4)
+		rounds = atoi(argv[4]);
+	if (num_dst < 1)
+		num_dst = 1;
+	if (rounds < 1)
+		rounds = 1;
+
+	if (os_program_init() || eloop_init())
+		return -1;
+
+	addrs = os_malloc(num_dst * ETH_ALEN);
+	tx = l2_packet_init(argv[1], NULL, ETH_P_ALL, test_tx_rx, NULL, 1);
+	rx = l2_packet_init(argv[2], NULL, ETH_P_ALL, test_rx, NULL, 1);
+	if (!addrs || !tx || !rx) {
+		printf("Failed to initialize l2_packet\n");
+		goto fail;
+	}
+
+	/* A broadcast frame of the size of a typical DHCP reply */
+	os_memset(pkt, 0, sizeof(pkt));
+	os_memset(pkt, 0xff, ETH_ALEN);
+	l2_packet_get_own_addr(tx, &pkt[ETH_ALEN]);
+	WPA_PUT_BE16(&pkt[2 * ETH_ALEN], 0x0800);
+	for (i = 0; i < num_dst; i++) {
+		addrs[i * ETH_ALEN] = 0x02;
+		addrs[i * ETH_ALEN + 1] = 0x00;
+		WPA_PUT_BE32(&addrs[i * ETH_ALEN + 2], i);
+	}
+
+	test_receive();
+	received = 0;
+	sent = 0;
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < num_dst; i++) {
+			os_memcpy(addr, pkt, ETH_ALEN);
+			os_memcpy(pkt, &addrs[i * ETH_ALEN], ETH_ALEN);
+			if (l2_packet_send(tx, NULL, 0, pkt, sizeof(pkt)) >= 0)
+				sent++;
+			os_memcpy(pkt, addr, ETH_ALEN);
+		}
+	}
+	single = pkts_per_sec(&start, sent);
+	test_receive();
+	printf("l2_packet_send:       %10.0f pkts/s (sent %u, received %u)\n",
+	       single, sent, received);
+
+	received = 0;
+	sent = 0;
+	os_get_reltime(&start);
+	for (r = 0; r < rounds; r++) {
+		res = l2_packet_send_multi(tx, addrs, num_dst, pkt,
+					   sizeof(pkt));
+		if (res < 0) {
+			printf("l2_packet_send_multi() not supported\n");
+			goto fail;
+		}
+		sent += res;
+	}
+	multi = pkts_per_sec(&start, sent);
+	test_receive();
+	printf("l2_packet_send_multi: %10.0f pkts/s (sent %u, received %u)\n",
+	       multi, sent, received);
+
+	ret = sent == num_dst * rounds ? 0 : -1;
+
+	/* Only the receive test sockets are to see the flood */
+	l2_packet_deinit(tx);
+	l2_packet_deinit(rx);
+	tx = rx = NULL;
+	if (test_receive_flood(argv[1], argv[2], 0) < 0 ||
+	    test_receive_flood(argv[1], argv[2], 1) < 0)
+		ret = -1;
+
+fail:
+	if (tx)
+		l2_packet_deinit(tx);
+	if (rx)
+		l2_packet_deinit(rx);
+	os_free(addrs);
+	eloop_destroy();
+	os_program_deinit();
+
+	return ret;
+}
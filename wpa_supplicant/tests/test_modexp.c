@@ -0,0 +1,283 @@
+/*
+ * Test program and benchmark for internal modular exponentiation
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "includes.h"
+
+#include "common.h"
+#include "crypto/crypto.h"
+#include "crypto/dh_groups.h"
+#include "tls/bignum.h"
+
+
+int random_get_bytes(void *buf, size_t len)
+{
+	return os_get_random(buf, len);
+}
+
+
+static int test_reference(const struct dh_group *dh, const struct wpabuf *base,
+			  const struct wpabuf *exp, const struct wpabuf *res)
+{
+	struct bignum *bn_base, *bn_exp, *bn_mod, *bn_res;
+	u8 buf[512];
+	size_t len = sizeof(buf);
+	int ret = -1;
+
+	bn_base = bignum_init();
+	bn_exp = bignum_init();
+	bn_mod = bignum_init();
+	bn_res = bignum_init();
+	if (!bn_base || !bn_exp || !bn_mod || !bn_res ||
+	    bignum_set_unsigned_bin(bn_base, wpabuf_head(base),
+				    wpabuf_len(base)) < 0 ||
+	    bignum_set_unsigned_bin(bn_exp, wpabuf_head(exp),
+				    wpabuf_len(exp)) < 0 ||
+	    bignum_set_unsigned_bin(bn_mod, dh->prime, dh->prime_len) < 0 ||
+	    bignum_exptmod(bn_base, bn_exp, bn_mod, bn_res) < 0 ||
+	    bignum_get_unsigned_bin(bn_res, buf, &len) < 0)
+		goto fail;
+
+	if (len != wpabuf_len(res) ||
+	    os_memcmp(buf, wpabuf_head(res), len) != 0) {
+		printf("DH group %d: result does not match bignum_exptmod()\n",
+		       dh->id);
+		goto fail;
+	}
+	ret = 0;
+fail:
+	bignum_deinit(bn_base);
+	bignum_deinit(bn_exp);
+	bignum_deinit(bn_mod);
+	bignum_deinit(bn_res);
+	return ret;
+}
+
+
+static int test_fixed_base(const struct dh_group *dh)
+{
+	struct bignum *bn_gen, *bn_exp, *bn_mod, *bn_res, *bn_ref;
+	struct bignum_fixed_base *fb = NULL;
+	u8 exp[512 + 2];
+	int i, ret = -1;
+
+	if (dh->prime_len + 2 > sizeof(exp))
+		return -1;
+
+	bn_gen = bignum_init();
+	bn_exp = bignum_init();
+	bn_mod = bignum_init();
+	bn_res = bignum_init();
+	bn_ref = bignum_init();
+	if (!bn_gen || !bn_exp || !bn_mod || !bn_res || !bn_ref ||
+	    bignum_set_unsigned_bin(bn_gen, dh->generator,
+				    dh->generator_len) < 0 ||
+	    bignum_set_unsigned_bin(bn_mod, dh->prime, dh->prime_len) < 0)
+		goto fail;
+
+	fb = bignum_fixed_base_init(bn_gen, bn_mod, dh->prime_len * 8);
+	if (fb == NULL) {
+		/* Not available without CONFIG_INTERNAL_LIBTOMMATH_FAST */
+		ret = 0;
+		goto fail;
+	}
+
+	/* Exponents 0, 1, 2^n - 1, and random values */
+	for (i = 0; i < 8; i++) {
+		if (i == 0 || i == 1) {
+			os_memset(exp, 0, dh->prime_len);
+			exp[dh->prime_len - 1] = i;
+		} else if (i == 2) {
+			os_memset(exp, 0xff, dh->prime_len);
+		} else if (os_get_random(exp, dh->prime_len) < 0) {
+			goto fail;
+		}
+		if (bignum_set_unsigned_bin(bn_exp, exp, dh->prime_len) < 0 ||
+		    bignum_fixed_base_exptmod(fb, bn_exp, bn_res) < 0 ||
+		    bignum_exptmod(bn_gen, bn_exp, bn_mod, bn_ref) < 0 ||
+		    bignum_cmp(bn_res, bn_ref) != 0) {
+			printf("DH group %d: fixed-base exponentiation failed\n",
+			       dh->id);
+			goto fail;
+		}
+	}
+
+	/* Exponents that do not fit in the table must be rejected */
+	exp[0] = 1;
+	os_memset(exp + 1, 0, dh->prime_len + 1);
+	if (bignum_set_unsigned_bin(bn_exp, exp, dh->prime_len + 2) < 0 ||
+	    bignum_fixed_base_exptmod(fb, bn_exp, bn_res) == 0) {
+		printf("DH group %d: too long exponent accepted\n", dh->id);
+		goto fail;
+	}
+	ret = 0;
+
+fail:
+	bignum_fixed_base_deinit(fb);
+	bignum_deinit(bn_gen);
+	bignum_deinit(bn_exp);
+	bignum_deinit(bn_mod);
+	bignum_deinit(bn_res);
+	bignum_deinit(bn_ref);
+	return ret;
+}
+
+
+static double ops_per_sec(struct os_reltime *start, int count)
+{
+	struct os_reltime now, diff;
+	double sec;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	sec = diff.sec + diff.usec / 1000000.0;
+	return sec > 0 ? count / sec : 0;
+}
+
+
+static int test_dh_group(int id, int iterations)
+{
+	const struct dh_group *dh = dh_groups_get(id);
+	struct wpabuf *priv_a = NULL, *priv_b = NULL, *pub_a, *pub_b;
+	struct wpabuf *shared_a = NULL, *shared_b = NULL, *gen;
+	struct wpabuf **peers = NULL;
+	struct bignum *bn_base, *bn_exp, *bn_mod, *bn_res;
+	struct os_reltime start;
+	double ref, keygen, shared;
+	int i, ret = -1;
+
+	if (dh == NULL)
+		return 0;
+
+	if (test_fixed_base(dh) < 0)
+		return -1;
+
+	/* Verify DH key agreement against plain bignum_exptmod() */
+	for (i = 0; i < 3; i++) {
+		wpabuf_clear_free(priv_a);
+		wpabuf_clear_free(priv_b);
+		wpabuf_clear_free(shared_a);
+		wpabuf_clear_free(shared_b);
+		priv_a = priv_b = shared_a = shared_b = NULL;
+		pub_a = dh_init(dh, &priv_a);
+		pub_b = dh_init(dh, &priv_b);
+		if (pub_a && pub_b) {
+			shared_a = dh_derive_shared(pub_b, priv_a, dh);
+			shared_b = dh_derive_shared(pub_a, priv_b, dh);
+		}
+		gen = wpabuf_alloc_copy(dh->generator, dh->generator_len);
+		if (!pub_a || !pub_b || !shared_a || !shared_b || !gen ||
+		    wpabuf_len(shared_a) != wpabuf_len(shared_b) ||
+		    os_memcmp(wpabuf_head(shared_a), wpabuf_head(shared_b),
+			      wpabuf_len(shared_a)) != 0 ||
+		    test_reference(dh, gen, priv_a, pub_a) < 0 ||
+		    test_reference(dh, pub_b, priv_a, shared_a) < 0) {
+			printf("DH group %d: key agreement failed\n", id);
+			wpabuf_free(gen);
+			wpabuf_free(pub_a);
+			wpabuf_free(pub_b);
+			goto fail;
+		}
+		wpabuf_free(gen);
+		wpabuf_free(pub_a);
+		wpabuf_free(pub_b);
+	}
+
+	bn_base = bignum_init();
+	bn_exp = bignum_init();
+	bn_mod = bignum_init();
+	bn_res = bignum_init();
+	if (!bn_base || !bn_exp || !bn_mod || !bn_res ||
+	    bignum_set_unsigned_bin(bn_base, dh->generator,
+				    dh->generator_len) < 0 ||
+	    bignum_set_unsigned_bin(bn_exp, wpabuf_head(priv_a),
+				    wpabuf_len(priv_a)) < 0 ||
+	    bignum_set_unsigned_bin(bn_mod, dh->prime, dh->prime_len) < 0) {
+		bignum_deinit(bn_base);
+		bignum_deinit(bn_exp);
+		bignum_deinit(bn_mod);
+		bignum_deinit(bn_res);
+		goto fail;
+	}
+	os_get_reltime(&start);
+	for (i = 0; i < iterations; i++)
+		bignum_exptmod(bn_base, bn_exp, bn_mod, bn_res);
+	ref = ops_per_sec(&start, iterations);
+	bignum_deinit(bn_base);
+	bignum_deinit(bn_exp);
+	bignum_deinit(bn_mod);
+	bignum_deinit(bn_res);
+
+	os_get_reltime(&start);
+	for (i = 0; i < iterations; i++) {
+		wpabuf_clear_free(priv_a);
+		priv_a = NULL;
+		pub_a = dh_init(dh, &priv_a);
+		if (!pub_a)
+			goto fail;
+		wpabuf_free(pub_a);
+	}
+	keygen = ops_per_sec(&start, iterations);
+
+	/* Use a different peer for each shared secret as in real use */
+	peers = os_calloc(iterations, sizeof(*peers));
+	if (!peers)
+		goto fail;
+	for (i = 0; i < iterations; i++) {
+		wpabuf_clear_free(priv_b);
+		priv_b = NULL;
+		peers[i] = dh_init(dh, &priv_b);
+		if (!peers[i])
+			goto fail;
+	}
+	os_get_reltime(&start);
+	for (i = 0; i < iterations; i++) {
+		wpabuf_clear_free(shared_a);
+		shared_a = dh_derive_shared(peers[i], priv_a, dh);
+		if (!shared_a)
+			goto fail;
+	}
+	shared = ops_per_sec(&start, iterations);
+
+	printf("DH group %2d (%4u bits): bignum_exptmod %8.1f ops/s  keypair %8.1f ops/s  shared secret %8.1f ops/s\n",
+	       id, (unsigned int) dh->prime_len * 8, ref, keygen, shared);
+	ret = 0;
+
+fail:
+	for (i = 0; peers && i < iterations; i++)
+		wpabuf_free(peers[i]);
+	os_free(peers);
+	wpabuf_clear_free(priv_a);
+	wpabuf_clear_free(priv_b);
+	wpabuf_clear_free(shared_a);
+	wpabuf_clear_free(shared_b);
+	return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+	static const int groups[] = { 1, 2, 5, 14, 15, 22, 23, 24 };
+	int iterations = 5;
+	int errors = 0;
+	unsigned int i;
+
+	if (argc > 1)
+		iterations = atoi(argv[1]);
+	if (iterations < 1)
+		iterations = 1;
+
+	printf("Testing modular exponentiation (%d iterations)\n",
+	       iterations);
+	for (i = 0; i < ARRAY_SIZE(groups); i++) {
+		if (test_dh_group(groups[i], iterations) < 0)
+			errors++;
+	}
+	crypto_mod_exp_deinit();
+
+	return errors;
+}
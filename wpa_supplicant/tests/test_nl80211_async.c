@@ -0,0 +1,474 @@
+/*
+ * Test program and benchmark for asynchronous nl80211 commands
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * The commands are sent to a mock kernel in a child process over a
+ * NETLINK_USERSOCK socket (this requires root privileges). The mock
+ * acknowledges each command like the kernel does, fails a test command with
+ * -EINVAL, and replies to a statistics request with the number of received
+ * datagrams and commands.
+ *
+ * The benchmark runs the nl80211 commands used for each association in an AP
+ * (DEL_STATION, NEW_STATION, SET_STATION, NEW_KEY, and SET_STATION to
+ * authorize the station) synchronously, with the SET_STATION commands sent
+ * asynchronously (as driver_nl80211 does), and with all commands pipelined.
+ * Since the mock runs in another process, each synchronous round trip
+ * includes a process switch that a real kernel would not need, so the numbers
+ * are mostly useful for comparing the modes with each other.
+ */
+
+#include "utils/includes.h"
+#include <sys/wait.h>
+#include <netlink/genl/genl.h>
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "drivers/driver_nl80211.h"
+
+
+#define TEST_FAMILY 0x20
+#define TEST_CMD_STATS 0xfd
+#define TEST_CMD_FAIL 0xfe
+
+struct test_result {
+	int called;
+	int err;
+	int order;
+	int valid;
+};
+
+static int order;
+
+
+static void mock_send(int sock, const struct sockaddr_nl *to,
+		      const void *buf, size_t len)
+{
+	sendto(sock, buf, len, 0, (const struct sockaddr *) to, sizeof(*to));
+}
+
+
+static void mock_ack(int sock, const struct sockaddr_nl *to,
+		     const struct nlmsghdr *req, int error)
+{
+	struct {
+		struct nlmsghdr hdr;
+		struct nlmsgerr err;
+	} ack;
+
+	os_memset(&ack, 0, sizeof(ack));
+	ack.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(ack.err));
+	ack.hdr.nlmsg_type = NLMSG_ERROR;
+	ack.hdr.nlmsg_seq = req->nlmsg_seq;
+	ack.hdr.nlmsg_pid = req->nlmsg_pid;
+	ack.err.error = error;
+	ack.err.msg = *req;
+	ack.err.msg.nlmsg_len = NLMSG_HDRLEN;
+	mock_send(sock, to, &ack, sizeof(ack));
+}
+
+
+static void mock_stats(int sock, const struct sockaddr_nl *to,
+		       const struct nlmsghdr *req, u32 datagrams, u32 cmds)
+{
+	struct {
+		struct nlmsghdr hdr;
+		struct genlmsghdr genl;
+		struct nlattr a1;
+		u32 datagrams;
+		struct nlattr a2;
+		u32 cmds;
+	} reply;
+
+	os_memset(&reply, 0, sizeof(reply));
+	reply.hdr.nlmsg_len = sizeof(reply);
+	reply.hdr.nlmsg_type = TEST_FAMILY;
+	reply.hdr.nlmsg_seq = req->nlmsg_seq;
+	reply.hdr.nlmsg_pid = req->nlmsg_pid;
+	reply.genl.cmd = TEST_CMD_STATS;
+	reply.a1.nla_len = NLA_HDRLEN + sizeof(u32);
+	reply.a1.nla_type = 1;
+	reply.datagrams = datagrams;
+	reply.a2.nla_len = NLA_HDRLEN + sizeof(u32);
+	reply.a2.nla_type = 2;
+	reply.cmds = cmds;
+	mock_send(sock, to, &reply, sizeof(reply));
+}
+
+
+static void mock_kernel(int sock)
+{
+	static u8 buf[65536];
+	struct sockaddr_nl from;
+	socklen_t fromlen;
+	struct nlmsghdr *hdr;
+	struct genlmsghdr *genl;
+	u32 datagrams = 0, cmds = 0;
+	int len;
+
+	for (;;) {
+		fromlen = sizeof(from);
+		len = recvfrom(sock, buf, sizeof(buf), 0,
+			       (struct sockaddr *) &from, &fromlen);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			_exit(1);
+		}
+		datagrams++;
+
+		/* Process all commands in the datagram like the kernel */
+		for (hdr = (struct nlmsghdr *) buf; NLMSG_OK(hdr, len);
+		     hdr = NLMSG_NEXT(hdr, len)) {
+			if (hdr->nlmsg_len < NLMSG_LENGTH(GENL_HDRLEN))
+				continue;
+			cmds++;
+			genl = NLMSG_DATA(hdr);
+			switch (genl->cmd) {
+			case TEST_CMD_STATS:
+				mock_stats(sock, &from, hdr, datagrams, cmds);
+				mock_ack(sock, &from, hdr, 0);
+				break;
+			case TEST_CMD_FAIL:
+				mock_ack(sock, &from, hdr, -EINVAL);
+				break;
+			default:
+				mock_ack(sock, &from, hdr, 0);
+				break;
+			}
+		}
+	}
+}
+
+
+static struct nl_handle * test_handle(u32 port)
+{
+	struct nl_handle *handle;
+
+	handle = nl_socket_alloc();
+	if (!handle)
+		return NULL;
+	if (nl_connect(handle, NETLINK_USERSOCK) < 0) {
+		nl_socket_free(handle);
+		return NULL;
+	}
+	nl_socket_set_peer_port(handle, port);
+	return handle;
+}
+
+
+static struct nl_msg * test_msg(u8 cmd, const u8 *addr)
+{
+	struct nl_msg *msg;
+	struct nlmsghdr *hdr;
+	struct genlmsghdr *genl;
+
+	msg = nlmsg_alloc();
+	if (!msg)
+		return NULL;
+	hdr = nlmsg_put(msg, NL_AUTO_PORT, NL_AUTO_SEQ, TEST_FAMILY,
+			GENL_HDRLEN, 0);
+	if (!hdr ||
+	    (addr && nla_put(msg, NL80211_ATTR_MAC, ETH_ALEN, addr))) {
+		nlmsg_free(msg);
+		return NULL;
+	}
+	genl = nlmsg_data(hdr);
+	genl->cmd = cmd;
+	return msg;
+}
+
+
+static int test_ack(struct nl_msg *msg, void *arg)
+{
+	int *err = arg;
+
+	*err = 0;
+	return NL_STOP;
+}
+
+
+static int test_error(struct sockaddr_nl *nla, struct nlmsgerr *err,
+		      void *arg)
+{
+	int *ret = arg;
+
+	*ret = err->error;
+	return NL_SKIP;
+}
+
+
+static int test_seq_check(struct nl_msg *msg, void *arg)
+{
+	return NL_OK;
+}
+
+
+/* Synchronous command like send_and_recv() in driver_nl80211 */
+static int test_send_sync(struct nl80211_async *async, struct nl_handle *h,
+			  struct nl_msg *msg)
+{
+	struct nl_cb *cb;
+	int err = -ENOMEM;
+
+	if (!msg)
+		return -ENOMEM;
+	if (nl80211_async_queued(async))
+		nl80211_async_flush(async);
+	cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!cb)
+		goto out;
+	err = nl_send_auto_complete(h, msg);
+	if (err < 0)
+		goto out;
+	err = 1;
+	nl_cb_set(cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, test_seq_check, NULL);
+	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, test_ack, &err);
+	nl_cb_err(cb, NL_CB_CUSTOM, test_error, &err);
+	while (err > 0)
+		nl_recvmsgs(h, cb);
+out:
+	nl_cb_put(cb);
+	nlmsg_free(msg);
+	return err;
+}
+
+
+static void test_done(void *ctx, int err)
+{
+	struct test_result *res = ctx;
+
+	res->called++;
+	res->err = err;
+	res->order = order++;
+}
+
+
+static int test_stats_reply(struct nl_msg *msg, void *arg)
+{
+	u32 *stats = arg;
+	struct nlmsghdr *hdr = nlmsg_hdr(msg);
+	struct nlattr *tb[3];
+
+	if (nla_parse(tb, 2, nlmsg_attrdata(hdr, GENL_HDRLEN),
+		      nlmsg_attrlen(hdr, GENL_HDRLEN), NULL) < 0 ||
+	    !tb[1] || !tb[2])
+		return NL_SKIP;
+	stats[0] = nla_get_u32(tb[1]);
+	stats[1] = nla_get_u32(tb[2]);
+	return NL_SKIP;
+}
+
+
+static int test_get_stats(struct nl80211_async *async, u32 *datagrams,
+			  u32 *cmds)
+{
+	u32 stats[2] = { 0, 0 };
+
+	if (nl80211_send_async(async, test_msg(TEST_CMD_STATS, NULL),
+			       test_stats_reply, stats, NULL, NULL) < 0 ||
+	    nl80211_async_wait(async) < 0 || !stats[1])
+		return -1;
+	*datagrams = stats[0];
+	*cmds = stats[1];
+	return 0;
+}
+
+
+static int test_results(struct nl80211_async *async)
+{
+	struct test_result res[4], cancelled;
+	u32 stats[2] = { 0, 0 };
+	u8 addr[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+	int i;
+
+	/* Errors are reported for the failed command only */
+	os_memset(res, 0, sizeof(res));
+	os_memset(&cancelled, 0, sizeof(cancelled));
+	order = 0;
+	if (nl80211_send_async(async, test_msg(NL80211_CMD_SET_STATION, addr),
+			       NULL, NULL, test_done, &res[0]) < 0 ||
+	    nl80211_send_async(async, test_msg(TEST_CMD_FAIL, addr),
+			       NULL, NULL, test_done, &res[1]) < 0 ||
+	    nl80211_send_async(async, test_msg(TEST_CMD_STATS, NULL),
+			       test_stats_reply, stats, test_done,
+			       &res[2]) < 0 ||
+	    nl80211_send_async(async, test_msg(NL80211_CMD_SET_STATION, addr),
+			       NULL, NULL, test_done, &cancelled) < 0 ||
+	    nl80211_send_async(async, test_msg(NL80211_CMD_SET_STATION, addr),
+			       NULL, NULL, test_done, &res[3]) < 0)
+		return -1;
+	if (nl80211_async_pending(async) != 5)
+		return -1;
+	nl80211_async_cancel(async, &cancelled);
+	if (nl80211_async_wait(async) < 0 || nl80211_async_pending(async))
+		return -1;
+
+	for (i = 0; i < 4; i++) {
+		if (res[i].called != 1 || res[i].order != i) {
+			printf("Command %d: unexpected completion\n", i);
+			return -1;
+		}
+	}
+	if (res[0].err || res[1].err != -EINVAL || res[2].err || res[3].err) {
+		printf("Unexpected command result\n");
+		return -1;
+	}
+	/* Queued commands go out in a single datagram */
+	if (stats[1] != stats[0] + 2) {
+		printf("Commands were not batched (%u datagrams, %u commands)\n",
+		       stats[0], stats[1]);
+		return -1;
+	}
+	if (cancelled.called) {
+		printf("Cancelled callback was called\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static double assoc_per_sec(struct os_reltime *start, int count)
+{
+	struct os_reltime now, diff;
+	double sec;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	sec = diff.sec + diff.usec / 1000000.0;
+	return sec > 0 ? count / sec : 0;
+}
+
+
+/*
+ * mode 0: all commands synchronous
+ * mode 1: SET_STATION asynchronous
+ * mode 2: all commands asynchronous
+ */
+static int test_assoc(struct nl80211_async *async, struct nl_handle *sync,
+		      int mode, int num_sta, double *rate, double *per_send)
+{
+	static const u8 cmds[] = {
+		NL80211_CMD_DEL_STATION, NL80211_CMD_NEW_STATION,
+		NL80211_CMD_SET_STATION, NL80211_CMD_NEW_KEY,
+		NL80211_CMD_SET_STATION
+	};
+	struct os_reltime start;
+	u32 datagrams, total, datagrams2, total2;
+	u8 addr[ETH_ALEN];
+	int i, res;
+	unsigned int j;
+
+	if (test_get_stats(async, &datagrams, &total) < 0)
+		return -1;
+
+	os_get_reltime(&start);
+	for (i = 0; i < num_sta; i++) {
+		addr[0] = 0x02;
+		addr[1] = 0x00;
+		WPA_PUT_BE32(&addr[2], i);
+		for (j = 0; j < ARRAY_SIZE(cmds); j++) {
+			if (mode == 2 ||
+			    (mode == 1 && cmds[j] == NL80211_CMD_SET_STATION))
+				res = nl80211_send_async(
+					async, test_msg(cmds[j], addr),
+					NULL, NULL, NULL, NULL);
+			else
+				res = test_send_sync(async, sync,
+						     test_msg(cmds[j], addr));
+			if (res < 0)
+				return -1;
+		}
+	}
+	if (nl80211_async_wait(async) < 0)
+		return -1;
+	*rate = assoc_per_sec(&start, num_sta);
+
+	if (test_get_stats(async, &datagrams2, &total2) < 0)
+		return -1;
+	/* Exclude the statistics requests themselves */
+	*per_send = (double) (total2 - total - 1) /
+		(datagrams2 - datagrams - 1);
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	static const char *modes[] = {
+		"synchronous", "async SET_STATION", "pipelined"
+	};
+	struct sockaddr_nl addr;
+	socklen_t addrlen;
+	struct nl_handle *sync = NULL, *h = NULL;
+	struct nl80211_async *async = NULL;
+	int num_sta = 1000, mock, mode, status, ret = -1;
+	double rate, per_send;
+	pid_t pid;
+
+	if (argc > 1)
+		num_sta = atoi(argv[1]);
+	if (num_sta < 1)
+		num_sta = 1;
+
+	mock = socket(AF_NETLINK, SOCK_RAW, NETLINK_USERSOCK);
+	os_memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addrlen = sizeof(addr);
+	if (mock < 0 ||
+	    bind(mock, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+	    getsockname(mock, (struct sockaddr *) &addr, &addrlen) < 0) {
+		printf("Failed to create mock netlink socket: %s\n",
+		       strerror(errno));
+		return -1;
+	}
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (pid == 0)
+		mock_kernel(mock);
+	close(mock);
+
+	if (os_program_init() || eloop_init())
+		goto fail;
+	sync = test_handle(addr.nl_pid);
+	h = test_handle(addr.nl_pid);
+	async = h ? nl80211_async_init(h) : NULL;
+	if (!sync || !async) {
+		printf("Failed to initialize netlink handles\n");
+		goto fail;
+	}
+
+	if (test_results(async) < 0) {
+		printf("Asynchronous command tests failed\n");
+		goto fail;
+	}
+
+	printf("Testing nl80211 commands for %d associations\n", num_sta);
+	for (mode = 0; mode < 3; mode++) {
+		if (test_assoc(async, sync, mode, num_sta, &rate,
+			       &per_send) < 0) {
+			printf("%s: test failed\n", modes[mode]);
+			goto fail;
+		}
+		printf("%-18s %10.1f associations/s  %5.1f commands/send\n",
+		       modes[mode], rate, per_send);
+	}
+	ret = 0;
+
+fail:
+	nl80211_async_deinit(async);
+	if (h)
+		nl_socket_free(h);
+	if (sync)
+		nl_socket_free(sync);
+	kill(pid, SIGTERM);
+	waitpid(pid, &status, 0);
+	eloop_destroy();
+	os_program_deinit();
+
+	return ret;
+}
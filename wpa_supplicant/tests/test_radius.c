@@ -0,0 +1,347 @@
+/*
+ * Test program and benchmark for RADIUS message parsing and signing
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This builds an Access-Accept like the ones received for IEEE 802.1X
+ * authentication (EAP-Success, MS-MPPE keys, Class, Session-Timeout, VLAN
+ * tunnel attributes, and WFA vendor attributes) and goes through the same
+ * lookups that hostapd does for it. The lookups are done both on the message
+ * as built and as parsed with radius_msg_parse() to verify that the results
+ * match, and the parse/verify/lookup sequence is then timed. Signing and
+ * verifying Access-Requests is timed both with and without the precomputed
+ * shared secret state attached to the messages.
+ */
+
+#include "utils/includes.h"
+#include <time.h>
+
+#include "utils/common.h"
+#include "utils/wpabuf.h"
+#include "radius/radius.h"
+
+
+static const u8 secret[] = "radius-test-secret";
+#define SECRET_LEN (sizeof(secret) - 1)
+
+
+struct test_result {
+	size_t eap_len;
+	size_t send_len, recv_len;
+	u8 send[32], recv[32];
+	int classes;
+	u32 session_timeout, termination_action, interim;
+	int vlan_id;
+	int wfa_attrs;
+	size_t cui_len;
+};
+
+
+static struct radius_msg *
+build_request(const struct radius_secret_state *state)
+{
+	static const u8 eap[] = { 2, 7, 0, 6, 13, 0 };
+	struct radius_msg *msg;
+	const char *user = "user@example.com";
+	u8 auth[16];
+	int i;
+
+	msg = radius_msg_new(RADIUS_CODE_ACCESS_REQUEST, 17);
+	if (!msg)
+		return NULL;
+	radius_msg_set_secret_state(msg, state);
+	for (i = 0; i < 16; i++)
+		auth[i] = i * 11;
+	os_memcpy(radius_msg_get_hdr(msg)->authenticator, auth, 16);
+	if (!radius_msg_add_attr(msg, RADIUS_ATTR_USER_NAME, (const u8 *) user,
+				 os_strlen(user)) ||
+	    !radius_msg_add_eap(msg, eap, sizeof(eap)) ||
+	    radius_msg_finish(msg, secret, SECRET_LEN) < 0) {
+		radius_msg_free(msg);
+		return NULL;
+	}
+	return msg;
+}
+
+
+static struct radius_msg *
+build_accept(struct radius_msg *req, const struct radius_secret_state *state)
+{
+	static const u8 eap_success[] = { 3, 7, 0, 4 };
+	const u8 *req_auth = radius_msg_get_hdr(req)->authenticator;
+	struct radius_msg *msg;
+	u8 send[32], recv[32], cls[40];
+	const char *vlan = "100";
+	u8 remediation[30];
+	int i, ok;
+
+	msg = radius_msg_new(RADIUS_CODE_ACCESS_ACCEPT, 17);
+	if (!msg)
+		return NULL;
+	radius_msg_set_secret_state(msg, state);
+	for (i = 0; i < 32; i++) {
+		send[i] = i;
+		recv[i] = 0x80 + i;
+	}
+	os_memset(cls, 'c', sizeof(cls));
+	remediation[0] = 1;
+	os_memcpy(remediation + 1, "https://example.com/remediate", 29);
+
+	ok = radius_msg_add_attr(msg, RADIUS_ATTR_USER_NAME,
+				 (const u8 *) "user@example.com", 16) &&
+		radius_msg_add_eap(msg, eap_success, sizeof(eap_success)) &&
+		radius_msg_add_attr(msg, RADIUS_ATTR_CLASS, cls,
+				    sizeof(cls)) &&
+		radius_msg_add_attr(msg, RADIUS_ATTR_CLASS, cls, 20) &&
+		radius_msg_add_attr_int32(msg, RADIUS_ATTR_SESSION_TIMEOUT,
+					  3600) &&
+		radius_msg_add_attr_int32(msg, RADIUS_ATTR_TERMINATION_ACTION,
+					  1) &&
+		radius_msg_add_attr_int32(msg, RADIUS_ATTR_ACCT_INTERIM_INTERVAL,
+					  600) &&
+		radius_msg_add_attr_int32(msg, RADIUS_ATTR_TUNNEL_TYPE,
+					  RADIUS_TUNNEL_TYPE_VLAN) &&
+		radius_msg_add_attr_int32(msg, RADIUS_ATTR_TUNNEL_MEDIUM_TYPE,
+					  RADIUS_TUNNEL_MEDIUM_TYPE_802) &&
+		radius_msg_add_attr(msg, RADIUS_ATTR_TUNNEL_PRIVATE_GROUP_ID,
+				    (const u8 *) vlan, os_strlen(vlan)) &&
+		radius_msg_add_attr(msg, RADIUS_ATTR_CHARGEABLE_USER_IDENTITY,
+				    (const u8 *) "cui-0123456789", 14) &&
+		radius_msg_add_mppe_keys(msg, req_auth, secret, SECRET_LEN,
+					 send, sizeof(send),
+					 recv, sizeof(recv)) &&
+		radius_msg_add_wfa(msg,
+				   RADIUS_VENDOR_ATTR_WFA_HS20_SUBSCR_REMEDIATION,
+				   remediation, sizeof(remediation)) &&
+		radius_msg_add_wfa(msg,
+				   RADIUS_VENDOR_ATTR_WFA_HS20_SESSION_INFO_URL,
+				   (const u8 *) "\x05https://example.com/info",
+				   25) &&
+		radius_msg_finish_srv(msg, secret, SECRET_LEN, req_auth) == 0;
+	if (!ok) {
+		radius_msg_free(msg);
+		return NULL;
+	}
+	return msg;
+}
+
+
+/* The lookups done by hostapd for a received Access-Accept */
+static int process_accept(struct radius_msg *msg, struct radius_msg *req,
+			  struct test_result *res)
+{
+	struct radius_ms_mppe_keys *keys;
+	struct wpabuf *eap;
+	u8 *buf, *pos = NULL;
+	size_t len;
+
+	os_memset(res, 0, sizeof(*res));
+
+	if (radius_msg_verify(msg, secret, SECRET_LEN, req, 1))
+		return -1;
+
+	eap = radius_msg_get_eap(msg);
+	if (!eap)
+		return -1;
+	res->eap_len = wpabuf_len(eap);
+	wpabuf_free(eap);
+
+	keys = radius_msg_get_ms_keys(msg, req, secret, SECRET_LEN);
+	if (!keys || !keys->send || !keys->recv ||
+	    keys->send_len != sizeof(res->send) ||
+	    keys->recv_len != sizeof(res->recv)) {
+		if (keys) {
+			bin_clear_free(keys->send, keys->send_len);
+			bin_clear_free(keys->recv, keys->recv_len);
+			os_free(keys);
+		}
+		return -1;
+	}
+	res->send_len = keys->send_len;
+	res->recv_len = keys->recv_len;
+	os_memcpy(res->send, keys->send, keys->send_len);
+	os_memcpy(res->recv, keys->recv, keys->recv_len);
+	bin_clear_free(keys->send, keys->send_len);
+	bin_clear_free(keys->recv, keys->recv_len);
+	os_free(keys);
+
+	res->classes = radius_msg_count_attr(msg, RADIUS_ATTR_CLASS, 1);
+	while (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_CLASS, &buf, &len,
+				       pos) == 0)
+		pos = buf;
+
+	if (radius_msg_get_attr_int32(msg, RADIUS_ATTR_SESSION_TIMEOUT,
+				      &res->session_timeout) ||
+	    radius_msg_get_attr_int32(msg, RADIUS_ATTR_TERMINATION_ACTION,
+				      &res->termination_action) ||
+	    radius_msg_get_attr_int32(msg, RADIUS_ATTR_ACCT_INTERIM_INTERVAL,
+				      &res->interim))
+		return -1;
+
+	res->vlan_id = radius_msg_get_vlanid(msg);
+
+	pos = NULL;
+	while (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_VENDOR_SPECIFIC, &buf,
+				       &len, pos) == 0) {
+		if (len >= 6 && WPA_GET_BE32(buf) == RADIUS_VENDOR_ID_WFA)
+			res->wfa_attrs++;
+		pos = buf;
+	}
+
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_CHARGEABLE_USER_IDENTITY,
+				    &buf, &res->cui_len, NULL) < 0)
+		return -1;
+
+	return 0;
+}
+
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static int test_sign_verify(unsigned int rounds,
+			    const struct radius_secret_state *state)
+{
+	struct radius_msg *req;
+	struct wpabuf *buf;
+	unsigned int i;
+	u64 start, t_sign, t_verify;
+
+	start = now_ns();
+	for (i = 0; i < rounds; i++) {
+		req = build_request(state);
+		if (!req)
+			return -1;
+		radius_msg_free(req);
+	}
+	t_sign = now_ns() - start;
+
+	req = build_request(state);
+	if (!req)
+		return -1;
+	buf = radius_msg_get_buf(req);
+	start = now_ns();
+	for (i = 0; i < rounds; i++) {
+		if (radius_msg_verify_msg_auth(req, secret, SECRET_LEN, NULL)) {
+			radius_msg_free(req);
+			return -1;
+		}
+	}
+	t_verify = now_ns() - start;
+
+	printf("Access-Request of %lu bytes, shared secret state %s\n",
+	       (unsigned long) wpabuf_len(buf),
+	       state ? "precomputed" : "recomputed");
+	printf("sign:                     %6.0f ns  (%.0f msg/s)\n",
+	       (double) t_sign / rounds, rounds * 1e9 / t_sign);
+	printf("verify:                   %6.0f ns  (%.0f msg/s)\n",
+	       (double) t_verify / rounds, rounds * 1e9 / t_verify);
+	radius_msg_free(req);
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct radius_msg *req, *accept, *parsed, *plain;
+	struct radius_secret_state *state;
+	struct test_result built_res, parsed_res;
+	struct wpabuf *buf;
+	unsigned int i, rounds = 100000;
+	u64 start, t_parse = 0, t_lookup = 0;
+	int ret = -1;
+
+	if (argc > 1)
+		rounds = atoi(argv[1]);
+	if (rounds < 1)
+		rounds = 1;
+
+	wpa_debug_level = MSG_ERROR;
+
+	state = radius_secret_state_init(secret, SECRET_LEN);
+	req = build_request(state);
+	accept = req ? build_accept(req, state) : NULL;
+	plain = build_request(NULL);
+	if (!accept || !plain) {
+		printf("Could not build RADIUS messages\n");
+		radius_msg_free(plain);
+		goto fail;
+	}
+	buf = radius_msg_get_buf(accept);
+
+	/* The precomputed state must not change the Message-Authenticator */
+	if (state &&
+	    (wpabuf_len(radius_msg_get_buf(req)) !=
+	     wpabuf_len(radius_msg_get_buf(plain)) ||
+	     os_memcmp(wpabuf_head(radius_msg_get_buf(req)),
+		       wpabuf_head(radius_msg_get_buf(plain)),
+		       wpabuf_len(radius_msg_get_buf(plain))) != 0)) {
+		printf("Access-Request signed with precomputed state differs\n");
+		radius_msg_free(plain);
+		goto fail;
+	}
+	radius_msg_free(plain);
+
+	parsed = radius_msg_parse(wpabuf_head(buf), wpabuf_len(buf));
+	if (!parsed ||
+	    process_accept(accept, req, &built_res) < 0 ||
+	    process_accept(parsed, req, &parsed_res) < 0) {
+		printf("Could not process Access-Accept\n");
+		radius_msg_free(parsed);
+		goto fail;
+	}
+	radius_msg_free(parsed);
+
+	if (os_memcmp(&built_res, &parsed_res, sizeof(built_res)) != 0 ||
+	    built_res.eap_len != 4 || built_res.classes != 2 ||
+	    built_res.session_timeout != 3600 || built_res.vlan_id != 100 ||
+	    built_res.wfa_attrs != 2 || built_res.cui_len != 14 ||
+	    built_res.send[31] != 31 || built_res.recv[31] != 0x80 + 31) {
+		printf("Lookup results do not match\n");
+		goto fail;
+	}
+
+	/* Parsing the received message and the lookups */
+	for (i = 0; i < rounds; i++) {
+		u64 mid;
+
+		start = now_ns();
+		parsed = radius_msg_parse(wpabuf_head(buf), wpabuf_len(buf));
+		mid = now_ns();
+		if (!parsed || process_accept(parsed, req, &parsed_res) < 0) {
+			radius_msg_free(parsed);
+			goto fail;
+		}
+		t_lookup += now_ns() - mid;
+		t_parse += mid - start;
+		radius_msg_free(parsed);
+	}
+
+	printf("Access-Accept of %lu bytes, %u rounds\n",
+	       (unsigned long) wpabuf_len(buf), rounds);
+	printf("parse:                    %6.0f ns\n",
+	       (double) t_parse / rounds);
+	printf("verify+lookups:           %6.0f ns\n",
+	       (double) t_lookup / rounds);
+
+	if ((state && test_sign_verify(rounds, state) < 0) ||
+	    test_sign_verify(rounds, NULL) < 0) {
+		printf("Could not sign and verify Access-Request\n");
+		goto fail;
+	}
+	ret = 0;
+
+fail:
+	radius_msg_free(accept);
+	radius_msg_free(req);
+	radius_secret_state_free(state);
+	return ret;
+}
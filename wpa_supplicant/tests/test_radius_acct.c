@@ -0,0 +1,359 @@
+/*
+ * Test program for RADIUS accounting queueing and spooling
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This runs the RADIUS client against a local stand-in accounting server that
+ * stops responding for a while. The accounting messages sent during the
+ * outage are queued (limited by acct_max_pending) and written to a spool file
+ * when the queue is full, and they have to be received by the server after it
+ * resumes. The same is then done over a RADIUS client restart, i.e., the
+ * messages left in the spool file by the previous instance are sent by the
+ * next one.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "radius/radius.h"
+#include "radius/radius_client.h"
+
+
+static const u8 secret[] = "acct-test-secret";
+#define SECRET_LEN (sizeof(secret) - 1)
+
+#define MAX_RECORDS 1000
+
+struct test_server {
+	int sock;
+	int paused;
+	unsigned int received, ignored, duplicates, delayed;
+	u8 seen[MAX_RECORDS];
+	unsigned int last_interim;
+};
+
+static struct test_server server;
+static unsigned int next_record, expected;
+
+
+static void server_receive(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct test_server *srv = eloop_ctx;
+	struct sockaddr_in from;
+	socklen_t fromlen = sizeof(from);
+	struct radius_msg *msg, *resp;
+	struct wpabuf *buf;
+	u8 data[3000], *val;
+	char id[9];
+	size_t len;
+	unsigned int rec;
+	u32 type;
+	int res;
+
+	res = recvfrom(sock, data, sizeof(data), 0, (struct sockaddr *) &from,
+		       &fromlen);
+	if (res < 0)
+		return;
+	if (srv->paused) {
+		srv->ignored++;
+		return;
+	}
+
+	msg = radius_msg_parse(data, res);
+	if (!msg)
+		return;
+	if (radius_msg_verify_acct_req(msg, secret, SECRET_LEN)) {
+		printf("Invalid Accounting-Request authenticator\n");
+		radius_msg_free(msg);
+		return;
+	}
+
+	if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_ACCT_SESSION_ID, &val,
+				    &len, NULL) == 0 && len == 8) {
+		os_memcpy(id, val, 8);
+		id[8] = '\0';
+		rec = strtoul(id, NULL, 16);
+		if (rec < MAX_RECORDS) {
+			if (srv->seen[rec])
+				srv->duplicates++;
+			else
+				srv->received++;
+			srv->seen[rec] = 1;
+		}
+		if (radius_msg_get_attr_int32(msg, RADIUS_ATTR_ACCT_STATUS_TYPE,
+					      &type) == 0 &&
+		    type == RADIUS_ACCT_STATUS_TYPE_INTERIM_UPDATE)
+			srv->last_interim = rec;
+		if (radius_msg_get_attr_ptr(msg, RADIUS_ATTR_ACCT_DELAY_TIME,
+					    &val, &len, NULL) == 0)
+			srv->delayed++;
+	}
+
+	resp = radius_msg_new(RADIUS_CODE_ACCOUNTING_RESPONSE,
+			      radius_msg_get_hdr(msg)->identifier);
+	if (resp) {
+		radius_msg_finish_acct_resp(resp, secret, SECRET_LEN,
+					    radius_msg_get_hdr(msg)->authenticator);
+		buf = radius_msg_get_buf(resp);
+		sendto(sock, wpabuf_head(buf), wpabuf_len(buf), 0,
+		       (struct sockaddr *) &from, fromlen);
+		radius_msg_free(resp);
+	}
+	radius_msg_free(msg);
+}
+
+
+static int server_init(struct test_server *srv)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+
+	os_memset(srv, 0, sizeof(*srv));
+	srv->sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (srv->sock < 0)
+		return -1;
+	os_memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(srv->sock, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+	    getsockname(srv->sock, (struct sockaddr *) &addr, &addrlen) < 0 ||
+	    eloop_register_read_sock(srv->sock, server_receive, srv, NULL) < 0)
+		return -1;
+	return ntohs(addr.sin_port);
+}
+
+
+static RadiusRxResult acct_receive(struct radius_msg *msg,
+				   struct radius_msg *req,
+				   const u8 *shared_secret,
+				   size_t shared_secret_len, void *data)
+{
+	if (radius_msg_verify(msg, shared_secret, shared_secret_len, req, 0))
+		return RADIUS_RX_INVALID_AUTHENTICATOR;
+	return RADIUS_RX_PROCESSED;
+}
+
+
+static int send_record(struct radius_client_data *radius, u32 status,
+		       const u8 *addr)
+{
+	struct radius_msg *msg;
+	char id[9];
+
+	msg = radius_msg_new(RADIUS_CODE_ACCOUNTING_REQUEST,
+			     radius_client_get_id(radius));
+	if (!msg)
+		return -1;
+	os_snprintf(id, sizeof(id), "%08X", next_record++);
+	if (!radius_msg_add_attr(msg, RADIUS_ATTR_ACCT_SESSION_ID,
+				 (const u8 *) id, 8) ||
+	    !radius_msg_add_attr_int32(msg, RADIUS_ATTR_ACCT_STATUS_TYPE,
+				       status) ||
+	    radius_client_send(radius, msg,
+			       status == RADIUS_ACCT_STATUS_TYPE_INTERIM_UPDATE ?
+			       RADIUS_ACCT_INTERIM : RADIUS_ACCT, addr) < 0) {
+		radius_msg_free(msg);
+		return -1;
+	}
+	return 0;
+}
+
+
+static int send_records(struct radius_client_data *radius, unsigned int num)
+{
+	u8 addr[ETH_ALEN] = { 0x02, 0, 0, 0, 0, 0 };
+	unsigned int i;
+
+	for (i = 0; i < num; i++) {
+		WPA_PUT_BE16(&addr[4], next_record);
+		if (send_record(radius, i & 1 ? RADIUS_ACCT_STATUS_TYPE_STOP :
+				RADIUS_ACCT_STATUS_TYPE_START, addr) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+
+static void wait_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	unsigned int *left = eloop_ctx;
+
+	if (*left == 0 || --(*left) == 0 || server.received >= expected) {
+		eloop_terminate();
+		return;
+	}
+	eloop_register_timeout(0, 100000, wait_timeout, left, NULL);
+}
+
+
+/* Run the event loop until the expected number of records has been received
+ * or for the given number of 100 ms steps */
+static void wait_records(unsigned int num, unsigned int steps)
+{
+	unsigned int left = steps;
+
+	expected = num;
+	eloop_register_timeout(0, 100000, wait_timeout, &left, NULL);
+	eloop_run();
+	eloop_cancel_timeout(wait_timeout, &left, NULL);
+}
+
+
+static long file_size(const char *fname)
+{
+	FILE *f;
+	long size;
+
+	f = fopen(fname, "rb");
+	if (!f)
+		return 0;
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fclose(f);
+	return size;
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct hostapd_radius_server acct_server;
+	struct hostapd_radius_servers conf;
+	struct radius_client_data *radius = NULL;
+	char spool[100];
+	u8 sta[ETH_ALEN] = { 0x02, 0xff, 0, 0, 0, 1 };
+	unsigned int i, interims = 0;
+	long spooled;
+	int port, ret = -1;
+
+	wpa_debug_level = MSG_WARNING;
+	os_snprintf(spool, sizeof(spool), "/tmp/test-radius-acct-%d",
+		    (int) getpid());
+	unlink(spool);
+
+	if (eloop_init() < 0)
+		return -1;
+	port = server_init(&server);
+	if (port < 0) {
+		printf("Could not start test server\n");
+		goto fail;
+	}
+
+	os_memset(&acct_server, 0, sizeof(acct_server));
+	acct_server.addr.af = AF_INET;
+	acct_server.addr.u.v4.s_addr = htonl(INADDR_LOOPBACK);
+	acct_server.port = port;
+	acct_server.shared_secret = (u8 *) secret;
+	acct_server.shared_secret_len = SECRET_LEN;
+	os_memset(&conf, 0, sizeof(conf));
+	conf.acct_servers = conf.acct_server = &acct_server;
+	conf.num_acct_servers = 1;
+	conf.acct_max_pending = 4;
+	conf.acct_spool = spool;
+
+	radius = radius_client_init(NULL, &conf);
+	if (!radius ||
+	    radius_client_register(radius, RADIUS_ACCT, acct_receive, NULL)) {
+		printf("Could not initialize RADIUS client\n");
+		goto fail;
+	}
+
+	/* Server responding */
+	if (send_records(radius, 20) < 0)
+		goto fail;
+	wait_records(20, 50);
+	if (server.received != 20 || file_size(spool) != 0) {
+		printf("Records not received with the server responding (%u)\n",
+		       server.received);
+		goto fail;
+	}
+
+	/* Outage: acct_max_pending requests are retransmitted, the queue is
+	 * filled, and the rest is written to the spool */
+	server.paused = 1;
+	if (send_records(radius, 10) < 0)
+		goto fail;
+	/* Queued interim updates for a station are replaced by newer ones */
+	for (i = 0; i < 10; i++) {
+		interims = next_record;
+		if (send_record(radius, RADIUS_ACCT_STATUS_TYPE_INTERIM_UPDATE,
+				sta) < 0)
+			goto fail;
+	}
+	if (send_records(radius, 400) < 0)
+		goto fail;
+	spooled = file_size(spool);
+	wait_records(next_record, 10);
+	server.paused = 0;
+	printf("Outage: %u requests ignored, %ld bytes spooled\n",
+	       server.ignored, spooled);
+	if (spooled == 0) {
+		printf("Nothing was spooled\n");
+		goto fail;
+	}
+
+	wait_records(next_record - 9, 300);
+	for (i = 0; i < next_record; i++) {
+		if (!server.seen[i] && (i < interims - 9 || i > interims))
+			break;
+	}
+	if (i < next_record || server.last_interim != interims ||
+	    server.seen[interims - 1] || server.received != next_record - 9) {
+		printf("Records lost after the outage (%u/%u received)\n",
+		       server.received, next_record);
+		goto fail;
+	}
+	printf("Resumed: %u received, %u duplicates, %u with Acct-Delay-Time\n",
+	       server.received, server.duplicates, server.delayed);
+	if (file_size(spool) != 0) {
+		printf("Spool not cleared after replay\n");
+		goto fail;
+	}
+
+	/* Outage over a restart of the RADIUS client */
+	server.paused = 1;
+	os_memset(server.seen, 0, sizeof(server.seen));
+	server.received = server.delayed = 0;
+	next_record = 0;
+	if (send_records(radius, 100) < 0)
+		goto fail;
+	radius_client_deinit(radius);
+	radius = NULL;
+	spooled = file_size(spool);
+	if (spooled == 0) {
+		printf("Nothing was spooled on deinit\n");
+		goto fail;
+	}
+
+	server.paused = 0;
+	radius = radius_client_init(NULL, &conf);
+	if (!radius ||
+	    radius_client_register(radius, RADIUS_ACCT, acct_receive, NULL) ||
+	    send_records(radius, 1) < 0)
+		goto fail;
+	wait_records(next_record, 100);
+	for (i = 0; i < next_record; i++) {
+		if (!server.seen[i])
+			break;
+	}
+	printf("Restart: %ld bytes spooled, %u received, %u with Acct-Delay-Time\n",
+	       spooled, server.received, server.delayed);
+	if (i < next_record || server.delayed < 100) {
+		printf("Records lost over restart\n");
+		goto fail;
+	}
+	ret = 0;
+
+fail:
+	radius_client_deinit(radius);
+	if (server.sock >= 0) {
+		eloop_unregister_read_sock(server.sock);
+		close(server.sock);
+	}
+	eloop_destroy();
+	unlink(spool);
+	printf("%s\n", ret == 0 ? "PASS" : "FAIL");
+	return ret;
+}
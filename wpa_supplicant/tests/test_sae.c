@@ -0,0 +1,277 @@
+/*
+ * Test program and benchmark for SAE
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This runs complete SAE handshakes between an AP and a number of stations
+ * with the Authentication frame bodies passed in memory instead of through a
+ * driver. The AP side derives PWE either synchronously (as hostapd does
+ * without worker threads), from a cached PWE (as for retries), or in worker
+ * threads (as hostapd does with CONFIG_WORKER_THREADS).
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "utils/worker.h"
+#include "crypto/random.h"
+#include "common/ieee802_11_defs.h"
+#include "common/sae.h"
+
+
+static const char *password = "test-sae-password";
+static const u8 ap_addr[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x01, 0x00 };
+
+struct test_sta {
+	u8 addr[ETH_ALEN];
+	struct sae_data sae; /* station side */
+	struct sae_data ap_sae; /* AP side */
+	struct sae_data job_sae; /* AP side PWE derivation in a worker */
+	int job_res;
+};
+
+static int allowed_groups[2];
+static unsigned int pending;
+static int errors;
+
+
+static int test_sta_init(struct test_sta *sta, unsigned int idx, int group)
+{
+	os_memset(sta, 0, sizeof(*sta));
+	sta->addr[0] = 0x02;
+	WPA_PUT_BE32(&sta->addr[2], idx);
+
+	/* Station side commit is not part of the measurement */
+	if (sae_set_group(&sta->sae, group) < 0 ||
+	    sae_set_group(&sta->ap_sae, group) < 0 ||
+	    sae_prepare_commit(sta->addr, ap_addr, (const u8 *) password,
+			       os_strlen(password), &sta->sae) < 0)
+		return -1;
+	return 0;
+}
+
+
+static void test_sta_deinit(struct test_sta *sta)
+{
+	sae_clear_data(&sta->sae);
+	sae_clear_data(&sta->ap_sae);
+	sae_clear_data(&sta->job_sae);
+}
+
+
+static int test_commit(struct sae_data *from, struct sae_data *to)
+{
+	struct wpabuf *buf;
+	const u8 *token;
+	size_t token_len;
+	u16 res;
+
+	buf = wpabuf_alloc(SAE_COMMIT_MAX_LEN);
+	if (!buf)
+		return -1;
+	sae_write_commit(from, buf, NULL);
+	res = sae_parse_commit(to, wpabuf_head(buf), wpabuf_len(buf),
+			       &token, &token_len, allowed_groups);
+	wpabuf_free(buf);
+	return res == WLAN_STATUS_SUCCESS ? 0 : -1;
+}
+
+
+static int test_confirm(struct sae_data *from, struct sae_data *to)
+{
+	struct wpabuf *buf;
+	int res;
+
+	buf = wpabuf_alloc(SAE_CONFIRM_MAX_LEN);
+	if (!buf)
+		return -1;
+	sae_write_confirm(from, buf);
+	res = sae_check_confirm(to, wpabuf_head(buf), wpabuf_len(buf));
+	wpabuf_free(buf);
+	return res;
+}
+
+
+/* Complete the handshake once the AP has prepared its commit */
+static int test_sta_exchange(struct test_sta *sta)
+{
+	if (test_commit(&sta->sae, &sta->ap_sae) < 0 ||
+	    test_commit(&sta->ap_sae, &sta->sae) < 0 ||
+	    sae_process_commit(&sta->ap_sae) < 0 ||
+	    sae_process_commit(&sta->sae) < 0 ||
+	    test_confirm(&sta->sae, &sta->ap_sae) < 0 ||
+	    test_confirm(&sta->ap_sae, &sta->sae) < 0 ||
+	    os_memcmp(sta->sae.pmk, sta->ap_sae.pmk, SAE_PMK_LEN) != 0) {
+		printf("SAE handshake failed for " MACSTR "\n",
+		       MAC2STR(sta->addr));
+		return -1;
+	}
+	return 0;
+}
+
+
+static int test_sta_import_pwe(struct test_sta *sta, const struct wpabuf *pwe)
+{
+	if (!pwe || sae_import_pwe(&sta->ap_sae, wpabuf_head(pwe),
+				   wpabuf_len(pwe)) < 0 ||
+	    sae_prepare_commit_pwe(&sta->ap_sae) < 0)
+		return -1;
+	return 0;
+}
+
+
+static void test_pwe_job(void *ctx)
+{
+	struct test_sta *sta = ctx;
+
+	sta->job_res = sae_derive_pwe(ap_addr, sta->addr,
+				      (const u8 *) password,
+				      os_strlen(password), &sta->job_sae);
+}
+
+
+static void test_pwe_job_done(void *ctx, int cancelled)
+{
+	struct test_sta *sta = ctx;
+	struct wpabuf *pwe;
+
+	pwe = cancelled || sta->job_res < 0 ? NULL :
+		sae_export_pwe(&sta->job_sae);
+	if (test_sta_import_pwe(sta, pwe) < 0 || test_sta_exchange(sta) < 0)
+		errors++;
+	wpabuf_clear_free(pwe);
+
+	if (--pending == 0)
+		eloop_terminate();
+}
+
+
+static double handshakes_per_sec(struct os_reltime *start, int count)
+{
+	struct os_reltime now, diff;
+	double sec;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	sec = diff.sec + diff.usec / 1000000.0;
+	return sec > 0 ? count / sec : 0;
+}
+
+
+static int test_group(int group, int num_sta)
+{
+	struct test_sta *sta;
+	struct wpabuf *pwe = NULL;
+	struct os_reltime start;
+	double full, cached, worker = 0;
+	int i, ret = -1;
+
+	allowed_groups[0] = group;
+	allowed_groups[1] = 0;
+
+	sta = os_calloc(num_sta, sizeof(*sta));
+	if (!sta)
+		return -1;
+
+	/* Full PWE derivation for each handshake */
+	for (i = 0; i < num_sta; i++) {
+		if (test_sta_init(&sta[i], i, group) < 0)
+			goto fail;
+	}
+	os_get_reltime(&start);
+	for (i = 0; i < num_sta; i++) {
+		if (sae_prepare_commit(ap_addr, sta[i].addr,
+				       (const u8 *) password,
+				       os_strlen(password),
+				       &sta[i].ap_sae) < 0 ||
+		    test_sta_exchange(&sta[i]) < 0)
+			goto fail;
+	}
+	full = handshakes_per_sec(&start, num_sta);
+
+	/* Retries from a single station using the cached PWE */
+	pwe = sae_export_pwe(&sta[0].ap_sae);
+	for (i = 0; i < num_sta; i++) {
+		test_sta_deinit(&sta[i]);
+		if (test_sta_init(&sta[i], 0, group) < 0)
+			goto fail;
+	}
+	os_get_reltime(&start);
+	for (i = 0; i < num_sta; i++) {
+		if (test_sta_import_pwe(&sta[i], pwe) < 0 ||
+		    test_sta_exchange(&sta[i]) < 0)
+			goto fail;
+	}
+	cached = handshakes_per_sec(&start, num_sta);
+
+	/* PWE derivation in worker threads */
+	if (worker_threads() > 0) {
+		for (i = 0; i < num_sta; i++) {
+			test_sta_deinit(&sta[i]);
+			if (test_sta_init(&sta[i], i, group) < 0 ||
+			    sae_set_group(&sta[i].job_sae, group) < 0)
+				goto fail;
+		}
+		errors = 0;
+		os_get_reltime(&start);
+		for (i = 0; i < num_sta; i++) {
+			if (worker_submit(test_pwe_job, test_pwe_job_done,
+					  &sta[i]) < 0)
+				goto fail;
+			pending++;
+		}
+		eloop_run();
+		worker = handshakes_per_sec(&start, num_sta);
+		if (errors)
+			goto fail;
+	}
+
+	printf("SAE group %2d: full %8.1f/s  cached PWE %8.1f/s  workers(%d) %8.1f/s\n",
+	       group, full, cached, worker_threads(), worker);
+	ret = 0;
+
+fail:
+	if (ret)
+		printf("SAE group %d: test failed\n", group);
+	wpabuf_clear_free(pwe);
+	for (i = 0; i < num_sta; i++)
+		test_sta_deinit(&sta[i]);
+	os_free(sta);
+	return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+	static const int groups[] = { 19, 20, 21 };
+	int num_sta = 20;
+	unsigned int i;
+	int ret = 0;
+
+	if (argc > 1)
+		num_sta = atoi(argv[1]);
+	if (num_sta < 1)
+		num_sta = 1;
+
+	if (os_program_init() || eloop_init())
+		return -1;
+	random_init(NULL);
+	if (worker_init(0, 0) < 0)
+		printf("Worker threads not available\n");
+
+	printf("Testing SAE handshakes (%d stations)\n", num_sta);
+	for (i = 0; i < ARRAY_SIZE(groups); i++) {
+		if (test_group(groups[i], num_sta) < 0)
+			ret = -1;
+	}
+
+	worker_deinit();
+	random_deinit();
+	eloop_destroy();
+	os_program_deinit();
+
+	return ret;
+}
@@ -0,0 +1,255 @@
+/*
+ * Test program for batched VLAN and bridge configuration over rtnetlink
+ * Copyright (c) 2016, hostapd/wpa_supplicant contributors
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ *
+ * This runs in a new network namespace, so it needs root privileges, but does
+ * not touch the interfaces of the host. A number of bridges is created first
+ * with one request per round trip (as done for each VLAN by vlan_newlink())
+ * and then in a single batch, and the times are reported. VLAN interfaces on
+ * a veth interface are then added to the bridges in one batch. If the kernel
+ * does not support VLAN interfaces, veth interfaces are used as the bridge
+ * ports instead. The bridge ports are verified with a link dump before all the
+ * interfaces are removed in a batch:
+ *
+ * ./test-vlan_rtnl [bridges]
+ */
+
+#define _GNU_SOURCE
+#include "utils/includes.h"
+#include <sched.h>
+#include <net/if.h>
+
+#include "utils/common.h"
+#include "ap/vlan_rtnl.h"
+
+
+struct link_count {
+	int num;
+	int *br_index;
+	int *ports;
+	unsigned int links;
+};
+
+
+static void count_cb(void *ctx, int ifindex, const char *ifname, int master)
+{
+	struct link_count *c = ctx;
+	int i;
+
+	c->links++;
+	for (i = 0; i < c->num; i++) {
+		if (master && c->br_index[i] == master)
+			c->ports[i]++;
+	}
+}
+
+
+static double elapsed(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	return diff.sec + diff.usec / 1000000.0;
+}
+
+
+static int delete_bridges(struct vlan_rtnl *rtnl, int num)
+{
+	char name[IFNAMSIZ];
+	int i;
+
+	for (i = 0; i < num; i++) {
+		os_snprintf(name, sizeof(name), "brvlan%d", i + 1);
+		vlan_rtnl_del_link(rtnl, name);
+	}
+	return vlan_rtnl_commit(rtnl);
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct vlan_rtnl *rtnl;
+	struct os_reltime start;
+	struct link_count count;
+	char name[IFNAMSIZ], br_name[IFNAMSIZ];
+	int num = 200, i, res, vlan = 1, ret = -1;
+	int *req = NULL;
+	unsigned int initial;
+	double seq, batch;
+
+	if (argc > 1)
+		num = atoi(argv[1]);
+	if (num <= 0 || num > 4094)
+		return -1;
+
+	wpa_debug_level = MSG_WARNING;
+	if (unshare(CLONE_NEWNET) < 0) {
+		printf("unshare(CLONE_NEWNET) failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	rtnl = vlan_rtnl_init();
+	req = os_calloc(num, sizeof(int));
+	count.num = num;
+	count.br_index = os_calloc(num, sizeof(int));
+	count.ports = os_calloc(num, sizeof(int));
+	if (!rtnl || !req || !count.br_index || !count.ports)
+		goto fail;
+
+	count.num = 0;
+	count.links = 0;
+	if (vlan_rtnl_dump_links(rtnl, count_cb, &count) < 0)
+		goto fail;
+	initial = count.links;
+	count.num = num;
+
+	/* One request per round trip */
+	os_get_reltime(&start);
+	for (i = 0; i < num; i++) {
+		os_snprintf(name, sizeof(name), "brvlan%d", i + 1);
+		if (vlan_rtnl_add_bridge(rtnl, name, 1) < 0 ||
+		    vlan_rtnl_commit(rtnl) != 0) {
+			printf("Could not create %s\n", name);
+			goto fail;
+		}
+	}
+	seq = elapsed(&start);
+	if (delete_bridges(rtnl, num) != 0) {
+		printf("Could not delete bridges\n");
+		goto fail;
+	}
+
+	/* All requests in one batch */
+	os_get_reltime(&start);
+	for (i = 0; i < num; i++) {
+		os_snprintf(name, sizeof(name), "brvlan%d", i + 1);
+		req[i] = vlan_rtnl_add_bridge(rtnl, name, 1);
+	}
+	res = vlan_rtnl_commit(rtnl);
+	batch = elapsed(&start);
+	for (i = 0; i < num; i++) {
+		if (vlan_rtnl_result(rtnl, req[i]) != 0)
+			break;
+	}
+	if (res != 0 || i < num) {
+		printf("Batch of %d bridges failed (%d)\n", num, res);
+		goto fail;
+	}
+	printf("%d bridges: %.3f s one by one, %.3f s batched\n",
+	       num, seq, batch);
+
+	/* Per-request results */
+	req[0] = vlan_rtnl_add_bridge(rtnl, "brvlan1", 1);
+	req[1] = vlan_rtnl_add_bridge(rtnl, "brtest", 0);
+	req[2] = vlan_rtnl_del_link(rtnl, "nonexistent");
+	if (vlan_rtnl_commit(rtnl) != 2 ||
+	    vlan_rtnl_result(rtnl, req[0]) != EEXIST ||
+	    vlan_rtnl_result(rtnl, req[1]) != 0 ||
+	    vlan_rtnl_result(rtnl, req[2]) != ENODEV) {
+		printf("Unexpected per-request results\n");
+		goto fail;
+	}
+	vlan_rtnl_del_link(rtnl, "brtest");
+
+	/* Bridge ports */
+	if (vlan_rtnl_add_link(rtnl, "vtest0", "veth", 1) < 0 ||
+	    vlan_rtnl_commit(rtnl) != 0) {
+		printf("Could not create veth interface\n");
+		goto fail;
+	}
+	os_get_reltime(&start);
+	for (i = 0; i < num; i++) {
+		os_snprintf(name, sizeof(name), "vlan%d", i + 1);
+		os_snprintf(br_name, sizeof(br_name), "brvlan%d", i + 1);
+		req[i] = vlan_rtnl_add_vlan(rtnl, "vtest0", i + 1, name,
+					    br_name, 1);
+	}
+	res = vlan_rtnl_commit(rtnl);
+	if (res > 0 && vlan_rtnl_result(rtnl, req[0]) == EOPNOTSUPP) {
+		printf("VLAN interfaces not supported; using veth ports\n");
+		vlan = 0;
+		os_get_reltime(&start);
+		for (i = 0; i < num; i++) {
+			os_snprintf(name, sizeof(name), "port%d", i + 1);
+			vlan_rtnl_add_link(rtnl, name, "veth", 1);
+		}
+		res = vlan_rtnl_commit(rtnl);
+		for (i = 0; res == 0 && i < num; i++) {
+			os_snprintf(name, sizeof(name), "port%d", i + 1);
+			os_snprintf(br_name, sizeof(br_name), "brvlan%d",
+				    i + 1);
+			vlan_rtnl_set_master(rtnl, name, br_name);
+		}
+		if (res == 0)
+			res = vlan_rtnl_commit(rtnl);
+	}
+	if (res != 0) {
+		printf("Could not add bridge ports (%d)\n", res);
+		goto fail;
+	}
+	printf("%d %s ports: %.3f s batched\n", num, vlan ? "VLAN" : "veth",
+	       elapsed(&start));
+
+	for (i = 0; i < num; i++) {
+		os_snprintf(br_name, sizeof(br_name), "brvlan%d", i + 1);
+		count.br_index[i] = if_nametoindex(br_name);
+	}
+	count.links = 0;
+	if (vlan_rtnl_dump_links(rtnl, count_cb, &count) < 0) {
+		printf("Link dump failed\n");
+		goto fail;
+	}
+	for (i = 0; i < num; i++) {
+		if (count.ports[i] != 1)
+			break;
+	}
+	os_snprintf(name, sizeof(name), vlan ? "vlan%d" : "port%d", num);
+	if (i < num ||
+	    vlan_rtnl_get_master(rtnl, name) != count.br_index[num - 1] ||
+	    vlan_rtnl_get_master(rtnl, "vtest0") != 0) {
+		printf("Unexpected bridge ports\n");
+		goto fail;
+	}
+	printf("Dump: %u links\n", count.links);
+
+	/* Detach one port, then remove everything in one batch */
+	os_snprintf(name, sizeof(name), vlan ? "vlan%d" : "port%d", 1);
+	if (vlan_rtnl_set_master(rtnl, name, NULL) < 0 ||
+	    vlan_rtnl_commit(rtnl) != 0 ||
+	    vlan_rtnl_get_master(rtnl, name) != 0) {
+		printf("Could not remove port from bridge\n");
+		goto fail;
+	}
+	for (i = 0; i < num; i++) {
+		os_snprintf(name, sizeof(name), vlan ? "vlan%d" : "port%d",
+			    i + 1);
+		vlan_rtnl_del_link(rtnl, name);
+	}
+	if (vlan_rtnl_commit(rtnl) != 0 || delete_bridges(rtnl, num) != 0) {
+		printf("Could not remove interfaces\n");
+		goto fail;
+	}
+	vlan_rtnl_del_link(rtnl, "vtest0");
+	vlan_rtnl_commit(rtnl);
+
+	count.num = 0;
+	count.links = 0;
+	if (vlan_rtnl_dump_links(rtnl, count_cb, &count) < 0 ||
+	    count.links != initial) {
+		printf("Interfaces left after removal: %u\n", count.links);
+		goto fail;
+	}
+	ret = 0;
+
+fail:
+	vlan_rtnl_deinit(rtnl);
+	os_free(req);
+	os_free(count.br_index);
+	os_free(count.ports);
+	printf("%s\n", ret == 0 ? "PASS" : "FAIL");
+	return ret;
+}
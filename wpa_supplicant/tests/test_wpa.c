@@ -4,6 +4,27 @@
  *
  * This software may be distributed under the terms of the BSD license.
  * See README for more details.
+ *
+ * A number of virtual stations, each with its own supplicant state machine,
+ * are connected to a single authenticator in one process. EAPOL-Key frames
+ * are passed between them in memory, so the results show the CPU cost of the
+ * handshakes in src/ap/wpa_auth.c and src/rsn_supp/wpa.c. The stations are
+ * connected with a limited number of handshakes in progress at a time,
+ * followed by optional group rekeys and, for AKMs that use PMKSA caching,
+ * a reconnection of all stations with the cached PMKSAs. Handshakes per
+ * second, latency percentiles, and heap allocations per handshake are
+ * reported for each phase:
+ *
+ * test_wpa [-a psk|sha256|ft|eap|sae] [-n stations] [-w in progress]
+ *          [-r group rekeys] [-g rekey window ms] [-b rekey batch] [-c]
+ *          [-m minimum handshakes/sec] [-d]
+ *
+ * With -g, the Group Key handshakes of a rekeying are paced by the
+ * authenticator (wpa_group_update_window) and the latency of each one is
+ * measured from its first message.
+ *
+ * The exit code is non-zero if any handshake fails or if the rate of the
+ * initial connections is below the -m limit.
  */
 
 #include "includes.h"
@@ -11,78 +32,234 @@
 #include "common.h"
 #include "eloop.h"
 #include "common/ieee802_11_defs.h"
-#include "../config.h"
 #include "rsn_supp/wpa.h"
 #include "rsn_supp/wpa_ie.h"
+#include "rsn_supp/pmksa_cache.h"
 #include "ap/wpa_auth.h"
 
 
-struct wpa {
-	u8 auth_addr[ETH_ALEN];
-	u8 supp_addr[ETH_ALEN];
-	u8 psk[PMK_LEN];
+#ifdef __GLIBC__
+/* Count heap allocations by wrapping the C library allocator */
+extern void * __libc_malloc(size_t size);
+extern void * __libc_calloc(size_t nmemb, size_t size);
+extern void * __libc_realloc(void *ptr, size_t size);
 
-	/* from authenticator */
-	u8 auth_eapol_dst[ETH_ALEN];
-	u8 *auth_eapol;
-	size_t auth_eapol_len;
+static unsigned long num_allocs;
+
+void * malloc(size_t size)
+{
+	num_allocs++;
+	return __libc_malloc(size);
+}
+
+
+void * calloc(size_t nmemb, size_t size)
+{
+	num_allocs++;
+	return __libc_calloc(nmemb, size);
+}
 
-	/* from supplicant */
-	u8 *supp_eapol;
-	size_t supp_eapol_len;
+
+void * realloc(void *ptr, size_t size)
+{
+	num_allocs++;
+	return __libc_realloc(ptr, size);
+}
+#define ALLOC_COUNT() num_allocs
+#else /* __GLIBC__ */
+#define ALLOC_COUNT() 0
+#endif /* __GLIBC__ */
+
+
+#define EAPOL_MAX_LEN 512
+
+struct sta {
+	unsigned int idx;
+	u8 addr[ETH_ALEN];
+	u8 pmk[PMK_LEN];
 
 	struct wpa_sm *supp;
-	struct wpa_authenticator *auth_group;
+	enum wpa_states state;
 	struct wpa_state_machine *auth;
-
-	struct wpa_ssid ssid;
 	u8 supp_ie[80];
 	size_t supp_ie_len;
+
+	/* pending frames: 0 = to supplicant, 1 = to authenticator */
+	u8 eapol[2][EAPOL_MAX_LEN];
+	size_t eapol_len[2];
+	int pending[2];
+
+	struct os_reltime start;
+	int in_progress;
+	int done;
+	int rekey_started;
+};
+
+struct wpa {
+	u8 auth_addr[ETH_ALEN];
+	u8 psk[PMK_LEN];
+	int key_mgmt;
+	const char *akm;
+
+	struct wpa_authenticator *auth_group;
+	struct sta *sta;
+	unsigned int num_sta;
+
+	/* frames waiting for delivery as (station index << 1 | direction) */
+	unsigned int *queue;
+	unsigned int queue_size, queue_head, queue_len;
+
+	unsigned int active, completed, failed, get_msk;
+	unsigned int *latency; /* usec for each completed handshake */
+	struct os_reltime phase_start;
+	int group_phase;
+	unsigned int rekey_window, rekey_batch; /* paced GTK rekeying */
 };
 
+static struct wpa wpa;
+
+#ifdef CONFIG_IEEE80211R
+static const u8 mobility_domain[MOBILITY_DOMAIN_ID_LEN] = { 0x12, 0x34 };
+static const char ssid[] = "test-wpa";
+
+
+/* RIC requests are not used here; avoid linking in ap/wmm.c */
+int wmm_process_tspec(struct wmm_tspec_element *tspec)
+{
+	return WMM_ADDTS_STATUS_REFUSED;
+}
+#endif /* CONFIG_IEEE80211R */
+
+
+static unsigned int elapsed_usec(struct os_reltime *start)
+{
+	struct os_reltime now, diff;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, start, &diff);
+	return diff.sec * 1000000 + diff.usec;
+}
+
+
+static struct sta * sta_get(const u8 *addr)
+{
+	unsigned int idx;
+
+	idx = WPA_GET_BE24(&addr[3]);
+	if (os_memcmp(addr, wpa.sta[0].addr, 3) != 0 || idx >= wpa.num_sta)
+		return NULL;
+	return &wpa.sta[idx];
+}
+
+
+static void queue_frame(struct sta *sta, int dir, const u8 *data, size_t len)
+{
+	if (len > EAPOL_MAX_LEN) {
+		wpa_printf(MSG_ERROR, "Too long EAPOL frame (%u)",
+			   (unsigned int) len);
+		return;
+	}
+	if (dir == 0 && wpa.group_phase && sta->in_progress &&
+	    !sta->rekey_started) {
+		/* Group Key handshakes may be paced by the authenticator */
+		os_get_reltime(&sta->start);
+		sta->rekey_started = 1;
+	}
+	os_memcpy(sta->eapol[dir], data, len);
+	sta->eapol_len[dir] = len;
+	if (sta->pending[dir])
+		return; /* replaced a pending frame */
+	sta->pending[dir] = 1;
+	wpa.queue[(wpa.queue_head + wpa.queue_len) % wpa.queue_size] =
+		sta->idx << 1 | dir;
+	wpa.queue_len++;
+}
+
+
+static int deliver_frame(void)
+{
+	struct sta *sta;
+	int dir;
+
+	if (wpa.queue_len == 0)
+		return 0;
+	sta = &wpa.sta[wpa.queue[wpa.queue_head] >> 1];
+	dir = wpa.queue[wpa.queue_head] & 1;
+	wpa.queue_head = (wpa.queue_head + 1) % wpa.queue_size;
+	wpa.queue_len--;
+	sta->pending[dir] = 0;
+
+	if (dir == 0)
+		wpa_sm_rx_eapol(sta->supp, wpa.auth_addr, sta->eapol[0],
+				sta->eapol_len[0]);
+	else if (sta->auth)
+		wpa_receive(wpa.auth_group, sta->auth, sta->eapol[1],
+			    sta->eapol_len[1]);
+	return 1;
+}
+
+
+static void sta_completed(struct sta *sta)
+{
+	wpa.latency[wpa.completed++] = elapsed_usec(&sta->start);
+	sta->in_progress = 0;
+	wpa.active--;
+}
+
 
 static int supp_get_bssid(void *ctx, u8 *bssid)
 {
-	struct wpa *wpa = ctx;
-	wpa_printf(MSG_DEBUG, "SUPP: %s", __func__);
-	os_memcpy(bssid, wpa->auth_addr, ETH_ALEN);
+	os_memcpy(bssid, wpa.auth_addr, ETH_ALEN);
 	return 0;
 }
 
 
 static void supp_set_state(void *ctx, enum wpa_states state)
 {
+	struct sta *sta = ctx;
+
 	wpa_printf(MSG_DEBUG, "SUPP: %s(state=%d)", __func__, state);
+	sta->state = state;
 }
 
 
-static void auth_eapol_rx(void *eloop_data, void *user_ctx)
+static enum wpa_states supp_get_state(void *ctx)
 {
-	struct wpa *wpa = eloop_data;
+	struct sta *sta = ctx;
 
-	wpa_printf(MSG_DEBUG, "AUTH: RX EAPOL frame");
-	wpa_receive(wpa->auth_group, wpa->auth, wpa->supp_eapol,
-		    wpa->supp_eapol_len);
+	return sta->state;
+}
+
+
+static void supp_deauthenticate(void *ctx, int reason_code)
+{
+	struct sta *sta = ctx;
+
+	wpa_printf(MSG_INFO, "SUPP: Deauthenticate " MACSTR " reason=%d",
+		   MAC2STR(sta->addr), reason_code);
+	if (sta->in_progress) {
+		sta->in_progress = 0;
+		wpa.active--;
+		wpa.failed++;
+	}
+}
+
+
+static void * supp_get_network_ctx(void *ctx)
+{
+	return ctx;
 }
 
 
 static int supp_ether_send(void *ctx, const u8 *dest, u16 proto, const u8 *buf,
 			   size_t len)
 {
-	struct wpa *wpa = ctx;
+	struct sta *sta = ctx;
 
 	wpa_printf(MSG_DEBUG, "SUPP: %s(dest=" MACSTR " proto=0x%04x "
 		   "len=%lu)",
 		   __func__, MAC2STR(dest), proto, (unsigned long) len);
-
-	os_free(wpa->supp_eapol);
-	wpa->supp_eapol = os_malloc(len);
-	if (wpa->supp_eapol == NULL)
-		return -1;
-	os_memcpy(wpa->supp_eapol, buf, len);
-	wpa->supp_eapol_len = len;
-	eloop_register_timeout(0, 0, auth_eapol_rx, wpa, NULL);
-
+	queue_frame(sta, 1, buf, len);
 	return 0;
 }
 
@@ -118,18 +295,18 @@ static u8 * supp_alloc_eapol(void *ctx, u8 type, const void *data,
 
 static int supp_get_beacon_ie(void *ctx)
 {
-	struct wpa *wpa = ctx;
+	struct sta *sta = ctx;
 	const u8 *ie;
 	size_t ielen;
 
 	wpa_printf(MSG_DEBUG, "SUPP: %s", __func__);
 
-	ie = wpa_auth_get_wpa_ie(wpa->auth_group, &ielen);
+	ie = wpa_auth_get_wpa_ie(wpa.auth_group, &ielen);
 	if (ie == NULL || ielen < 1)
 		return -1;
 	if (ie[0] == WLAN_EID_RSN)
-		return wpa_sm_set_ap_rsn_ie(wpa->supp, ie, 2 + ie[1]);
-	return wpa_sm_set_ap_wpa_ie(wpa->supp, ie, 2 + ie[1]);
+		return wpa_sm_set_ap_rsn_ie(sta->supp, ie, 2 + ie[1]);
+	return wpa_sm_set_ap_wpa_ie(sta->supp, ie, 2 + ie[1]);
 }
 
 
@@ -138,11 +315,17 @@ static int supp_set_key(void *ctx, enum wpa_alg alg,
 			const u8 *seq, size_t seq_len,
 			const u8 *key, size_t key_len)
 {
+	struct sta *sta = ctx;
+
 	wpa_printf(MSG_DEBUG, "SUPP: %s(alg=%d addr=" MACSTR " key_idx=%d "
 		   "set_tx=%d)",
 		   __func__, alg, MAC2STR(addr), key_idx, set_tx);
 	wpa_hexdump(MSG_DEBUG, "SUPP: set_key - seq", seq, seq_len);
-	wpa_hexdump(MSG_DEBUG, "SUPP: set_key - key", key, key_len);
+	wpa_hexdump_key(MSG_DEBUG, "SUPP: set_key - key", key, key_len);
+
+	if (wpa.group_phase && key_idx > 0 && key_idx < 4 &&
+	    sta->in_progress)
+		sta_completed(sta);
 	return 0;
 }
 
@@ -163,15 +346,32 @@ static void supp_cancel_auth_timeout(void *ctx)
 }
 
 
-static int supp_init(struct wpa *wpa)
+static int supp_add_pmkid(void *ctx, const u8 *bssid, const u8 *pmkid)
+{
+	return 0;
+}
+
+
+static int supp_remove_pmkid(void *ctx, const u8 *bssid, const u8 *pmkid)
+{
+	return 0;
+}
+
+
+static int supp_init(struct sta *sta)
 {
 	struct wpa_sm_ctx *ctx = os_zalloc(sizeof(*ctx));
+	struct rsn_supp_config conf;
+
 	if (ctx == NULL)
 		return -1;
 
-	ctx->ctx = wpa;
-	ctx->msg_ctx = wpa;
+	ctx->ctx = sta;
+	ctx->msg_ctx = sta;
 	ctx->set_state = supp_set_state;
+	ctx->get_state = supp_get_state;
+	ctx->deauthenticate = supp_deauthenticate;
+	ctx->get_network_ctx = supp_get_network_ctx;
 	ctx->get_bssid = supp_get_bssid;
 	ctx->ether_send = supp_ether_send;
 	ctx->get_beacon_ie = supp_get_beacon_ie;
@@ -179,29 +379,28 @@ static int supp_init(struct wpa *wpa)
 	ctx->set_key = supp_set_key;
 	ctx->mlme_setprotection = supp_mlme_setprotection;
 	ctx->cancel_auth_timeout = supp_cancel_auth_timeout;
-	wpa->supp = wpa_sm_init(ctx);
-	if (wpa->supp == NULL) {
+	ctx->add_pmkid = supp_add_pmkid;
+	ctx->remove_pmkid = supp_remove_pmkid;
+	sta->supp = wpa_sm_init(ctx);
+	if (sta->supp == NULL) {
 		wpa_printf(MSG_DEBUG, "SUPP: wpa_sm_init() failed");
 		return -1;
 	}
 
-	wpa_sm_set_own_addr(wpa->supp, wpa->supp_addr);
-	wpa_sm_set_param(wpa->supp, WPA_PARAM_RSN_ENABLED, 1);
-	wpa_sm_set_param(wpa->supp, WPA_PARAM_PROTO, WPA_PROTO_RSN);
-	wpa_sm_set_param(wpa->supp, WPA_PARAM_PAIRWISE, WPA_CIPHER_CCMP);
-	wpa_sm_set_param(wpa->supp, WPA_PARAM_GROUP, WPA_CIPHER_CCMP);
-	wpa_sm_set_param(wpa->supp, WPA_PARAM_KEY_MGMT, WPA_KEY_MGMT_PSK);
-	wpa_sm_set_pmk(wpa->supp, wpa->psk, PMK_LEN);
-
-	wpa->supp_ie_len = sizeof(wpa->supp_ie);
-	if (wpa_sm_set_assoc_wpa_ie_default(wpa->supp, wpa->supp_ie,
-					    &wpa->supp_ie_len) < 0) {
-		wpa_printf(MSG_DEBUG, "SUPP: wpa_sm_set_assoc_wpa_ie_default()"
-			   " failed");
-		return -1;
-	}
-
-	wpa_sm_notify_assoc(wpa->supp, wpa->auth_addr);
+	os_memset(&conf, 0, sizeof(conf));
+	conf.network_ctx = sta;
+#ifdef CONFIG_IEEE80211R
+	conf.ssid = (const u8 *) ssid;
+	conf.ssid_len = os_strlen(ssid);
+#endif /* CONFIG_IEEE80211R */
+	wpa_sm_set_config(sta->supp, &conf);
+
+	wpa_sm_set_own_addr(sta->supp, sta->addr);
+	wpa_sm_set_param(sta->supp, WPA_PARAM_RSN_ENABLED, 1);
+	wpa_sm_set_param(sta->supp, WPA_PARAM_PROTO, WPA_PROTO_RSN);
+	wpa_sm_set_param(sta->supp, WPA_PARAM_PAIRWISE, WPA_CIPHER_CCMP);
+	wpa_sm_set_param(sta->supp, WPA_PARAM_GROUP, WPA_CIPHER_CCMP);
+	wpa_sm_set_param(sta->supp, WPA_PARAM_KEY_MGMT, wpa.key_mgmt);
 
 	return 0;
 }
@@ -218,50 +417,121 @@ static void auth_logger(void *ctx, const u8 *addr, logger_level level,
 }
 
 
-static void supp_eapol_rx(void *eloop_data, void *user_ctx)
+static void auth_disconnect(void *ctx, const u8 *addr, u16 reason)
 {
-	struct wpa *wpa = eloop_data;
+	struct sta *sta = sta_get(addr);
+
+	wpa_printf(MSG_INFO, "AUTH: Disconnect " MACSTR " reason=%u",
+		   MAC2STR(addr), reason);
+	if (sta && sta->in_progress) {
+		sta->in_progress = 0;
+		wpa.active--;
+		wpa.failed++;
+	}
+}
 
-	wpa_printf(MSG_DEBUG, "SUPP: RX EAPOL frame");
-	wpa_sm_rx_eapol(wpa->supp, wpa->auth_addr, wpa->auth_eapol,
-			wpa->auth_eapol_len);
+
+static void auth_set_eapol(void *ctx, const u8 *addr, wpa_eapol_variable var,
+			   int value)
+{
+	struct sta *sta;
+
+	if (var != WPA_EAPOL_keyDone || !value)
+		return;
+	sta = sta_get(addr);
+	if (sta && sta->in_progress && !wpa.group_phase) {
+		/* PMKSA caching after EAP authentication */
+		if (wpa_key_mgmt_wpa_ieee8021x(wpa.key_mgmt) &&
+		    !wpa_auth_sta_get_pmksa(sta->auth))
+			wpa_auth_pmksa_add(sta->auth, sta->pmk, 0, NULL);
+		sta->done = 1;
+		sta_completed(sta);
+	}
+}
+
+
+static int auth_get_eapol(void *ctx, const u8 *addr, wpa_eapol_variable var)
+{
+	/* EAP authentication is assumed to have completed on association */
+	return var == WPA_EAPOL_keyRun || var == WPA_EAPOL_keyAvailable;
+}
+
+
+static int auth_get_msk(void *ctx, const u8 *addr, u8 *msk, size_t *len)
+{
+	struct sta *sta = sta_get(addr);
+
+	if (sta == NULL || *len < PMK_LEN)
+		return -1;
+	wpa.get_msk++;
+	os_memcpy(msk, sta->pmk, PMK_LEN);
+	*len = PMK_LEN;
+	return 0;
+}
+
+
+static int auth_set_key(void *ctx, int vlan_id, enum wpa_alg alg,
+			const u8 *addr, int idx, u8 *key, size_t key_len)
+{
+	return 0;
+}
+
+
+static int auth_get_seqnum(void *ctx, const u8 *addr, int idx, u8 *seq)
+{
+	os_memset(seq, 0, WPA_KEY_RSC_LEN);
+	return 0;
 }
 
 
 static int auth_send_eapol(void *ctx, const u8 *addr, const u8 *data,
 			   size_t data_len, int encrypt)
 {
-	struct wpa *wpa = ctx;
+	struct sta *sta = sta_get(addr);
 
 	wpa_printf(MSG_DEBUG, "AUTH: %s(addr=" MACSTR " data_len=%lu "
 		   "encrypt=%d)",
 		   __func__, MAC2STR(addr), (unsigned long) data_len, encrypt);
-
-	os_free(wpa->auth_eapol);
-	wpa->auth_eapol = os_malloc(data_len);
-	if (wpa->auth_eapol == NULL)
+	if (sta == NULL)
 		return -1;
-	os_memcpy(wpa->auth_eapol_dst, addr, ETH_ALEN);
-	os_memcpy(wpa->auth_eapol, data, data_len);
-	wpa->auth_eapol_len = data_len;
-	eloop_register_timeout(0, 0, supp_eapol_rx, wpa, NULL);
+	queue_frame(sta, 0, data, data_len);
+	return 0;
+}
+
+
+static int auth_for_each_sta(void *ctx,
+			     int (*cb)(struct wpa_state_machine *sm, void *ctx),
+			     void *cb_ctx)
+{
+	unsigned int i;
 
+	for (i = 0; i < wpa.num_sta; i++) {
+		if (wpa.sta[i].auth && cb(wpa.sta[i].auth, cb_ctx))
+			return 1;
+	}
 	return 0;
 }
 
 
-static const u8 * auth_get_psk(void *ctx, const u8 *addr, const u8 *prev_psk)
+static const u8 * auth_get_psk(void *ctx, const u8 *addr,
+			       const u8 *p2p_dev_addr, const u8 *prev_psk)
 {
-	struct wpa *wpa = ctx;
+	struct sta *sta;
+
 	wpa_printf(MSG_DEBUG, "AUTH: %s (addr=" MACSTR " prev_psk=%p)",
 		   __func__, MAC2STR(addr), prev_psk);
 	if (prev_psk)
 		return NULL;
-	return wpa->psk;
+	if (wpa_key_mgmt_sae(wpa.key_mgmt)) {
+		/* PMK from SAE */
+		sta = sta_get(addr);
+		return sta ? sta->pmk : NULL;
+	}
+	return wpa.psk;
 }
 
 
-static int auth_init_group(struct wpa *wpa)
+static int auth_init_group(void)
 {
 	struct wpa_auth_config conf;
 	struct wpa_auth_callbacks cb;
@@ -270,100 +540,482 @@ static int auth_init_group(struct wpa *wpa)
 
 	os_memset(&conf, 0, sizeof(conf));
 	conf.wpa = 2;
-	conf.wpa_key_mgmt = WPA_KEY_MGMT_PSK;
+	conf.wpa_key_mgmt = wpa.key_mgmt;
 	conf.wpa_pairwise = WPA_CIPHER_CCMP;
 	conf.rsn_pairwise = WPA_CIPHER_CCMP;
 	conf.wpa_group = WPA_CIPHER_CCMP;
 	conf.eapol_version = 2;
+	conf.wpa_group_update_window = wpa.rekey_window;
+	conf.wpa_group_update_batch = wpa.rekey_batch;
+#ifdef CONFIG_IEEE80211R
+	os_memcpy(conf.ssid, ssid, os_strlen(ssid));
+	conf.ssid_len = os_strlen(ssid);
+	os_memcpy(conf.mobility_domain, mobility_domain,
+		  MOBILITY_DOMAIN_ID_LEN);
+	os_memcpy(conf.r0_key_holder, "r0kh.example.com", 16);
+	conf.r0_key_holder_len = 16;
+	os_memcpy(conf.r1_key_holder, wpa.auth_addr, FT_R1KH_ID_LEN);
+	conf.r0_key_lifetime = 10000;
+	conf.reassociation_deadline = 1000;
+#endif /* CONFIG_IEEE80211R */
 
 	os_memset(&cb, 0, sizeof(cb));
-	cb.ctx = wpa;
+	cb.ctx = &wpa;
 	cb.logger = auth_logger;
+	cb.disconnect = auth_disconnect;
+	cb.set_eapol = auth_set_eapol;
+	cb.get_eapol = auth_get_eapol;
+	cb.get_msk = auth_get_msk;
+	cb.set_key = auth_set_key;
+	cb.get_seqnum = auth_get_seqnum;
 	cb.send_eapol = auth_send_eapol;
+	cb.for_each_sta = auth_for_each_sta;
 	cb.get_psk = auth_get_psk;
 
-	wpa->auth_group = wpa_init(wpa->auth_addr, &conf, &cb);
-	if (wpa->auth_group == NULL) {
+	wpa.auth_group = wpa_init(wpa.auth_addr, &conf, &cb);
+	if (wpa.auth_group == NULL) {
 		wpa_printf(MSG_DEBUG, "AUTH: wpa_init() failed");
 		return -1;
 	}
+	if (wpa_init_keys(wpa.auth_group) < 0)
+		return -1;
 
 	return 0;
 }
 
 
-static int auth_init(struct wpa *wpa)
+/* Association of a station followed by the start of the 4-way handshake */
+static int sta_connect(struct sta *sta, int cached)
 {
-	wpa->auth = wpa_auth_sta_init(wpa->auth_group, wpa->supp_addr, NULL);
-	if (wpa->auth == NULL) {
+	const u8 *ie;
+	size_t ielen;
+	u8 mdie[2 + MOBILITY_DOMAIN_ID_LEN + 1], *md = NULL;
+	size_t md_len = 0;
+
+	os_get_reltime(&sta->start);
+	sta->in_progress = 1;
+	sta->done = 0;
+	wpa.active++;
+
+	if (sta->auth) {
+		/* Reconnection */
+		wpa_auth_sta_deinit(sta->auth);
+		sta->auth = NULL;
+		wpa_sm_notify_disassoc(sta->supp);
+	}
+
+	ie = wpa_auth_get_wpa_ie(wpa.auth_group, &ielen);
+	if (ie == NULL || wpa_sm_set_ap_rsn_ie(sta->supp, ie, 2 + ie[1]) < 0)
+		goto fail;
+
+	if (wpa_key_mgmt_sae(wpa.key_mgmt)) {
+		/* PMKSA from SAE authentication */
+		if (!cached) {
+			wpa_sm_set_pmk(sta->supp, sta->pmk, PMK_LEN,
+				       wpa.auth_addr);
+			wpa_auth_pmksa_add_sae(wpa.auth_group, sta->addr,
+					       sta->pmk);
+		}
+		cached = 1;
+	} else if (wpa_key_mgmt_wpa_psk(wpa.key_mgmt)) {
+		wpa_sm_set_pmk(sta->supp, wpa.psk, PMK_LEN, NULL);
+	} else if (!cached) {
+		/* PMKSA from EAP authentication */
+		wpa_sm_set_pmk(sta->supp, sta->pmk, PMK_LEN, wpa.auth_addr);
+	}
+	if (cached &&
+	    pmksa_cache_set_current(sta->supp, NULL, wpa.auth_addr, sta, 0) <
+	    0) {
+		wpa_printf(MSG_ERROR, "SUPP: No PMKSA for " MACSTR,
+			   MAC2STR(sta->addr));
+		goto fail;
+	}
+
+	wpa_sm_set_assoc_wpa_ie(sta->supp, NULL, 0);
+	sta->supp_ie_len = sizeof(sta->supp_ie);
+	if (wpa_sm_set_assoc_wpa_ie_default(sta->supp, sta->supp_ie,
+					    &sta->supp_ie_len) < 0) {
+		wpa_printf(MSG_DEBUG, "SUPP: wpa_sm_set_assoc_wpa_ie_default()"
+			   " failed");
+		goto fail;
+	}
+	wpa_sm_notify_assoc(sta->supp, wpa.auth_addr);
+
+	sta->auth = wpa_auth_sta_init(wpa.auth_group, sta->addr, NULL);
+	if (sta->auth == NULL) {
 		wpa_printf(MSG_DEBUG, "AUTH: wpa_auth_sta_init() failed");
-		return -1;
+		goto fail;
 	}
 
-	if (wpa_validate_wpa_ie(wpa->auth_group, wpa->auth, wpa->supp_ie,
-				wpa->supp_ie_len, NULL, 0) != WPA_IE_OK) {
+#ifdef CONFIG_IEEE80211R
+	if (wpa_key_mgmt_ft(wpa.key_mgmt)) {
+		mdie[0] = WLAN_EID_MOBILITY_DOMAIN;
+		mdie[1] = MOBILITY_DOMAIN_ID_LEN + 1;
+		os_memcpy(&mdie[2], mobility_domain, MOBILITY_DOMAIN_ID_LEN);
+		mdie[2 + MOBILITY_DOMAIN_ID_LEN] = 0;
+		md = &mdie[2];
+		md_len = mdie[1];
+	}
+#endif /* CONFIG_IEEE80211R */
+
+	if (wpa_validate_wpa_ie(wpa.auth_group, sta->auth, sta->supp_ie,
+				sta->supp_ie_len, md, md_len) != WPA_IE_OK) {
 		wpa_printf(MSG_DEBUG, "AUTH: wpa_validate_wpa_ie() failed");
-		return -1;
+		goto fail;
+	}
+	if (cached && !wpa_auth_sta_get_pmksa(sta->auth)) {
+		wpa_printf(MSG_ERROR, "AUTH: No PMKSA for " MACSTR,
+			   MAC2STR(sta->addr));
+		goto fail;
 	}
 
-	wpa_auth_sm_event(wpa->auth, WPA_ASSOC);
+#ifdef CONFIG_IEEE80211R
+	if (md) {
+		u8 resp[300], *end;
+
+		/* Mobility Domain and Fast BSS Transition elements from the
+		 * Association Response frame */
+		end = wpa_sm_write_assoc_resp_ies(sta->auth, resp,
+						  sizeof(resp), WLAN_AUTH_OPEN,
+						  mdie, sizeof(mdie));
+		if (wpa_sm_set_ft_params(sta->supp, resp, end - resp) < 0)
+			goto fail;
+	}
+#endif /* CONFIG_IEEE80211R */
 
-	wpa_auth_sta_associated(wpa->auth_group, wpa->auth);
+	wpa_auth_sm_event(sta->auth, WPA_ASSOC);
+	wpa_auth_sta_associated(wpa.auth_group, sta->auth);
 
 	return 0;
+
+fail:
+	sta->in_progress = 0;
+	wpa.active--;
+	wpa.failed++;
+	return -1;
+}
+
+
+static int cmp_uint(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *) a;
+	unsigned int y = *(const unsigned int *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+
+static double report(const char *phase, unsigned int usec,
+		     unsigned long allocs)
+{
+	double rate;
+	unsigned int p50 = 0, p99 = 0;
+
+	rate = usec ? wpa.completed * 1000000.0 / usec : 0;
+	if (wpa.completed) {
+		qsort(wpa.latency, wpa.completed, sizeof(unsigned int),
+		      cmp_uint);
+		p50 = wpa.latency[wpa.completed / 2];
+		p99 = wpa.latency[wpa.completed * 99 / 100];
+	}
+	printf("%-10s %6u ok %4u failed  %9.1f handshakes/s  "
+	       "p50 %6u us  p99 %6u us", phase, wpa.completed, wpa.failed,
+	       rate, p50, p99);
+#ifdef __GLIBC__
+	printf("  %5.1f allocs/handshake",
+	       wpa.completed ? (double) allocs / wpa.completed : 0.0);
+#endif /* __GLIBC__ */
+	printf("\n");
+	return rate;
 }
 
 
-static void deinit(struct wpa *wpa)
+/* Handshakes that stalled without completing are counted as failures */
+static void fail_stalled(void)
 {
-	wpa_auth_sta_deinit(wpa->auth);
-	wpa_sm_deinit(wpa->supp);
-	wpa_deinit(wpa->auth_group);
-	os_free(wpa->auth_eapol);
-	wpa->auth_eapol = NULL;
-	os_free(wpa->supp_eapol);
-	wpa->supp_eapol = NULL;
+	unsigned int i;
+
+	for (i = 0; i < wpa.num_sta; i++) {
+		if (wpa.sta[i].in_progress) {
+			wpa_printf(MSG_ERROR, "Handshake for " MACSTR
+				   " did not complete",
+				   MAC2STR(wpa.sta[i].addr));
+			wpa.sta[i].in_progress = 0;
+			wpa.failed++;
+		}
+	}
+	wpa.active = 0;
+}
+
+
+static double run_connect(const char *phase, unsigned int window, int cached)
+{
+	unsigned int next = 0;
+	unsigned long allocs;
+
+	wpa.completed = wpa.failed = wpa.active = 0;
+	wpa.group_phase = 0;
+	allocs = ALLOC_COUNT();
+	os_get_reltime(&wpa.phase_start);
+
+	while (wpa.completed + wpa.failed < wpa.num_sta) {
+		while (wpa.active < window && next < wpa.num_sta)
+			sta_connect(&wpa.sta[next++], cached);
+		if (!deliver_frame() && wpa.active) {
+			/* Nothing left to deliver */
+			fail_stalled();
+		}
+	}
+
+	return report(phase, elapsed_usec(&wpa.phase_start),
+		      ALLOC_COUNT() - allocs);
+}
+
+
+static int mib_value(const char *name)
+{
+	char buf[4096], *pos;
+
+	if (wpa_get_mib(wpa.auth_group, buf, sizeof(buf) - 1) <= 0)
+		return -1;
+	buf[sizeof(buf) - 1] = '\0';
+	pos = os_strstr(buf, name);
+	if (pos == NULL || pos[os_strlen(name)] != '=')
+		return -1;
+	return atoi(pos + os_strlen(name) + 1);
+}
+
+
+/* Deliver frames while paced Group Key handshakes are started from eloop */
+static void rekey_pump(void *eloop_ctx, void *timeout_ctx)
+{
+	while (deliver_frame())
+		;
+	if (wpa.active == 0 ||
+	    elapsed_usec(&wpa.phase_start) / 1000 > wpa.rekey_window + 5000) {
+		eloop_terminate();
+		return;
+	}
+	eloop_register_timeout(0, 1000, rekey_pump, NULL, NULL);
+}
+
+
+static void run_rekey(void)
+{
+	unsigned long allocs;
+	unsigned int i;
+	int completed;
+
+	wpa.completed = wpa.failed = wpa.active = 0;
+	wpa.group_phase = 1;
+	completed = mib_value("hostapdWPAGroupUpdateCompleted");
+	allocs = ALLOC_COUNT();
+	os_get_reltime(&wpa.phase_start);
+
+	for (i = 0; i < wpa.num_sta; i++) {
+		if (!wpa.sta[i].done)
+			continue;
+		wpa.sta[i].start = wpa.phase_start;
+		wpa.sta[i].in_progress = 1;
+		wpa.sta[i].rekey_started = 0;
+		wpa.active++;
+	}
+
+	wpa_auth_rekey_gtk(wpa.auth_group);
+	if (wpa.rekey_window) {
+		rekey_pump(NULL, NULL);
+		eloop_run();
+		eloop_cancel_timeout(rekey_pump, NULL, NULL);
+	} else {
+		while (deliver_frame())
+			;
+	}
+	fail_stalled();
+
+	report("rekey", elapsed_usec(&wpa.phase_start),
+	       ALLOC_COUNT() - allocs);
+	wpa.group_phase = 0;
+
+	if (mib_value("hostapdWPAGroupUpdatePending") != 0 ||
+	    mib_value("hostapdWPAGroupUpdateCompleted") - completed !=
+	    (int) wpa.completed) {
+		printf("Unexpected Group Key update counters\n");
+		wpa.failed++;
+	}
+}
+
+
+static void usage(void)
+{
+	printf("usage: test_wpa [-a psk|sha256|ft|eap|sae] [-n stations] "
+	       "[-w in progress]\n"
+	       "                [-r group rekeys] [-g rekey window ms] "
+	       "[-b rekey batch] [-c]\n"
+	       "                [-m minimum handshakes/sec] [-d]\n");
+}
+
+
+static void deinit(void)
+{
+	unsigned int i;
+
+	for (i = 0; wpa.sta && i < wpa.num_sta; i++) {
+		wpa_auth_sta_deinit(wpa.sta[i].auth);
+		wpa_sm_deinit(wpa.sta[i].supp);
+	}
+	wpa_deinit(wpa.auth_group);
+	os_free(wpa.sta);
+	os_free(wpa.queue);
+	os_free(wpa.latency);
 }
 
 
 int main(int argc, char *argv[])
 {
-	struct wpa wpa;
+	unsigned int i, window = 16;
+	int c, rekeys = 0, cached = 0, ret = -1;
+	double rate, min_rate = 0;
 
 	if (os_program_init())
 		return -1;
 
 	os_memset(&wpa, 0, sizeof(wpa));
 	os_memset(wpa.auth_addr, 0x12, ETH_ALEN);
-	os_memset(wpa.supp_addr, 0x32, ETH_ALEN);
 	os_memset(wpa.psk, 0x44, PMK_LEN);
+	wpa.key_mgmt = WPA_KEY_MGMT_PSK;
+	wpa.akm = "psk";
+	wpa.num_sta = 1000;
+	wpa.rekey_batch = 32;
+	wpa_debug_level = MSG_ERROR;
+
+	for (;;) {
+		c = getopt(argc, argv, "a:b:cdg:m:n:r:w:");
+		if (c < 0)
+			break;
+		switch (c) {
+		case 'a':
+			wpa.akm = optarg;
+			if (os_strcmp(optarg, "psk") == 0)
+				wpa.key_mgmt = WPA_KEY_MGMT_PSK;
+#ifdef CONFIG_IEEE80211W
+			else if (os_strcmp(optarg, "sha256") == 0)
+				wpa.key_mgmt = WPA_KEY_MGMT_PSK_SHA256;
+#endif /* CONFIG_IEEE80211W */
+#ifdef CONFIG_IEEE80211R
+			else if (os_strcmp(optarg, "ft") == 0)
+				wpa.key_mgmt = WPA_KEY_MGMT_FT_PSK;
+#endif /* CONFIG_IEEE80211R */
+			else if (os_strcmp(optarg, "eap") == 0)
+				wpa.key_mgmt = WPA_KEY_MGMT_IEEE8021X;
+#ifdef CONFIG_SAE
+			else if (os_strcmp(optarg, "sae") == 0)
+				wpa.key_mgmt = WPA_KEY_MGMT_SAE;
+#endif /* CONFIG_SAE */
+			else {
+				printf("Unsupported AKM: %s\n", optarg);
+				return -1;
+			}
+			break;
+		case 'b':
+			wpa.rekey_batch = atoi(optarg);
+			break;
+		case 'c':
+			cached = 1;
+			break;
+		case 'd':
+			wpa_debug_level = MSG_DEBUG;
+			wpa_debug_show_keys = 1;
+			break;
+		case 'g':
+			wpa.rekey_window = atoi(optarg);
+			break;
+		case 'm':
+			min_rate = atof(optarg);
+			break;
+		case 'n':
+			wpa.num_sta = atoi(optarg);
+			break;
+		case 'r':
+			rekeys = atoi(optarg);
+			break;
+		case 'w':
+			window = atoi(optarg);
+			break;
+		default:
+			usage();
+			return -1;
+		}
+	}
 
-	wpa_debug_level = 0;
-	wpa_debug_show_keys = 1;
+	if (wpa.num_sta == 0 || wpa.num_sta > 0xffffff || window == 0) {
+		usage();
+		return -1;
+	}
+	if (cached && wpa_key_mgmt_wpa_psk(wpa.key_mgmt) &&
+	    !wpa_key_mgmt_sae(wpa.key_mgmt)) {
+		printf("PMKSA caching is not used with %s\n", wpa.akm);
+		return -1;
+	}
 
 	if (eloop_init()) {
 		wpa_printf(MSG_ERROR, "Failed to initialize event loop");
 		return -1;
 	}
 
-	if (auth_init_group(&wpa) < 0)
-		return -1;
+	wpa.sta = os_calloc(wpa.num_sta, sizeof(struct sta));
+	wpa.latency = os_calloc(wpa.num_sta, sizeof(unsigned int));
+	wpa.queue_size = 2 * wpa.num_sta;
+	wpa.queue = os_calloc(wpa.queue_size, sizeof(unsigned int));
+	if (!wpa.sta || !wpa.latency || !wpa.queue)
+		goto out;
+
+	if (auth_init_group() < 0)
+		goto out;
+
+	for (i = 0; i < wpa.num_sta; i++) {
+		struct sta *sta = &wpa.sta[i];
+
+		sta->idx = i;
+		sta->addr[0] = 0x02;
+		WPA_PUT_BE24(&sta->addr[3], i);
+		os_memset(sta->pmk, 0x55, PMK_LEN);
+		WPA_PUT_BE32(sta->pmk, i);
+		if (supp_init(sta) < 0)
+			goto out;
+	}
 
-	if (supp_init(&wpa) < 0)
-		return -1;
+	printf("%u stations, AKM %s, %u handshakes in progress\n",
+	       wpa.num_sta, wpa.akm, window);
+	rate = run_connect("connect", window, 0);
+	ret = wpa.failed ? -1 : 0;
 
-	if (auth_init(&wpa) < 0)
-		return -1;
+	for (c = 0; c < rekeys; c++) {
+		run_rekey();
+		if (wpa.failed)
+			ret = -1;
+	}
 
-	wpa_printf(MSG_DEBUG, "Starting eloop");
-	eloop_run();
-	wpa_printf(MSG_DEBUG, "eloop done");
+	if (cached) {
+		wpa.get_msk = 0;
+		run_connect("pmksa", window, 1);
+		if (wpa.failed || wpa.get_msk) {
+			printf("PMKSA caching not used (%u new PMKs)\n",
+			       wpa.get_msk);
+			ret = -1;
+		}
+	}
 
-	deinit(&wpa);
+	if (min_rate > 0 && rate < min_rate) {
+		printf("Connect rate %.1f/s below the minimum %.1f/s\n",
+		       rate, min_rate);
+		ret = -1;
+	}
 
+out:
+	deinit();
 	eloop_destroy();
-
 	os_program_deinit();
+	printf("%s\n", ret == 0 ? "PASS" : "FAIL");
 
-	return 0;
+	return ret;
 }
@@ -20,6 +20,7 @@
 #include "bss.h"
 #include "wnm_sta.h"
 #include "hs20_supplicant.h"
+#include "roam_cand.h"
 
 #define MAX_TFS_IE_LEN  1024
 #define WNM_MAX_NEIGHBOR_REPORT 10
@@ -864,7 +865,7 @@ static void ieee802_11_rx_bss_trans_mgmt_req(struct wpa_supplicant *wpa_s,
 	}
 
 	if (wpa_s->wnm_mode & WNM_BSS_TM_REQ_PREF_CAND_LIST_INCLUDED) {
-		unsigned int valid_ms;
+		unsigned int valid_ms, i;
 
 		wpa_msg(wpa_s, MSG_INFO, "WNM: Preferred List Available");
 		wnm_deallocate_memory(wpa_s);
@@ -898,6 +899,18 @@ static void ieee802_11_rx_bss_trans_mgmt_req(struct wpa_supplicant *wpa_s,
 		}
 		wnm_sort_cand_list(wpa_s);
 		wnm_dump_cand_list(wpa_s);
+		for (i = 0; i < wpa_s->wnm_num_neighbor_report; i++) {
+			struct neighbor_report *rep;
+
+			rep = &wpa_s->wnm_neighbor_report_elements[i];
+			if (is_zero_ether_addr(rep->bssid))
+				continue;
+			roam_cand_btm_cand(wpa_s->roam_cand, rep->bssid,
+					   rep->freq,
+					   rep->preference_present ?
+					   rep->preference : -1);
+		}
+		roam_cand_roam_started(wpa_s->roam_cand, "BTM", NULL);
 		valid_ms = valid_int * beacon_int * 128 / 125;
 		wpa_printf(MSG_DEBUG, "WNM: Candidate list valid for %u ms",
 			   valid_ms);
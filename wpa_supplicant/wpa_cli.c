@@ -1759,6 +1759,20 @@ static int wpa_cli_cmd_scan_results(struct wpa_ctrl *ctrl, int argc,
 }
 
 
+static int wpa_cli_cmd_scan_plan(struct wpa_ctrl *ctrl, int argc,
+				 char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "SCAN_PLAN");
+}
+
+
+static int wpa_cli_cmd_roam_cand(struct wpa_ctrl *ctrl, int argc,
+				 char *argv[])
+{
+	return wpa_ctrl_command(ctrl, "ROAM_CAND");
+}
+
+
 static int wpa_cli_cmd_bss(struct wpa_ctrl *ctrl, int argc, char *argv[])
 {
 	return wpa_cli_cmd(ctrl, "BSS", 1, argc, argv);
@@ -2919,6 +2933,7 @@ static const struct wpa_cli_cmd wpa_cli_commands[] = {
 	  cli_cmd_flag_none,
 	  "<BSSID> = add a BSSID to the blacklist\n"
 	  "blacklist clear = clear the blacklist\n"
+	  "blacklist info = display blacklist counts and decay times\n"
 	  "blacklist = display the blacklist" },
 	{ "log_level", wpa_cli_cmd_log_level, NULL,
 	  cli_cmd_flag_none,
@@ -2989,6 +3004,12 @@ static const struct wpa_cli_cmd wpa_cli_commands[] = {
 	{ "scan_results", wpa_cli_cmd_scan_results, NULL,
 	  cli_cmd_flag_none,
 	  "= get latest scan results" },
+	{ "scan_plan", wpa_cli_cmd_scan_plan, NULL,
+	  cli_cmd_flag_none,
+	  "= get scan channel history and connection statistics" },
+	{ "roam_cand", wpa_cli_cmd_roam_cand, NULL,
+	  cli_cmd_flag_none,
+	  "= get roaming candidates and roam latency statistics" },
 	{ "bss", wpa_cli_cmd_bss, wpa_cli_complete_bss,
 	  cli_cmd_flag_none,
 	  "<<idx> | <bssid>> = get detailed scan result info" },
@@ -3349,7 +3370,7 @@ static const struct wpa_cli_cmd wpa_cli_commands[] = {
 	  "<command> = driver private commands" },
 #endif /* ANDROID */
 	{ "radio_work", wpa_cli_cmd_radio_work, NULL, cli_cmd_flag_none,
-	  "= radio_work <show/add/done>" },
+	  "= radio_work <show/add/done/stats>" },
 	{ "vendor", wpa_cli_cmd_vendor, NULL, cli_cmd_flag_none,
 	  "<vendor id> <command id> [<hex formatted command argument>] = Send vendor command"
 	},
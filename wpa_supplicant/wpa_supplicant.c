@@ -23,6 +23,7 @@
 #include "eloop.h"
 #include "config.h"
 #include "utils/ext_password.h"
+#include "utils/frame_pool.h"
 #include "l2_packet/l2_packet.h"
 #include "wpa_supplicant_i.h"
 #include "driver_i.h"
@@ -52,6 +53,10 @@
 #include "scan.h"
 #include "offchannel.h"
 #include "hs20_supplicant.h"
+#include "anqp_cache.h"
+#include "scan_plan.h"
+#include "roam_cand.h"
+#include "interworking.h"
 #include "wnm_sta.h"
 #include "wpas_kay.h"
 #include "mesh.h"
@@ -446,6 +451,19 @@ static void wpa_supplicant_cleanup(struct wpa_supplicant *wpa_s)
 	wpa_s->wpa = NULL;
 	wpa_blacklist_clear(wpa_s);
 
+#ifdef CONFIG_INTERWORKING
+	anqp_cache_deinit(wpa_s->anqp_cache);
+	wpa_s->anqp_cache = NULL;
+	interworking_cred_changed(wpa_s);
+#endif /* CONFIG_INTERWORKING */
+#ifdef CONFIG_SCAN_PLAN
+	scan_plan_deinit(wpa_s->scan_plan);
+	wpa_s->scan_plan = NULL;
+#endif /* CONFIG_SCAN_PLAN */
+#ifdef CONFIG_ROAM_CAND
+	roam_cand_deinit(wpa_s->roam_cand);
+	wpa_s->roam_cand = NULL;
+#endif /* CONFIG_ROAM_CAND */
 	wpa_bss_deinit(wpa_s);
 
 	wpa_supplicant_cancel_delayed_sched_scan(wpa_s);
@@ -814,6 +832,9 @@ void wpa_supplicant_set_state(struct wpa_supplicant *wpa_s,
 		 */
 		wpas_p2p_indicate_state_change(wpa_s);
 
+		scan_plan_state_changed(wpa_s->scan_plan, wpa_s->wpa_state);
+		roam_cand_state_changed(wpa_s->roam_cand, wpa_s->wpa_state);
+
 		if (wpa_s->wpa_state == WPA_COMPLETED ||
 		    old_state == WPA_COMPLETED)
 			wpas_notify_auth_changed(wpa_s);
@@ -934,6 +955,9 @@ int wpa_supplicant_reload_configuration(struct wpa_supplicant *wpa_s)
 	old_ap_scan = wpa_s->conf->ap_scan;
 	wpa_config_free(wpa_s->conf);
 	wpa_s->conf = conf;
+#ifdef CONFIG_INTERWORKING
+	interworking_cred_changed(wpa_s);
+#endif /* CONFIG_INTERWORKING */
 	if (old_ap_scan != wpa_s->conf->ap_scan)
 		wpas_notify_ap_scan_changed(wpa_s);
 
@@ -3347,6 +3371,7 @@ wpa_supplicant_alloc(struct wpa_supplicant *parent)
 	wpa_s->new_connection = 1;
 	wpa_s->parent = parent ? parent : wpa_s;
 	wpa_s->sched_scanning = 0;
+	dl_list_init(&wpa_s->blacklist);
 
 	return wpa_s;
 }
@@ -3912,19 +3937,122 @@ static void radio_work_free(struct wpa_radio_work *work)
 }
 
 
+/*
+ * Scheduling parameters for each class of radio work. Pending works are kept
+ * in the order of priority and a work that has waited for longer than its
+ * deadline is started ahead of all other pending works. Only works that are
+ * not exclusive and that use the same known channel may run concurrently.
+ * Offchannel Action frame exchanges and P2P Listen are exclusive since there
+ * is only a single pending offchannel TX and remain-on-channel operation per
+ * interface; the GAS queries to a single channel are combined into one work
+ * in gas_query.c instead. Preemptible works that are already running are
+ * aborted when a connection work is added.
+ */
+static const struct radio_work_class_params {
+	const char *name;
+	int prio;
+	unsigned int deadline; /* ms; 0 = none */
+	unsigned int exclusive:1;
+	unsigned int preemptible:1;
+} radio_work_classes[NUM_RADIO_WORK_CLASSES] = {
+	[RADIO_WORK_CONNECT] = { "connect", 4, 0, 1, 0 },
+	[RADIO_WORK_P2P_ACTION] = { "p2p-send-action", 3, 0, 1, 0 },
+	[RADIO_WORK_GAS] = { "gas-query", 2, 5000, 1, 0 },
+	[RADIO_WORK_P2P_LISTEN] = { "p2p-listen", 2, 5000, 1, 0 },
+	[RADIO_WORK_OTHER] = { "other", 2, 0, 0, 0 },
+	[RADIO_WORK_SCAN] = { "scan", 1, 10000, 1, 1 },
+};
+
+
+static enum radio_work_class radio_work_get_class(const char *type)
+{
+	if (os_strcmp(type, "connect") == 0 ||
+	    os_strcmp(type, "sme-connect") == 0)
+		return RADIO_WORK_CONNECT;
+	if (os_strcmp(type, "p2p-send-action") == 0)
+		return RADIO_WORK_P2P_ACTION;
+	if (os_strcmp(type, "gas-query") == 0)
+		return RADIO_WORK_GAS;
+	if (os_strcmp(type, "p2p-listen") == 0)
+		return RADIO_WORK_P2P_LISTEN;
+	if (os_strcmp(type, "scan") == 0 || os_strcmp(type, "p2p-scan") == 0)
+		return RADIO_WORK_SCAN;
+	return RADIO_WORK_OTHER;
+}
+
+
+static int radio_work_exclusive(struct wpa_radio_work *work)
+{
+	return work->freq == 0 || radio_work_classes[work->cls].exclusive;
+}
+
+
+/* Whether the work can be started next to the works already in progress */
+static int radio_work_compatible(struct wpa_radio *radio,
+				 struct wpa_radio_work *work)
+{
+	struct wpa_radio_work *active;
+
+	dl_list_for_each(active, &radio->work, struct wpa_radio_work, list) {
+		if (!active->started)
+			continue;
+		if (radio_work_exclusive(active) ||
+		    radio_work_exclusive(work) || active->freq != work->freq)
+			return 0;
+	}
+
+	return 1;
+}
+
+
+static int radio_work_expired(struct wpa_radio_work *work,
+			      struct os_reltime *now)
+{
+	unsigned int deadline = radio_work_classes[work->cls].deadline;
+	struct os_reltime diff;
+
+	if (!deadline || work->started)
+		return 0;
+	os_reltime_sub(now, &work->time, &diff);
+	return diff.sec * 1000 + diff.usec / 1000 >= deadline;
+}
+
+
+static struct wpa_radio_work * radio_get_next_work(struct wpa_radio *radio,
+						   struct os_reltime *now)
+{
+	struct wpa_radio_work *work;
+
+	/* Works that have waited past their deadline go first; do not start
+	 * anything else while the first one of them cannot be started */
+	dl_list_for_each(work, &radio->work, struct wpa_radio_work, list) {
+		if (radio_work_expired(work, now))
+			return radio_work_compatible(radio, work) ? work : NULL;
+	}
+
+	dl_list_for_each(work, &radio->work, struct wpa_radio_work, list) {
+		if (work->started)
+			continue;
+		if (radio_work_compatible(radio, work))
+			return work;
+		/* Keep the radio for a blocked exclusive work instead of
+		 * letting works behind it delay it further */
+		if (radio_work_exclusive(work))
+			return NULL;
+	}
+
+	return NULL;
+}
+
+
 static void radio_start_next_work(void *eloop_ctx, void *timeout_ctx)
 {
 	struct wpa_radio *radio = eloop_ctx;
 	struct wpa_radio_work *work;
 	struct os_reltime now, diff;
 	struct wpa_supplicant *wpa_s;
-
-	work = dl_list_first(&radio->work, struct wpa_radio_work, list);
-	if (work == NULL)
-		return;
-
-	if (work->started)
-		return; /* already started and still in progress */
+	struct radio_work_stats *stats;
+	u64 wait;
 
 	wpa_s = dl_list_first(&radio->ifaces, struct wpa_supplicant,
 			      radio_list);
@@ -3934,12 +4062,48 @@ static void radio_start_next_work(void *eloop_ctx, void *timeout_ctx)
 	}
 
 	os_get_reltime(&now);
-	os_reltime_sub(&now, &work->time, &diff);
-	wpa_dbg(work->wpa_s, MSG_DEBUG, "Starting radio work '%s'@%p after %ld.%06ld second wait",
-		work->type, work, diff.sec, diff.usec);
-	work->started = 1;
-	work->time = now;
-	work->cb(work, 0);
+	/* The callback may add or remove works, so search again after each
+	 * started work */
+	while ((work = radio_get_next_work(radio, &now))) {
+		os_reltime_sub(&now, &work->time, &diff);
+		wpa_dbg(work->wpa_s, MSG_DEBUG, "Starting radio work '%s'@%p after %ld.%06ld second wait",
+			work->type, work, diff.sec, diff.usec);
+		wait = (u64) diff.sec * 1000000 + diff.usec;
+		stats = &radio->stats[work->cls];
+		stats->started++;
+		stats->wait_total_us += wait;
+		if (wait > stats->max_wait_us)
+			stats->max_wait_us = wait;
+		work->started = 1;
+		work->time = now;
+		wpa_s = work->wpa_s;
+		work->cb(work, 0);
+		if (wpa_s->ext_work_in_progress)
+			break;
+	}
+}
+
+
+/* Abort preemptible works in progress to release the radio for the work */
+static void radio_preempt_works(struct wpa_radio *radio,
+				struct wpa_radio_work *work)
+{
+	struct wpa_radio_work *active;
+
+	dl_list_for_each(active, &radio->work, struct wpa_radio_work, list) {
+		if (!active->started || active->preempted ||
+		    !radio_work_classes[active->cls].preemptible ||
+		    radio_work_classes[active->cls].prio >=
+		    radio_work_classes[work->cls].prio)
+			continue;
+		wpa_dbg(active->wpa_s, MSG_DEBUG,
+			"Abort radio work '%s'@%p for '%s'@%p",
+			active->type, active, work->type, work);
+		if (wpa_drv_abort_scan(active->wpa_s) < 0)
+			continue;
+		active->preempted = 1;
+		radio->stats[active->cls].preempted++;
+	}
 }
 
 
@@ -4001,6 +4165,16 @@ static void radio_remove_interface(struct wpa_supplicant *wpa_s)
 }
 
 
+#ifdef CONFIG_MODULE_TESTS
+/* Start the pending radio works without going through eloop */
+void radio_work_run_pending(struct wpa_radio *radio)
+{
+	eloop_cancel_timeout(radio_start_next_work, radio, NULL);
+	radio_start_next_work(radio, NULL);
+}
+#endif /* CONFIG_MODULE_TESTS */
+
+
 void radio_work_check_next(struct wpa_supplicant *wpa_s)
 {
 	struct wpa_radio *radio = wpa_s->radio;
@@ -4041,14 +4215,18 @@ void radio_work_check_next(struct wpa_supplicant *wpa_s)
  * operations to be performed in parallel if they apply for the same channel.
  * Setting this to 0 indicates that the work item may use multiple channels or
  * requires exclusive control of the radio.
+ *
+ * Pending work items are started in the order of the priority of their type
+ * (see radio_work_classes[]). @next moves the work ahead of the other pending
+ * works with the same priority.
  */
 int radio_add_work(struct wpa_supplicant *wpa_s, unsigned int freq,
 		   const char *type, int next,
 		   void (*cb)(struct wpa_radio_work *work, int deinit),
 		   void *ctx)
 {
-	struct wpa_radio_work *work;
-	int was_empty;
+	struct wpa_radio_work *work, *pos, *before;
+	int was_empty, prio;
 
 	work = os_zalloc(sizeof(*work));
 	if (work == NULL)
@@ -4060,15 +4238,39 @@ int radio_add_work(struct wpa_supplicant *wpa_s, unsigned int freq,
 	work->wpa_s = wpa_s;
 	work->cb = cb;
 	work->ctx = ctx;
+	work->cls = radio_work_get_class(type);
+	prio = radio_work_classes[work->cls].prio;
 
+	/* Insert after all the works with a higher priority (or the same
+	 * priority, unless next is set) that have not yet been started */
 	was_empty = dl_list_empty(&wpa_s->radio->work);
-	if (next)
-		dl_list_add(&wpa_s->radio->work, &work->list);
+	before = NULL;
+	dl_list_for_each(pos, &wpa_s->radio->work, struct wpa_radio_work,
+			 list) {
+		int pos_prio = radio_work_classes[pos->cls].prio;
+
+		if (pos->started)
+			continue;
+		if (pos_prio < prio || (next && pos_prio == prio)) {
+			before = pos;
+			break;
+		}
+	}
+	if (before)
+		dl_list_add_tail(&before->list, &work->list);
 	else
 		dl_list_add_tail(&wpa_s->radio->work, &work->list);
+
+	if (radio_work_classes[work->cls].exclusive &&
+	    !radio_work_classes[work->cls].preemptible)
+		radio_preempt_works(wpa_s->radio, work);
+
 	if (was_empty) {
 		wpa_dbg(wpa_s, MSG_DEBUG, "First radio work item in the queue - schedule start immediately");
 		radio_work_check_next(wpa_s);
+	} else if (!radio_work_exclusive(work)) {
+		/* May be able to run next to the works in progress */
+		radio_work_check_next(wpa_s);
 	}
 
 	return 0;
@@ -4099,6 +4301,44 @@ void radio_work_done(struct wpa_radio_work *work)
 }
 
 
+/**
+ * radio_work_stats - Show queue wait statistics for radio work classes
+ * @radio: Radio data
+ * @buf: Buffer for the text
+ * @buflen: Length of the buffer
+ * Returns: Number of characters written to buf
+ */
+int radio_work_stats(struct wpa_radio *radio, char *buf, size_t buflen)
+{
+	char *pos = buf, *end = buf + buflen;
+	int i, ret, pending;
+	struct wpa_radio_work *work;
+
+	for (i = 0; i < NUM_RADIO_WORK_CLASSES; i++) {
+		struct radio_work_stats *stats = &radio->stats[i];
+
+		pending = 0;
+		dl_list_for_each(work, &radio->work, struct wpa_radio_work,
+				 list) {
+			if (work->cls == i && !work->started)
+				pending++;
+		}
+		ret = os_snprintf(pos, end - pos,
+				  "%s started=%u pending=%d preempted=%u avg_wait_us=%llu max_wait_us=%llu\n",
+				  radio_work_classes[i].name, stats->started,
+				  pending, stats->preempted,
+				  stats->started ? (unsigned long long)
+				  (stats->wait_total_us / stats->started) : 0ULL,
+				  (unsigned long long) stats->max_wait_us);
+		if (os_snprintf_error(end - pos, ret))
+			break;
+		pos += ret;
+	}
+
+	return pos - buf;
+}
+
+
 struct wpa_radio_work *
 radio_work_pending(struct wpa_supplicant *wpa_s, const char *type)
 {
@@ -4432,6 +4672,36 @@ static int wpa_supplicant_init_iface(struct wpa_supplicant *wpa_s,
 	if (wpa_bss_init(wpa_s) < 0)
 		return -1;
 
+#ifdef CONFIG_INTERWORKING
+	if (wpa_s->conf->anqp_cache_file) {
+		wpa_s->anqp_cache = anqp_cache_init(wpa_s->conf->anqp_cache_file,
+						    wpa_s->conf->anqp_cache_size,
+						    wpa_s->conf->anqp_cache_ttl);
+		if (wpa_s->anqp_cache == NULL)
+			wpa_msg(wpa_s, MSG_INFO,
+				"Failed to initialize ANQP cache");
+	}
+#endif /* CONFIG_INTERWORKING */
+
+#ifdef CONFIG_SCAN_PLAN
+	if (wpa_s->conf->scan_plan && !iface->p2p_mgmt) {
+		wpa_s->scan_plan = scan_plan_init(wpa_s,
+						  wpa_s->conf->scan_plan_file);
+		if (wpa_s->scan_plan == NULL)
+			wpa_msg(wpa_s, MSG_INFO,
+				"Failed to initialize scan planner");
+	}
+#endif /* CONFIG_SCAN_PLAN */
+
+#ifdef CONFIG_ROAM_CAND
+	if (wpa_s->conf->roam_cand && !iface->p2p_mgmt) {
+		wpa_s->roam_cand = roam_cand_init(wpa_s);
+		if (wpa_s->roam_cand == NULL)
+			wpa_msg(wpa_s, MSG_INFO,
+				"Failed to initialize roaming candidate cache");
+	}
+#endif /* CONFIG_ROAM_CAND */
+
 	/*
 	 * Set Wake-on-WLAN triggers, if configured.
 	 * Note: We don't restore/remove the triggers on shutdown (it doesn't
@@ -4950,6 +5220,7 @@ void wpa_supplicant_deinit(struct wpa_global *global)
 	os_free(global->drv_priv);
 
 	random_deinit();
+	frame_pool_deinit();
 
 	eloop_destroy();
 
@@ -5612,6 +5883,8 @@ void wpas_rrm_process_neighbor_rep(struct wpa_supplicant *wpa_s,
 	eloop_cancel_timeout(wpas_rrm_neighbor_rep_timeout_handler, &wpa_s->rrm,
 			     NULL);
 
+	roam_cand_neighbor_report(wpa_s->roam_cand, report + 1, report_len - 1);
+
 	if (!wpa_s->rrm.notify_neighbor_rep) {
 		wpa_printf(MSG_ERROR, "RRM: Unexpected neighbor report");
 		return;
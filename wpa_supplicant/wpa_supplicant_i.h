@@ -289,6 +289,30 @@ struct wpa_global {
 };
 
 
+/**
+ * enum radio_work_class - Scheduling class of a radio work item
+ *
+ * The class is determined from the work type. It defines the priority of the
+ * work, how long it may wait before it is started ahead of other works, and
+ * whether it can share the radio with other works on the same channel.
+ */
+enum radio_work_class {
+	RADIO_WORK_CONNECT, /* "connect", "sme-connect" */
+	RADIO_WORK_P2P_ACTION, /* "p2p-send-action" */
+	RADIO_WORK_GAS, /* "gas-query" */
+	RADIO_WORK_P2P_LISTEN, /* "p2p-listen" */
+	RADIO_WORK_OTHER, /* external works and unknown types */
+	RADIO_WORK_SCAN, /* "scan", "p2p-scan" */
+	NUM_RADIO_WORK_CLASSES
+};
+
+struct radio_work_stats {
+	unsigned int started;
+	unsigned int preempted;
+	u64 wait_total_us;
+	u64 max_wait_us;
+};
+
 /**
  * struct wpa_radio - Internal data for per-radio information
  *
@@ -301,7 +325,9 @@ struct wpa_radio {
 			* available */
 	unsigned int external_scan_running:1;
 	struct dl_list ifaces; /* struct wpa_supplicant::radio_list entries */
-	struct dl_list work; /* struct wpa_radio_work::list entries */
+	struct dl_list work; /* struct wpa_radio_work::list entries in the order
+			      * of priority */
+	struct radio_work_stats stats[NUM_RADIO_WORK_CLASSES];
 };
 
 /**
@@ -314,7 +340,9 @@ struct wpa_radio_work {
 	struct wpa_supplicant *wpa_s;
 	void (*cb)(struct wpa_radio_work *work, int deinit);
 	void *ctx;
+	enum radio_work_class cls;
 	unsigned int started:1;
+	unsigned int preempted:1; /* abort requested for a higher priority work */
 	struct os_reltime time;
 };
 
@@ -328,6 +356,10 @@ void radio_remove_works(struct wpa_supplicant *wpa_s,
 void radio_work_check_next(struct wpa_supplicant *wpa_s);
 struct wpa_radio_work *
 radio_work_pending(struct wpa_supplicant *wpa_s, const char *type);
+int radio_work_stats(struct wpa_radio *radio, char *buf, size_t buflen);
+#ifdef CONFIG_MODULE_TESTS
+void radio_work_run_pending(struct wpa_radio *radio);
+#endif /* CONFIG_MODULE_TESTS */
 
 struct wpa_connect_work {
 	unsigned int sme:1;
@@ -508,6 +540,9 @@ struct wpa_supplicant {
 				 struct wpa_scan_results *scan_res);
 	struct dl_list bss; /* struct wpa_bss::list */
 	struct dl_list bss_id; /* struct wpa_bss::list_id */
+#define BSS_HASH_SIZE 256
+#define BSS_HASH(bssid) ((bssid)[5])
+	struct dl_list bss_hash[BSS_HASH_SIZE]; /* struct wpa_bss::list_hash */
 	size_t num_bss;
 	unsigned int bss_update_idx;
 	unsigned int bss_next_id;
@@ -547,7 +582,11 @@ struct wpa_supplicant {
 	unsigned int keys_cleared; /* bitfield of key indexes that the driver is
 				    * known not to be configured with a key */
 
-	struct wpa_blacklist *blacklist;
+	/* struct wpa_blacklist entries in the order they decay */
+	struct dl_list blacklist;
+#define BLACKLIST_HASH_SIZE 64
+#define BLACKLIST_HASH(a) (((a)[4] ^ (a)[5]) & (BLACKLIST_HASH_SIZE - 1))
+	struct wpa_blacklist *blacklist_hash[BLACKLIST_HASH_SIZE];
 
 	/**
 	 * extra_blacklist_count - Sum of blacklist counts after last connection
@@ -891,7 +930,17 @@ struct wpa_supplicant {
 	struct os_reltime osu_icon_fetch_start;
 	unsigned int num_osu_scans;
 	unsigned int num_prov_found;
+	struct os_reltime network_select_start;
+	struct os_reltime anqp_fetch_start;
+	unsigned int anqp_fetch_time; /* ms */
+	unsigned int anqp_fetch_queries;
+	unsigned int anqp_fetch_channels;
+	unsigned int anqp_fetch_shared;
+	struct anqp_cache *anqp_cache;
+	struct anqp_cred_match *cred_match;
 #endif /* CONFIG_INTERWORKING */
+	struct scan_plan *scan_plan;
+	struct roam_cand *roam_cand;
 	unsigned int drv_capa_known;
 
 	struct {
@@ -10,15 +10,29 @@
 
 #include "utils/common.h"
 #include "wpa_supplicant_i.h"
+#include "drivers/driver.h"
+#include "config.h"
+#include "scan.h"
 #include "blacklist.h"
+#include "scan_plan.h"
+#include "roam_cand.h"
+#include "bss.h"
+#include "interworking.h"
+#include "anqp_match.h"
+#include "eap_common/eap_defs.h"
 
 
 static int wpas_blacklist_module_tests(void)
 {
 	struct wpa_supplicant wpa_s;
+	struct wpa_blacklist *e;
+	struct os_reltime start, now, diff;
+	u8 bssid[ETH_ALEN];
+	unsigned int i, count;
 	int ret = -1;
 
 	os_memset(&wpa_s, 0, sizeof(wpa_s));
+	dl_list_init(&wpa_s.blacklist);
 
 	wpa_blacklist_clear(&wpa_s);
 
@@ -58,6 +72,62 @@ static int wpas_blacklist_module_tests(void)
 	    wpa_blacklist_add(&wpa_s, (u8 *) "333333") < 0)
 		goto fail;
 
+	/* Entries in the same hash bucket */
+	if (wpa_blacklist_add(&wpa_s, (u8 *) "a11111") < 0 ||
+	    wpa_blacklist_add(&wpa_s, (u8 *) "b11111") < 0 ||
+	    wpa_blacklist_del(&wpa_s, (u8 *) "111111") < 0 ||
+	    wpa_blacklist_get(&wpa_s, (u8 *) "111111") != NULL ||
+	    wpa_blacklist_get(&wpa_s, (u8 *) "a11111") == NULL ||
+	    wpa_blacklist_get(&wpa_s, (u8 *) "b11111") == NULL ||
+	    wpa_blacklist_del(&wpa_s, (u8 *) "b11111") < 0 ||
+	    wpa_blacklist_get(&wpa_s, (u8 *) "a11111") == NULL)
+		goto fail;
+
+	if (wpa_blacklist_add(&wpa_s, (u8 *) "555555") != 1 ||
+	    wpa_blacklist_add(&wpa_s, (u8 *) "555555") != 2 ||
+	    wpa_blacklist_add_manual(&wpa_s, (u8 *) "666666") != 2 ||
+	    wpa_blacklist_add(&wpa_s, (u8 *) "666666") != 3)
+		goto fail;
+
+	/* Expired entries decay one count at a time; manual entries do not */
+	for (i = 0; i < 2; i++) {
+		dl_list_for_each(e, &wpa_s.blacklist, struct wpa_blacklist,
+				 list) {
+			if (!e->manual)
+				e->expire.sec -= BLACKLIST_DECAY_MAX + 1;
+		}
+		wpa_blacklist_update(&wpa_s);
+	}
+	e = wpa_blacklist_get(&wpa_s, (u8 *) "666666");
+	if (wpa_blacklist_get(&wpa_s, (u8 *) "222222") != NULL ||
+	    wpa_blacklist_get(&wpa_s, (u8 *) "555555") != NULL ||
+	    e == NULL || e->count != 3 ||
+	    dl_list_len(&wpa_s.blacklist) != 1)
+		goto fail;
+
+	/* Scan result processing with a large blacklist */
+	wpa_blacklist_clear(&wpa_s);
+	for (i = 0; i < 1000; i++) {
+		bssid[0] = 0x02;
+		WPA_PUT_BE32(&bssid[2], i * 2);
+		if (wpa_blacklist_add(&wpa_s, bssid) < 0)
+			goto fail;
+	}
+	os_get_reltime(&start);
+	count = 0;
+	for (i = 0; i < 100 * 2000; i++) {
+		WPA_PUT_BE32(&bssid[2], i % 2000);
+		if (wpa_blacklist_get(&wpa_s, bssid))
+			count++;
+	}
+	os_get_reltime(&now);
+	os_reltime_sub(&now, &start, &diff);
+	wpa_printf(MSG_INFO,
+		   "blacklist: 100 scans of 2000 BSSes against 1000 entries in %u usec",
+		   (unsigned int) (diff.sec * 1000000 + diff.usec));
+	if (count != 100 * 1000)
+		goto fail;
+
 	ret = 0;
 fail:
 	wpa_blacklist_clear(&wpa_s);
@@ -69,6 +139,660 @@ fail:
 }
 
 
+static const char *radio_test_started[10];
+static unsigned int radio_test_num_started;
+static unsigned int radio_test_aborts;
+
+
+static void radio_test_cb(struct wpa_radio_work *work, int deinit)
+{
+	if (deinit)
+		return;
+	if (radio_test_num_started < ARRAY_SIZE(radio_test_started))
+		radio_test_started[radio_test_num_started] = work->type;
+	radio_test_num_started++;
+}
+
+
+static int radio_test_abort_scan(void *priv)
+{
+	radio_test_aborts++;
+	return 0;
+}
+
+
+static struct wpa_radio_work * radio_test_work(struct wpa_radio *radio,
+					       const char *type)
+{
+	struct wpa_radio_work *work;
+
+	dl_list_for_each(work, &radio->work, struct wpa_radio_work, list) {
+		if (os_strcmp(work->type, type) == 0)
+			return work;
+	}
+
+	return NULL;
+}
+
+
+static int radio_test_started_only(const char *a, const char *b)
+{
+	if (radio_test_num_started != (b ? 2 : 1) ||
+	    os_strcmp(radio_test_started[0], a) != 0 ||
+	    (b && os_strcmp(radio_test_started[1], b) != 0))
+		return 0;
+	radio_test_num_started = 0;
+	return 1;
+}
+
+
+static int wpas_radio_work_module_tests(void)
+{
+	struct wpa_global global;
+	struct wpa_supplicant wpa_s;
+	struct wpa_driver_ops driver;
+	struct wpa_radio radio;
+	struct wpa_radio_work *work;
+	char buf[500];
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "radio work tests");
+
+	os_memset(&global, 0, sizeof(global));
+	os_memset(&wpa_s, 0, sizeof(wpa_s));
+	os_memset(&driver, 0, sizeof(driver));
+	os_memset(&radio, 0, sizeof(radio));
+	wpa_s.global = &global;
+	wpa_s.driver = &driver;
+	driver.abort_scan = radio_test_abort_scan;
+	dl_list_init(&radio.ifaces);
+	dl_list_init(&radio.work);
+	dl_list_add(&radio.ifaces, &wpa_s.radio_list);
+	wpa_s.radio = &radio;
+	radio_test_num_started = 0;
+	radio_test_aborts = 0;
+
+	/* Pending works are started in the order of priority */
+	if (radio_add_work(&wpa_s, 0, "scan", 0, radio_test_cb, NULL) < 0 ||
+	    radio_add_work(&wpa_s, 2412, "gas-query", 0, radio_test_cb,
+			   NULL) < 0 ||
+	    radio_add_work(&wpa_s, 0, "connect", 0, radio_test_cb, NULL) < 0)
+		goto fail;
+	radio_work_run_pending(&radio);
+	if (!radio_test_started_only("connect", NULL))
+		goto fail;
+	radio_work_done(radio_test_work(&radio, "connect"));
+	radio_work_run_pending(&radio);
+	if (!radio_test_started_only("gas-query", NULL))
+		goto fail;
+	radio_work_done(radio_test_work(&radio, "gas-query"));
+	radio_work_run_pending(&radio);
+	if (!radio_test_started_only("scan", NULL))
+		goto fail;
+
+	/* Connect preempts the running scan */
+	if (radio_add_work(&wpa_s, 0, "connect", 0, radio_test_cb, NULL) < 0)
+		goto fail;
+	work = radio_test_work(&radio, "scan");
+	if (radio_test_aborts != 1 || !work || !work->preempted)
+		goto fail;
+	radio_work_run_pending(&radio);
+	if (radio_test_num_started)
+		goto fail;
+	radio_work_done(work);
+	radio_work_run_pending(&radio);
+	if (!radio_test_started_only("connect", NULL))
+		goto fail;
+	radio_work_done(radio_test_work(&radio, "connect"));
+
+	/* Offchannel works are exclusive even on the same channel while
+	 * external works on the same channel may run concurrently */
+	if (radio_add_work(&wpa_s, 2412, "gas-query", 0, radio_test_cb,
+			   NULL) < 0 ||
+	    radio_add_work(&wpa_s, 2412, "p2p-listen", 0, radio_test_cb,
+			   NULL) < 0)
+		goto fail;
+	radio_work_run_pending(&radio);
+	if (!radio_test_started_only("gas-query", NULL))
+		goto fail;
+	radio_work_done(radio_test_work(&radio, "gas-query"));
+	radio_work_run_pending(&radio);
+	if (!radio_test_started_only("p2p-listen", NULL))
+		goto fail;
+	radio_work_done(radio_test_work(&radio, "p2p-listen"));
+	if (radio_add_work(&wpa_s, 2412, "ext:a", 0, radio_test_cb,
+			   NULL) < 0 ||
+	    radio_add_work(&wpa_s, 2412, "ext:b", 0, radio_test_cb,
+			   NULL) < 0)
+		goto fail;
+	radio_work_run_pending(&radio);
+	if (!radio_test_started_only("ext:a", "ext:b"))
+		goto fail;
+	radio_work_done(radio_test_work(&radio, "ext:a"));
+	radio_work_done(radio_test_work(&radio, "ext:b"));
+
+	/* A scan past its deadline goes ahead of higher priority works and
+	 * long waits are reported without overflow */
+	if (radio_add_work(&wpa_s, 2412, "gas-query", 0, radio_test_cb,
+			   NULL) < 0 ||
+	    radio_add_work(&wpa_s, 0, "scan", 0, radio_test_cb, NULL) < 0)
+		goto fail;
+	work = radio_test_work(&radio, "scan");
+	if (!work)
+		goto fail;
+	work->time.sec -= 5000;
+	radio_work_run_pending(&radio);
+	if (!radio_test_started_only("scan", NULL))
+		goto fail;
+	if (radio_work_stats(&radio, buf, sizeof(buf)) <= 0 ||
+	    os_strstr(buf, "scan started=2 pending=0 preempted=1 ") == NULL ||
+	    os_strstr(buf, "max_wait_us=5000") == NULL ||
+	    os_strstr(buf, "gas-query started=2 pending=1 ") == NULL)
+		goto fail;
+
+	ret = 0;
+fail:
+	radio_remove_works(&wpa_s, NULL, 1);
+	radio_work_run_pending(&radio);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "radio work module test failure");
+
+	return ret;
+}
+
+
+#if defined(CONFIG_SCAN_PLAN) || defined(CONFIG_ROAM_CAND)
+
+static struct wpa_scan_res * scan_plan_test_res(const char *ssid, int freq)
+{
+	struct wpa_scan_res *res;
+	size_t len = os_strlen(ssid);
+	u8 *ie;
+
+	res = os_zalloc(sizeof(*res) + 2 + len);
+	if (res == NULL)
+		return NULL;
+	res->freq = freq;
+	res->ie_len = 2 + len;
+	ie = (u8 *) (res + 1);
+	ie[0] = WLAN_EID_SSID;
+	ie[1] = len;
+	os_memcpy(ie + 2, ssid, len);
+
+	return res;
+}
+
+#endif /* CONFIG_SCAN_PLAN || CONFIG_ROAM_CAND */
+
+
+#ifdef CONFIG_SCAN_PLAN
+
+static int wpas_scan_plan_module_tests(void)
+{
+	struct wpa_global global;
+	struct wpa_supplicant wpa_s;
+	struct wpa_config conf;
+	struct wpa_ssid ssid1, ssid2;
+	struct wpa_scan_results scan_res;
+	struct wpa_scan_res *res[3];
+	struct scan_plan *plan;
+	int *freqs = NULL, scanned[] = { 2437, 0 };
+	char buf[500];
+	int ret = -1;
+
+	os_memset(&global, 0, sizeof(global));
+	os_memset(&wpa_s, 0, sizeof(wpa_s));
+	os_memset(&conf, 0, sizeof(conf));
+	os_memset(&ssid1, 0, sizeof(ssid1));
+	os_memset(&ssid2, 0, sizeof(ssid2));
+	wpa_s.global = &global;
+	wpa_s.conf = &conf;
+	wpa_s.wpa_state = WPA_SCANNING;
+	conf.scan_plan_full_interval = 3600;
+	conf.ssid = &ssid1;
+	ssid1.next = &ssid2;
+	ssid1.ssid = (u8 *) "home";
+	ssid1.ssid_len = 4;
+	ssid1.key_mgmt = WPA_KEY_MGMT_NONE;
+	ssid2.ssid = (u8 *) "work";
+	ssid2.ssid_len = 4;
+	ssid2.key_mgmt = WPA_KEY_MGMT_NONE;
+	ssid2.disabled = 1;
+
+	res[0] = scan_plan_test_res("home", 2437);
+	res[1] = scan_plan_test_res("home", 5180);
+	res[2] = scan_plan_test_res("other", 2412);
+	scan_res.res = res;
+	scan_res.num = 3;
+
+	plan = scan_plan_init(&wpa_s, NULL);
+	if (plan == NULL || !res[0] || !res[1] || !res[2])
+		goto fail;
+
+	/* No channel history for an enabled network */
+	freqs = scan_plan_freqs(plan, SCAN_PLAN_CONNECT);
+	if (freqs)
+		goto fail;
+
+	/* Only the configured SSID is learned */
+	scan_plan_update(plan, &scan_res);
+	freqs = scan_plan_ess_freqs(plan, (u8 *) "other", 5);
+	if (freqs)
+		goto fail;
+	freqs = scan_plan_freqs(plan, SCAN_PLAN_CONNECT);
+	if (freqs == NULL || int_array_len(freqs) != 2 ||
+	    freqs[0] != 2437 || freqs[1] != 5180)
+		goto fail;
+	os_free(freqs);
+
+	/* All channels after a limited scan without connection */
+	freqs = scan_plan_freqs(plan, SCAN_PLAN_CONNECT);
+	if (freqs)
+		goto fail;
+	freqs = scan_plan_freqs(plan, SCAN_PLAN_CONNECT);
+	if (freqs == NULL)
+		goto fail;
+	os_free(freqs);
+	freqs = NULL;
+
+	/* Connection statistics */
+	scan_plan_scan_started(plan, scanned);
+	wpa_s.wpa_state = WPA_COMPLETED;
+	scan_plan_state_changed(plan, WPA_COMPLETED);
+	if (scan_plan_status(plan, buf, sizeof(buf)) <= 0 ||
+	    os_strstr(buf, "connections=1\n") == NULL ||
+	    os_strstr(buf, "last_connect_channels=1\n") == NULL ||
+	    os_strstr(buf, "ssid=home channels=2437:1,5180:1\n") == NULL)
+		goto fail;
+
+	/* A newly enabled network without history needs all channels */
+	ssid2.disabled = 0;
+	freqs = scan_plan_freqs(plan, SCAN_PLAN_CONNECT);
+	if (freqs)
+		goto fail;
+
+	ret = 0;
+fail:
+	os_free(freqs);
+	scan_plan_deinit(plan);
+	os_free(res[0]);
+	os_free(res[1]);
+	os_free(res[2]);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "scan plan module test failure");
+
+	return ret;
+}
+
+#endif /* CONFIG_SCAN_PLAN */
+
+
+#ifdef CONFIG_ROAM_CAND
+
+static int wpas_roam_cand_module_tests(void)
+{
+	struct wpa_global global;
+	struct wpa_supplicant wpa_s;
+	struct wpa_config conf;
+	struct wpa_ssid ssid;
+	struct wpa_scan_results scan_res;
+	struct wpa_scan_res *res[3];
+	struct roam_cand *rc;
+	char buf[1000], *pos;
+	const u8 cur[ETH_ALEN] = { 0x02, 0, 0, 0, 0, 0x01 };
+	const u8 nei[] = {
+		WLAN_EID_NEIGHBOR_REPORT, 16,
+		0x02, 0, 0, 0, 0, 0x04, /* BSSID */
+		0, 0, 0, 0, /* BSSID Information */
+		115, 36, 0, /* Operating Class, Channel, PHY Type */
+		WNM_NEIGHBOR_BSS_TRANSITION_CANDIDATE, 1, 255
+	};
+	unsigned int i;
+	int ret = -1;
+
+	os_memset(&global, 0, sizeof(global));
+	os_memset(&wpa_s, 0, sizeof(wpa_s));
+	os_memset(&conf, 0, sizeof(conf));
+	os_memset(&ssid, 0, sizeof(ssid));
+	wpa_s.global = &global;
+	wpa_s.conf = &conf;
+	conf.ap_scan = 1;
+	wpa_s.wpa_state = WPA_COMPLETED;
+	wpa_s.current_ssid = &ssid;
+	wpa_s.assoc_freq = 2437;
+	os_memcpy(wpa_s.bssid, cur, ETH_ALEN);
+	ssid.ssid = (u8 *) "home";
+	ssid.ssid_len = 4;
+
+	res[0] = scan_plan_test_res("home", 2437);
+	res[1] = scan_plan_test_res("home", 2412);
+	res[2] = scan_plan_test_res("home", 5180);
+	scan_res.res = res;
+	scan_res.num = 3;
+
+	rc = roam_cand_init(&wpa_s);
+	if (rc == NULL || !res[0] || !res[1] || !res[2])
+		goto fail;
+
+	for (i = 0; i < 3; i++) {
+		os_memcpy(res[i]->bssid, cur, ETH_ALEN);
+		res[i]->bssid[5] += i;
+		res[i]->flags = WPA_SCAN_LEVEL_DBM;
+	}
+	res[0]->level = -70;
+	res[1]->level = -65;
+	res[2]->level = -60;
+
+	/* Ranked by signal level; current AP is not a candidate */
+	roam_cand_scan_results(rc, &scan_res);
+	if (roam_cand_status(rc, buf, sizeof(buf)) <= 0 ||
+	    (pos = os_strstr(buf, "\nbssid=")) == NULL ||
+	    os_strncmp(pos, "\nbssid=02:00:00:00:00:03 freq=5180", 34) != 0 ||
+	    os_strstr(buf, "bssid=02:00:00:00:00:01") != NULL ||
+	    os_strstr(buf, "current=02:00:00:00:00:01 level=-70") == NULL)
+		goto fail;
+
+	/* Signal trend changes the ranking */
+	res[1]->level = -60;
+	res[2]->level = -64;
+	roam_cand_scan_results(rc, &scan_res);
+	if (roam_cand_status(rc, buf, sizeof(buf)) <= 0 ||
+	    (pos = os_strstr(buf, "\nbssid=")) == NULL ||
+	    os_strncmp(pos, "\nbssid=02:00:00:00:00:02", 24) != 0)
+		goto fail;
+
+	/* Neighbor report with preference */
+	roam_cand_neighbor_report(rc, nei, sizeof(nei));
+	if (roam_cand_status(rc, buf, sizeof(buf)) <= 0 ||
+	    os_strstr(buf, "bssid=02:00:00:00:00:04 freq=5180 level=0 trend=0 pref=255") == NULL)
+		goto fail;
+
+	/* BSS excluded by the AP is removed */
+	roam_cand_btm_cand(rc, res[2]->bssid, 5180, 0);
+	if (roam_cand_status(rc, buf, sizeof(buf)) <= 0 ||
+	    os_strstr(buf, "bssid=02:00:00:00:00:03") != NULL)
+		goto fail;
+
+	/* Roam latency and the previous AP kept as a candidate */
+	roam_cand_roam_started(rc, "test", NULL);
+	os_memcpy(wpa_s.bssid, res[1]->bssid, ETH_ALEN);
+	wpa_s.assoc_freq = 2412;
+	roam_cand_state_changed(rc, WPA_ASSOCIATED);
+	roam_cand_state_changed(rc, WPA_COMPLETED);
+	if (roam_cand_status(rc, buf, sizeof(buf)) <= 0 ||
+	    os_strstr(buf, "roams=1\n") == NULL ||
+	    os_strstr(buf, "last_roam_trigger=test\n") == NULL ||
+	    os_strstr(buf, "current=02:00:00:00:00:02 level=-60") == NULL ||
+	    os_strstr(buf, "bssid=02:00:00:00:00:01 freq=2437 level=-70") ==
+	    NULL)
+		goto fail;
+
+	/* No probe while the current AP signal is good */
+	roam_cand_signal_change(rc, 1, -58);
+	if (wpa_s.next_scan_freqs)
+		goto fail;
+
+	/* Weak and falling signal probes the channel of the best candidate */
+	roam_cand_signal_change(rc, 0, -80);
+	if (wpa_s.next_scan_freqs == NULL ||
+	    int_array_len(wpa_s.next_scan_freqs) != 1 ||
+	    wpa_s.next_scan_freqs[0] != 2437 ||
+	    roam_cand_status(rc, buf, sizeof(buf)) <= 0 ||
+	    os_strstr(buf, "probes=1\n") == NULL)
+		goto fail;
+	os_free(wpa_s.next_scan_freqs);
+	wpa_s.next_scan_freqs = NULL;
+
+	/* Probes are rate limited */
+	roam_cand_signal_change(rc, 0, -82);
+	if (wpa_s.next_scan_freqs)
+		goto fail;
+
+	ret = 0;
+fail:
+	wpa_supplicant_cancel_scan(&wpa_s);
+	os_free(wpa_s.next_scan_freqs);
+	roam_cand_deinit(rc);
+	os_free(res[0]);
+	os_free(res[1]);
+	os_free(res[2]);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "roam cand module test failure");
+
+	return ret;
+}
+
+#endif /* CONFIG_ROAM_CAND */
+
+
+#ifdef CONFIG_INTERWORKING
+
+static void interworking_test_realm(struct wpabuf *buf, const char *name,
+				    u8 method)
+{
+	size_t len = os_strlen(name);
+
+	wpabuf_put_le16(buf, 4 + len + (method == EAP_TYPE_TTLS ? 5 : 2));
+	wpabuf_put_u8(buf, 0); /* NAI Realm Encoding */
+	wpabuf_put_u8(buf, len);
+	wpabuf_put_str(buf, name);
+	wpabuf_put_u8(buf, 1); /* EAP Method Count */
+	if (method == EAP_TYPE_TTLS) {
+		wpabuf_put_u8(buf, 5); /* EAP Method Length */
+		wpabuf_put_u8(buf, method);
+		wpabuf_put_u8(buf, 1); /* Authentication Parameter Count */
+		wpabuf_put_u8(buf, NAI_REALM_EAP_AUTH_NON_EAP_INNER_AUTH);
+		wpabuf_put_u8(buf, 1);
+		wpabuf_put_u8(buf, NAI_REALM_INNER_NON_EAP_MSCHAPV2);
+	} else {
+		wpabuf_put_u8(buf, 2); /* EAP Method Length */
+		wpabuf_put_u8(buf, method);
+		wpabuf_put_u8(buf, 0); /* Authentication Parameter Count */
+	}
+}
+
+
+static struct wpa_bss * interworking_test_bss(const char *ssid)
+{
+	struct wpa_bss *bss;
+
+	bss = os_zalloc(sizeof(*bss));
+	if (bss == NULL)
+		return NULL;
+	bss->ssid_len = os_strlen(ssid);
+	os_memcpy(bss->ssid, ssid, bss->ssid_len);
+	bss->bssid[0] = 0x02;
+	bss->bssid[5] = bss->ssid_len;
+	bss->anqp = wpa_bss_anqp_alloc();
+	if (bss->anqp == NULL) {
+		os_free(bss);
+		return NULL;
+	}
+	return bss;
+}
+
+
+static void interworking_test_bss_free(struct wpa_bss *bss)
+{
+	if (bss == NULL)
+		return;
+	wpa_bss_anqp_free(bss->anqp);
+	os_free(bss);
+}
+
+
+static int interworking_test_sel(struct wpa_supplicant *wpa_s,
+				 struct wpa_bss *bss, struct wpa_cred *cred,
+				 int excluded)
+{
+	int res_excluded = -1;
+
+	/* Compiled credentials and parsed ANQP data are cached */
+	interworking_cred_changed(wpa_s);
+	anqp_parsed_flush(bss->anqp);
+
+	if (interworking_credentials_available(wpa_s, bss, &res_excluded) !=
+	    cred || (cred && res_excluded != excluded)) {
+		wpa_printf(MSG_INFO, "interworking test: unexpected selection on %s (expected cred %d excluded=%d)",
+			   wpa_ssid_txt(bss->ssid, bss->ssid_len),
+			   cred ? cred->id : -1, excluded);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int wpas_interworking_module_tests(void)
+{
+	struct wpa_global global;
+	struct wpa_supplicant wpa_s;
+	struct wpa_config conf;
+	struct wpa_cred cred[4];
+	struct excluded_ssid ex[2];
+	struct wpa_bss *realm_bss, *plmn_bss, *tls_bss;
+	unsigned int i;
+	int ret = -1;
+
+	wpa_printf(MSG_INFO, "interworking module tests");
+
+	os_memset(&global, 0, sizeof(global));
+	os_memset(&wpa_s, 0, sizeof(wpa_s));
+	os_memset(&conf, 0, sizeof(conf));
+	os_memset(cred, 0, sizeof(cred));
+	os_memset(ex, 0, sizeof(ex));
+	wpa_s.global = &global;
+	wpa_s.conf = &conf;
+	conf.ap_scan = 1;
+
+	for (i = 0; i < ARRAY_SIZE(cred); i++) {
+		cred[i].id = i;
+		cred[i].priority = 1;
+		cred[i].username = "user";
+		cred[i].password = "secret";
+		if (i + 1 < ARRAY_SIZE(cred))
+			cred[i].next = &cred[i + 1];
+	}
+	conf.cred = &cred[0];
+	cred[0].realm = "example.com";
+	cred[1].realm = "Example.ORG";
+	os_memcpy(cred[2].roaming_consortium, "\x50\x6f\x9a", 3);
+	cred[2].roaming_consortium_len = 3;
+	cred[3].imsi = "310260-000000000";
+	cred[3].milenage = "milenage";
+	cred[3].priority = 0;
+
+	realm_bss = interworking_test_bss("realm");
+	plmn_bss = interworking_test_bss("plmn");
+	tls_bss = interworking_test_bss("tls");
+	if (realm_bss == NULL || plmn_bss == NULL || tls_bss == NULL)
+		goto fail;
+
+	realm_bss->anqp->nai_realm = wpabuf_alloc(200);
+	plmn_bss->anqp->anqp_3gpp = wpabuf_alloc(20);
+	tls_bss->anqp->nai_realm = wpabuf_alloc(100);
+	if (realm_bss->anqp->nai_realm == NULL ||
+	    plmn_bss->anqp->anqp_3gpp == NULL ||
+	    tls_bss->anqp->nai_realm == NULL)
+		goto fail;
+
+	/* Realms are matched case insensitively within a ';' separated list */
+	wpabuf_put_le16(realm_bss->anqp->nai_realm, 2);
+	interworking_test_realm(realm_bss->anqp->nai_realm,
+				"example.net;EXAMPLE.com", EAP_TYPE_TTLS);
+	interworking_test_realm(realm_bss->anqp->nai_realm, "example.org",
+				EAP_TYPE_TTLS);
+
+	/* Username/password credentials cannot be used with EAP-TLS */
+	wpabuf_put_le16(tls_bss->anqp->nai_realm, 1);
+	interworking_test_realm(tls_bss->anqp->nai_realm, "example.com",
+				EAP_TYPE_TLS);
+
+	/* PLMN 310/260 advertised with only two digits of the MNC */
+	wpabuf_put_u8(plmn_bss->anqp->anqp_3gpp, 0); /* GUD version */
+	wpabuf_put_u8(plmn_bss->anqp->anqp_3gpp, 3 + 3); /* UDHL */
+	wpabuf_put_u8(plmn_bss->anqp->anqp_3gpp, 0); /* PLMN List IEI */
+	wpabuf_put_u8(plmn_bss->anqp->anqp_3gpp, 1 + 3);
+	wpabuf_put_u8(plmn_bss->anqp->anqp_3gpp, 1);
+	wpabuf_put_data(plmn_bss->anqp->anqp_3gpp, "\x13\xf0\x62", 3);
+
+	/* The first credential in configuration order wins a priority tie */
+	if (interworking_test_sel(&wpa_s, realm_bss, &cred[0], 0) < 0 ||
+	    interworking_test_sel(&wpa_s, tls_bss, NULL, 0) < 0)
+		goto fail;
+
+	cred[1].priority = 2;
+	if (interworking_test_sel(&wpa_s, realm_bss, &cred[1], 0) < 0)
+		goto fail;
+	cred[1].priority = 1;
+
+	/* Roaming Consortium match is preferred over realm on a tie */
+	realm_bss->anqp->roaming_consortium = wpabuf_alloc(4);
+	if (realm_bss->anqp->roaming_consortium == NULL)
+		goto fail;
+	wpabuf_put_u8(realm_bss->anqp->roaming_consortium, 3);
+	wpabuf_put_data(realm_bss->anqp->roaming_consortium, "\x50\x6f\x9a",
+			3);
+	if (interworking_test_sel(&wpa_s, realm_bss, &cred[2], 0) < 0)
+		goto fail;
+	cred[0].priority = 2;
+	if (interworking_test_sel(&wpa_s, realm_bss, &cred[0], 0) < 0)
+		goto fail;
+	cred[0].priority = 1;
+	wpabuf_free(realm_bss->anqp->roaming_consortium);
+	realm_bss->anqp->roaming_consortium = NULL;
+
+	/* Required Roaming Consortium OI filters out a realm match */
+	cred[0].required_roaming_consortium[0] = 0x11;
+	cred[0].required_roaming_consortium_len = 3;
+	if (interworking_test_sel(&wpa_s, realm_bss, &cred[1], 0) < 0)
+		goto fail;
+	cred[0].required_roaming_consortium_len = 0;
+
+	/* Excluded credential is used only if nothing else matches */
+	ex[0].ssid_len = realm_bss->ssid_len;
+	os_memcpy(ex[0].ssid, realm_bss->ssid, realm_bss->ssid_len);
+	cred[0].excluded_ssid = &ex[0];
+	cred[0].num_excluded_ssid = 1;
+	if (interworking_test_sel(&wpa_s, realm_bss, &cred[1], 0) < 0)
+		goto fail;
+	ex[1] = ex[0];
+	cred[1].excluded_ssid = &ex[1];
+	cred[1].num_excluded_ssid = 1;
+	if (interworking_test_sel(&wpa_s, realm_bss, &cred[0], 1) < 0)
+		goto fail;
+	cred[0].excluded_ssid = NULL;
+	cred[1].excluded_ssid = NULL;
+
+	/* 3GPP match needs Milenage parameters or external SIM */
+	if (interworking_test_sel(&wpa_s, plmn_bss, &cred[3], 0) < 0)
+		goto fail;
+	cred[3].milenage = NULL;
+	if (interworking_test_sel(&wpa_s, plmn_bss, NULL, 0) < 0)
+		goto fail;
+	conf.external_sim = 1;
+	if (interworking_test_sel(&wpa_s, plmn_bss, &cred[3], 0) < 0)
+		goto fail;
+
+	ret = 0;
+fail:
+	interworking_cred_changed(&wpa_s);
+	interworking_test_bss_free(realm_bss);
+	interworking_test_bss_free(plmn_bss);
+	interworking_test_bss_free(tls_bss);
+
+	if (ret)
+		wpa_printf(MSG_ERROR, "interworking module test failure");
+
+	return ret;
+}
+
+#endif /* CONFIG_INTERWORKING */
+
+
 int wpas_module_tests(void)
 {
 	int ret = 0;
@@ -78,6 +802,24 @@ int wpas_module_tests(void)
 	if (wpas_blacklist_module_tests() < 0)
 		ret = -1;
 
+	if (wpas_radio_work_module_tests() < 0)
+		ret = -1;
+
+#ifdef CONFIG_SCAN_PLAN
+	if (wpas_scan_plan_module_tests() < 0)
+		ret = -1;
+#endif /* CONFIG_SCAN_PLAN */
+
+#ifdef CONFIG_ROAM_CAND
+	if (wpas_roam_cand_module_tests() < 0)
+		ret = -1;
+#endif /* CONFIG_ROAM_CAND */
+
+#ifdef CONFIG_INTERWORKING
+	if (wpas_interworking_module_tests() < 0)
+		ret = -1;
+#endif /* CONFIG_INTERWORKING */
+
 #ifdef CONFIG_WPS
 	{
 		int wps_module_tests(void);